@@ -27,16 +27,29 @@ static void cli_write(const char* string, void* userdata) {
     printf("%s", string);
 }
 
-static void hello_command(size_t argc, const CliArgument* argv, void* userdata) {
+static void hello_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* userdata
+) {
     (void)argc;
     (void)userdata;
     (void)userdata;
 
     const char* name = argv[0].string;
-    printf("Hello, %s\n", name);
+    libcli_write(header, "Hello, ");
+    libcli_write(header, name);
+    libcli_write(header, "\n");
 }
 
-static void add_command(size_t argc, const CliArgument* argv, void* userdata) {
+static void add_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* userdata
+) {
+    (void)header;
     (void)argc;
     (void)userdata;
     (void)userdata;
@@ -47,13 +60,19 @@ static void add_command(size_t argc, const CliArgument* argv, void* userdata) {
 }
 
 static CliHeader setup_cli(CliCommand* commands, size_t commands_size) {
+    static char pipe_buffer[512];
+
     CliNewInfo cli_info = {
         .commands = commands,
         .commands_size = commands_size,
         .writeback = cli_write,
         .writeback_data = NULL,
+        .pipe_buffer = pipe_buffer,
+        .pipe_buffer_size = sizeof(pipe_buffer),
+        .parse_float = libcli_parse_float,
     };
     CliHeader cli = libcli_new(&cli_info);
+    libcli_add_filters(&cli);
 
     CliArgumentType hello_args[] = { cli_argument_type_string };
     libcli_add(&cli, "hello", "Say hello to something", 1, hello_args, hello_command);
@@ -102,6 +121,9 @@ int main(void) {
         case cli_run_result_unknown:
             printf("error: unknown command\n");
             break;
+        case cli_run_result_bad_pipe:
+            printf("error: invalid pipeline\n");
+            break;
         default:
             break;
         }
@@ -3,32 +3,104 @@
 
 #include <stddef.h>
 #include <stdbool.h>
+#include <stdint.h>
+
+// Number of fractional bits of `cli_argument_type_fixed` arguments, eg. 16 for Q15.16. Set with
+// the FIXED_FRACTION_BITS CMake option.
+#ifndef LIBCLI_FIXED_FRACTION_BITS
+#define LIBCLI_FIXED_FRACTION_BITS 16
+#endif
 
 enum {
     cli_max_argument_count = 4,
+    cli_fixed_fraction_bits = LIBCLI_FIXED_FRACTION_BITS,
 };
 
+_Static_assert(
+    (LIBCLI_FIXED_FRACTION_BITS >= 0) && (LIBCLI_FIXED_FRACTION_BITS <= 31),
+    "fixed-point arguments must have between 0 and 31 fractional bits"
+);
+
 typedef enum CliArgumentType {
     cli_argument_type_string,
     cli_argument_type_int,
     cli_argument_type_float,
+
+    // A decimal number stored as a signed 32-bit fixed-point value with
+    // `cli_fixed_fraction_bits` fractional bits, rounded to the nearest step (halves away from
+    // zero)
+    cli_argument_type_fixed,
+
+    // Bytes given as hex (eg. "00ff10"), or as base64 after a "b64:" prefix (eg. "b64:AP8Q"). They
+    // are decoded in place in the input buffer, and are only valid until it is reused.
+    cli_argument_type_blob,
+
+    // Lists of elements separated by commas or spaces (eg. "0x10,0x0,255" or, quoted, "1 2 3"),
+    // stored in the `array_buffer` given in `CliNewInfo`. Integer elements are decimal or "0x"
+    // hex. Float elements are converted with the header's float parser.
+    cli_argument_type_int_array,
+    cli_argument_type_u8_array,
+    cli_argument_type_float_array,
 } CliArgumentType;
 
+typedef struct CliBlob {
+    const uint8_t* data;
+    size_t size;
+} CliBlob;
+
+// The elements of an array argument, read through the member matching its type. They are only
+// valid until the header's array buffer is reused by the next run.
+typedef struct CliArray {
+    union {
+        const void* data;
+        const int* integers;
+        const uint8_t* bytes;
+        const float* floats;
+    };
+    size_t count;
+} CliArray;
+
 typedef struct CliArgument {
     CliArgumentType type;
     union {
         const char* string;
         int integer;
         float float_;
+        int32_t fixed;
+        CliBlob blob;
+        CliArray array;
     };
 } CliArgument;
 
-// A function belonging to a command.
-typedef void (*CliCommandFunction)(size_t, const CliArgument*, void*);
+typedef struct CliHeader CliHeader;
+typedef struct CliTiming CliTiming;
+typedef struct CliRunError CliRunError;
+typedef struct CliRecorder CliRecorder;
+typedef struct CliContextStack CliContextStack;
+typedef struct CliOptionTable CliOptionTable;
+typedef struct CliOptions CliOptions;
+typedef struct CliSharedCommands CliSharedCommands;
+typedef struct CliConstraint CliConstraint;
+typedef struct CliCache CliCache;
+typedef struct CliJobs CliJobs;
+
+// A function belonging to a command. Output should be written with `libcli_write` on the given
+// header, so that it reaches whichever output the command is being run for.
+typedef void (*CliCommandFunction)(const CliHeader*, size_t, const CliArgument*, void*);
 
 // Type of a function called when the CLI needs to write a string back to the user.
 typedef void (*CliWritebackFunction)(const char*, void*);
 
+// Type of a function returning the current time in ticks (eg. a cycle counter or timer count).
+typedef uint32_t (*CliTimestampFunction)(void);
+
+// Type of a function converting text to a float. Returns false if the text is not a valid number.
+typedef bool (*CliParseFloatFunction)(const char*, float*);
+
+// Type of a function which finds the real function of a lazily bound command (a command added with
+// a NULL function) the first time it runs. Returns NULL if the function could not be found.
+typedef CliCommandFunction (*CliResolveFunction)(const char* name, void* data);
+
 // A command registered by the CLI. All fields are private and must not be modified manually.
 typedef struct CliCommand {
     const char* name;
@@ -36,18 +108,56 @@ typedef struct CliCommand {
     CliCommandFunction function;
     size_t argument_count;
     CliArgumentType arguments[cli_max_argument_count];
+    const CliOptionTable* options;
+    const CliConstraint* constraints;
+    size_t constraint_count;
+    bool cacheable;
 } CliCommand;
 
+// An entry of the keyword index searched by `help -s <word>`: the hash of a word of a command's
+// name or summary. All fields are private and must not be modified manually.
+typedef struct CliKeyword {
+    uint32_t hash;
+    const char* name;
+} CliKeyword;
+
 // Contains all information used by the CLI. All fields are private and must not be modified
 // manually.
-typedef struct CliHeader {
+struct CliHeader {
     size_t capacity;
     size_t count;
     CliCommand* commands;
     CliWritebackFunction writeback;
     void* writeback_data;
     size_t longest_command_name_length;
-} CliHeader;
+    char* pipe_buffer;
+    size_t pipe_buffer_size;
+    char* pipe_input;
+    uint32_t fingerprint;
+    CliTimestampFunction timestamp;
+    CliTiming* timing;
+    bool validate_utf8;
+    CliRunError* error;
+    const unsigned char* summary_blob;
+    size_t summary_blob_size;
+    CliResolveFunction resolve;
+    void* resolve_data;
+    CliRecorder* recorder;
+    CliParseFloatFunction parse_float;
+    CliKeyword* keywords;
+    size_t keyword_capacity;
+    size_t keyword_count;
+    bool keywords_complete;
+    CliContextStack* contexts;
+    const CliOptions* options;
+    CliSharedCommands* shared;
+    bool read_only;
+    void* array_buffer;
+    size_t array_buffer_size;
+    CliCache* cache;
+    CliJobs* jobs;
+    bool transient_output;
+};
 
 // The result of a `libcli_run` call.
 typedef enum CliRunResult {
@@ -71,8 +181,54 @@ typedef enum CliRunResult {
 
     // One or more arguments were invalid or not formatted correctly
     cli_run_result_bad_argument,
+
+    // A pipeline had an empty stage, or no pipe buffer was provided to run it in. Also returned
+    // by `every` and `watch` (see `cli_jobs.h`) in a pipeline or a shared-memory channel request,
+    // whose output does not outlive the line.
+    cli_run_result_bad_pipe,
+
+    // A caller-provided buffer was too small to hold the result
+    cli_run_result_no_space,
+
+    // A compiled macro or recorded trace was corrupt, or a macro was compiled for a different set
+    // of commands
+    cli_run_result_bad_macro,
+
+    // The input was not valid UTF-8 (only checked if `validate_utf8` is set)
+    cli_run_result_invalid_utf8,
+
+    // A lazily bound command's function could not be resolved, or a module manifest was invalid
+    cli_run_result_bad_module,
+
+    // A word of the input was not an option of the command, or an option's value was missing or
+    // invalid (see `cli_options.h`)
+    cli_run_result_bad_option,
+
+    // An argument did not pass one of the command's constraints (see `cli_constraints.h`)
+    cli_run_result_failed_constraint,
 } CliRunResult;
 
+// Details of a failed `libcli_run_with_error` call.
+struct CliRunError {
+    // For `cli_run_result_invalid_utf8`, the byte offset in the input of the invalid sequence. For
+    // a `cli_run_result_bad_argument` blob, the offset in the argument of the invalid digit, and
+    // for an array, the offset in the argument of the element in error.
+    size_t offset;
+
+    // For `cli_run_result_bad_argument`, the index of the argument which could not be converted.
+    // For `cli_run_result_bad_option`, the index of the word (after the command name) in error.
+    // For `cli_run_result_failed_constraint`, the index of the argument which failed.
+    size_t argument;
+
+    // For `cli_run_result_failed_constraint`, the index of the constraint which failed in the
+    // command's constraints.
+    size_t constraint;
+
+    // For a `cli_run_result_bad_argument` array, the index of the element which was not valid or
+    // did not fit in the array buffer.
+    size_t element;
+};
+
 // Information required to create a new CLI. All field are public and must be written to before
 // calling `libcli_new`.
 typedef struct CliNewInfo {
@@ -87,13 +243,75 @@ typedef struct CliNewInfo {
 
     // Additional data passed to `writeback` calls.
     void* writeback_data;
+
+    // Optional buffer which holds the output of each pipeline stage (`a | b`) for the next stage.
+    // It is split in half, and a stage's output is truncated to fit in one half. If NULL,
+    // pipelines are rejected with `cli_run_result_bad_pipe`.
+    char* pipe_buffer;
+
+    // The size of `pipe_buffer` in bytes.
+    size_t pipe_buffer_size;
+
+    // Optional function returning the current time in ticks. If set, the built-in `time <command>`
+    // and `repeat <count> <command>` commands are added, which measure the latency of a command.
+    CliTimestampFunction timestamp;
+
+    // If true, input is checked to be valid UTF-8 while it is tokenized. Invalid input is rejected
+    // with `cli_run_result_invalid_utf8` before any command runs.
+    bool validate_utf8;
+
+    // Optional blob of compressed summaries generated by the host-side `compress_summaries` tool.
+    // Summaries which point into the blob are decompressed as the help command writes them.
+    const unsigned char* summary_blob;
+
+    // The size of `summary_blob` in bytes.
+    size_t summary_blob_size;
+
+    // Optional recorder (see `cli_record.h`) which logs every line run by `libcli_run`.
+    CliRecorder* recorder;
+
+    // The function which converts `cli_argument_type_float` arguments, usually
+    // `libcli_parse_float`. If NULL, commands with float arguments cannot be added, and the float
+    // parser (with `strtof` and any soft-float support) is not linked in.
+    CliParseFloatFunction parse_float;
+
+    // Optional buffer for the keyword index searched by `help -s <word>`, which takes one entry
+    // for each distinct word (of three or more letters and digits) of each command's name and
+    // summary. If NULL, or once it is full, searches scan every summary instead.
+    CliKeyword* keywords;
+
+    // The maximum number of elements in `keywords`.
+    size_t keywords_size;
+
+    // Optional stack of entered command contexts (see `cli_context.h`). If NULL, only the global
+    // commands can be run. Servers give each session its own stack instead.
+    CliContextStack* contexts;
+
+    // Optional buffer which the elements of array arguments are stored in, shared by all the
+    // arrays of a line (like `pipe_buffer`, by every run of the header). If NULL, commands with
+    // array arguments cannot be added.
+    void* array_buffer;
+
+    // The size of `array_buffer` in bytes.
+    size_t array_buffer_size;
+
+    // Optional cache (see `cli_cache.h`) which serves repeated lines of cacheable commands from
+    // their captured output. If NULL, every line runs its command.
+    CliCache* cache;
+
+    // Optional periodic jobs (see `cli_jobs.h`). If set, the built-in
+    // `every <period> <command...>`, `watch <period> <command...>`, `jobs` and `cancel <id>`
+    // commands are added.
+    CliJobs* jobs;
 } CliNewInfo;
 
 // Initialize a new `CliHeader` with the given command buffer and capacity.
 CliHeader libcli_new(const CliNewInfo* info);
 
 // Add a new command `name` (calling `function`) to the header. Returns true if the command was
-// added. Returns false if the command was not added (if the command buffer is full).
+// added. Returns false if the command was not added (if the command buffer is full, or it has float
+// arguments and no float parser was given). If `function` is NULL, it is bound through the
+// header's resolve function the first time the command runs.
 bool libcli_add(
     CliHeader* header,
     const char* name,
@@ -103,9 +321,71 @@ bool libcli_add(
     CliCommandFunction function
 );
 
+// Information describing a command for `libcli_add_command`. All fields are public and must be
+// written to before calling `libcli_add_command`. Optional fields may be left zeroed.
+typedef struct CliCommandInfo {
+    // The name of the command.
+    const char* name;
+
+    // The summary shown by `help`.
+    const char* summary;
+
+    // The number of positional arguments, and their types.
+    size_t argument_count;
+    const CliArgumentType* arguments;
+
+    // Optional named options (see `cli_options.h`).
+    const CliOptionTable* options;
+
+    // Optional checks of the positional arguments (see `cli_constraints.h`). The array must
+    // outlive the header.
+    const CliConstraint* constraints;
+
+    // The number of elements in `constraints`.
+    size_t constraint_count;
+
+    // The function called to run the command, or NULL to bind it lazily (see `libcli_add`).
+    CliCommandFunction function;
+
+    // If true, the output of each run may be served again from the header's cache (see
+    // `cli_cache.h`) without calling `function`. Only set it for commands whose output depends on
+    // nothing but their arguments and state which invalidates the cache when it changes.
+    bool cacheable;
+} CliCommandInfo;
+
+// Add the command described by `info` to the header. Returns false if the command was not added
+// (for the same reasons as `libcli_add`, or if a constraint does not fit its argument's type).
+bool libcli_add_command(CliHeader* header, const CliCommandInfo* info);
+
+// Remove the command called `name` from the header. Returns false if there is no such command.
+bool libcli_remove(CliHeader* header, const char* name);
+
 // Parse and execute `input` using the given CLI (`header`). This parses in-place and destroys the
 // original string pointed to by `input`. Do _not_ pass immutable data or re-use `input` after this
 // call.
 CliRunResult libcli_run(const CliHeader* header, char* input, void* userdata);
 
+// Like `libcli_run`, but if the input is rejected, details of why are written to `error`.
+CliRunResult libcli_run_with_error(
+    const CliHeader* header,
+    char* input,
+    void* userdata,
+    CliRunError* error
+);
+
+// Write `string` back to the user through the header's writeback function.
+void libcli_write(const CliHeader* header, const char* string);
+
+// The output of the previous pipeline stage, if the command being run with `header` is not the
+// first stage of a pipeline. Otherwise NULL. The text may be modified in-place by the command.
+char* libcli_pipe_input(const CliHeader* header);
+
+// Convert `string` to a float with `strtof`. Pass as `CliNewInfo.parse_float` to use float
+// arguments.
+bool libcli_parse_float(const char* string, float* out);
+
+// Add the built-in pipeline filters: `grep <text>` (lines containing text), `head <count>` (first
+// lines) and `count` (number of lines). Returns false if any could not be added.
+bool libcli_add_filters(CliHeader* header);
+
 #endif // LIBCLI_CLI_H
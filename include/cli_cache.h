@@ -0,0 +1,81 @@
+#ifndef LIBCLI_CLI_CACHE_H
+#define LIBCLI_CLI_CACHE_H
+
+//
+// libCLI Output Cache
+//
+// Memoizes the output of read-only query commands (eg. `status` or `show config`), which are
+// marked `cacheable` when added with `libcli_add_command`. The first run of a line writes its
+// output as usual, and also captures it in an entry of a fixed-size `CliCache`. Repeated runs of
+// the same line (compared word by word after tokenizing, so spacing and quoting do not matter) are
+// served from the entry without calling the command.
+//
+// Entries are invalidated all at once by `libcli_cache_invalidate`, eg. when the state a query
+// reports changes, and each expires after an optional time to live measured with a clock
+// function. When the cache is full, the least recently used entry is replaced.
+//
+// Pipelines are not cached, and neither are runs which fail or whose output does not fit in an
+// entry. Like the pipe buffer, a cache must not be used by several runs at once.
+//
+
+#include "cli.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+enum {
+    // Maximum size of a cached line's words, including a terminator after each.
+    cli_cache_key_size = 64,
+
+    // Maximum size of a cached output, including its terminator.
+    cli_cache_output_size = 512,
+};
+
+// A cached output. All fields are private and must not be modified manually.
+typedef struct CliCacheEntry {
+    bool valid;
+    bool filling;
+    uint32_t hash;
+    uint32_t generation;
+    uint32_t stored_at;
+    uint32_t last_used;
+    CliCommandFunction function;
+    size_t key_length;
+    size_t output_length;
+    char key[cli_cache_key_size];
+    char output[cli_cache_output_size];
+} CliCacheEntry;
+
+// An output cache. All fields are private and must not be modified manually.
+typedef struct CliCache {
+    CliCacheEntry* entries;
+    size_t capacity;
+    uint32_t generation;
+    uint32_t uses;
+    CliTimestampFunction clock;
+    uint32_t time_to_live;
+    size_t hits;
+    size_t misses;
+} CliCache;
+
+// Create a cache storing up to `capacity` outputs in `entries`. If `clock` is not NULL, entries
+// expire `time_to_live` ticks of it after their command began running. Otherwise, they last until
+// they are replaced or invalidated. Give the cache to `libcli_new` in `CliNewInfo.cache`.
+CliCache libcli_cache_new(
+    CliCacheEntry* entries,
+    size_t capacity,
+    CliTimestampFunction clock,
+    uint32_t time_to_live
+);
+
+// Invalidate every entry, so the next run of each line calls its command again.
+void libcli_cache_invalidate(CliCache* cache);
+
+// Number of runs served from the cache.
+size_t libcli_cache_hits(const CliCache* cache);
+
+// Number of runs of cacheable commands which called the command.
+size_t libcli_cache_misses(const CliCache* cache);
+
+#endif // LIBCLI_CLI_CACHE_H
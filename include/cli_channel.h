@@ -0,0 +1,149 @@
+#ifndef LIBCLI_CLI_CHANNEL_H
+#define LIBCLI_CLI_CHANNEL_H
+
+//
+// libCLI Shared-Memory Command Channel (Linux only)
+//
+// A transport for local clients which run commands at a high rate, without the system calls and
+// copies of a socket. A `CliChannelRegion` is placed in memory shared by the server and one client
+// process (eg. a `memfd_create` or `shm_open` mapping). It holds a ring of request slots, each with
+// room for its response. The client writes a command line, or a macro compiled with
+// `libcli_compile` (see `cli_macro.h`), into the next free slot. The server runs a copy of it, so
+// the client cannot change a request while it runs, and command output is written straight into
+// the slot's response.
+//
+// Requests and responses are counted with two free-running counters, so the client can submit
+// several requests before reading any response. Each side only sleeps (on a futex) when the other
+// has nothing for it, and is only woken (by the other side) when it is actually asleep.
+//
+// A channel has a single client. Serve several clients with one region each.
+//
+
+#include "cli.h"
+#include "cli_context.h"
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+enum {
+    // Number of request slots in a region.
+    cli_channel_slot_count = 16,
+
+    // Maximum size of a request, including the terminator of a line.
+    cli_channel_request_size = 256,
+
+    // Size of the response of each slot. Output which does not fit is dropped and counted.
+    cli_channel_response_size = 1024,
+};
+
+typedef enum CliChannelFrame {
+    // A command line, run with `libcli_run`.
+    cli_channel_frame_line,
+
+    // A compiled macro, run with `libcli_replay`.
+    cli_channel_frame_macro,
+} CliChannelFrame;
+
+// A request and its response. All fields are private and must not be modified manually.
+typedef struct CliChannelSlot {
+    uint32_t frame;
+    uint32_t request_size;
+    int32_t result;
+    uint32_t response_size;
+    uint32_t response_dropped;
+    char request[cli_channel_request_size];
+    char response[cli_channel_response_size];
+} CliChannelSlot;
+
+// The shared part of a channel. It holds no pointers, so it may be mapped at different addresses
+// in each process. All fields are private and must not be modified manually.
+typedef struct CliChannelRegion {
+    uint32_t magic;
+
+    // Free-running request counts. `submitted` is only written by the client, `completed` by the
+    // server. Both are also futex words.
+    _Atomic uint32_t submitted;
+    _Atomic uint32_t completed;
+
+    // Set by a side while it sleeps, so the other side only makes a system call to wake it then.
+    _Atomic uint32_t server_sleeping;
+    _Atomic uint32_t client_sleeping;
+
+    CliChannelSlot slots[cli_channel_slot_count];
+} CliChannelRegion;
+
+// The server's side of a channel. All fields are private and must not be modified manually.
+typedef struct CliChannel {
+    CliChannelRegion* region;
+
+    // Number of requests run. The region's copy is only published for the client, since the
+    // client can write to the whole region.
+    uint32_t completed;
+
+    // The stack of contexts entered by the client's commands.
+    CliContextStack contexts;
+} CliChannel;
+
+// The client's side of a channel. All fields are private and must not be modified manually.
+typedef struct CliChannelClient {
+    CliChannelRegion* region;
+
+    // Number of responses read, which frees their slots.
+    uint32_t received;
+} CliChannelClient;
+
+// A response read by `libcli_channel_receive`. The output is in shared memory, and is valid until
+// the client next calls `libcli_channel_submit`, `libcli_channel_submit_macro` or
+// `libcli_channel_receive`.
+typedef struct CliChannelResponse {
+    // The result of running the request.
+    CliRunResult result;
+
+    // The request's output, which is not null-terminated.
+    const char* output;
+    size_t output_size;
+
+    // The number of bytes of output which did not fit in the response.
+    size_t output_dropped;
+} CliChannelResponse;
+
+// Prepare a newly mapped region for use. Called once, by the process which created the region,
+// before either side uses it.
+void libcli_channel_init(CliChannelRegion* region);
+
+// Create the server's side of the channel in `region`.
+CliChannel libcli_channel_new(CliChannelRegion* region);
+
+// Wait up to `timeout_ms` milliseconds (or forever if negative) for requests, then run every
+// submitted request against `header`. Returns the number of requests run.
+size_t libcli_channel_serve(
+    const CliHeader* header,
+    CliChannel* channel,
+    int timeout_ms,
+    void* userdata
+);
+
+// Create the client's side of the channel in `region`. Returns false if the region was not
+// initialized with `libcli_channel_init`.
+bool libcli_channel_connect(CliChannelClient* client, CliChannelRegion* region);
+
+// Write `line` into the next free slot and wake the server. Returns false if every slot holds a
+// response which was not received yet, or the line does not fit in a request.
+bool libcli_channel_submit(CliChannelClient* client, const char* line);
+
+// Like `libcli_channel_submit`, for a macro of `size` bytes compiled with `libcli_compile` against
+// the server's commands.
+bool libcli_channel_submit_macro(CliChannelClient* client, const uint8_t* macro, size_t size);
+
+// Wait up to `timeout_ms` milliseconds (or forever if negative) for the response to the oldest
+// request which was not received yet. Returns false if there is no such request, or it did not
+// complete in time.
+bool libcli_channel_receive(
+    CliChannelClient* client,
+    int timeout_ms,
+    CliChannelResponse* response
+);
+
+#endif // LIBCLI_CLI_CHANNEL_H
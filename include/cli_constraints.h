@@ -0,0 +1,85 @@
+#ifndef LIBCLI_CLI_CONSTRAINTS_H
+#define LIBCLI_CLI_CONSTRAINTS_H
+
+//
+// libCLI Argument Constraints
+//
+// Checks declared with a command (see `CliCommandInfo`), which each positional argument must pass
+// as soon as it is converted, before the command runs. A failed check rejects the line with
+// `cli_run_result_failed_constraint`, and `libcli_run_with_error` reports the index of the
+// argument and of the constraint which failed. `libcli_write_constraint` describes a constraint,
+// eg. for an error message.
+//
+
+#include "cli.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Type of a function checking a converted argument. Returns false if it is not valid.
+typedef bool (*CliConstraintFunction)(const CliArgument* argument, const void* data);
+
+typedef enum CliConstraintKind {
+    // An int, fixed or float argument between `range.min` and `range.max` inclusive. For fixed
+    // arguments, the bounds are fixed-point values.
+    cli_constraint_range,
+
+    // A string with a length, a blob with a size, or an array with a number of elements, between
+    // `length.min` and `length.max` inclusive.
+    cli_constraint_length,
+
+    // A string made only of the characters of `charset`, where `a-z` is a range of characters
+    // (a '-' at the start or end is itself allowed), eg. "a-zA-Z0-9_-".
+    cli_constraint_charset,
+
+    // A string equal to one of the `one_of.count` strings of `one_of.values`.
+    cli_constraint_one_of,
+
+    // Any argument for which `predicate.function` returns true.
+    cli_constraint_predicate,
+} CliConstraintKind;
+
+// A check of one positional argument. All fields are public and must be written to before adding
+// the command. A command may have several constraints on the same argument, checked in order.
+typedef struct CliConstraint {
+    // The index of the positional argument to check.
+    size_t argument;
+
+    CliConstraintKind kind;
+
+    union {
+        struct {
+            int32_t min;
+            int32_t max;
+        } range;
+
+        struct {
+            size_t min;
+            size_t max;
+        } length;
+
+        const char* charset;
+
+        struct {
+            const char* const* values;
+            size_t count;
+        } one_of;
+
+        struct {
+            CliConstraintFunction function;
+            const void* data;
+        } predicate;
+    };
+} CliConstraint;
+
+// Write a description of what the constraint allows, eg. "between 1 and 10" or "one of: on, off".
+// `type` is the type of the argument it checks, so the bounds of a range on a fixed argument are
+// written as decimals (eg. "between 0.5 and 2.25").
+void libcli_write_constraint(
+    const CliHeader* header,
+    const CliConstraint* constraint,
+    CliArgumentType type
+);
+
+#endif // LIBCLI_CLI_CONSTRAINTS_H
@@ -0,0 +1,92 @@
+#ifndef LIBCLI_CLI_CONTEXT_H
+#define LIBCLI_CLI_CONTEXT_H
+
+//
+// libCLI Command Contexts
+//
+// Router-style modes (eg. `configure`, `interface eth0`), each with its own prebuilt table of
+// commands. A session enters and leaves modes on a `CliContextStack` given in `CliNewInfo`, which
+// only pushes or pops a pointer, so the header's commands are never re-registered.
+//
+// Commands are looked up in the active contexts from the innermost outwards, and then in the
+// header's global commands, so global commands are visible in every mode and a context command
+// hides a global command of the same name.
+//
+
+#include "cli.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+
+enum {
+    // Maximum number of contexts which can be entered at once
+    cli_max_context_depth = 8,
+};
+
+// A table of commands for one mode. All fields are private and must not be modified manually.
+typedef struct CliContext {
+    const char* prompt;
+    size_t capacity;
+    size_t count;
+    CliCommand* commands;
+    size_t longest_command_name_length;
+} CliContext;
+
+// An entered context and the data it was entered with.
+typedef struct CliContextEntry {
+    const CliContext* context;
+    void* data;
+} CliContextEntry;
+
+// The contexts a session has entered. All fields are private and must not be modified manually.
+struct CliContextStack {
+    size_t depth;
+    CliContextEntry entries[cli_max_context_depth];
+};
+
+// Initialize a new context called `prompt` (eg. "config") with the given command buffer.
+CliContext libcli_context_new(const char* prompt, CliCommand* commands, size_t commands_size);
+
+// Add a new command to a context. Returns false if the command was not added (for the same reasons
+// as `libcli_add`, or if `function` is NULL, as context commands cannot be lazily bound). The
+// header is the CLI the context will be used with.
+bool libcli_context_add(
+    const CliHeader* header,
+    CliContext* context,
+    const char* name,
+    const char* summary,
+    size_t argument_count,
+    const CliArgumentType* arguments,
+    CliCommandFunction function
+);
+
+// Add the command described by `info` to a context, with options, constraints and caching like
+// `libcli_add_command`. Returns false if the command was not added (for the same reasons as
+// `libcli_context_add`, or if a constraint does not fit its argument's type).
+bool libcli_context_add_command(
+    const CliHeader* header,
+    CliContext* context,
+    const CliCommandInfo* info
+);
+
+// Initialize an empty context stack, for `CliNewInfo.contexts`.
+CliContextStack libcli_context_stack_new(void);
+
+// Enter `context` on top of the header's context stack, eg. from a command's function. `data` is
+// returned by `libcli_context_data` while the context is innermost. Returns false if the header
+// has no context stack or it is full.
+bool libcli_enter_context(const CliHeader* header, const CliContext* context, void* data);
+
+// Leave the innermost context. Returns false if no context was entered.
+bool libcli_exit_context(const CliHeader* header);
+
+// Leave every context, returning to the global commands.
+void libcli_exit_all_contexts(const CliHeader* header);
+
+// The prompt of the innermost context, or NULL if no context was entered.
+const char* libcli_context_prompt(const CliHeader* header);
+
+// The data the innermost context was entered with, or NULL if no context was entered.
+void* libcli_context_data(const CliHeader* header);
+
+#endif // LIBCLI_CLI_CONTEXT_H
@@ -0,0 +1,44 @@
+#ifndef LIBCLI_CLI_FORMAT_H
+#define LIBCLI_CLI_FORMAT_H
+
+//
+// libCLI Formatted Output
+//
+// Allocation-free formatting for command handlers, written to the header's output (the writeback,
+// or the pipe buffer of a pipeline stage) through a small buffer on the stack, so handlers need
+// neither `snprintf` nor their own temporary buffers. Integers are formatted two decimal digits at
+// a time with a lookup table.
+//
+
+#include "cli.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum {
+    // Size of the buffer output is collected in before it is written. Longer output is written in
+    // pieces of this size (less the terminator).
+    cli_format_buffer_size = 64,
+
+    // Maximum number of decimal places of `libcli_put_fixed`
+    cli_format_max_decimals = 9,
+};
+
+// Write formatted output, like `printf`. The conversions `d`, `i`, `u`, `x`, `X`, `c`, `s` and `%`
+// are supported, with the `l`, `ll` and `z` length modifiers, a field width, and the `-` and `0`
+// flags. Anything else is written as it is. A null character given to `c` is left out, since
+// output is null-terminated.
+void libcli_printf(const CliHeader* header, const char* format, ...);
+
+// Write `value` in decimal.
+void libcli_put_u32(const CliHeader* header, uint32_t value);
+void libcli_put_i32(const CliHeader* header, int32_t value);
+
+// Write `value` as `digits` lowercase hex digits (1 to 8, with leading zeros), without a prefix.
+void libcli_put_hex(const CliHeader* header, uint32_t value, size_t digits);
+
+// Write a `cli_argument_type_fixed` value in decimal with `decimals` places (at most
+// `cli_format_max_decimals`), rounded to the nearest with halves away from zero.
+void libcli_put_fixed(const CliHeader* header, int32_t value, size_t decimals);
+
+#endif // LIBCLI_CLI_FORMAT_H
@@ -0,0 +1,137 @@
+#ifndef LIBCLI_CLI_JOBS_H
+#define LIBCLI_CLI_JOBS_H
+
+//
+// libCLI Periodic Jobs
+//
+// Runs commands again and again at a fixed period, without sending or parsing them each time.
+// Given jobs in `CliNewInfo.jobs`, the header gets the built-in commands:
+//
+//   every <period> <command...>   runs the command in the background
+//   watch <period> <command...>   runs the command, writing its output to where `watch` was run
+//   jobs                          lists the jobs, how often they ran and how late
+//   cancel <id>                   stops a job
+//
+// Periods are given in ticks of the jobs' clock (eg. "250"), or in milliseconds or seconds (eg.
+// "100ms" or "2s"). The command is looked up and its arguments converted once, when the job is
+// created (like compiled macros, commands with options run with their defaults), and each run
+// calls its function directly.
+//
+// Jobs wait in a hierarchical timer wheel: four levels of 64 slots, each slot of a level covering a
+// whole turn of the level below it. Adding, cancelling and running a job take constant time, and
+// `libcli_jobs_service` (called from the main loop) only looks at the slots of the ticks which
+// have passed. Periods must be shorter than `cli_job_max_period` ticks.
+//
+// A job runs at most once per service call. If the loop falls behind by a whole period or more,
+// the runs which were missed are skipped and counted, and the job keeps its phase. How late each
+// run is (the jitter of the loop) is recorded in the job's `CliJobStats`.
+//
+// Jobs keep a copy of their command, so cancel a command's jobs before removing it, and cancel the
+// watches of an output (eg. a server session) before it closes. Jobs cannot be started by a
+// pipeline stage or a shared-memory channel request, whose output only lasts for the line.
+//
+
+#include "cli.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+enum {
+    cli_wheel_level_count = 4,
+    cli_wheel_slot_bits = 6,
+    cli_wheel_slot_count = 1 << cli_wheel_slot_bits,
+
+    // Periods, in ticks, must be less than this
+    cli_job_max_period = 1 << (cli_wheel_level_count * cli_wheel_slot_bits),
+
+    // Maximum size of a job's command words, including a terminator after each
+    cli_job_text_size = 64,
+
+    // Maximum size of the elements of a job's array arguments
+    cli_job_array_size = 64,
+
+    // Marks the end of a list of jobs in the wheel
+    cli_job_none = UINT16_MAX,
+};
+
+// How often a job ran, and how late. Times are in ticks of the jobs' clock.
+typedef struct CliJobStats {
+    // Runs made, and runs skipped because the loop fell a whole period behind
+    uint32_t runs;
+    uint32_t missed;
+
+    // How long after it was due each run began
+    uint32_t last_late;
+    uint32_t max_late;
+    uint64_t total_late;
+} CliJobStats;
+
+// A periodic job. All fields are private and must not be modified manually.
+typedef struct CliJob {
+    // Zero if the job is not in use
+    uint32_t id;
+    uint32_t period;
+    uint32_t due;
+
+    // The wheel list the job is in (`cli_job_none` while it runs), and its neighbours there
+    uint16_t bucket;
+    uint16_t next;
+    uint16_t previous;
+
+    // For watches, where the output goes. Otherwise NULL.
+    CliWritebackFunction writeback;
+    void* writeback_data;
+
+    CliCommand command;
+    size_t argc;
+    CliArgument argv[cli_max_argument_count];
+    CliJobStats stats;
+
+    // The command's words as given, and the copy its arguments were converted from
+    char text[cli_job_text_size];
+    char argument_text[cli_job_text_size];
+    _Alignas(4) uint8_t elements[cli_job_array_size];
+} CliJob;
+
+// A set of periodic jobs. All fields are private and must not be modified manually.
+typedef struct CliJobs {
+    CliJob* jobs;
+    size_t capacity;
+    CliTimestampFunction clock;
+    uint32_t ticks_per_second;
+
+    // The last tick the wheel has turned to
+    uint32_t now;
+    uint32_t next_id;
+    size_t active;
+
+    uint16_t buckets[cli_wheel_level_count * cli_wheel_slot_count];
+} CliJobs;
+
+// Initialize a set of up to `capacity` jobs, stored in `jobs`, timed by `clock`, which counts
+// `ticks_per_second` ticks each second. Returns false if the clock or tick rate is missing, or the
+// capacity does not fit in the wheel's lists.
+bool libcli_jobs_init(
+    CliJobs* jobs,
+    CliJob* entries,
+    size_t capacity,
+    CliTimestampFunction clock,
+    uint32_t ticks_per_second
+);
+
+// Turn the wheel to the clock's current tick, and run every job which has come due. Background
+// jobs write to `header`'s writeback. Returns the number of runs.
+size_t libcli_jobs_service(const CliHeader* header, CliJobs* jobs, void* userdata);
+
+// Stop the job with the given id. Returns false if there is no such job.
+bool libcli_jobs_cancel(CliJobs* jobs, uint32_t id);
+
+// Stop every watch writing to `writeback_data` (eg. a closing session). Returns how many stopped.
+size_t libcli_jobs_cancel_watches(CliJobs* jobs, const void* writeback_data);
+
+// Copy the statistics of the job with the given id to `stats`. Returns false if there is no such
+// job.
+bool libcli_jobs_stats(const CliJobs* jobs, uint32_t id, CliJobStats* stats);
+
+#endif // LIBCLI_CLI_JOBS_H
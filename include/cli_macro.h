@@ -0,0 +1,77 @@
+#ifndef LIBCLI_CLI_MACRO_H
+#define LIBCLI_CLI_MACRO_H
+
+//
+// libCLI Compiled Macros
+//
+// A script of command lines can be compiled once into a compact, position-independent bytecode:
+// each line becomes the index of the resolved command followed by its already converted and
+// type-checked arguments. Replaying the bytecode dispatches commands directly, without tokenizing,
+// looking up or converting anything.
+//
+// The bytecode may be stored (eg. in flash) and replayed later. It is only valid for the same set
+// of registered commands, which is checked by a fingerprint before replaying.
+//
+// Format (all integers little-endian):
+//     header:      "LCM" version:u8 fingerprint:u32 body_size:u32
+//     instruction: command_index:u16 argc:u8 argument*
+//     argument:    type:u8 (a `CliArgumentType`), then by type:
+//         string       length:u16 bytes NUL
+//         int          i32
+//         float        f32
+//         fixed        i32 (the fixed-point value, with `cli_fixed_fraction_bits` fraction bits)
+//         blob         size:u16 bytes
+//         int[]        count:u16 i32*
+//         u8[]         count:u16 u8*
+//         float[]      count:u16 f32*
+//
+// Readers only accept their own version. Version 2 added the fixed, blob and array arguments.
+//
+
+#include "cli.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum {
+    // Size of the bytecode header which precedes all instructions.
+    cli_macro_header_size = 12,
+
+    // Version of the bytecode format produced by `libcli_compile`.
+    cli_macro_version = 2,
+};
+
+// The result of a `libcli_compile` call.
+typedef struct CliCompileResult {
+    // `cli_run_result_ok` if the whole script was compiled, otherwise the reason it failed.
+    CliRunResult status;
+
+    // If compilation failed, the zero-based index of the line which failed.
+    size_t line;
+
+    // If successful, the number of bytes of bytecode written to the buffer.
+    size_t size;
+} CliCompileResult;
+
+// Compile `script`, a list of newline-separated command lines, into `buffer`. Empty lines are
+// skipped. Like `libcli_run`, this tokenizes in-place and destroys `script`. Pipelines cannot be
+// compiled. String arguments are copied into the bytecode, so `script` is not needed afterwards.
+CliCompileResult libcli_compile(
+    const CliHeader* header,
+    char* script,
+    uint8_t* buffer,
+    size_t buffer_size
+);
+
+// Run every command in the compiled `macro` of `size` bytes, in order. Returns
+// `cli_run_result_bad_macro` without running anything if the macro was compiled for a different
+// set of commands or its header is damaged. A damaged instruction stops the replay at that
+// instruction, also returning `cli_run_result_bad_macro`.
+CliRunResult libcli_replay(
+    const CliHeader* header,
+    const uint8_t* macro,
+    size_t size,
+    void* userdata
+);
+
+#endif // LIBCLI_CLI_MACRO_H
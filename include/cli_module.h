@@ -0,0 +1,65 @@
+#ifndef LIBCLI_CLI_MODULE_H
+#define LIBCLI_CLI_MODULE_H
+
+//
+// libCLI Lazily Loaded Command Modules (Linux only)
+//
+// Commands are listed in a manifest, mapping each command to a function in a shared object. Loading
+// the manifest only adds stub commands, whose names, summaries and argument types come from the
+// manifest, so `help` and argument checking work without loading any shared object. The first time
+// a command runs, its shared object is opened with `dlopen` and the real function is bound.
+//
+// Manifest lines are tab-separated:
+//
+//     name    arguments    shared object path    symbol    summary
+//
+// where `arguments` lists the argument types, one character each (`s` string, `i` int, `f`
+// float, `q` fixed-point, `b` blob), or is `-` for none. Empty lines and lines starting with '#'
+// are ignored.
+//
+
+#include "cli.h"
+
+#include <stddef.h>
+
+// Where a module command's function is found. All fields are private and must not be modified
+// manually.
+typedef struct CliModuleCommand {
+    const char* name;
+    const char* path;
+    const char* symbol;
+    void* handle;
+} CliModuleCommand;
+
+// The module commands of a CLI. All fields are private and must not be modified manually.
+typedef struct CliModules {
+    CliModuleCommand* commands;
+    size_t capacity;
+    size_t count;
+} CliModules;
+
+// The result of a `libcli_load_manifest` call.
+typedef struct CliManifestResult {
+    // `cli_run_result_ok` if every command was added. `cli_run_result_bad_module` if a line is not
+    // formatted correctly or names an existing command, or the header's commands are shared (see
+    // `cli_shared.h`). `cli_run_result_no_space` if the command buffer or module command buffer is
+    // full.
+    CliRunResult status;
+
+    // The zero-based line at which loading failed
+    size_t line;
+} CliManifestResult;
+
+// Initialize module command storage with the given buffer and capacity.
+CliModules libcli_modules_new(CliModuleCommand* commands, size_t commands_size);
+
+// Parse `manifest` in-place and add a stub command for each line. The manifest text and `modules`
+// are referenced by the header and must outlive it. Only one set of modules can be used per header.
+CliManifestResult libcli_load_manifest(CliHeader* header, CliModules* modules, char* manifest);
+
+// Close every shared object opened for module commands, and unbind the header's module commands,
+// so the next run of one opens its module again. Periodic jobs (see `cli_jobs.h`) keep a copy of
+// their command, so cancel the jobs of module commands first.
+void libcli_unload_modules(CliHeader* header, CliModules* modules);
+
+#endif // LIBCLI_CLI_MODULE_H
@@ -0,0 +1,93 @@
+#ifndef LIBCLI_CLI_OPTIONS_H
+#define LIBCLI_CLI_OPTIONS_H
+
+//
+// libCLI Named Options
+//
+// Commands added with `libcli_add_with_options` take named options as well as positional
+// arguments: flags (`--verbose` or `-v`) and typed values (`--count=5`, `--count 5` or `-c 5`).
+// Options may appear anywhere after the command name, and `--` ends them, so later words are
+// always positional.
+//
+// Each command's options are described by a `CliOptionTable`, which hashes every long and short
+// name once when it is created. Each option word is then found with one hash and one comparison,
+// and its value is converted along with the positional arguments, before the command runs. The
+// command reads the converted values and which options were given with `libcli_options`.
+//
+
+#include "cli.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+enum {
+    // Maximum number of options of one command
+    cli_max_option_count = 16,
+
+    // Number of slots of an option table's hash table, at most half full
+    cli_option_slot_count = 64,
+};
+
+// A named option. All fields are public and must be written to before calling
+// `libcli_option_table_new`.
+typedef struct CliOption {
+    // The long name, eg. "count" for `--count`.
+    const char* name;
+
+    // The short name, eg. 'c' for `-c`, or '\0' if there is none. Must be a letter.
+    char short_name;
+
+    // If false, the option is a flag, whose value is an int of 1 if it was given and 0 if not.
+    bool takes_value;
+
+    // The type of the option's value.
+    CliArgumentType type;
+
+    // The value used when the option is not given. Its type is taken from `type`.
+    CliArgument default_value;
+} CliOption;
+
+// The options of a command. All fields are private and must not be modified manually.
+struct CliOptionTable {
+    const CliOption* options;
+    size_t count;
+
+    // For each slot, 0 if empty, or one more than the key of the name hashed to it. The key of an
+    // option's long name is twice its index, and of its short name one more than that.
+    uint8_t slots[cli_option_slot_count];
+};
+
+// The options given to a command. All fields are public and may be read by the command.
+struct CliOptions {
+    // Bit `i` is set if the option at index `i` of the command's table was given.
+    uint32_t present;
+
+    // The value of each option, in the order of the command's table. Options which were not given
+    // hold their default value.
+    CliArgument values[cli_max_option_count];
+};
+
+// Initialize an option table for `options`, which must outlive it. Returns false if there are more
+// than `cli_max_option_count` options, or two options share a name.
+bool libcli_option_table_new(CliOptionTable* table, const CliOption* options, size_t count);
+
+// Like `libcli_add`, but the command also takes the named options of `options`, which must outlive
+// the header. Returns false if the command was not added.
+bool libcli_add_with_options(
+    CliHeader* header,
+    const char* name,
+    const char* summary,
+    size_t argument_count,
+    const CliArgumentType* arguments,
+    const CliOptionTable* options,
+    CliCommandFunction function
+);
+
+// The options given to the command being run with `header`, or NULL if it takes no options.
+const CliOptions* libcli_options(const CliHeader* header);
+
+// Returns true if the option at `index` of the command's table was given.
+bool libcli_option_present(const CliOptions* options, size_t index);
+
+#endif // LIBCLI_CLI_OPTIONS_H
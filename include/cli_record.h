@@ -0,0 +1,95 @@
+#ifndef LIBCLI_CLI_RECORD_H
+#define LIBCLI_CLI_RECORD_H
+
+//
+// libCLI Session Recording and Replay
+//
+// A recorder given in `CliNewInfo` logs every line run by `libcli_run` into a fixed-size ring
+// buffer: the line, a timestamp, the result and the time spent in the handler. When the ring is
+// full, the oldest lines are dropped. The ring can be dumped into a trace (eg. to save to a file),
+// which `libcli_replay_trace` runs back through a CLI to benchmark it with real traffic.
+//
+// Trace format (all integers little-endian):
+//     "LCR" version:u8 entry_count:u32
+//     entries                        timestamp:u32 duration:u32 result:u8 length:u16 line[length]
+//
+
+#include "cli.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+enum {
+    // Version of the trace format
+    cli_trace_version = 1,
+
+    // Size of the header at the start of a trace
+    cli_trace_header_size = 8,
+
+    // Size of the fields of an entry before its line
+    cli_trace_entry_size = 11,
+
+    // Maximum length of a recorded line, including a terminator. Longer lines are not recorded.
+    cli_trace_line_size = 256,
+};
+
+// A ring buffer of recorded lines. All fields are private and must not be modified manually.
+struct CliRecorder {
+    uint8_t* buffer;
+    size_t size;
+    size_t start;
+    size_t length;
+    size_t entry_count;
+    size_t dropped;
+    CliTimestampFunction timestamp;
+};
+
+// Statistics of a `libcli_replay_trace` call. Times are in ticks of the replay timestamp function.
+typedef struct CliReplayStats {
+    // Number of lines run
+    size_t runs;
+
+    // Number of lines whose result differed from the recorded result
+    size_t mismatches;
+
+    // Time from the first line starting to the last line finishing
+    uint64_t elapsed;
+
+    // Distribution of the time taken by each `libcli_run` call
+    uint32_t min;
+    uint32_t mean;
+    uint32_t p50;
+    uint32_t p99;
+    uint32_t max;
+} CliReplayStats;
+
+// Initialize a recorder with the given ring buffer. `timestamp` is optional; without it, recorded
+// timestamps and durations are zero.
+CliRecorder libcli_recorder_new(uint8_t* buffer, size_t size, CliTimestampFunction timestamp);
+
+// The number of lines dropped because the ring was full or they were too long.
+size_t libcli_recorder_dropped(const CliRecorder* recorder);
+
+// The size of the trace `libcli_recorder_dump` would write.
+size_t libcli_recorder_dump_size(const CliRecorder* recorder);
+
+// Write the recorded lines, oldest first, into `trace`. Returns the number of bytes written, or 0
+// if `trace_size` is smaller than `libcli_recorder_dump_size`.
+size_t libcli_recorder_dump(const CliRecorder* recorder, uint8_t* trace, size_t trace_size);
+
+// Run every line of `trace` through `header`, measuring each run with `timestamp`. If `realtime`
+// is set, lines are started at their recorded times (by polling `timestamp`, which must then use
+// the same ticks as the recording); otherwise they run back to back. Returns
+// `cli_run_result_bad_macro` if the trace is damaged.
+CliRunResult libcli_replay_trace(
+    const CliHeader* header,
+    const uint8_t* trace,
+    size_t trace_size,
+    CliTimestampFunction timestamp,
+    bool realtime,
+    void* userdata,
+    CliReplayStats* stats
+);
+
+#endif // LIBCLI_CLI_RECORD_H
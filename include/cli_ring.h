@@ -0,0 +1,76 @@
+#ifndef LIBCLI_CLI_RING_H
+#define LIBCLI_CLI_RING_H
+
+//
+// libCLI Input Ring
+//
+// A lock-free single-producer, single-consumer byte ring for passing input from an interrupt
+// handler (eg. UART RX) to the main loop. The producer calls `libcli_ring_push`, and the consumer
+// calls `libcli_service`, which runs every complete line in place in the ring.
+//
+// Lines end with '\n' or '\r'. To keep lines which wrap around the end of the ring contiguous, the
+// producer also writes the first `line_size` bytes of the ring to a mirror just past its end.
+//
+// When the ring is full, the producer drops bytes until the end of the line, and then stores a
+// cancel byte (`cli_ring_cancel`) in place of the line end, so the damaged line is discarded
+// rather than run. A cancel byte received as input discards its line in the same way.
+//
+
+#include "cli.h"
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+enum {
+    // Ends a line, which is discarded rather than run (ASCII CAN, Ctrl-X)
+    cli_ring_cancel = 0x18,
+};
+
+// An input ring. All fields are private and must not be modified manually.
+typedef struct CliRing {
+    char* buffer;
+    size_t mask;
+    size_t line_size;
+
+    // Free-running byte counts. `head` is only written by the producer, `tail` by the consumer.
+    atomic_size_t head;
+    atomic_size_t tail;
+
+    // Producer state
+    atomic_size_t overrun_bytes;
+    bool dropping;
+
+    // Consumer state
+    size_t scanned;
+    bool discarding;
+    size_t discarded_lines;
+} CliRing;
+
+// Initialize a ring of `size` bytes, which must be a power of two. `buffer` must hold
+// `size + line_size` bytes, and lines (including their terminator) must fit in `line_size` bytes,
+// which must be at most `size`. Returns false if the sizes are not valid.
+bool libcli_ring_init(CliRing* ring, char* buffer, size_t size, size_t line_size);
+
+// Push input into the ring. Called by the producer only (eg. in an interrupt handler). Returns the
+// number of bytes stored. The rest were dropped, counted in `libcli_ring_overrun_bytes`, and the
+// line they belong to is cancelled.
+size_t libcli_ring_push(CliRing* ring, const char* data, size_t length);
+
+// Number of bytes which can be pushed without an overrun. Called by the producer only, eg. to
+// apply flow control instead of dropping input.
+size_t libcli_ring_space(const CliRing* ring);
+
+// Run every complete line in the ring through `libcli_run`, in place, then free its space. Called
+// by the consumer only (eg. in the main loop). Lines longer than the ring's line size, and lines
+// damaged by an overrun, are discarded. Returns `cli_run_result_no_space` if any line was
+// discarded, otherwise the first result other than `cli_run_result_ok`, or `cli_run_result_ok`.
+CliRunResult libcli_service(const CliHeader* header, CliRing* ring, void* userdata);
+
+// Number of input bytes dropped because the ring was full. Safe to call from either side.
+size_t libcli_ring_overrun_bytes(const CliRing* ring);
+
+// Number of lines discarded by `libcli_service`. Called by the consumer only.
+size_t libcli_ring_discarded_lines(const CliRing* ring);
+
+#endif // LIBCLI_CLI_RING_H
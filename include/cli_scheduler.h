@@ -0,0 +1,138 @@
+#ifndef LIBCLI_CLI_SCHEDULER_H
+#define LIBCLI_CLI_SCHEDULER_H
+
+//
+// libCLI Input Scheduler
+//
+// Shares one single-threaded loop between several input sources (eg. a debug UART, USB-CDC and a
+// radio link). Each source queues its complete lines in a fixed-capacity queue, and each call to
+// `libcli_scheduler_tick` runs one queued line, so a flood of lines on one source cannot hold up
+// the others for longer than a line.
+//
+// The line to run is taken from the sources with the highest priority which have lines waiting.
+// Sources of equal priority take turns in proportion to their weights (smooth weighted
+// round-robin: a source of weight 3 runs three lines for every line of a source of weight 1,
+// interleaved rather than in bursts). Each line's output is written to the writeback of the source
+// it came from.
+//
+// All functions must be called from the same loop. Input received in interrupt handlers should be
+// gathered into lines first (eg. through `cli_ring.h`).
+//
+
+#include "cli.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+enum {
+    // Maximum length of a queued line, including the terminator. Longer lines are rejected.
+    cli_scheduler_line_size = 128,
+};
+
+// A line waiting in a source's queue. All fields are private and must not be modified manually.
+typedef struct CliQueuedLine {
+    uint32_t queued_at;
+    char text[cli_scheduler_line_size];
+} CliQueuedLine;
+
+// Queue depth and wait time of a source, for tuning its priority, weight and queue capacity. Wait
+// times are in ticks of the scheduler's clock, from when a line was queued until it began running.
+typedef struct CliSourceStats {
+    // Lines waiting now, and the most which have waited at once
+    size_t depth;
+    size_t max_depth;
+
+    // Lines run, and lines rejected because the queue was full or they were too long
+    size_t dispatched;
+    size_t dropped;
+
+    uint32_t last_wait;
+    uint32_t max_wait;
+    uint64_t total_wait;
+} CliSourceStats;
+
+// An input source. All fields are private and must not be modified manually.
+typedef struct CliSchedulerSource {
+    CliQueuedLine* lines;
+    size_t capacity;
+    size_t head;
+    size_t count;
+    uint8_t priority;
+    uint32_t weight;
+    int64_t credit;
+    CliWritebackFunction writeback;
+    void* writeback_data;
+    CliContextStack* contexts;
+    CliSourceStats stats;
+} CliSchedulerSource;
+
+// A scheduler. All fields are private and must not be modified manually.
+typedef struct CliScheduler {
+    CliSchedulerSource* sources;
+    size_t capacity;
+    size_t count;
+    CliTimestampFunction clock;
+} CliScheduler;
+
+// Information describing a source for `libcli_scheduler_add_source`. All fields are public and
+// must be written to before calling `libcli_scheduler_add_source`. Optional fields may be left
+// zeroed.
+typedef struct CliSourceInfo {
+    // The buffer which the source's queued lines are stored in.
+    CliQueuedLine* lines;
+
+    // The maximum number of elements in `lines`.
+    size_t lines_size;
+
+    // Sources with a higher priority always run first.
+    uint8_t priority;
+
+    // The share of lines run for the source among sources of the same priority. Must not be zero.
+    uint32_t weight;
+
+    // The function which the output of the source's lines is written to, and its data.
+    CliWritebackFunction writeback;
+    void* writeback_data;
+
+    // Optional stack of entered command contexts for the source's lines. If NULL, the header's own
+    // stack is used.
+    CliContextStack* contexts;
+} CliSourceInfo;
+
+// Create a scheduler for up to `capacity` sources, stored in `sources`. If `clock` is not NULL,
+// it times how long lines wait (see `CliSourceStats`).
+CliScheduler libcli_scheduler_new(
+    CliSchedulerSource* sources,
+    size_t capacity,
+    CliTimestampFunction clock
+);
+
+// Add the source described by `info`, and store its index in `source`. Returns false if the
+// scheduler is full, or the source has no queue, weight or writeback.
+bool libcli_scheduler_add_source(
+    CliScheduler* scheduler,
+    const CliSourceInfo* info,
+    size_t* source
+);
+
+// Queue a copy of `line` from the source at `source`. Returns false (and counts the line as
+// dropped) if the source's queue is full or the line does not fit in `cli_scheduler_line_size`.
+bool libcli_scheduler_submit(CliScheduler* scheduler, size_t source, const char* line);
+
+// Run the next line through `libcli_run`, if any are queued. Returns false if every queue was
+// empty. Otherwise `result` is set to the result of the line.
+bool libcli_scheduler_tick(
+    const CliHeader* header,
+    CliScheduler* scheduler,
+    void* userdata,
+    CliRunResult* result
+);
+
+// Total number of lines waiting in every queue.
+size_t libcli_scheduler_pending(const CliScheduler* scheduler);
+
+// The queue depth and wait time statistics of the source at `source`.
+CliSourceStats libcli_scheduler_stats(const CliScheduler* scheduler, size_t source);
+
+#endif // LIBCLI_CLI_SCHEDULER_H
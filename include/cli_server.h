@@ -0,0 +1,102 @@
+#ifndef LIBCLI_CLI_SERVER_H
+#define LIBCLI_CLI_SERVER_H
+
+//
+// libCLI Multi-Session Server (Linux only)
+//
+// A single-threaded epoll event loop which accepts connections on a Unix-domain socket or a
+// loopback TCP port and runs each received line against one shared `CliHeader`. Every connection
+// is a fixed-size `CliSession` from a caller-provided array. Command output is routed to the
+// session which sent the command and is written without blocking, through a per-session queue.
+// When the queue fills during a command, it is written to the connection as far as the connection
+// accepts. Output which still does not fit is dropped, and the line's output ends with
+// "(output truncated)". Each session has its own stack of entered command contexts (see
+// `cli_context.h`).
+//
+
+#include "cli.h"
+#include "cli_context.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+enum {
+    // Maximum length of a single input line, including the terminator. Longer lines are discarded.
+    cli_session_input_size = 256,
+
+    // Size of the per-session queue of output waiting to be written to the connection. Commands may
+    // write more, as long as the connection keeps accepting it.
+    cli_session_output_size = 1024,
+};
+
+// A connection to the server. All fields are private and must not be modified manually.
+typedef struct CliSession {
+    int fd;
+    bool discarding_line;
+    bool output_blocked;
+    size_t input_length;
+    size_t output_start;
+    size_t output_length;
+    size_t output_dropped;
+    size_t output_reported;
+    CliContextStack contexts;
+    char input[cli_session_input_size];
+    char output[cli_session_output_size];
+} CliSession;
+
+// A running server. All fields are private and must not be modified manually.
+typedef struct CliServer {
+    const CliHeader* header;
+    CliSession* sessions;
+    size_t sessions_size;
+    size_t session_count;
+    size_t next_free_session;
+    int epoll_fd;
+    int listen_fd;
+    const char* unix_path;
+    void* userdata;
+} CliServer;
+
+// Information required to create a new server. All field are public and must be written to before
+// calling `libcli_server_new`.
+typedef struct CliServerInfo {
+    // The CLI which all sessions run commands against. Its writeback is replaced by the server for
+    // every command, so command output is sent to the session which ran the command.
+    const CliHeader* header;
+
+    // The buffer which sessions are stored in.
+    CliSession* sessions;
+
+    // The maximum number of elements in `sessions`. Further connections are refused.
+    size_t sessions_size;
+
+    // Path of the Unix-domain socket to listen on. If NULL, listen on `tcp_port` instead.
+    const char* unix_path;
+
+    // The loopback TCP port to listen on if `unix_path` is NULL. Zero picks any free port.
+    uint16_t tcp_port;
+
+    // Additional data passed to every command run by the server.
+    void* userdata;
+} CliServerInfo;
+
+// Create the listening socket and event loop. Returns false if any of them could not be created.
+bool libcli_server_new(CliServer* server, const CliServerInfo* info);
+
+// Wait up to `timeout_ms` milliseconds (or forever if negative) for connection activity and
+// handle it. Returns false if waiting for events failed.
+bool libcli_server_poll(CliServer* server, int timeout_ms);
+
+// Write the output queued for sessions outside of `libcli_server_poll`, eg. by watches (see
+// `cli_jobs.h`) which `libcli_jobs_service` ran, and wait for writability where it did not all fit.
+// Call it after each `libcli_jobs_service` call.
+void libcli_server_flush(CliServer* server);
+
+// The TCP port the server is listening on, or zero if it is listening on a Unix-domain socket.
+uint16_t libcli_server_port(const CliServer* server);
+
+// Close all sessions and the listening socket.
+void libcli_server_delete(CliServer* server);
+
+#endif // LIBCLI_CLI_SERVER_H
@@ -0,0 +1,69 @@
+#ifndef LIBCLI_CLI_SHARED_H
+#define LIBCLI_CLI_SHARED_H
+
+//
+// libCLI Shared Command Tables
+//
+// Lets threads run commands while other threads add and remove them, without locks in the run
+// path. Once a header's commands are shared with `libcli_share_commands`, each run reads one
+// immutable snapshot of the command table, found through an atomic pointer.
+//
+// `libcli_add` and `libcli_remove` then build a new sorted table in the spare buffer, publish it
+// atomically, and wait for a grace period before the old table becomes the next spare buffer.
+// The grace period ends once every run which may have seen the old table has finished. Each run
+// counts itself in one of two reader counters, chosen by a grace period epoch. A writer flips the
+// epoch and waits for the old epoch's counter to drain, twice, so new runs never delay it.
+//
+// Writers are serialized with each other, and wait for the grace period, so they should not be
+// called from a command's function. Shared commands cannot be searched with the keyword index.
+//
+// Only the command table is synchronized. A recorder, output cache, module resolver or periodic
+// jobs are written by runs without locks, so headers with any of them cannot be shared. The pipe
+// buffer, array buffer and context stack are also written by runs: threads which use pipelines,
+// array arguments or contexts each need a copy of the shared header with their own (copies of a
+// shared header run against the same command table).
+//
+
+#include "cli.h"
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Type of a function called while a writer waits for other threads, eg. `sched_yield`.
+typedef void (*CliWaitFunction)(void);
+
+// A snapshot of the command table. All fields are private and must not be modified manually.
+typedef struct CliCommandTable {
+    CliCommand* commands;
+    size_t count;
+    size_t longest_command_name_length;
+    uint32_t fingerprint;
+} CliCommandTable;
+
+// The shared commands of a header. All fields are private and must not be modified manually.
+struct CliSharedCommands {
+    _Atomic(CliCommandTable*) current;
+    CliCommandTable tables[2];
+
+    // Runs in progress, counted by the grace period epoch (the low bit of `epoch`) they started in
+    atomic_uint epoch;
+    atomic_size_t readers[2];
+
+    atomic_flag writing;
+    CliWaitFunction wait;
+};
+
+// Share the header's commands through `shared`. `spare_commands` must hold as many commands as the
+// header's command buffer. `wait` is called while writers wait, and may be NULL to spin. The
+// header must not be in use by other threads yet. Returns false if the commands are already
+// shared, or the header has a recorder, cache, module resolver or jobs.
+bool libcli_share_commands(
+    CliHeader* header,
+    CliSharedCommands* shared,
+    CliCommand* spare_commands,
+    CliWaitFunction wait
+);
+
+#endif // LIBCLI_CLI_SHARED_H
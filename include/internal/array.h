@@ -0,0 +1,42 @@
+#ifndef CLI_INTERNAL_ARRAY_H
+#define CLI_INTERNAL_ARRAY_H
+
+//
+// Internal libCLI Array Arguments
+//
+// Parses array arguments into the header's array buffer. Each run of a line hands out the buffer
+// from the start, so `used` counts the bytes taken by the line's earlier arrays.
+//
+
+#include "cli.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Returns true if `type` is one of the array argument types.
+bool libcli_is_array_type(CliArgumentType type);
+
+// Take room for `count` elements of the array `type` in the header's array buffer, after the
+// first `used` bytes, and add the bytes taken to `used`. Returns NULL if they do not fit.
+void* libcli_reserve_array(
+    const CliHeader* header,
+    CliArgumentType type,
+    size_t count,
+    size_t* used
+);
+
+// Parse the elements of `text`, separated by commas or spaces, into the header's array buffer
+// after the first `used` bytes, and add the bytes taken to `used`. Returns false if an element is
+// not valid or does not fit, with its index stored in `error_element` and its offset in `text` in
+// `error_offset`. `text` is modified.
+bool libcli_parse_array(
+    const CliHeader* header,
+    CliArgumentType type,
+    char* text,
+    size_t* used,
+    CliArray* out,
+    size_t* error_element,
+    size_t* error_offset
+);
+
+#endif // CLI_INTERNAL_ARRAY_H
@@ -0,0 +1,20 @@
+#ifndef CLI_INTERNAL_BLOB_H
+#define CLI_INTERNAL_BLOB_H
+
+//
+// Internal libCLI Blob Decoding
+//
+// Decodes `cli_argument_type_blob` arguments in place, in the input buffer they were tokenized in.
+//
+
+#include "cli.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Decode hex text, or base64 text after a "b64:" prefix, into bytes at the start of `text`.
+// Returns false if the text is not valid, with the offset in `text` of the first invalid character
+// (or of the end, if the text is cut short) stored in `error_offset`.
+bool libcli_decode_blob(char* text, CliBlob* out, size_t* error_offset);
+
+#endif // CLI_INTERNAL_BLOB_H
@@ -0,0 +1,60 @@
+#ifndef CLI_INTERNAL_CACHE_H
+#define CLI_INTERNAL_CACHE_H
+
+//
+// Internal libCLI Output Cache
+//
+// Finds and fills the entries of `cli_cache.h`. A line's key is its words, each followed by a
+// terminator, and the function of its command (so that commands of the same name in different
+// contexts are cached apart).
+//
+
+#include "cli_cache.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+
+// The run of a line whose output is being captured into an entry
+typedef struct CacheCapture {
+    CliCache* cache;
+
+    // The entry being filled, or NULL if every entry is being filled by an outer run
+    CliCacheEntry* entry;
+
+    // Where the output also goes
+    CliWritebackFunction writeback;
+    void* writeback_data;
+
+    // The cache's generation and time when the run began
+    uint32_t generation;
+    uint32_t started_at;
+
+    bool overflowed;
+} CacheCapture;
+
+// Find the valid, unexpired entry for a key. Returns NULL if there is none.
+const CliCacheEntry* libcli_cache_find(
+    CliCache* cache,
+    const char* key,
+    size_t key_length,
+    CliCommandFunction function
+);
+
+// Take an entry to capture the output of a run of a key in, which goes on to `header`'s writeback.
+// Write the run's output with `libcli_cache_writeback` and `capture` as its data.
+void libcli_cache_begin(
+    CliCache* cache,
+    const char* key,
+    size_t key_length,
+    CliCommandFunction function,
+    const CliHeader* header,
+    CacheCapture* capture
+);
+
+// Writeback function which captures output and passes it on.
+void libcli_cache_writeback(const char* string, void* userdata);
+
+// Finish a capture. The entry is stored if the run succeeded and its whole output was captured.
+void libcli_cache_end(CacheCapture* capture, bool succeeded);
+
+#endif // CLI_INTERNAL_CACHE_H
@@ -0,0 +1,83 @@
+#ifndef CLI_INTERNAL_COMMAND_H
+#define CLI_INTERNAL_COMMAND_H
+
+//
+// Internal libCLI Command Interface
+//
+// The stages of `libcli_run` (tokenizing, command lookup, argument conversion and dispatch),
+// exposed for library modules which run commands without going through a full input line.
+//
+
+#include "cli.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+
+enum {
+    // Maximum number of arguments the parser can handle
+    input_parser_argument_capacity = 16,
+};
+
+typedef struct {
+    bool found;
+    size_t index;
+} SearchResult;
+
+// Tokenize `input` in-place into at most `capacity` strings, storing the number of strings found
+// in `count`. Pipeline separators are stored as NULL strings.
+CliRunResult libcli_tokenize(
+    const CliHeader* header,
+    char* input,
+    const char** strings,
+    size_t capacity,
+    size_t* count
+);
+
+// Perform a binary search for a command called `name`.
+SearchResult libcli_find_command(const CliHeader* header, const char* name);
+
+// Perform a binary search for a command called `name` in a sorted table of commands.
+SearchResult libcli_find_in_table(const CliCommand* commands, size_t count, const char* name);
+
+// Find the command called `name` in the active contexts, innermost first, and then in the global
+// commands. Returns NULL if there is no such command.
+const CliCommand* libcli_lookup_command(const CliHeader* header, const char* name);
+
+// Returns true if the command is a built-in which takes a varying number of unconverted arguments.
+bool libcli_is_variadic_command(const CliCommand* command);
+
+// A hash of a command's name and signature. A header's fingerprint is the sum of its commands'.
+uint32_t libcli_command_fingerprint(const CliCommand* command);
+
+// The length of the longest command name of a table.
+size_t libcli_longest_name_length(const CliCommand* commands, size_t count);
+
+// Returns true if the header can convert every argument type in `arguments`.
+bool libcli_can_convert_arguments(
+    const CliHeader* header,
+    size_t argument_count,
+    const CliArgumentType* arguments
+);
+
+// Returns true if the header can convert the value of every option in the table (which may be
+// NULL).
+bool libcli_can_convert_options(const CliHeader* header, const CliOptionTable* options);
+
+// Convert `input` into an argument of the given type. Returns false if `input` is not valid.
+bool libcli_convert_argument(
+    const CliHeader* header,
+    CliArgumentType type,
+    const char* input,
+    CliArgument* output
+);
+
+// Run a command with already converted and type-checked arguments.
+CliRunResult libcli_run_command(
+    const CliHeader* header,
+    CliCommand command,
+    size_t argc,
+    const CliArgument* argv,
+    void* userdata
+);
+
+#endif // CLI_INTERNAL_COMMAND_H
@@ -0,0 +1,33 @@
+#ifndef CLI_INTERNAL_CONSTRAINTS_H
+#define CLI_INTERNAL_CONSTRAINTS_H
+
+//
+// Internal libCLI Argument Constraints
+//
+// Checks converted arguments against the constraints of `cli_constraints.h`.
+//
+
+#include "cli_constraints.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+
+// Returns true if every constraint refers to an argument of the command, and its kind can check
+// that argument's type.
+bool libcli_constraints_fit(
+    const CliConstraint* constraints,
+    size_t constraint_count,
+    size_t argument_count,
+    const CliArgumentType* arguments
+);
+
+// Check the converted argument at `argument` against each of the command's constraints on it.
+// Returns false if one fails, and sets `failed` to its index.
+bool libcli_check_constraints(
+    const CliCommand* command,
+    size_t argument,
+    const CliArgument* value,
+    size_t* failed
+);
+
+#endif // CLI_INTERNAL_CONSTRAINTS_H
@@ -0,0 +1,19 @@
+#ifndef CLI_INTERNAL_FIXED_H
+#define CLI_INTERNAL_FIXED_H
+
+//
+// Internal libCLI Fixed-Point Parsing
+//
+// Converts decimal text to fixed-point with integer arithmetic only, so FPU-less targets do not
+// need `strtof` or soft-float support to take fractional arguments.
+//
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Convert decimal text (eg. "-3.25") to a signed 32-bit value with `fraction_bits` fractional bits,
+// rounding to the nearest step with halves away from zero. Returns false if the text is not a
+// decimal number or the value does not fit.
+bool libcli_parse_fixed(const char* string, unsigned fraction_bits, int32_t* out);
+
+#endif // CLI_INTERNAL_FIXED_H
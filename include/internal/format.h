@@ -0,0 +1,26 @@
+#ifndef CLI_INTERNAL_FORMAT_H
+#define CLI_INTERNAL_FORMAT_H
+
+//
+// Internal libCLI Number Formatting
+//
+// Small allocation-free helpers for writing numbers as text without a libc formatter.
+//
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+enum {
+    // Enough characters for any `uint64_t` in decimal, plus a terminator
+    format_unsigned_size = 21,
+};
+
+// Write `value` in decimal to `buffer` (at least `format_unsigned_size` bytes) with a terminator.
+// Returns the number of digits written.
+size_t libcli_format_unsigned(char* buffer, uint64_t value);
+
+// Write `value` as `digits` hex digits (at most 16) to `buffer`, with a terminator.
+void libcli_format_hex(char* buffer, uint64_t value, size_t digits, bool uppercase);
+
+#endif // CLI_INTERNAL_FORMAT_H
@@ -0,0 +1,38 @@
+#ifndef CLI_INTERNAL_HELP_H
+#define CLI_INTERNAL_HELP_H
+
+//
+// Internal libCLI Help
+//
+// Implements the built-in `help` command: the list of commands, `help <command>` for one command's
+// summary and argument types, and `help -s <word>` to find commands by a word of their name or
+// summary. Searches use the keyword index given in `CliNewInfo`, a sorted array of word hashes
+// built as commands are added, and fall back to scanning every summary if there is no index or
+// it ran out of space. Either way, a command only matches if it has the word itself, not just a
+// word with the same hash. The commands of active contexts are not indexed; they are listed and
+// scanned before the global commands.
+//
+
+#include "cli.h"
+
+#include <stddef.h>
+
+enum {
+    // Shortest word which is indexed and can be searched for
+    help_min_keyword_length = 3,
+};
+
+// Placeholder function of the built-in `help` command. It takes an optional topic, so it is
+// dispatched to `libcli_run_help` before argument checking.
+void libcli_help_command(const CliHeader*, size_t, const CliArgument*, void*);
+
+// Add the words of a newly added command's name and summary to the keyword index.
+void libcli_index_command(CliHeader* header, const CliCommand* command);
+
+// Remove the words of a removed command from the keyword index.
+void libcli_unindex_command(CliHeader* header, const CliCommand* command);
+
+// Run `help [<command> | -s <word>]` given the strings after `help`.
+CliRunResult libcli_run_help(const CliHeader* header, const char* const* strings, size_t count);
+
+#endif // CLI_INTERNAL_HELP_H
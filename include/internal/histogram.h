@@ -0,0 +1,36 @@
+#ifndef CLI_INTERNAL_HISTOGRAM_H
+#define CLI_INTERNAL_HISTOGRAM_H
+
+//
+// Internal libCLI Latency Histogram
+//
+// A fixed-size summary of tick samples: min, max, sum and a log2 histogram for percentiles.
+//
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum {
+    // Buckets: 0, 1, 2-3, 4-7, ... up to 2^31 to 2^32-1 ticks
+    histogram_bucket_count = 33,
+};
+
+typedef struct Histogram {
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+    uint32_t count;
+    uint32_t buckets[histogram_bucket_count];
+} Histogram;
+
+void libcli_histogram_init(Histogram* histogram);
+
+void libcli_histogram_add(Histogram* histogram, uint32_t value);
+
+// The mean of the samples, or 0 if there are none.
+uint32_t libcli_histogram_mean(const Histogram* histogram);
+
+// The given percentile (0 to 100) to the resolution of the histogram, never more than the maximum.
+uint32_t libcli_histogram_percentile(const Histogram* histogram, unsigned percentile);
+
+#endif // CLI_INTERNAL_HISTOGRAM_H
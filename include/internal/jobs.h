@@ -0,0 +1,37 @@
+#ifndef CLI_INTERNAL_JOBS_H
+#define CLI_INTERNAL_JOBS_H
+
+//
+// Internal libCLI Periodic Jobs
+//
+// Implements the built-in `every`, `watch`, `jobs` and `cancel` commands of `cli_jobs.h`.
+//
+
+#include "cli_jobs.h"
+
+#include <stddef.h>
+
+// Placeholder functions of the built-in commands which take a command. They take any number of
+// arguments, so they are dispatched to `libcli_run_every` and `libcli_run_watch` before argument
+// checking.
+void libcli_every_command(const CliHeader*, size_t, const CliArgument*, void*);
+void libcli_watch_command(const CliHeader*, size_t, const CliArgument*, void*);
+
+// Add the `every`, `watch`, `jobs` and `cancel` commands.
+bool libcli_add_job_commands(CliHeader* header);
+
+// Run `every <period> <command...>` given the strings after `every`.
+CliRunResult libcli_run_every(
+    const CliHeader* header,
+    const char* const* strings,
+    size_t string_count
+);
+
+// Run `watch <period> <command...>` given the strings after `watch`.
+CliRunResult libcli_run_watch(
+    const CliHeader* header,
+    const char* const* strings,
+    size_t string_count
+);
+
+#endif // CLI_INTERNAL_JOBS_H
@@ -0,0 +1,32 @@
+#ifndef CLI_INTERNAL_OPTIONS_H
+#define CLI_INTERNAL_OPTIONS_H
+
+//
+// Internal libCLI Option Lookup
+//
+// Finds the option named by a word of the input in a command's option table, with one hash of the
+// word and (usually) one comparison.
+//
+
+#include "cli_options.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+
+enum {
+    // Returned by `libcli_find_option` if the word does not name an option of the table
+    option_not_found = cli_max_option_count,
+};
+
+// Returns true if `word` is an option word (`--name` or `-x`, where x is a letter) rather than a
+// positional argument. Negative numbers such as `-5` are positional.
+bool libcli_is_option_word(const char* word);
+
+// The index of the option named by the option word `word`, or `option_not_found`. If the word
+// includes a value (`--name=value`), `value` is set to it, and otherwise to NULL.
+size_t libcli_find_option(const CliOptionTable* table, const char* word, const char** value);
+
+// Fill `options` with the table's default values, with no options present.
+void libcli_default_options(const CliOptionTable* table, CliOptions* options);
+
+#endif // CLI_INTERNAL_OPTIONS_H
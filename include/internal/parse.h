@@ -13,6 +13,11 @@
 // The write head must be guaranteed to never advance beyond the read head. This allows in-place
 // parsing. Currently, this is guaranteed as all state functions read at least once before writing.
 //
+// An unquoted `|` separates pipeline stages. It is recorded as a NULL entry in the argument array.
+//
+// `libcli_parse_tokens` hands each token to a callback as soon as it ends, so the caller can act
+// on it (and stop the parse) while the rest of the input is unread.
+//
 
 #include <stddef.h>
 #include <stdbool.h>
@@ -29,16 +34,43 @@ typedef enum ParseStatus {
 
     // The string ended before a closing `'`.
     parse_status_unterminated_single_quote,
+
+    // The string was not valid UTF-8 (only reported when validating).
+    parse_status_invalid_utf8,
+
+    // The token callback stopped the parse.
+    parse_status_stopped,
 } ParseStatus;
 
 typedef struct ParseResult {
     // Status of the parse (parse_status_success if it succeeded).
     ParseStatus status;
 
-    // If successful, the number of arguments collected by the parser.
+    // If successful, the number of arguments collected by the parser (including NULL pipe entries).
     size_t argument_count;
+
+    // If the string was not valid UTF-8, the offset of the first byte of the invalid sequence.
+    size_t error_offset;
 } ParseResult;
 
 ParseResult libcli_parse(char* input, const char** arguments, size_t max_arguments);
 
+// Like `libcli_parse`, but also validates that the string is UTF-8, in the same pass.
+ParseResult libcli_parse_utf8(char* input, const char** arguments, size_t max_arguments);
+
+// Called with each token as soon as it ends (NULL for a pipeline separator), including tokens past
+// `max_arguments`. Returning false stops the parse with `parse_status_stopped`.
+typedef bool (*ParseTokenFunction)(const char* token, void* data);
+
+// Like `libcli_parse` (or `libcli_parse_utf8` if `validate_utf8` is set), calling `on_token` with
+// each token as it ends.
+ParseResult libcli_parse_tokens(
+    char* input,
+    const char** arguments,
+    size_t max_arguments,
+    bool validate_utf8,
+    ParseTokenFunction on_token,
+    void* data
+);
+
 #endif // CLI_INTERNAL_PARSE_H
@@ -0,0 +1,13 @@
+#ifndef CLI_INTERNAL_RECORD_H
+#define CLI_INTERNAL_RECORD_H
+
+//
+// Internal libCLI Session Recording
+//
+
+#include "cli.h"
+
+// Run `input` like `libcli_run`, recording it in the header's recorder.
+CliRunResult libcli_run_recorded(const CliHeader* header, char* input, void* userdata);
+
+#endif // CLI_INTERNAL_RECORD_H
@@ -0,0 +1,29 @@
+#ifndef CLI_INTERNAL_SHARED_H
+#define CLI_INTERNAL_SHARED_H
+
+//
+// Internal libCLI Shared Command Tables
+//
+// The reader and writer sides of `cli_shared.h`.
+//
+
+#include "cli_shared.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+
+// Start reading the header's shared commands. `snapshot` is set to a copy of the header which
+// reads the current table. Returns the reader counter to pass to `libcli_end_snapshot`.
+unsigned libcli_begin_snapshot(const CliHeader* header, CliHeader* snapshot);
+
+// Finish reading the snapshot started by `libcli_begin_snapshot`.
+void libcli_end_snapshot(const CliHeader* header, unsigned reader);
+
+// Publish a table with a validated command added. Returns false if a command with its name exists,
+// or the table already holds `capacity` commands.
+bool libcli_shared_add(CliSharedCommands* shared, size_t capacity, const CliCommand* command);
+
+// Publish a table without the command called `name`. Returns false if there is no such command.
+bool libcli_shared_remove(CliSharedCommands* shared, const char* name);
+
+#endif // CLI_INTERNAL_SHARED_H
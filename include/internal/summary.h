@@ -0,0 +1,51 @@
+#ifndef CLI_INTERNAL_SUMMARY_H
+#define CLI_INTERNAL_SUMMARY_H
+
+//
+// Internal libCLI Compressed Summaries
+//
+// Command summaries may point into a blob generated by the host-side `compress_summaries` tool
+// instead of at plain text. Such summaries are decoded a few bytes at a time, straight into the
+// writeback, so the whole text is never expanded in memory.
+//
+// Blob format (all integers little-endian):
+//     "LCS" version:u8
+//     code_length_counts:u8[16]     number of Huffman codes of each length from 1 to 16 bits
+//     symbols:u8[sum of counts]     symbols in canonical code order
+//     word_count:u8
+//     word_offsets:u16[word_count]  offset in the blob of each dictionary word
+//     words                         length:u8 followed by the word's characters
+//     summaries                     each starts on a byte boundary and ends with symbol 0
+//
+// Symbols 0x01 to 0x7F are literal characters, and symbols from 0x80 are dictionary words. Codes
+// are packed most significant bit first.
+//
+
+#include "cli.h"
+
+#include <stdbool.h>
+
+enum {
+    // Version of the summary blob format
+    summary_blob_version = 1,
+
+    // Size of the fixed part of the blob header, before the symbols
+    summary_blob_header_size = 20,
+
+    // Longest Huffman code in bits
+    summary_max_code_length = 16,
+
+    // The symbol which ends a summary
+    summary_end_symbol = 0,
+
+    // The first symbol which refers to a dictionary word
+    summary_first_word_symbol = 0x80,
+};
+
+// Returns true if `summary` points into the header's compressed summary blob.
+bool libcli_is_compressed_summary(const CliHeader* header, const char* summary);
+
+// Write a command summary, decompressing it if it points into the compressed summary blob.
+void libcli_write_summary(const CliHeader* header, const char* summary);
+
+#endif // CLI_INTERNAL_SUMMARY_H
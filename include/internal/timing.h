@@ -0,0 +1,55 @@
+#ifndef CLI_INTERNAL_TIMING_H
+#define CLI_INTERNAL_TIMING_H
+
+//
+// Internal libCLI Latency Measurement
+//
+// Implements the built-in `time` and `repeat` commands. A timed command is run through
+// `libcli_run` on a copy of the header with `timing` set, which makes each phase of the run record
+// a timestamp as it finishes.
+//
+
+#include "cli.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum TimingPhase {
+    timing_phase_start,
+    timing_phase_parse,
+    timing_phase_lookup,
+    timing_phase_convert,
+    timing_phase_handler,
+    timing_phase_count,
+} TimingPhase;
+
+// Timestamps taken as each phase of a timed run finishes.
+struct CliTiming {
+    uint32_t stamps[timing_phase_count];
+};
+
+// Placeholder functions of the built-in commands. The commands take any number of arguments, so
+// they are dispatched to `libcli_run_time` and `libcli_run_repeat` before argument checking.
+void libcli_time_command(const CliHeader*, size_t, const CliArgument*, void*);
+void libcli_repeat_command(const CliHeader*, size_t, const CliArgument*, void*);
+
+// Add the `time` and `repeat` commands.
+bool libcli_add_timing_commands(CliHeader* header);
+
+// Run `time <command...>` given the strings after `time`.
+CliRunResult libcli_run_time(
+    const CliHeader* header,
+    const char* const* strings,
+    size_t string_count,
+    void* userdata
+);
+
+// Run `repeat <count> <command...>` given the strings after `repeat`.
+CliRunResult libcli_run_repeat(
+    const CliHeader* header,
+    const char* const* strings,
+    size_t string_count,
+    void* userdata
+);
+
+#endif // CLI_INTERNAL_TIMING_H
@@ -0,0 +1,282 @@
+#include "internal/array.h"
+
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+
+// Integer elements are converted eight digits at a time, with the digits loaded into a 64-bit word
+// and checked and combined with a few word-wide operations (SWAR) instead of one per digit.
+
+static const uint64_t ones = 0x0101010101010101u;
+
+// Load `count` (at most eight) digits into a word, right-aligned behind '0' padding, with the
+// first digit in the lowest byte.
+static uint64_t load_digits(const char* digits, size_t count) {
+    char chunk[8];
+    memset(chunk, '0', sizeof(chunk));
+    memcpy(&chunk[sizeof(chunk) - count], digits, count);
+
+    uint64_t word;
+    memcpy(&word, chunk, sizeof(word));
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    word = __builtin_bswap64(word);
+#endif
+
+    return word;
+}
+
+// High bit of each byte set where `low < byte < high`, for bounds below 0x80 (exact per byte, as
+// no byte carries or borrows into the next)
+static uint64_t bytes_between(uint64_t word, uint8_t low, uint8_t high) {
+    uint64_t low_bits = word & (ones * 0x7f);
+    return ((ones * (0x7fu + high)) - low_bits)
+        & ~word
+        & (low_bits + (ones * (0x7fu - low)))
+        & (ones * 0x80);
+}
+
+static bool eight_decimal_digits(uint64_t word, uint32_t* value) {
+    if (bytes_between(word, '0' - 1, '9' + 1) != (ones * 0x80)) {
+        return false;
+    }
+
+    // Combine neighbouring digits, then pairs of those, then the two halves.
+    word -= ones * '0';
+    word = (word * 10) + (word >> 8);
+    word = (((word & 0x000000ff000000ffu) * (100 + (1000000ull << 32)))
+        + (((word >> 16) & 0x000000ff000000ffu) * (1 + (10000ull << 32)))) >> 32;
+
+    *value = (uint32_t)word;
+    return true;
+}
+
+static bool eight_hex_digits(uint64_t word, uint32_t* value) {
+    uint64_t digits = bytes_between(word, '0' - 1, '9' + 1);
+    uint64_t letters = bytes_between(word | (ones * 0x20), 'a' - 1, 'f' + 1);
+
+    if ((digits | letters) != (ones * 0x80)) {
+        return false;
+    }
+
+    // Turn each byte into its nibble, then pack neighbouring nibbles, bytes and halves.
+    uint64_t nibbles = (word & (ones * 0x0f)) + ((letters >> 7) * 9);
+    uint64_t bytes = ((nibbles & 0x000f000f000f000fu) << 4)
+        | ((nibbles >> 8) & 0x000f000f000f000fu);
+    uint64_t halves = ((bytes & 0x000000ff000000ffu) << 8)
+        | ((bytes >> 16) & 0x000000ff000000ffu);
+
+    *value = (uint32_t)(((halves & 0xffffu) << 16) | ((halves >> 32) & 0xffffu));
+    return true;
+}
+
+// Parse 1 to 10 decimal digits
+static bool parse_decimal(const char* digits, size_t count, int64_t* value) {
+    uint32_t high = 0;
+    uint32_t low = 0;
+
+    if ((count == 0) || (count > 10)) {
+        return false;
+    } else if (count <= 8) {
+        bool valid = eight_decimal_digits(load_digits(digits, count), &low);
+        *value = low;
+        return valid;
+    } else {
+        bool valid = eight_decimal_digits(load_digits(digits, count - 8), &high)
+            && eight_decimal_digits(load_digits(&digits[count - 8], 8), &low);
+        *value = ((int64_t)high * 100000000) + low;
+        return valid;
+    }
+}
+
+// Parse 1 to 8 hex digits
+static bool parse_hex(const char* digits, size_t count, int64_t* value) {
+    uint32_t word_value = 0;
+
+    if ((count == 0) || (count > 8)) {
+        return false;
+    }
+
+    bool valid = eight_hex_digits(load_digits(digits, count), &word_value);
+    *value = word_value;
+    return valid;
+}
+
+// Parse a signed decimal or "0x" hex integer between `min` and `max`
+static bool parse_integer(
+    const char* text,
+    size_t length,
+    int64_t min,
+    int64_t max,
+    int64_t* value
+) {
+    bool negative = (length > 0) && (text[0] == '-');
+
+    if ((length > 0) && ((text[0] == '-') || (text[0] == '+'))) {
+        text += 1;
+        length -= 1;
+    }
+
+    int64_t magnitude = 0;
+    bool valid;
+
+    if ((length > 2) && (text[0] == '0') && ((text[1] == 'x') || (text[1] == 'X'))) {
+        valid = parse_hex(&text[2], length - 2, &magnitude);
+    } else {
+        valid = parse_decimal(text, length, &magnitude);
+    }
+
+    *value = negative ? -magnitude : magnitude;
+    return valid && (*value >= min) && (*value <= max);
+}
+
+static size_t element_size(CliArgumentType type) {
+    switch (type) {
+        case cli_argument_type_int_array:
+            return sizeof(int);
+        case cli_argument_type_float_array:
+            return sizeof(float);
+        default:
+            return sizeof(uint8_t);
+    }
+}
+
+static size_t element_alignment(CliArgumentType type) {
+    switch (type) {
+        case cli_argument_type_int_array:
+            return _Alignof(int);
+        case cli_argument_type_float_array:
+            return _Alignof(float);
+        default:
+            return _Alignof(uint8_t);
+    }
+}
+
+// Offset of the first element after the first `used` bytes of the buffer, and how many fit
+static size_t array_start(
+    const CliHeader* header,
+    CliArgumentType type,
+    size_t used,
+    size_t* capacity
+) {
+    uintptr_t base = (uintptr_t)header->array_buffer;
+    uintptr_t alignment = element_alignment(type);
+    size_t start = (size_t)((((base + used) + (alignment - 1)) & ~(alignment - 1)) - base);
+
+    *capacity = (start < header->array_buffer_size)
+        ? (header->array_buffer_size - start) / element_size(type)
+        : 0;
+    return start;
+}
+
+bool libcli_is_array_type(CliArgumentType type) {
+    return (type == cli_argument_type_int_array)
+        || (type == cli_argument_type_u8_array)
+        || (type == cli_argument_type_float_array);
+}
+
+void* libcli_reserve_array(
+    const CliHeader* header,
+    CliArgumentType type,
+    size_t count,
+    size_t* used
+) {
+    size_t capacity = 0;
+    size_t start = array_start(header, type, *used, &capacity);
+
+    if ((header->array_buffer == NULL) || (count > capacity)) {
+        return NULL;
+    }
+
+    *used = start + (count * element_size(type));
+    return (char*)header->array_buffer + start;
+}
+
+static bool is_separator(char c) {
+    return (c == ',') || (c == ' ');
+}
+
+static bool parse_element(
+    const CliHeader* header,
+    CliArgumentType type,
+    const char* text,
+    size_t length,
+    void* elements,
+    size_t index
+) {
+    int64_t value = 0;
+
+    switch (type) {
+        case cli_argument_type_int_array:
+            if (!parse_integer(text, length, INT_MIN, INT_MAX, &value)) {
+                return false;
+            }
+
+            ((int*)elements)[index] = (int)value;
+            return true;
+        case cli_argument_type_u8_array:
+            if (!parse_integer(text, length, 0, UINT8_MAX, &value)) {
+                return false;
+            }
+
+            ((uint8_t*)elements)[index] = (uint8_t)value;
+            return true;
+        case cli_argument_type_float_array:
+            return (header->parse_float != NULL)
+                && header->parse_float(text, &((float*)elements)[index]);
+        default:
+            return false;
+    }
+}
+
+bool libcli_parse_array(
+    const CliHeader* header,
+    CliArgumentType type,
+    char* text,
+    size_t* used,
+    CliArray* out,
+    size_t* error_element,
+    size_t* error_offset
+) {
+    size_t capacity = 0;
+    size_t start = array_start(header, type, *used, &capacity);
+    void* elements = (header->array_buffer != NULL) ? (char*)header->array_buffer + start : NULL;
+
+    size_t count = 0;
+    char* element = text;
+
+    while (true) {
+        while (is_separator(*element)) {
+            element += 1;
+        }
+
+        if (*element == '\0') {
+            break;
+        }
+
+        char* end = element;
+        while ((*end != '\0') && !is_separator(*end)) {
+            end += 1;
+        }
+
+        // Elements are terminated in place, for the float parser.
+        bool last = (*end == '\0');
+        *end = '\0';
+
+        if ((count >= capacity)
+            || !parse_element(header, type, element, (size_t)(end - element), elements, count)
+        ) {
+            *error_element = count;
+            *error_offset = (size_t)(element - text);
+            return false;
+        }
+
+        count += 1;
+        element = last ? end : (end + 1);
+    }
+
+    *used = start + (count * element_size(type));
+    out->data = (count > 0) ? elements : NULL;
+    out->count = count;
+    return true;
+}
@@ -0,0 +1,224 @@
+#include "internal/blob.h"
+
+#include <string.h>
+
+enum {
+    // Table entry of a character which is not a digit. Digits are at most 63, so a block of digits
+    // is valid exactly when the OR of their entries has this bit clear.
+    blob_invalid_digit = 0x80,
+
+    // Hex characters decoded per block
+    hex_block_size = 16,
+
+    // Base64 characters decoded per block
+    base64_block_size = 16,
+};
+
+static const char base64_prefix[] = "b64:";
+
+static const uint8_t hex_digits[256] = {
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+};
+
+static const uint8_t base64_digits[256] = {
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x3E, 0x80, 0x80, 0x80, 0x3F,
+    0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E,
+    0x0F, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x30, 0x31, 0x32, 0x33, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+};
+
+// Find the first character of `text` which is not a digit of `table`
+static size_t find_invalid_digit(const uint8_t* table, const char* text, size_t length) {
+    size_t offset = 0;
+
+    while ((offset < length) && (table[(unsigned char)text[offset]] != blob_invalid_digit)) {
+        offset += 1;
+    }
+
+    return offset;
+}
+
+// Decode `length` hex characters at `text` into `out`, which may be `text` itself. Whole blocks are
+// decoded without branching on each digit, and only checked once the block is done.
+static bool decode_hex(char* text, size_t length, uint8_t* out, size_t* error_offset) {
+    if ((length % 2) != 0) {
+        *error_offset = length;
+        return false;
+    }
+
+    size_t offset = 0;
+
+    for (; (length - offset) >= hex_block_size; offset += hex_block_size) {
+        uint8_t digits[hex_block_size];
+        uint8_t invalid = 0;
+
+        for (size_t i = 0; i < hex_block_size; i++) {
+            digits[i] = hex_digits[(unsigned char)text[offset + i]];
+            invalid |= digits[i];
+        }
+
+        if ((invalid & blob_invalid_digit) != 0) {
+            *error_offset = offset + find_invalid_digit(hex_digits, &text[offset], length - offset);
+            return false;
+        }
+
+        for (size_t i = 0; i < (hex_block_size / 2); i++) {
+            out[(offset / 2) + i] = (uint8_t)((digits[i * 2] << 4) | digits[(i * 2) + 1]);
+        }
+    }
+
+    for (; offset < length; offset += 2) {
+        uint8_t high = hex_digits[(unsigned char)text[offset]];
+        uint8_t low = hex_digits[(unsigned char)text[offset + 1]];
+
+        if (((high | low) & blob_invalid_digit) != 0) {
+            *error_offset = offset + ((high == blob_invalid_digit) ? 0 : 1);
+            return false;
+        }
+
+        out[offset / 2] = (uint8_t)((high << 4) | low);
+    }
+
+    return true;
+}
+
+// Decode a group of four base64 digits into three bytes
+static void decode_base64_group(const uint8_t* digits, uint8_t* out) {
+    uint32_t bits = ((uint32_t)digits[0] << 18)
+        | ((uint32_t)digits[1] << 12)
+        | ((uint32_t)digits[2] << 6)
+        | (uint32_t)digits[3];
+
+    out[0] = (uint8_t)(bits >> 16);
+    out[1] = (uint8_t)(bits >> 8);
+    out[2] = (uint8_t)bits;
+}
+
+// Decode `length` base64 characters at `text` into `out`, which may be at or before `text`.
+// Padding is optional, but only allowed at the end.
+static bool decode_base64(
+    char* text,
+    size_t length,
+    uint8_t* out,
+    size_t* size,
+    size_t* error_offset
+) {
+    size_t padding = 0;
+
+    while ((padding < 2) && (padding < length) && (text[length - padding - 1] == '=')) {
+        padding += 1;
+    }
+
+    size_t digit_count = length - padding;
+
+    if (((padding > 0) && ((length % 4) != 0)) || ((digit_count % 4) == 1)) {
+        *error_offset = length;
+        return false;
+    }
+
+    size_t offset = 0;
+    *size = 0;
+
+    for (; (digit_count - offset) >= base64_block_size; offset += base64_block_size) {
+        uint8_t digits[base64_block_size];
+        uint8_t invalid = 0;
+
+        for (size_t i = 0; i < base64_block_size; i++) {
+            digits[i] = base64_digits[(unsigned char)text[offset + i]];
+            invalid |= digits[i];
+        }
+
+        if ((invalid & blob_invalid_digit) != 0) {
+            break;
+        }
+
+        for (size_t i = 0; i < base64_block_size; i += 4) {
+            decode_base64_group(&digits[i], &out[*size]);
+            *size += 3;
+        }
+    }
+
+    // The rest, and any block with an invalid digit, which is found here
+    uint8_t digits[4] = {0};
+    size_t digit_index = 0;
+
+    for (; offset < digit_count; offset++) {
+        digits[digit_index] = base64_digits[(unsigned char)text[offset]];
+
+        if (digits[digit_index] == blob_invalid_digit) {
+            *error_offset = offset;
+            return false;
+        }
+
+        digit_index += 1;
+
+        if (digit_index == 4) {
+            decode_base64_group(digits, &out[*size]);
+            *size += 3;
+            digit_index = 0;
+        }
+    }
+
+    if (digit_index > 0) {
+        uint8_t group[3];
+        memset(&digits[digit_index], 0, 4 - digit_index);
+        decode_base64_group(digits, group);
+        memcpy(&out[*size], group, digit_index - 1);
+        *size += digit_index - 1;
+    }
+
+    return true;
+}
+
+bool libcli_decode_blob(char* text, CliBlob* out, size_t* error_offset) {
+    size_t length = strlen(text);
+    size_t prefix_length = sizeof(base64_prefix) - 1;
+    uint8_t* data = (uint8_t*)text;
+
+    *error_offset = 0;
+    out->data = data;
+
+    if (strncmp(text, base64_prefix, prefix_length) == 0) {
+        size_t offset = 0;
+        size_t size = 0;
+        char* digits = &text[prefix_length];
+
+        if (!decode_base64(digits, length - prefix_length, data, &size, &offset)) {
+            *error_offset = prefix_length + offset;
+            return false;
+        }
+
+        out->size = size;
+        return true;
+    } else {
+        out->size = length / 2;
+        return decode_hex(text, length, data, error_offset);
+    }
+}
@@ -0,0 +1,193 @@
+#include "internal/cache.h"
+
+#include <string.h>
+
+// FNV-1a parameters used for key hashes
+static const uint32_t fnv_offset_basis = 2166136261u;
+static const uint32_t fnv_prime = 16777619u;
+
+static uint32_t hash_key(const char* key, size_t key_length) {
+    uint32_t hash = fnv_offset_basis;
+
+    for (size_t i = 0; i < key_length; i++) {
+        hash = (hash ^ (unsigned char)key[i]) * fnv_prime;
+    }
+
+    return hash;
+}
+
+static uint32_t now(const CliCache* cache) {
+    return (cache->clock != NULL) ? cache->clock() : 0;
+}
+
+// Returns true if the entry holds an output which may still be served
+static bool is_current(const CliCache* cache, const CliCacheEntry* entry, uint32_t time) {
+    if (!entry->valid || (entry->generation != cache->generation)) {
+        return false;
+    } else if (cache->clock != NULL) {
+        return (uint32_t)(time - entry->stored_at) < cache->time_to_live;
+    } else {
+        return true;
+    }
+}
+
+// Choose the entry to fill next: one which holds nothing current, or else the least recently used.
+// Entries being filled by outer runs are skipped.
+static CliCacheEntry* choose_victim(CliCache* cache, uint32_t time) {
+    CliCacheEntry* victim = NULL;
+
+    for (size_t i = 0; i < cache->capacity; i++) {
+        CliCacheEntry* entry = &cache->entries[i];
+
+        if (entry->filling) {
+            continue;
+        } else if (!is_current(cache, entry, time)) {
+            return entry;
+        } else if ((victim == NULL)
+            || ((uint32_t)(cache->uses - entry->last_used)
+                > (uint32_t)(cache->uses - victim->last_used))
+        ) {
+            victim = entry;
+        }
+    }
+
+    return victim;
+}
+
+CliCache libcli_cache_new(
+    CliCacheEntry* entries,
+    size_t capacity,
+    CliTimestampFunction clock,
+    uint32_t time_to_live
+) {
+    for (size_t i = 0; i < capacity; i++) {
+        entries[i].valid = false;
+        entries[i].filling = false;
+    }
+
+    return (CliCache){
+        .entries = entries,
+        .capacity = capacity,
+        .generation = 0,
+        .uses = 0,
+        .clock = clock,
+        .time_to_live = time_to_live,
+        .hits = 0,
+        .misses = 0,
+    };
+}
+
+void libcli_cache_invalidate(CliCache* cache) {
+    cache->generation += 1;
+}
+
+size_t libcli_cache_hits(const CliCache* cache) {
+    return cache->hits;
+}
+
+size_t libcli_cache_misses(const CliCache* cache) {
+    return cache->misses;
+}
+
+// Internal interface (see internal/cache.h)
+
+const CliCacheEntry* libcli_cache_find(
+    CliCache* cache,
+    const char* key,
+    size_t key_length,
+    CliCommandFunction function
+) {
+    uint32_t hash = hash_key(key, key_length);
+    uint32_t time = now(cache);
+
+    for (size_t i = 0; i < cache->capacity; i++) {
+        CliCacheEntry* entry = &cache->entries[i];
+
+        if ((entry->hash == hash)
+            && (entry->function == function)
+            && (entry->key_length == key_length)
+            && is_current(cache, entry, time)
+            && (memcmp(entry->key, key, key_length) == 0)
+        ) {
+            cache->uses += 1;
+            cache->hits += 1;
+            entry->last_used = cache->uses;
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+void libcli_cache_begin(
+    CliCache* cache,
+    const char* key,
+    size_t key_length,
+    CliCommandFunction function,
+    const CliHeader* header,
+    CacheCapture* capture
+) {
+    uint32_t time = now(cache);
+    CliCacheEntry* entry = choose_victim(cache, time);
+
+    *capture = (CacheCapture){
+        .cache = cache,
+        .entry = entry,
+        .writeback = header->writeback,
+        .writeback_data = header->writeback_data,
+        .generation = cache->generation,
+        .started_at = time,
+        .overflowed = false,
+    };
+
+    cache->misses += 1;
+
+    if (entry != NULL) {
+        entry->valid = false;
+        entry->filling = true;
+        entry->hash = hash_key(key, key_length);
+        entry->function = function;
+        entry->key_length = key_length;
+        entry->output_length = 0;
+        entry->output[0] = '\0';
+        memcpy(entry->key, key, key_length);
+    }
+}
+
+void libcli_cache_writeback(const char* string, void* userdata) {
+    CacheCapture* capture = (CacheCapture*)userdata;
+    CliCacheEntry* entry = capture->entry;
+
+    capture->writeback(string, capture->writeback_data);
+
+    if ((entry == NULL) || capture->overflowed) {
+        return;
+    }
+
+    size_t length = strlen(string);
+
+    if (length >= (cli_cache_output_size - entry->output_length)) {
+        capture->overflowed = true;
+        return;
+    }
+
+    memcpy(&entry->output[entry->output_length], string, length + 1);
+    entry->output_length += length;
+}
+
+void libcli_cache_end(CacheCapture* capture, bool succeeded) {
+    CliCache* cache = capture->cache;
+    CliCacheEntry* entry = capture->entry;
+
+    if (entry == NULL) {
+        return;
+    }
+
+    cache->uses += 1;
+
+    entry->filling = false;
+    entry->valid = succeeded && !capture->overflowed;
+    entry->generation = capture->generation;
+    entry->stored_at = capture->started_at;
+    entry->last_used = cache->uses;
+}
@@ -0,0 +1,279 @@
+#include "cli_channel.h"
+#include "cli_macro.h"
+
+#include <limits.h>
+#include <linux/futex.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+_Static_assert(ATOMIC_INT_LOCK_FREE == 2, "channel counters must be lock-free to be shared");
+_Static_assert(
+    (cli_channel_slot_count & (cli_channel_slot_count - 1)) == 0,
+    "the slot count must divide the range of the free-running counters"
+);
+
+enum {
+    // Marks an initialized region ("LCCH")
+    channel_magic = 0x4843434c,
+
+    // Number of times a side checks for work before going to sleep. Waking a sleeping side costs
+    // a system call on both sides, which a short spin avoids while the other side is busy.
+    channel_spin_count = 256,
+};
+
+static size_t min_size(size_t a, size_t b) {
+    return (a < b) ? a : b;
+}
+
+static uint64_t milliseconds(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return ((uint64_t)time.tv_sec * 1000u) + ((uint64_t)time.tv_nsec / 1000000u);
+}
+
+// Wake the side sleeping on `word`, if it is asleep. `word` must have been written first.
+static void wake(_Atomic uint32_t* word, _Atomic uint32_t* sleeping) {
+    if (atomic_load(sleeping) != 0) {
+        syscall(SYS_futex, (void*)word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+    }
+}
+
+// Wait up to `timeout_ms` milliseconds (or forever if negative) until `word` is no longer `seen`.
+// Returns false if it did not change in time.
+static bool wait_for_change(
+    _Atomic uint32_t* word,
+    uint32_t seen,
+    _Atomic uint32_t* sleeping,
+    int timeout_ms
+) {
+    for (size_t i = 0; i < channel_spin_count; i++) {
+        if (atomic_load(word) != seen) {
+            return true;
+        }
+    }
+
+    uint64_t deadline = milliseconds() + (uint64_t)((timeout_ms > 0) ? timeout_ms : 0);
+
+    while (true) {
+        // Set before checking the word, so a write made after the check always sees it and wakes
+        // this side. The futex only sleeps while the word still holds `seen`.
+        atomic_store(sleeping, 1);
+
+        if (atomic_load(word) != seen) {
+            atomic_store(sleeping, 0);
+            return true;
+        }
+
+        uint64_t now = milliseconds();
+
+        if ((timeout_ms >= 0) && (now >= deadline)) {
+            atomic_store(sleeping, 0);
+            return false;
+        }
+
+        struct timespec remaining = {
+            .tv_sec = (time_t)((deadline - now) / 1000u),
+            .tv_nsec = (long)(((deadline - now) % 1000u) * 1000000u),
+        };
+
+        syscall(
+            SYS_futex,
+            (void*)word,
+            FUTEX_WAIT,
+            seen,
+            (timeout_ms < 0) ? NULL : &remaining,
+            NULL,
+            0
+        );
+        atomic_store(sleeping, 0);
+    }
+}
+
+void libcli_channel_init(CliChannelRegion* region) {
+    memset(region, 0, sizeof(CliChannelRegion));
+    atomic_init(&region->submitted, 0);
+    atomic_init(&region->completed, 0);
+    atomic_init(&region->server_sleeping, 0);
+    atomic_init(&region->client_sleeping, 0);
+    region->magic = channel_magic;
+}
+
+// Server side
+
+CliChannel libcli_channel_new(CliChannelRegion* region) {
+    return (CliChannel){
+        .region = region,
+        .completed = atomic_load(&region->completed),
+        .contexts = libcli_context_stack_new(),
+    };
+}
+
+// The response being written to a slot. Its length is kept here rather than read back from the
+// slot, since the client may write to the shared slot at any time.
+typedef struct {
+    CliChannelSlot* slot;
+    size_t size;
+    size_t dropped;
+} ChannelOutput;
+
+// Append `string` to the slot's response. Output which does not fit is dropped.
+static void channel_writeback(const char* string, void* userdata) {
+    ChannelOutput* output = (ChannelOutput*)userdata;
+
+    size_t length = strlen(string);
+    size_t stored = min_size(length, cli_channel_response_size - output->size);
+
+    memcpy(&output->slot->response[output->size], string, stored);
+    output->size += stored;
+    output->dropped += length - stored;
+}
+
+// Run a copy of the request. The client can write to the slot at any time, so the request is
+// parsed, checked and handed to the command from server memory.
+static CliRunResult run_request(const CliHeader* header, CliChannelSlot* slot, void* userdata) {
+    char request[cli_channel_request_size];
+    memcpy(request, slot->request, sizeof(request));
+
+    if (slot->frame == cli_channel_frame_macro) {
+        size_t size = min_size(slot->request_size, cli_channel_request_size);
+        return libcli_replay(header, (const uint8_t*)request, size, userdata);
+    } else {
+        request[cli_channel_request_size - 1] = '\0';
+        return libcli_run(header, request, userdata);
+    }
+}
+
+size_t libcli_channel_serve(
+    const CliHeader* header,
+    CliChannel* channel,
+    int timeout_ms,
+    void* userdata
+) {
+    CliChannelRegion* region = channel->region;
+    uint32_t completed = channel->completed;
+    uint32_t submitted = atomic_load(&region->submitted);
+
+    if (submitted == completed) {
+        if (!wait_for_change(
+            &region->submitted, completed, &region->server_sleeping, timeout_ms
+        )) {
+            return 0;
+        }
+
+        submitted = atomic_load(&region->submitted);
+    }
+
+    // The client can have at most a slot's worth of requests waiting, so a larger count is
+    // corrupt. Only as many requests as there are slots are run, so each slot runs once at most.
+    uint32_t batch = submitted - completed;
+
+    if (batch > cli_channel_slot_count) {
+        batch = cli_channel_slot_count;
+    }
+
+    CliHeader channel_header = *header;
+    channel_header.writeback = channel_writeback;
+    channel_header.contexts = &channel->contexts;
+    channel_header.transient_output = true;
+
+    for (uint32_t request = completed; request != completed + batch; request++) {
+        ChannelOutput output = {
+            .slot = &region->slots[request % cli_channel_slot_count],
+            .size = 0,
+            .dropped = 0,
+        };
+        channel_header.writeback_data = &output;
+
+        CliRunResult result = run_request(&channel_header, output.slot, userdata);
+        output.slot->result = (int32_t)result;
+        output.slot->response_size = (uint32_t)output.size;
+        output.slot->response_dropped = (uint32_t)output.dropped;
+
+        // Publishes the response, and wakes the client if it is waiting for it.
+        channel->completed = request + 1;
+        atomic_store(&region->completed, request + 1);
+        wake(&region->completed, &region->client_sleeping);
+    }
+
+    return batch;
+}
+
+// Client side
+
+bool libcli_channel_connect(CliChannelClient* client, CliChannelRegion* region) {
+    if (region->magic != channel_magic) {
+        return false;
+    }
+
+    client->region = region;
+    client->received = atomic_load(&region->completed);
+    return true;
+}
+
+// Fill the next free slot with a request, and wake the server
+static bool submit(
+    CliChannelClient* client,
+    CliChannelFrame frame,
+    const void* request,
+    size_t size
+) {
+    CliChannelRegion* region = client->region;
+    uint32_t submitted = atomic_load(&region->submitted);
+
+    if (((uint32_t)(submitted - client->received) >= cli_channel_slot_count)
+        || (size > cli_channel_request_size)
+    ) {
+        return false;
+    }
+
+    CliChannelSlot* slot = &region->slots[submitted % cli_channel_slot_count];
+    slot->frame = (uint32_t)frame;
+    slot->request_size = (uint32_t)size;
+    memcpy(slot->request, request, size);
+
+    atomic_store(&region->submitted, submitted + 1);
+    wake(&region->submitted, &region->server_sleeping);
+    return true;
+}
+
+bool libcli_channel_submit(CliChannelClient* client, const char* line) {
+    return submit(client, cli_channel_frame_line, line, strlen(line) + 1);
+}
+
+bool libcli_channel_submit_macro(CliChannelClient* client, const uint8_t* macro, size_t size) {
+    return submit(client, cli_channel_frame_macro, macro, size);
+}
+
+bool libcli_channel_receive(
+    CliChannelClient* client,
+    int timeout_ms,
+    CliChannelResponse* response
+) {
+    CliChannelRegion* region = client->region;
+    uint32_t received = client->received;
+
+    if (received == atomic_load(&region->submitted)) {
+        return false;
+    }
+
+    uint32_t completed = atomic_load(&region->completed);
+
+    if ((completed == received)
+        && !wait_for_change(&region->completed, completed, &region->client_sleeping, timeout_ms)
+    ) {
+        return false;
+    }
+
+    const CliChannelSlot* slot = &region->slots[received % cli_channel_slot_count];
+    *response = (CliChannelResponse){
+        .result = (CliRunResult)slot->result,
+        .output = slot->response,
+        .output_size = slot->response_size,
+        .output_dropped = slot->response_dropped,
+    };
+
+    client->received = received + 1;
+    return true;
+}
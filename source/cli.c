@@ -1,63 +1,51 @@
 #include "cli.h"
+#include "cli_context.h"
+#include "cli_options.h"
+#include "internal/array.h"
+#include "internal/blob.h"
+#include "internal/cache.h"
+#include "internal/command.h"
+#include "internal/constraints.h"
+#include "internal/fixed.h"
+#include "internal/help.h"
+#include "internal/jobs.h"
+#include "internal/options.h"
 #include "internal/parse.h"
+#include "internal/record.h"
+#include "internal/shared.h"
+#include "internal/summary.h"
+#include "internal/timing.h"
 
 #include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 
-enum {
-    // Maximum number of arguments the parser can handle
-    input_parser_argument_capacity = 16,
-};
+// FNV-1a parameters used for command set fingerprints
+static const uint32_t fnv_offset_basis = 2166136261u;
+static const uint32_t fnv_prime = 16777619u;
 
+// The captured output of a pipeline stage
 typedef struct {
-    bool found;
-    size_t index;
-} SearchResult;
-
-static void dummy_help_command(size_t argc, const CliArgument* argv, void* userdata) {
-    (void)argc;
-    (void)argv;
-    (void)userdata;
-    // Unused. If the help command is selected, a help function is executed instead of this.
-}
+    char* data;
+    size_t size;
+    size_t length;
+} PipeOutput;
 
 static void writeback(const CliHeader* header, const char* string) {
     header->writeback(string, header->writeback_data);
 }
 
-static void run_help_command(const CliHeader* header) {
-    writeback(header, "list of commands:");
-
-    for (size_t i = 0; i < header->count; i++) {
-        CliCommand command = header->commands[i];
-
-        writeback(header, "\n    ");
-        writeback(header, command.name);
-
-        size_t name_length = strlen(command.name);
-        for (size_t j = name_length; j < header->longest_command_name_length; j++) {
-            writeback(header, " ");
-        }
-
-        writeback(header, "    ");
-        writeback(header, command.summary);
-    }
-
-    writeback(header, "\n");
-}
-
-// Perform a binary search for a command called `name`.
-static SearchResult find_command_by_name(const CliHeader* header, const char* name) {
-    size_t size = header->count;
+// Perform a binary search for a command called `name` in a sorted table of commands.
+static SearchResult find_in_table(const CliCommand* commands, size_t count, const char* name) {
+    size_t size = count;
     size_t left = 0;
     size_t right = size;
 
     while (left < right) {
         size_t mid = left + size / 2;
 
-        const CliCommand* command = &header->commands[mid];
+        const CliCommand* command = &commands[mid];
         int cmp = strcmp(command->name, name);
 
         if (cmp < 0) {
@@ -74,6 +62,40 @@ static SearchResult find_command_by_name(const CliHeader* header, const char* na
     return (SearchResult) { false, left };
 }
 
+// Perform a binary search for a command called `name`.
+static SearchResult find_command_by_name(const CliHeader* header, const char* name) {
+    return find_in_table(header->commands, header->count, name);
+}
+
+// Find a command in the active contexts, innermost first, and then in the global commands.
+static const CliCommand* lookup_command(const CliHeader* header, const char* name) {
+    const CliContextStack* stack = header->contexts;
+    size_t depth = (stack != NULL) ? stack->depth : 0;
+
+    for (size_t i = depth; i > 0; i--) {
+        const CliContext* context = stack->entries[i - 1].context;
+        SearchResult search = find_in_table(context->commands, context->count, name);
+
+        if (search.found) {
+            return &context->commands[search.index];
+        }
+    }
+
+    SearchResult search = find_command_by_name(header, name);
+    return search.found ? &header->commands[search.index] : NULL;
+}
+
+static size_t longest_name_length(const CliCommand* commands, size_t count) {
+    size_t longest = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        size_t length = strlen(commands[i].name);
+        longest = (length > longest) ? length : longest;
+    }
+
+    return longest;
+}
+
 static void update_longest_name_length(CliHeader* header, const char* name) {
     size_t length = strlen(name);
 
@@ -82,6 +104,103 @@ static void update_longest_name_length(CliHeader* header, const char* name) {
     }
 }
 
+static uint32_t hash_bytes(uint32_t hash, const void* data, size_t size) {
+    const unsigned char* bytes = (const unsigned char*)data;
+
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * fnv_prime;
+    }
+
+    return hash;
+}
+
+static uint32_t hash_string(uint32_t hash, const char* string) {
+    return hash_bytes(hash, string, strlen(string) + 1);
+}
+
+// A hash of a converted value of type `type`. Blobs and arrays are hashed by their size only.
+static uint32_t hash_value(uint32_t hash, CliArgumentType type, const CliArgument* value) {
+    switch (type) {
+        case cli_argument_type_string:
+            return (value->string != NULL) ? hash_string(hash, value->string) : hash;
+        case cli_argument_type_int:
+            return hash_bytes(hash, &value->integer, sizeof(value->integer));
+        case cli_argument_type_float:
+            return hash_bytes(hash, &value->float_, sizeof(value->float_));
+        case cli_argument_type_fixed:
+            return hash_bytes(hash, &value->fixed, sizeof(value->fixed));
+        case cli_argument_type_blob:
+            return hash_bytes(hash, &value->blob.size, sizeof(value->blob.size));
+        default:
+            return hash_bytes(hash, &value->array.count, sizeof(value->array.count));
+    }
+}
+
+// A hash of what a constraint allows. Predicates are hashed by kind only, since function addresses
+// differ between the processes which compile and replay macros.
+static uint32_t hash_constraint(uint32_t hash, const CliConstraint* constraint) {
+    unsigned char kind = (unsigned char)constraint->kind;
+    hash = hash_bytes(hash, &constraint->argument, sizeof(constraint->argument));
+    hash = hash_bytes(hash, &kind, 1);
+
+    switch (constraint->kind) {
+        case cli_constraint_range:
+            hash = hash_bytes(hash, &constraint->range.min, sizeof(constraint->range.min));
+            return hash_bytes(hash, &constraint->range.max, sizeof(constraint->range.max));
+        case cli_constraint_length:
+            hash = hash_bytes(hash, &constraint->length.min, sizeof(constraint->length.min));
+            return hash_bytes(hash, &constraint->length.max, sizeof(constraint->length.max));
+        case cli_constraint_charset:
+            return hash_string(hash, constraint->charset);
+        case cli_constraint_one_of:
+            for (size_t i = 0; i < constraint->one_of.count; i++) {
+                hash = hash_string(hash, constraint->one_of.values[i]);
+            }
+            return hash;
+        case cli_constraint_predicate:
+            return hash;
+    }
+
+    return hash;
+}
+
+static uint32_t hash_option(uint32_t hash, const CliOption* option) {
+    unsigned char flags[3] = {
+        (unsigned char)option->short_name,
+        (unsigned char)option->takes_value,
+        (unsigned char)option->type,
+    };
+
+    hash = hash_string(hash, option->name);
+    hash = hash_bytes(hash, flags, sizeof(flags));
+    return option->takes_value ? hash_value(hash, option->type, &option->default_value) : hash;
+}
+
+// A hash of a command's name, signature, options and constraints. The header fingerprint is the
+// sum of these, which identifies the set of commands (and so their sorted order) no matter the
+// order they were added. Macros replay converted values, so a command re-added with other options
+// or constraints must change it too.
+static uint32_t command_fingerprint(const CliCommand* command) {
+    uint32_t hash = hash_string(fnv_offset_basis, command->name);
+
+    for (size_t i = 0; i < command->argument_count; i++) {
+        unsigned char type = (unsigned char)command->arguments[i];
+        hash = hash_bytes(hash, &type, 1);
+    }
+
+    if (command->options != NULL) {
+        for (size_t i = 0; i < command->options->count; i++) {
+            hash = hash_option(hash, &command->options->options[i]);
+        }
+    }
+
+    for (size_t i = 0; i < command->constraint_count; i++) {
+        hash = hash_constraint(hash, &command->constraints[i]);
+    }
+
+    return hash;
+}
+
 static void insert_command(
     CliHeader* header,
     size_t index,
@@ -94,37 +213,87 @@ static void insert_command(
     header->commands[index] = command;
 }
 
-static bool add_command(
-    CliHeader* header,
-    const char* name,
-    const char* summary,
+// Returns true if the header can convert every argument type in `arguments`.
+static bool can_convert_arguments(
+    const CliHeader* header,
     size_t argument_count,
-    const CliArgumentType* arguments,
-    CliCommandFunction function
+    const CliArgumentType* arguments
 ) {
-    SearchResult result = find_command_by_name(header, name);
+    for (size_t i = 0; i < argument_count; i++) {
+        bool is_float = (arguments[i] == cli_argument_type_float)
+            || (arguments[i] == cli_argument_type_float_array);
 
-    if (result.found) {
-        return false;
-    } else if (argument_count > cli_max_argument_count) {
+        if (is_float && (header->parse_float == NULL)) {
+            return false;
+        } else if (libcli_is_array_type(arguments[i]) && (header->array_buffer == NULL)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Returns true if the header can convert the value of every option in the table.
+static bool can_convert_options(const CliHeader* header, const CliOptionTable* options) {
+    for (size_t i = 0; (options != NULL) && (i < options->count); i++) {
+        const CliOption* option = &options->options[i];
+
+        if (option->takes_value && !can_convert_arguments(header, 1, &option->type)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool insert_new_command(CliHeader* header, CliCommand command) {
+    SearchResult result = find_command_by_name(header, command.name);
+
+    if (result.found || (header->count >= header->capacity)) {
         return false;
     } else {
-        CliCommand command = {
-            .name = name,
-            .summary = summary,
-            .function = function,
-            .argument_count = argument_count,
-        };
-        memcpy(command.arguments, arguments, sizeof(CliArgumentType) * argument_count);
-
         insert_command(header, result.index, command);
 
-        update_longest_name_length(header, name);
+        update_longest_name_length(header, command.name);
+        header->fingerprint += command_fingerprint(&command);
+        libcli_index_command(header, &command);
 
         return true;
     }
 }
 
+static bool add_command(CliHeader* header, const CliCommandInfo* info) {
+    if (info->argument_count > cli_max_argument_count) {
+        return false;
+    } else if (!can_convert_arguments(header, info->argument_count, info->arguments)) {
+        return false;
+    } else if (!can_convert_options(header, info->options)) {
+        return false;
+    } else if (!libcli_constraints_fit(
+        info->constraints, info->constraint_count, info->argument_count, info->arguments
+    )) {
+        return false;
+    }
+
+    CliCommand command = {
+        .name = info->name,
+        .summary = info->summary,
+        .function = info->function,
+        .argument_count = info->argument_count,
+        .options = info->options,
+        .constraints = info->constraints,
+        .constraint_count = info->constraint_count,
+        .cacheable = info->cacheable,
+    };
+    memcpy(command.arguments, info->arguments, sizeof(CliArgumentType) * info->argument_count);
+
+    if (header->shared != NULL) {
+        return libcli_shared_add(header->shared, header->capacity, &command);
+    } else {
+        return insert_new_command(header, command);
+    }
+}
+
 CliHeader libcli_new(const CliNewInfo* info) {
     CliHeader header = (CliHeader){
         .capacity = info->commands_size,
@@ -132,9 +301,44 @@ CliHeader libcli_new(const CliNewInfo* info) {
         .commands = info->commands,
         .writeback = info->writeback,
         .writeback_data = info->writeback_data,
+        .pipe_buffer = info->pipe_buffer,
+        .pipe_buffer_size = info->pipe_buffer_size,
+        .pipe_input = NULL,
+        .fingerprint = 0,
+        .timestamp = info->timestamp,
+        .timing = NULL,
+        .validate_utf8 = info->validate_utf8,
+        .error = NULL,
+        .summary_blob = info->summary_blob,
+        .summary_blob_size = info->summary_blob_size,
+        .resolve = NULL,
+        .resolve_data = NULL,
+        .recorder = info->recorder,
+        .parse_float = info->parse_float,
+        .keywords = info->keywords,
+        .keyword_capacity = (info->keywords != NULL) ? info->keywords_size : 0,
+        .keyword_count = 0,
+        .keywords_complete = (info->keywords != NULL),
+        .contexts = info->contexts,
+        .options = NULL,
+        .shared = NULL,
+        .read_only = false,
+        .array_buffer = info->array_buffer,
+        .array_buffer_size = (info->array_buffer != NULL) ? info->array_buffer_size : 0,
+        .cache = info->cache,
+        .jobs = info->jobs,
+        .transient_output = false,
     };
 
-    libcli_add(&header, "help", "displays information about commands", 0, NULL, dummy_help_command);
+    libcli_add(&header, "help", "displays information about commands", 0, NULL, libcli_help_command);
+
+    if (info->timestamp != NULL) {
+        libcli_add_timing_commands(&header);
+    }
+
+    if (info->jobs != NULL) {
+        libcli_add_job_commands(&header);
+    }
 
     return header;
 }
@@ -147,30 +351,168 @@ bool libcli_add(
     const CliArgumentType* arguments,
     CliCommandFunction function
 ) {
-    if (header->count < header->capacity) {
-        return add_command(header, name, summary, argument_count, arguments, function);
-    } else {
+    CliCommandInfo info = {
+        .name = name,
+        .summary = summary,
+        .argument_count = argument_count,
+        .arguments = arguments,
+        .function = function,
+    };
+    return add_command(header, &info);
+}
+
+bool libcli_add_with_options(
+    CliHeader* header,
+    const char* name,
+    const char* summary,
+    size_t argument_count,
+    const CliArgumentType* arguments,
+    const CliOptionTable* options,
+    CliCommandFunction function
+) {
+    CliCommandInfo info = {
+        .name = name,
+        .summary = summary,
+        .argument_count = argument_count,
+        .arguments = arguments,
+        .options = options,
+        .function = function,
+    };
+    return add_command(header, &info);
+}
+
+bool libcli_add_command(CliHeader* header, const CliCommandInfo* info) {
+    return add_command(header, info);
+}
+
+bool libcli_remove(CliHeader* header, const char* name) {
+    if (header->shared != NULL) {
+        return libcli_shared_remove(header->shared, name);
+    }
+
+    SearchResult result = find_command_by_name(header, name);
+
+    if (!result.found) {
         return false;
     }
+
+    CliCommand command = header->commands[result.index];
+    size_t move_size = (header->count - result.index - 1) * sizeof(CliCommand);
+    memmove(&header->commands[result.index], &header->commands[result.index + 1], move_size);
+
+    header->count -= 1;
+    header->fingerprint -= command_fingerprint(&command);
+    header->longest_command_name_length = longest_name_length(header->commands, header->count);
+    libcli_unindex_command(header, &command);
+
+    return true;
+}
+
+// Record the input offset of an error, if the caller asked for error details
+static void report_error_offset(const CliHeader* header, size_t offset) {
+    if (header->error != NULL) {
+        header->error->offset = offset;
+    }
 }
 
-// With validated arguments, run a given command
-static CliRunResult run_command(
+static void report_error_argument(const CliHeader* header, size_t argument) {
+    if (header->error != NULL) {
+        header->error->argument = argument;
+    }
+}
+
+static void report_error_constraint(const CliHeader* header, size_t argument, size_t constraint) {
+    if (header->error != NULL) {
+        header->error->argument = argument;
+        header->error->constraint = constraint;
+    }
+}
+
+static void report_error_element(const CliHeader* header, size_t element, size_t offset) {
+    if (header->error != NULL) {
+        header->error->element = element;
+        header->error->offset = offset;
+    }
+}
+
+// Record the end of a phase of `libcli_run`, if the run is being timed
+static void mark_phase(const CliHeader* header, TimingPhase phase) {
+    if (header->timing != NULL) {
+        header->timing->stamps[phase] = header->timestamp();
+    }
+}
+
+// Run a command added without a function, binding its real function on first use. The binding is
+// stored in the command table, so later runs go straight to the function.
+static CliRunResult run_lazy_command(
     const CliHeader* header,
     CliCommand command,
     size_t argc,
     const CliArgument* argv,
     void* userdata
 ) {
-    if (command.function == dummy_help_command) {
-        run_help_command(header);
-        return cli_run_result_ok;
+    CliCommandFunction function = (header->resolve != NULL)
+        ? header->resolve(command.name, header->resolve_data)
+        : NULL;
+
+    if (function == NULL) {
+        return cli_run_result_bad_module;
+    }
+
+    SearchResult search = find_command_by_name(header, command.name);
+
+    // Shared tables are immutable, so their commands are resolved on every run.
+    if (search.found && !header->read_only) {
+        header->commands[search.index].function = function;
+    }
+
+    function(header, argc, argv, userdata);
+    return cli_run_result_ok;
+}
+
+static CliRunResult dispatch_command(
+    const CliHeader* header,
+    CliCommand command,
+    size_t argc,
+    const CliArgument* argv,
+    void* userdata
+) {
+    if (command.function == libcli_help_command) {
+        return libcli_run_help(header, NULL, 0);
+    } else if (command.function == NULL) {
+        return run_lazy_command(header, command, argc, argv, userdata);
     } else {
-        command.function(argc, argv, userdata);
+        command.function(header, argc, argv, userdata);
         return cli_run_result_ok;
     }
 }
 
+// With validated arguments, run a given command. `options` are the options given to the command,
+// or NULL to run it with its default options.
+static CliRunResult run_command(
+    const CliHeader* header,
+    CliCommand command,
+    size_t argc,
+    const CliArgument* argv,
+    const CliOptions* options,
+    void* userdata
+) {
+    if ((command.options == NULL) && (header->options == NULL)) {
+        return dispatch_command(header, command, argc, argv, userdata);
+    }
+
+    CliOptions defaults;
+    if ((command.options != NULL) && (options == NULL)) {
+        libcli_default_options(command.options, &defaults);
+        options = &defaults;
+    }
+
+    CliHeader option_header = *header;
+    option_header.options = (command.options != NULL) ? options : NULL;
+
+    return dispatch_command(&option_header, command, argc, argv, userdata);
+}
+
 static bool parse_int(const char* string, int* out) {
     char* end = NULL;
     long value = strtol(string, &end, 0);
@@ -183,13 +525,44 @@ static bool parse_int(const char* string, int* out) {
     }
 }
 
-static bool parse_float(const char* string, float* out) {
-    char* end = NULL;
-    *out = strtof(string, &end);
-    return *end == '\0';
+// Tokens always point into the caller's (writable) input buffer, so blobs are decoded in place.
+static bool parse_blob(const CliHeader* header, const char* input, CliBlob* output) {
+    size_t error_offset = 0;
+
+    if (libcli_decode_blob((char*)input, output, &error_offset)) {
+        return true;
+    } else {
+        report_error_offset(header, error_offset);
+        return false;
+    }
+}
+
+// Like blobs, arrays are parsed in place, into the array buffer after the line's earlier arrays.
+static bool parse_array(
+    const CliHeader* header,
+    CliArgumentType type,
+    const char* input,
+    size_t* array_used,
+    CliArray* output
+) {
+    size_t element = 0;
+    size_t offset = 0;
+
+    if (libcli_parse_array(header, type, (char*)input, array_used, output, &element, &offset)) {
+        return true;
+    } else {
+        report_error_element(header, element, offset);
+        return false;
+    }
 }
 
-static bool parse_argument(CliArgumentType type, const char* input, CliArgument* output) {
+static bool parse_argument(
+    const CliHeader* header,
+    CliArgumentType type,
+    const char* input,
+    size_t* array_used,
+    CliArgument* output
+) {
     output->type = type;
 
     switch (type) {
@@ -199,65 +572,433 @@ static bool parse_argument(CliArgumentType type, const char* input, CliArgument*
         case cli_argument_type_int:
             return parse_int(input, &output->integer);
         case cli_argument_type_float:
-            return parse_float(input, &output->float_);
+            return (header->parse_float != NULL) && header->parse_float(input, &output->float_);
+        case cli_argument_type_fixed:
+            return libcli_parse_fixed(input, cli_fixed_fraction_bits, &output->fixed);
+        case cli_argument_type_blob:
+            return parse_blob(header, input, &output->blob);
+        case cli_argument_type_int_array:
+        case cli_argument_type_u8_array:
+        case cli_argument_type_float_array:
+            return parse_array(header, type, input, array_used, &output->array);
     }
 
     return false;
 }
 
-// Given a command, run it with given arguments
-static CliRunResult run_arguments(
+static bool is_variadic_command(CliCommand command) {
+    return (command.function == libcli_help_command)
+        || (command.function == libcli_time_command)
+        || (command.function == libcli_repeat_command)
+        || (command.function == libcli_every_command)
+        || (command.function == libcli_watch_command);
+}
+
+// A line being tokenized. Each stage's command is looked up as soon as its name ends, and each
+// argument is converted as soon as it ends, so bad input is rejected before the rest is read.
+typedef struct Line {
+    const CliHeader* header;
+    const char* strings[input_parser_argument_capacity];
+    CliArgument arguments[input_parser_argument_capacity];
+
+    // For the first token of each stage, the stage's command
+    const CliCommand* stage_commands[input_parser_argument_capacity];
+
+    // For each argument token, 0 if it is a positional argument, `option_word` if it is skipped,
+    // and otherwise one more than the index of the option whose value it holds
+    uint8_t token_options[input_parser_argument_capacity];
+
+    // Number of tokens seen, including pipeline separators and tokens past the capacity
+    size_t token_count;
+    size_t stage_start;
+    CliCommand command;
+
+    // Positional arguments of the stage, the option waiting for its value (plus one), and whether
+    // `--` ended the stage's options
+    size_t stage_argc;
+    size_t pending_option;
+    bool options_ended;
+
+    // Bytes of the array buffer taken by the line's arrays
+    size_t array_used;
+
+    bool variadic;
+    bool pipeline;
+    CliRunResult result;
+
+    // Whether the line may be served from the header's cache, and its words, each terminated
+    bool cacheable;
+    size_t cache_key_length;
+    char cache_key[cli_cache_key_size];
+} Line;
+
+enum {
+    // Marks an option word whose value is the next token, or the `--` which ends options
+    option_word = UINT8_MAX,
+};
+
+static bool reject_line(Line* line, CliRunResult result) {
+    line->result = result;
+    return false;
+}
+
+// Reject the line for a bad option word or value in the token at `index`
+static bool reject_option(Line* line, size_t index) {
+    report_error_argument(line->header, index - line->stage_start - 1);
+    return reject_line(line, cli_run_result_bad_option);
+}
+
+// Finish the stage which ends before the token at `end`. Returns false if it is not valid.
+static bool end_stage(Line* line, size_t end) {
+    if (end == line->stage_start) {
+        return reject_line(line, cli_run_result_bad_pipe);
+    } else if (line->pending_option != 0) {
+        // The last option word has no value
+        return reject_option(line, end - 1);
+    } else if (!line->variadic && (line->stage_argc != line->command.argument_count)) {
+        return reject_line(line, cli_run_result_bad_argc);
+    } else {
+        return true;
+    }
+}
+
+static bool lookup_stage_command(Line* line, size_t index, const char* name) {
+    const CliCommand* command = lookup_command(line->header, name);
+
+    if (command == NULL) {
+        return reject_line(line, cli_run_result_unknown);
+    }
+
+    line->stage_commands[index] = command;
+    line->command = *command;
+    line->stage_argc = 0;
+    line->pending_option = 0;
+    line->options_ended = false;
+    line->variadic = is_variadic_command(line->command);
+    line->cacheable = (index == 0) && (line->header->cache != NULL) && command->cacheable;
+    return true;
+}
+
+// Add a word to the line's cache key, before conversion modifies it in place. Lines which do not
+// fit are not cached.
+static void add_cache_word(Line* line, const char* word) {
+    size_t size = strlen(word) + 1;
+
+    if (!line->cacheable) {
+        return;
+    } else if (size > (cli_cache_key_size - line->cache_key_length)) {
+        line->cacheable = false;
+    } else {
+        memcpy(&line->cache_key[line->cache_key_length], word, size);
+        line->cache_key_length += size;
+    }
+}
+
+// Convert the value of the option at `option`, held by the token at `index`
+static bool convert_option_value(Line* line, size_t index, size_t option, const char* input) {
+    const CliOption* schema = &line->command.options->options[option];
+    line->token_options[index] = (uint8_t)(option + 1);
+
+    CliArgument* value = &line->arguments[index];
+
+    if (parse_argument(line->header, schema->type, input, &line->array_used, value)) {
+        return true;
+    } else {
+        return reject_option(line, index);
+    }
+}
+
+// Look up an option word, and convert its value if it is included (`--name=value`)
+static bool convert_option(Line* line, size_t index, const char* word) {
+    const char* value = NULL;
+    size_t option = libcli_find_option(line->command.options, word, &value);
+
+    if (option == option_not_found) {
+        return reject_option(line, index);
+    }
+
+    const CliOption* schema = &line->command.options->options[option];
+
+    if (!schema->takes_value && (value != NULL)) {
+        // Flags cannot be given a value
+        return reject_option(line, index);
+    } else if (!schema->takes_value) {
+        line->token_options[index] = (uint8_t)(option + 1);
+        line->arguments[index] = (CliArgument){ .type = cli_argument_type_int, .integer = 1 };
+        return true;
+    } else if (value == NULL) {
+        line->token_options[index] = option_word;
+        line->pending_option = option + 1;
+        return true;
+    } else {
+        return convert_option_value(line, index, option, value);
+    }
+}
+
+static bool convert_positional_argument(Line* line, size_t index, const char* input) {
+    size_t argument = line->stage_argc;
+    line->token_options[index] = 0;
+    line->stage_argc += 1;
+
+    if (argument >= line->command.argument_count) {
+        return reject_line(line, cli_run_result_bad_argc);
+    }
+
+    CliArgumentType type = line->command.arguments[argument];
+    CliArgument* value = &line->arguments[index];
+    size_t failed = 0;
+
+    if (!parse_argument(line->header, type, input, &line->array_used, value)) {
+        report_error_argument(line->header, argument);
+        return reject_line(line, cli_run_result_bad_argument);
+    } else if (!libcli_check_constraints(&line->command, argument, value, &failed)) {
+        report_error_constraint(line->header, argument, failed);
+        return reject_line(line, cli_run_result_failed_constraint);
+    } else {
+        return true;
+    }
+}
+
+static bool convert_stage_argument(Line* line, size_t index, const char* input) {
+    if (line->variadic) {
+        // Built-in variadic commands take their arguments unconverted.
+        return true;
+    } else if (line->command.options == NULL) {
+        return convert_positional_argument(line, index, input);
+    } else if (line->pending_option != 0) {
+        size_t option = line->pending_option - 1;
+        line->pending_option = 0;
+        return convert_option_value(line, index, option, input);
+    } else if (line->options_ended) {
+        return convert_positional_argument(line, index, input);
+    } else if (strcmp(input, "--") == 0) {
+        line->token_options[index] = option_word;
+        line->options_ended = true;
+        return true;
+    } else if (libcli_is_option_word(input)) {
+        return convert_option(line, index, input);
+    } else {
+        return convert_positional_argument(line, index, input);
+    }
+}
+
+static bool check_token(Line* line, size_t index, const char* token) {
+    if (index >= input_parser_argument_capacity) {
+        return reject_line(line, cli_run_result_bad_argc);
+    } else if (token == NULL) {
+        bool ended = end_stage(line, index);
+        line->pipeline = true;
+        line->cacheable = false;
+        line->stage_start = index + 1;
+        return ended;
+    } else if (index == line->stage_start) {
+        bool found = lookup_stage_command(line, index, token);
+        add_cache_word(line, token);
+        return found;
+    } else {
+        add_cache_word(line, token);
+        return convert_stage_argument(line, index, token);
+    }
+}
+
+// Called by the parser as each token ends. The phases of a timed run are interleaved, so they are
+// marked once each rather than per token: parsing ends with the first command's name, lookup is
+// the lookup of that command, and conversion is the rest of the line, tokenized and converted
+// together.
+static bool on_token(const char* token, void* data) {
+    Line* line = (Line*)data;
+    size_t index = line->token_count;
+    line->token_count += 1;
+
+    if ((index != 0) || (token == NULL)) {
+        return check_token(line, index, token);
+    }
+
+    mark_phase(line->header, timing_phase_parse);
+    bool found = check_token(line, index, token);
+    mark_phase(line->header, timing_phase_lookup);
+
+    return found;
+}
+
+// Run a built-in command which takes a varying number of unconverted arguments
+static CliRunResult run_variadic_command(
     const CliHeader* header,
     CliCommand command,
     size_t argc,
     const char* const* strings,
     void* userdata
 ) {
-    if (argc != command.argument_count) {
-        return cli_run_result_bad_argc;
+    if (command.function == libcli_help_command) {
+        return libcli_run_help(header, strings, argc);
+    } else if (command.function == libcli_time_command) {
+        return libcli_run_time(header, strings, argc, userdata);
+    } else if (command.function == libcli_repeat_command) {
+        return libcli_run_repeat(header, strings, argc, userdata);
+    } else if (command.function == libcli_every_command) {
+        return libcli_run_every(header, strings, argc);
     } else {
-        CliArgument argv[input_parser_argument_capacity - 1];
+        return libcli_run_watch(header, strings, argc);
+    }
+}
 
-        for (size_t i = 0; i < argc; i++) {
-            CliArgumentType expected_type = command.arguments[i];
+// Gather the positional arguments and options of a command which takes options, and run it
+static CliRunResult run_with_options(
+    const CliHeader* header,
+    const Line* line,
+    CliCommand command,
+    size_t start,
+    size_t end,
+    void* userdata
+) {
+    CliOptions options;
+    libcli_default_options(command.options, &options);
 
-            bool success = parse_argument(expected_type, strings[i], &argv[i]);
+    CliArgument argv[cli_max_argument_count];
+    size_t argc = 0;
 
-            if (!success) {
-                return cli_run_result_bad_argument;
-            }
-        }
+    for (size_t i = start + 1; i < end; i++) {
+        size_t option = line->token_options[i];
 
-        return run_command(header, command, argc, argv, userdata);
+        if (option == 0) {
+            argv[argc] = line->arguments[i];
+            argc += 1;
+        } else if (option != option_word) {
+            options.values[option - 1] = line->arguments[i];
+            options.present |= (uint32_t)1 << (option - 1);
+        }
     }
+
+    return run_command(header, command, argc, argv, &options, userdata);
 }
 
-// Execute a command based on tokenized arguments
-static CliRunResult run_parsed_input(
+// Run the already checked stage of `line` from `start` to the token before `end`
+static CliRunResult run_stage(
     const CliHeader* header,
-    const char* const* strings,
-    size_t string_count,
+    const Line* line,
+    size_t start,
+    size_t end,
     void* userdata
 ) {
-    if (string_count == 0) {
-        return cli_run_result_ok;
+    CliCommand command = *line->stage_commands[start];
+    size_t argc = end - start - 1;
+    CliRunResult result;
+
+    if (is_variadic_command(command)) {
+        result = run_variadic_command(header, command, argc, &line->strings[start + 1], userdata);
+    } else if (command.options != NULL) {
+        result = run_with_options(header, line, command, start, end, userdata);
     } else {
-        const char* command_name = strings[0];
-        SearchResult search = find_command_by_name(header, command_name);
+        result = run_command(header, command, argc, &line->arguments[start + 1], NULL, userdata);
+    }
 
-        if (!search.found) {
-            return cli_run_result_unknown;
-        } else {
-            CliCommand command = header->commands[search.index];
-            return run_arguments(header, command, string_count - 1, &strings[1], userdata);
+    mark_phase(header, timing_phase_handler);
+    return result;
+}
+
+// Serve a line of a cacheable command from the header's cache, or run it and capture its output
+static CliRunResult run_cached_stage(const CliHeader* header, const Line* line, void* userdata) {
+    CliCommandFunction function = line->stage_commands[0]->function;
+    const CliCacheEntry* entry = libcli_cache_find(
+        header->cache, line->cache_key, line->cache_key_length, function
+    );
+
+    if (entry != NULL) {
+        if (entry->output_length > 0) {
+            writeback(header, entry->output);
         }
+
+        mark_phase(header, timing_phase_handler);
+        return cli_run_result_ok;
     }
+
+    CacheCapture capture;
+    libcli_cache_begin(
+        header->cache, line->cache_key, line->cache_key_length, function, header, &capture
+    );
+
+    CliHeader capturing = *header;
+    capturing.writeback = libcli_cache_writeback;
+    capturing.writeback_data = &capture;
+    capturing.transient_output = true;
+
+    CliRunResult result = run_stage(&capturing, line, 0, line->token_count, userdata);
+    libcli_cache_end(&capture, result == cli_run_result_ok);
+    return result;
 }
 
-CliRunResult libcli_run(const CliHeader* header, char* input, void* userdata) {
-    const char* argument_strings[input_parser_argument_capacity];
-    ParseResult result = libcli_parse(input, argument_strings, input_parser_argument_capacity);
+// Append `string` to a pipeline stage's output, truncating it if the buffer is full.
+static void pipe_writeback(const char* string, void* userdata) {
+    PipeOutput* output = (PipeOutput*)userdata;
+
+    size_t length = strlen(string);
+    size_t space = output->size - output->length - 1;
 
+    if (length > space) {
+        length = space;
+    }
+
+    memcpy(&output->data[output->length], string, length);
+    output->length += length;
+    output->data[output->length] = '\0';
+}
+
+// Find the end of the pipeline stage starting at `start`
+static size_t find_stage_end(const char* const* strings, size_t start, size_t string_count) {
+    size_t end = start;
+
+    while ((end < string_count) && (strings[end] != NULL)) {
+        end += 1;
+    }
+
+    return end;
+}
+
+// Execute each stage of a checked pipeline in order. The output of every stage except the last is
+// captured in one half of the pipe buffer and handed to the next stage as its input.
+static CliRunResult run_pipeline(const CliHeader* header, const Line* line, void* userdata) {
+    size_t half_size = header->pipe_buffer_size / 2;
+
+    if ((header->pipe_buffer == NULL) || (half_size == 0)) {
+        return cli_run_result_bad_pipe;
+    }
+
+    // Jobs started by a stage would outlive the pipeline's output
+    CliHeader stage = *header;
+    stage.transient_output = true;
+    size_t start = 0;
+
+    for (size_t index = 0; ; index++) {
+        size_t end = find_stage_end(line->strings, start, line->token_count);
+
+        if (end == line->token_count) {
+            stage.writeback = header->writeback;
+            stage.writeback_data = header->writeback_data;
+            return run_stage(&stage, line, start, end, userdata);
+        }
+
+        PipeOutput output = {
+            .data = &header->pipe_buffer[(index % 2) * half_size],
+            .size = half_size,
+            .length = 0,
+        };
+        output.data[0] = '\0';
+
+        stage.writeback = pipe_writeback;
+        stage.writeback_data = &output;
+
+        CliRunResult result = run_stage(&stage, line, start, end, userdata);
+
+        if (result != cli_run_result_ok) {
+            return result;
+        }
+
+        stage.pipe_input = output.data;
+        start = end + 1;
+    }
+}
+
+static CliRunResult parse_status_result(const CliHeader* header, ParseResult result) {
     switch (result.status) {
         case parse_status_eof_after_slash:
             return cli_run_result_eof_after_slash;
@@ -265,9 +1006,191 @@ CliRunResult libcli_run(const CliHeader* header, char* input, void* userdata) {
             return cli_run_result_unterminated_double_quote;
         case parse_status_unterminated_single_quote:
             return cli_run_result_unterminated_single_quote;
+        case parse_status_invalid_utf8:
+            report_error_offset(header, result.error_offset);
+            return cli_run_result_invalid_utf8;
         case parse_status_success:
-            return run_parsed_input(header, argument_strings, result.argument_count, userdata);
+            return cli_run_result_ok;
         default:
             return cli_run_result_unknown;
     }
 }
+
+static CliRunResult tokenize(
+    const CliHeader* header,
+    char* input,
+    const char** strings,
+    size_t capacity,
+    size_t* count
+) {
+    ParseResult result = header->validate_utf8
+        ? libcli_parse_utf8(input, strings, capacity)
+        : libcli_parse(input, strings, capacity);
+    *count = result.argument_count;
+
+    return parse_status_result(header, result);
+}
+
+// Tokenize `input` into `line`, looking up commands and converting arguments on the way.
+static CliRunResult tokenize_line(const CliHeader* header, char* input, Line* line) {
+    ParseResult result = libcli_parse_tokens(
+        input,
+        line->strings,
+        input_parser_argument_capacity,
+        header->validate_utf8,
+        on_token,
+        line
+    );
+
+    mark_phase(header, timing_phase_convert);
+
+    if (result.status == parse_status_stopped) {
+        return line->result;
+    } else if (result.status != parse_status_success) {
+        return parse_status_result(header, result);
+    } else if ((line->token_count > 0) && !end_stage(line, line->token_count)) {
+        return line->result;
+    } else {
+        return cli_run_result_ok;
+    }
+}
+
+CliRunResult libcli_run(const CliHeader* header, char* input, void* userdata) {
+    if (header->shared != NULL) {
+        CliHeader snapshot;
+        unsigned reader = libcli_begin_snapshot(header, &snapshot);
+        CliRunResult result = libcli_run(&snapshot, input, userdata);
+        libcli_end_snapshot(header, reader);
+        return result;
+    } else if (header->recorder != NULL) {
+        return libcli_run_recorded(header, input, userdata);
+    }
+
+    Line line = {
+        .header = header,
+        .token_count = 0,
+        .stage_start = 0,
+        .stage_argc = 0,
+        .pending_option = 0,
+        .array_used = 0,
+        .options_ended = false,
+        .variadic = false,
+        .pipeline = false,
+        .result = cli_run_result_ok,
+        .cacheable = false,
+        .cache_key_length = 0,
+    };
+
+    mark_phase(header, timing_phase_start);
+
+    CliRunResult result = tokenize_line(header, input, &line);
+
+    if (result != cli_run_result_ok) {
+        return result;
+    } else if (line.token_count == 0) {
+        // No command runs, so no time is spent in a handler
+        mark_phase(header, timing_phase_handler);
+        return cli_run_result_ok;
+    } else if (line.pipeline) {
+        return run_pipeline(header, &line, userdata);
+    } else if (line.cacheable) {
+        return run_cached_stage(header, &line, userdata);
+    } else {
+        return run_stage(header, &line, 0, line.token_count, userdata);
+    }
+}
+
+CliRunResult libcli_run_with_error(
+    const CliHeader* header,
+    char* input,
+    void* userdata,
+    CliRunError* error
+) {
+    *error = (CliRunError){ .offset = 0, .argument = 0, .constraint = 0, .element = 0 };
+
+    CliHeader reporting_header = *header;
+    reporting_header.error = error;
+
+    return libcli_run(&reporting_header, input, userdata);
+}
+
+void libcli_write(const CliHeader* header, const char* string) {
+    writeback(header, string);
+}
+
+char* libcli_pipe_input(const CliHeader* header) {
+    return header->pipe_input;
+}
+
+const CliOptions* libcli_options(const CliHeader* header) {
+    return header->options;
+}
+
+// Internal interface (see internal/command.h)
+
+CliRunResult libcli_tokenize(
+    const CliHeader* header,
+    char* input,
+    const char** strings,
+    size_t capacity,
+    size_t* count
+) {
+    return tokenize(header, input, strings, capacity, count);
+}
+
+SearchResult libcli_find_command(const CliHeader* header, const char* name) {
+    return find_command_by_name(header, name);
+}
+
+uint32_t libcli_command_fingerprint(const CliCommand* command) {
+    return command_fingerprint(command);
+}
+
+size_t libcli_longest_name_length(const CliCommand* commands, size_t count) {
+    return longest_name_length(commands, count);
+}
+
+SearchResult libcli_find_in_table(const CliCommand* commands, size_t count, const char* name) {
+    return find_in_table(commands, count, name);
+}
+
+const CliCommand* libcli_lookup_command(const CliHeader* header, const char* name) {
+    return lookup_command(header, name);
+}
+
+bool libcli_is_variadic_command(const CliCommand* command) {
+    return is_variadic_command(*command);
+}
+
+bool libcli_can_convert_arguments(
+    const CliHeader* header,
+    size_t argument_count,
+    const CliArgumentType* arguments
+) {
+    return can_convert_arguments(header, argument_count, arguments);
+}
+
+bool libcli_can_convert_options(const CliHeader* header, const CliOptionTable* options) {
+    return can_convert_options(header, options);
+}
+
+bool libcli_convert_argument(
+    const CliHeader* header,
+    CliArgumentType type,
+    const char* input,
+    CliArgument* output
+) {
+    // Each converted argument is used before the next conversion, so the array buffer is reused.
+    size_t array_used = 0;
+    return parse_argument(header, type, input, &array_used, output);
+}
+
+CliRunResult libcli_run_command(
+    const CliHeader* header,
+    CliCommand command,
+    size_t argc,
+    const CliArgument* argv,
+    void* userdata
+) {
+    return run_command(header, command, argc, argv, NULL, userdata);
+}
@@ -0,0 +1,201 @@
+#include "internal/constraints.h"
+#include "internal/array.h"
+#include "cli_format.h"
+
+#include <string.h>
+
+// Returns true if the constraint's kind can check arguments of the given type
+static bool fits_type(const CliConstraint* constraint, CliArgumentType type) {
+    switch (constraint->kind) {
+        case cli_constraint_range:
+            return (type == cli_argument_type_int)
+                || (type == cli_argument_type_fixed)
+                || (type == cli_argument_type_float);
+        case cli_constraint_length:
+            return (type == cli_argument_type_string)
+                || (type == cli_argument_type_blob)
+                || libcli_is_array_type(type);
+        case cli_constraint_charset:
+            return (type == cli_argument_type_string) && (constraint->charset != NULL);
+        case cli_constraint_one_of:
+            return (type == cli_argument_type_string) && (constraint->one_of.values != NULL);
+        case cli_constraint_predicate:
+            return constraint->predicate.function != NULL;
+    }
+
+    return false;
+}
+
+bool libcli_constraints_fit(
+    const CliConstraint* constraints,
+    size_t constraint_count,
+    size_t argument_count,
+    const CliArgumentType* arguments
+) {
+    for (size_t i = 0; i < constraint_count; i++) {
+        const CliConstraint* constraint = &constraints[i];
+
+        if ((constraint->argument >= argument_count)
+            || !fits_type(constraint, arguments[constraint->argument])
+        ) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Returns true if `c` is in the charset. A '-' between two characters is a range, and any other
+// '-' is itself a member.
+static bool in_charset(const char* charset, char c) {
+    const char* set = charset;
+
+    while (*set != '\0') {
+        if ((set[1] == '-') && (set[2] != '\0')) {
+            if ((c >= set[0]) && (c <= set[2])) {
+                return true;
+            }
+
+            set += 3;
+        } else if (*set == c) {
+            return true;
+        } else {
+            set += 1;
+        }
+    }
+
+    return false;
+}
+
+static bool check_range(const CliConstraint* constraint, const CliArgument* value) {
+    int32_t min = constraint->range.min;
+    int32_t max = constraint->range.max;
+
+    switch (value->type) {
+        case cli_argument_type_int:
+            return (value->integer >= min) && (value->integer <= max);
+        case cli_argument_type_fixed:
+            return (value->fixed >= min) && (value->fixed <= max);
+        case cli_argument_type_float:
+            return (value->float_ >= (float)min) && (value->float_ <= (float)max);
+        default:
+            return false;
+    }
+}
+
+static bool check_constraint(const CliConstraint* constraint, const CliArgument* value) {
+    switch (constraint->kind) {
+        case cli_constraint_range:
+            return check_range(constraint, value);
+        case cli_constraint_length: {
+            size_t length;
+
+            if (value->type == cli_argument_type_blob) {
+                length = value->blob.size;
+            } else if (libcli_is_array_type(value->type)) {
+                length = value->array.count;
+            } else {
+                length = strlen(value->string);
+            }
+
+            return (length >= constraint->length.min) && (length <= constraint->length.max);
+        }
+        case cli_constraint_charset:
+            for (const char* c = value->string; *c != '\0'; c++) {
+                if (!in_charset(constraint->charset, *c)) {
+                    return false;
+                }
+            }
+            return true;
+        case cli_constraint_one_of:
+            for (size_t i = 0; i < constraint->one_of.count; i++) {
+                if (strcmp(constraint->one_of.values[i], value->string) == 0) {
+                    return true;
+                }
+            }
+            return false;
+        case cli_constraint_predicate:
+            return constraint->predicate.function(value, constraint->predicate.data);
+    }
+
+    return false;
+}
+
+bool libcli_check_constraints(
+    const CliCommand* command,
+    size_t argument,
+    const CliArgument* value,
+    size_t* failed
+) {
+    for (size_t i = 0; i < command->constraint_count; i++) {
+        const CliConstraint* constraint = &command->constraints[i];
+
+        if ((constraint->argument == argument) && !check_constraint(constraint, value)) {
+            *failed = i;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// The fewest decimal places which print a fixed-point value closely enough to convert back to it
+static size_t fixed_decimals(int32_t value) {
+    uint64_t magnitude = (value < 0) ? ((uint64_t)0 - (uint64_t)(int64_t)value) : (uint64_t)value;
+    uint64_t half = ((uint64_t)1 << cli_fixed_fraction_bits) / 2;
+    uint64_t scale = 1;
+
+    for (size_t decimals = 0; decimals < cli_format_max_decimals; decimals++) {
+        uint64_t scaled = ((magnitude * scale) + half) >> cli_fixed_fraction_bits;
+        uint64_t converted = ((scaled << cli_fixed_fraction_bits) + (scale / 2)) / scale;
+
+        if (converted == magnitude) {
+            return decimals;
+        }
+
+        scale *= 10;
+    }
+
+    return cli_format_max_decimals;
+}
+
+static void write_bound(const CliHeader* header, CliArgumentType type, int32_t bound) {
+    if (type == cli_argument_type_fixed) {
+        libcli_put_fixed(header, bound, fixed_decimals(bound));
+    } else {
+        libcli_put_i32(header, bound);
+    }
+}
+
+void libcli_write_constraint(
+    const CliHeader* header,
+    const CliConstraint* constraint,
+    CliArgumentType type
+) {
+    switch (constraint->kind) {
+        case cli_constraint_range:
+            libcli_write(header, "between ");
+            write_bound(header, type, constraint->range.min);
+            libcli_write(header, " and ");
+            write_bound(header, type, constraint->range.max);
+            break;
+        case cli_constraint_length: {
+            size_t min = constraint->length.min;
+            size_t max = constraint->length.max;
+            libcli_printf(header, "%zu to %zu long", min, max);
+            break;
+        }
+        case cli_constraint_charset:
+            libcli_printf(header, "made of [%s]", constraint->charset);
+            break;
+        case cli_constraint_one_of:
+            libcli_write(header, "one of:");
+            for (size_t i = 0; i < constraint->one_of.count; i++) {
+                libcli_printf(header, (i == 0) ? " %s" : ", %s", constraint->one_of.values[i]);
+            }
+            break;
+        case cli_constraint_predicate:
+            libcli_write(header, "valid");
+            break;
+    }
+}
@@ -0,0 +1,135 @@
+#include "cli_context.h"
+#include "internal/command.h"
+#include "internal/constraints.h"
+
+#include <string.h>
+
+CliContext libcli_context_new(const char* prompt, CliCommand* commands, size_t commands_size) {
+    return (CliContext){
+        .prompt = prompt,
+        .capacity = commands_size,
+        .count = 0,
+        .commands = commands,
+        .longest_command_name_length = 0,
+    };
+}
+
+bool libcli_context_add(
+    const CliHeader* header,
+    CliContext* context,
+    const char* name,
+    const char* summary,
+    size_t argument_count,
+    const CliArgumentType* arguments,
+    CliCommandFunction function
+) {
+    CliCommandInfo info = {
+        .name = name,
+        .summary = summary,
+        .argument_count = argument_count,
+        .arguments = arguments,
+        .function = function,
+    };
+    return libcli_context_add_command(header, context, &info);
+}
+
+bool libcli_context_add_command(
+    const CliHeader* header,
+    CliContext* context,
+    const CliCommandInfo* info
+) {
+    SearchResult result = libcli_find_in_table(context->commands, context->count, info->name);
+
+    if (result.found || (context->count >= context->capacity) || (info->function == NULL)) {
+        return false;
+    } else if (info->argument_count > cli_max_argument_count) {
+        return false;
+    } else if (!libcli_can_convert_arguments(header, info->argument_count, info->arguments)) {
+        return false;
+    } else if (!libcli_can_convert_options(header, info->options)) {
+        return false;
+    } else if (!libcli_constraints_fit(
+        info->constraints, info->constraint_count, info->argument_count, info->arguments
+    )) {
+        return false;
+    }
+
+    CliCommand command = {
+        .name = info->name,
+        .summary = info->summary,
+        .function = info->function,
+        .argument_count = info->argument_count,
+        .options = info->options,
+        .constraints = info->constraints,
+        .constraint_count = info->constraint_count,
+        .cacheable = info->cacheable,
+    };
+    memcpy(command.arguments, info->arguments, sizeof(CliArgumentType) * info->argument_count);
+
+    size_t move_size = (context->count - result.index) * sizeof(CliCommand);
+    memmove(&context->commands[result.index + 1], &context->commands[result.index], move_size);
+
+    context->commands[result.index] = command;
+    context->count += 1;
+
+    size_t length = strlen(info->name);
+    if (length > context->longest_command_name_length) {
+        context->longest_command_name_length = length;
+    }
+
+    return true;
+}
+
+CliContextStack libcli_context_stack_new(void) {
+    return (CliContextStack){ .depth = 0 };
+}
+
+bool libcli_enter_context(const CliHeader* header, const CliContext* context, void* data) {
+    CliContextStack* stack = header->contexts;
+
+    if ((stack == NULL) || (stack->depth == cli_max_context_depth)) {
+        return false;
+    }
+
+    stack->entries[stack->depth] = (CliContextEntry){ .context = context, .data = data };
+    stack->depth += 1;
+    return true;
+}
+
+bool libcli_exit_context(const CliHeader* header) {
+    CliContextStack* stack = header->contexts;
+
+    if ((stack == NULL) || (stack->depth == 0)) {
+        return false;
+    }
+
+    stack->depth -= 1;
+    return true;
+}
+
+void libcli_exit_all_contexts(const CliHeader* header) {
+    if (header->contexts != NULL) {
+        header->contexts->depth = 0;
+    }
+}
+
+// The innermost entered context, or NULL if no context was entered
+static const CliContextEntry* innermost_entry(const CliHeader* header) {
+    const CliContextStack* stack = header->contexts;
+
+    if ((stack == NULL) || (stack->depth == 0)) {
+        return NULL;
+    } else {
+        return &stack->entries[stack->depth - 1];
+    }
+}
+
+const char* libcli_context_prompt(const CliHeader* header) {
+    const CliContextEntry* entry = innermost_entry(header);
+    return (entry != NULL) ? entry->context->prompt : NULL;
+}
+
+void* libcli_context_data(const CliHeader* header) {
+    const CliContextEntry* entry = innermost_entry(header);
+    return (entry != NULL) ? entry->data : NULL;
+}
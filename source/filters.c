@@ -0,0 +1,118 @@
+#include "cli.h"
+#include "internal/format.h"
+
+#include <string.h>
+
+// Call `function` with every line of the pipeline input (without its newline). Stops if `function`
+// returns false.
+static void for_each_line(
+    const CliHeader* header,
+    bool (*function)(const CliHeader*, char*, void*),
+    void* data
+) {
+    char* line = libcli_pipe_input(header);
+
+    while ((line != NULL) && (*line != '\0')) {
+        char* newline = strchr(line, '\n');
+        char* next = NULL;
+
+        if (newline != NULL) {
+            *newline = '\0';
+            next = newline + 1;
+        }
+
+        if (!function(header, line, data)) {
+            return;
+        }
+
+        line = next;
+    }
+}
+
+static void write_line(const CliHeader* header, const char* line) {
+    libcli_write(header, line);
+    libcli_write(header, "\n");
+}
+
+static bool grep_line(const CliHeader* header, char* line, void* data) {
+    const char* pattern = (const char*)data;
+
+    if (strstr(line, pattern) != NULL) {
+        write_line(header, line);
+    }
+
+    return true;
+}
+
+static void grep_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* userdata
+) {
+    (void)argc;
+    (void)userdata;
+
+    for_each_line(header, grep_line, (void*)argv[0].string);
+}
+
+static bool head_line(const CliHeader* header, char* line, void* data) {
+    int* remaining = (int*)data;
+
+    if (*remaining <= 0) {
+        return false;
+    } else {
+        write_line(header, line);
+        *remaining -= 1;
+        return true;
+    }
+}
+
+static void head_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* userdata
+) {
+    (void)argc;
+    (void)userdata;
+
+    int remaining = argv[0].integer;
+    for_each_line(header, head_line, &remaining);
+}
+
+static bool count_line(const CliHeader* header, char* line, void* data) {
+    (void)header;
+    (void)line;
+
+    size_t* count = (size_t*)data;
+    *count += 1;
+    return true;
+}
+
+static void count_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* userdata
+) {
+    (void)argc;
+    (void)argv;
+    (void)userdata;
+
+    size_t count = 0;
+    for_each_line(header, count_line, &count);
+
+    char text[format_unsigned_size];
+    libcli_format_unsigned(text, count);
+    write_line(header, text);
+}
+
+bool libcli_add_filters(CliHeader* header) {
+    CliArgumentType grep_args[] = { cli_argument_type_string };
+    CliArgumentType head_args[] = { cli_argument_type_int };
+
+    return libcli_add(header, "grep", "output lines containing text", 1, grep_args, grep_command)
+        && libcli_add(header, "head", "output the first lines", 1, head_args, head_command)
+        && libcli_add(header, "count", "output the number of lines", 0, NULL, count_command);
+}
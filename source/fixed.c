@@ -0,0 +1,86 @@
+#include "internal/fixed.h"
+
+#include <stddef.h>
+
+enum {
+    // Fractional digits kept. Every rounding boundary of a value with at most 31 fractional bits
+    // has at most 32 decimal digits, so ignoring digits after these never changes the result.
+    fixed_max_fraction_digits = 40,
+};
+
+static bool is_digit(char c) {
+    return (c >= '0') && (c <= '9');
+}
+
+// Multiply the decimal fraction 0.d0d1d2... by two in place, returning the integer bit carried out.
+static uint32_t double_fraction(uint8_t* digits, size_t count) {
+    uint32_t carry = 0;
+
+    for (size_t i = count; i > 0; i--) {
+        uint32_t value = ((uint32_t)digits[i - 1] * 2) + carry;
+        digits[i - 1] = (uint8_t)(value % 10);
+        carry = value / 10;
+    }
+
+    return carry;
+}
+
+bool libcli_parse_fixed(const char* string, unsigned fraction_bits, int32_t* out) {
+    const char* c = string;
+    bool negative = false;
+
+    if ((*c == '-') || (*c == '+')) {
+        negative = (*c == '-');
+        c += 1;
+    }
+
+    // The magnitude limit, 2^31 for negative values and 2^31 - 1 for positive ones
+    uint64_t limit = negative ? ((uint64_t)1 << 31) : (((uint64_t)1 << 31) - 1);
+    uint64_t integer = 0;
+    size_t digit_count = 0;
+
+    for (; is_digit(*c); c++) {
+        integer = (integer * 10) + (uint64_t)(*c - '0');
+        digit_count += 1;
+
+        if ((integer << fraction_bits) > limit) {
+            return false;
+        }
+    }
+
+    uint8_t fraction[fixed_max_fraction_digits];
+    size_t fraction_count = 0;
+
+    if (*c == '.') {
+        for (c += 1; is_digit(*c); c++) {
+            if (fraction_count < fixed_max_fraction_digits) {
+                fraction[fraction_count] = (uint8_t)(*c - '0');
+                fraction_count += 1;
+            }
+
+            digit_count += 1;
+        }
+    }
+
+    if ((*c != '\0') || (digit_count == 0)) {
+        return false;
+    }
+
+    // Shift the fraction's bits out one at a time by doubling it in decimal, which is exact.
+    uint64_t bits = 0;
+
+    for (unsigned i = 0; i < fraction_bits; i++) {
+        bits = (bits << 1) | double_fraction(fraction, fraction_count);
+    }
+
+    // What is left of the fraction is at least a half if its first digit is 5 or more.
+    bool round_up = (fraction_count > 0) && (fraction[0] >= 5);
+    uint64_t magnitude = (integer << fraction_bits) + bits + (round_up ? 1 : 0);
+
+    if (magnitude > limit) {
+        return false;
+    }
+
+    *out = negative ? (int32_t)(-(int64_t)magnitude) : (int32_t)magnitude;
+    return true;
+}
@@ -0,0 +1,10 @@
+#include "cli.h"
+
+#include <stdlib.h>
+
+// Kept apart from the rest of the library, so `strtof` is only linked in if this is referenced.
+bool libcli_parse_float(const char* string, float* out) {
+    char* end = NULL;
+    *out = strtof(string, &end);
+    return *end == '\0';
+}
@@ -0,0 +1,308 @@
+#include "cli_format.h"
+#include "internal/format.h"
+
+#include <stdarg.h>
+#include <string.h>
+
+// Every pair of decimal digits "00" to "99", so integers are formatted with one division by 100
+// per two digits.
+static const char digit_pairs[200] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static const char lower_hex_digits[16] = "0123456789abcdef";
+static const char upper_hex_digits[16] = "0123456789ABCDEF";
+
+static const uint32_t powers_of_ten[cli_format_max_decimals + 1] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000,
+};
+
+size_t libcli_format_unsigned(char* buffer, uint64_t value) {
+    char digits[format_unsigned_size];
+    size_t start = sizeof(digits);
+
+    while (value >= 100) {
+        size_t pair = (size_t)(value % 100) * 2;
+        value /= 100;
+        start -= 2;
+        digits[start] = digit_pairs[pair];
+        digits[start + 1] = digit_pairs[pair + 1];
+    }
+
+    if (value >= 10) {
+        start -= 2;
+        digits[start] = digit_pairs[value * 2];
+        digits[start + 1] = digit_pairs[(value * 2) + 1];
+    } else {
+        start -= 1;
+        digits[start] = (char)('0' + value);
+    }
+
+    size_t count = sizeof(digits) - start;
+    memcpy(buffer, &digits[start], count);
+    buffer[count] = '\0';
+    return count;
+}
+
+void libcli_format_hex(char* buffer, uint64_t value, size_t digits, bool uppercase) {
+    const char* table = uppercase ? upper_hex_digits : lower_hex_digits;
+
+    for (size_t i = 0; i < digits; i++) {
+        buffer[digits - 1 - i] = table[(value >> (i * 4)) & 0xF];
+    }
+
+    buffer[digits] = '\0';
+}
+
+// Output collected on the stack, and written to the header's output whenever the buffer is full
+typedef struct Output {
+    const CliHeader* header;
+    size_t length;
+    char data[cli_format_buffer_size];
+} Output;
+
+static void output_flush(Output* output) {
+    if (output->length > 0) {
+        output->data[output->length] = '\0';
+        libcli_write(output->header, output->data);
+        output->length = 0;
+    }
+}
+
+static void output_char(Output* output, char c) {
+    if (output->length == (sizeof(output->data) - 1)) {
+        output_flush(output);
+    }
+
+    output->data[output->length] = c;
+    output->length += 1;
+}
+
+static void output_text(Output* output, const char* text, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        output_char(output, text[i]);
+    }
+}
+
+static void output_padding(Output* output, char pad, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        output_char(output, pad);
+    }
+}
+
+// A printf field: the flags and width of a conversion
+typedef struct Field {
+    bool left;
+    bool zero;
+    size_t width;
+} Field;
+
+// Write `text` padded to the field's width. Zero padding goes after the sign of a number.
+static void output_field(Output* output, Field field, const char* text, size_t length) {
+    size_t padding = (field.width > length) ? (field.width - length) : 0;
+
+    if (field.left) {
+        output_text(output, text, length);
+        output_padding(output, ' ', padding);
+    } else if (field.zero) {
+        size_t sign = ((length > 0) && (text[0] == '-')) ? 1 : 0;
+        output_text(output, text, sign);
+        output_padding(output, '0', padding);
+        output_text(output, &text[sign], length - sign);
+    } else {
+        output_padding(output, ' ', padding);
+        output_text(output, text, length);
+    }
+}
+
+static size_t format_signed(char* buffer, int64_t value) {
+    if (value < 0) {
+        buffer[0] = '-';
+        return 1 + libcli_format_unsigned(&buffer[1], (uint64_t)0 - (uint64_t)value);
+    } else {
+        return libcli_format_unsigned(buffer, (uint64_t)value);
+    }
+}
+
+static size_t hex_digit_count(uint64_t value) {
+    size_t count = 1;
+
+    while ((count < 16) && ((value >> (count * 4)) != 0)) {
+        count += 1;
+    }
+
+    return count;
+}
+
+typedef enum LengthModifier {
+    length_modifier_none,
+    length_modifier_long,
+    length_modifier_long_long,
+    length_modifier_size,
+} LengthModifier;
+
+static int64_t read_signed(va_list* arguments, LengthModifier modifier) {
+    switch (modifier) {
+        case length_modifier_long:
+            return va_arg(*arguments, long);
+        case length_modifier_long_long:
+            return va_arg(*arguments, long long);
+        case length_modifier_size:
+            return (int64_t)va_arg(*arguments, size_t);
+        default:
+            return va_arg(*arguments, int);
+    }
+}
+
+static uint64_t read_unsigned(va_list* arguments, LengthModifier modifier) {
+    switch (modifier) {
+        case length_modifier_long:
+            return va_arg(*arguments, unsigned long);
+        case length_modifier_long_long:
+            return va_arg(*arguments, unsigned long long);
+        case length_modifier_size:
+            return va_arg(*arguments, size_t);
+        default:
+            return va_arg(*arguments, unsigned);
+    }
+}
+
+// Write the conversion `c` of `field`, taking its value from `arguments`. Returns false if `c` is
+// not a supported conversion.
+static bool output_conversion(
+    Output* output,
+    Field field,
+    LengthModifier modifier,
+    char c,
+    va_list* arguments
+) {
+    char text[format_unsigned_size + 1];
+    size_t length = 0;
+
+    if ((c == 'd') || (c == 'i')) {
+        length = format_signed(text, read_signed(arguments, modifier));
+    } else if (c == 'u') {
+        length = libcli_format_unsigned(text, read_unsigned(arguments, modifier));
+    } else if ((c == 'x') || (c == 'X')) {
+        uint64_t value = read_unsigned(arguments, modifier);
+        length = hex_digit_count(value);
+        libcli_format_hex(text, value, length, c == 'X');
+    } else if (c == 'c') {
+        // Output is null-terminated, so a null character is left out (its field is still padded)
+        text[0] = (char)va_arg(*arguments, int);
+        length = (text[0] != '\0') ? 1 : 0;
+    } else if (c == 's') {
+        const char* string = va_arg(*arguments, const char*);
+        string = (string != NULL) ? string : "(null)";
+        output_field(output, field, string, strlen(string));
+        return true;
+    } else if (c == '%') {
+        text[0] = '%';
+        length = 1;
+    } else {
+        return false;
+    }
+
+    output_field(output, field, text, length);
+    return true;
+}
+
+void libcli_printf(const CliHeader* header, const char* format, ...) {
+    Output output = { .header = header, .length = 0 };
+    va_list arguments;
+    va_start(arguments, format);
+
+    const char* c = format;
+
+    while (*c != '\0') {
+        if (*c != '%') {
+            output_char(&output, *c);
+            c += 1;
+            continue;
+        }
+
+        const char* start = c;
+        Field field = { .left = false, .zero = false, .width = 0 };
+        LengthModifier modifier = length_modifier_none;
+        c += 1;
+
+        for (; (*c == '-') || (*c == '0'); c++) {
+            field.left = field.left || (*c == '-');
+            field.zero = field.zero || (*c == '0');
+        }
+
+        for (; (*c >= '0') && (*c <= '9'); c++) {
+            field.width = (field.width * 10) + (size_t)(*c - '0');
+        }
+
+        if (*c == 'z') {
+            modifier = length_modifier_size;
+            c += 1;
+        } else if (*c == 'l') {
+            modifier = (c[1] == 'l') ? length_modifier_long_long : length_modifier_long;
+            c += (c[1] == 'l') ? 2 : 1;
+        }
+
+        if ((*c == '\0') || !output_conversion(&output, field, modifier, *c, &arguments)) {
+            // Not a supported conversion, so it is written as it is
+            size_t length = (*c == '\0') ? (size_t)(c - start) : (size_t)(c - start) + 1;
+            output_text(&output, start, length);
+        }
+
+        c += (*c == '\0') ? 0 : 1;
+    }
+
+    va_end(arguments);
+    output_flush(&output);
+}
+
+void libcli_put_u32(const CliHeader* header, uint32_t value) {
+    char text[format_unsigned_size];
+    libcli_format_unsigned(text, value);
+    libcli_write(header, text);
+}
+
+void libcli_put_i32(const CliHeader* header, int32_t value) {
+    char text[format_unsigned_size + 1];
+    format_signed(text, value);
+    libcli_write(header, text);
+}
+
+void libcli_put_hex(const CliHeader* header, uint32_t value, size_t digits) {
+    char text[9];
+    digits = (digits < 1) ? 1 : ((digits > 8) ? 8 : digits);
+    libcli_format_hex(text, value, digits, false);
+    libcli_write(header, text);
+}
+
+void libcli_put_fixed(const CliHeader* header, int32_t value, size_t decimals) {
+    decimals = (decimals > cli_format_max_decimals) ? cli_format_max_decimals : decimals;
+
+    // The magnitude scaled to `decimals` places, rounded with halves away from zero. It is below
+    // 2^31 * 10^9, so it fits in 64 bits.
+    uint64_t magnitude = (value < 0) ? ((uint64_t)0 - (uint64_t)(int64_t)value) : (uint64_t)value;
+    uint64_t scale = powers_of_ten[decimals];
+    uint64_t half = ((uint64_t)1 << cli_fixed_fraction_bits) / 2;
+    uint64_t scaled = ((magnitude * scale) + half) >> cli_fixed_fraction_bits;
+
+    Output output = { .header = header, .length = 0 };
+    char text[format_unsigned_size];
+
+    if ((value < 0) && (scaled > 0)) {
+        output_char(&output, '-');
+    }
+
+    output_text(&output, text, libcli_format_unsigned(text, scaled / scale));
+
+    if (decimals > 0) {
+        size_t length = libcli_format_unsigned(text, scaled % scale);
+        output_char(&output, '.');
+        output_padding(&output, '0', decimals - length);
+        output_text(&output, text, length);
+    }
+
+    output_flush(&output);
+}
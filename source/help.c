@@ -0,0 +1,451 @@
+#include "internal/help.h"
+#include "internal/jobs.h"
+#include "cli_context.h"
+#include "cli_options.h"
+#include "internal/command.h"
+#include "internal/summary.h"
+#include "internal/timing.h"
+
+#include <string.h>
+
+static const uint32_t fnv_offset_basis = 2166136261u;
+static const uint32_t fnv_prime = 16777619u;
+
+static const char* const argument_type_names[] = {
+    [cli_argument_type_string] = "<string>",
+    [cli_argument_type_int] = "<int>",
+    [cli_argument_type_float] = "<float>",
+    [cli_argument_type_fixed] = "<fixed>",
+    [cli_argument_type_blob] = "<blob>",
+    [cli_argument_type_int_array] = "<int[]>",
+    [cli_argument_type_u8_array] = "<u8[]>",
+    [cli_argument_type_float_array] = "<float[]>",
+};
+
+void libcli_help_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* userdata
+) {
+    (void)header;
+    (void)argc;
+    (void)argv;
+    (void)userdata;
+    // Unused. If the help command is selected, a help function is executed instead of this.
+}
+
+// Words
+
+static bool is_word_char(char c) {
+    return ((c >= 'a') && (c <= 'z')) || ((c >= 'A') && (c <= 'Z')) || ((c >= '0') && (c <= '9'));
+}
+
+static char to_lower(char c) {
+    return ((c >= 'A') && (c <= 'Z')) ? (char)(c - 'A' + 'a') : c;
+}
+
+// Called with each word's hash, and whether the word is the one being searched for
+typedef void (*WordFunction)(uint32_t hash, bool is_target, void* data);
+
+// Splits text, which may arrive in pieces, into case-insensitive words of letters and digits.
+// Words are compared to `target` as they are split, since hashes of different words can collide.
+typedef struct WordSplitter {
+    uint32_t hash;
+    size_t length;
+    const char* target;
+    bool same;
+    WordFunction on_word;
+    void* data;
+} WordSplitter;
+
+static void splitter_end_word(WordSplitter* splitter) {
+    if (splitter->length >= help_min_keyword_length) {
+        bool is_target = splitter->same && (splitter->target[splitter->length] == '\0');
+        splitter->on_word(splitter->hash, is_target, splitter->data);
+    }
+
+    splitter->hash = fnv_offset_basis;
+    splitter->length = 0;
+    splitter->same = splitter->target != NULL;
+}
+
+static void splitter_feed(WordSplitter* splitter, const char* text) {
+    for (const char* c = text; *c != '\0'; c++) {
+        if (is_word_char(*c)) {
+            // The target's terminator never matches, so it is not read past.
+            splitter->same = splitter->same
+                && (to_lower(splitter->target[splitter->length]) == to_lower(*c));
+            splitter->hash = (splitter->hash ^ (uint8_t)to_lower(*c)) * fnv_prime;
+            splitter->length += 1;
+        } else {
+            splitter_end_word(splitter);
+        }
+    }
+}
+
+static void splitter_writeback(const char* string, void* userdata) {
+    splitter_feed((WordSplitter*)userdata, string);
+}
+
+// Call `on_word` for every word of the command's name and summary (decompressing the summary if
+// needed), telling it whether the word is `target` (if not NULL). Words which appear more than
+// once are passed each time.
+static void for_each_word(
+    const CliHeader* header,
+    const CliCommand* command,
+    const char* target,
+    WordFunction on_word,
+    void* data
+) {
+    WordSplitter splitter = {
+        .hash = fnv_offset_basis,
+        .length = 0,
+        .target = target,
+        .same = target != NULL,
+        .on_word = on_word,
+        .data = data,
+    };
+
+    splitter_feed(&splitter, command->name);
+    splitter_end_word(&splitter);
+
+    CliHeader summary_header = *header;
+    summary_header.writeback = splitter_writeback;
+    summary_header.writeback_data = &splitter;
+    libcli_write_summary(&summary_header, command->summary);
+    splitter_end_word(&splitter);
+}
+
+// Keyword index
+
+static int compare_keyword(const CliKeyword* keyword, uint32_t hash, const char* name) {
+    if (keyword->hash != hash) {
+        return (keyword->hash < hash) ? -1 : 1;
+    } else {
+        return strcmp(keyword->name, name);
+    }
+}
+
+// Find the first keyword which is not before (`hash`, `name`)
+static size_t find_keyword(const CliHeader* header, uint32_t hash, const char* name) {
+    size_t left = 0;
+    size_t right = header->keyword_count;
+
+    while (left < right) {
+        size_t middle = left + ((right - left) / 2);
+
+        if (compare_keyword(&header->keywords[middle], hash, name) < 0) {
+            left = middle + 1;
+        } else {
+            right = middle;
+        }
+    }
+
+    return left;
+}
+
+typedef struct Indexer {
+    CliHeader* header;
+    const char* name;
+} Indexer;
+
+static void index_word(uint32_t hash, bool is_target, void* data) {
+    (void)is_target;
+
+    Indexer* indexer = (Indexer*)data;
+    CliHeader* header = indexer->header;
+    size_t index = find_keyword(header, hash, indexer->name);
+
+    if ((index < header->keyword_count)
+        && (compare_keyword(&header->keywords[index], hash, indexer->name) == 0)
+    ) {
+        return;
+    } else if (header->keyword_count == header->keyword_capacity) {
+        header->keywords_complete = false;
+        return;
+    }
+
+    size_t move_size = (header->keyword_count - index) * sizeof(CliKeyword);
+    memmove(&header->keywords[index + 1], &header->keywords[index], move_size);
+
+    header->keywords[index] = (CliKeyword){ .hash = hash, .name = indexer->name };
+    header->keyword_count += 1;
+}
+
+void libcli_index_command(CliHeader* header, const CliCommand* command) {
+    if (header->keywords_complete) {
+        Indexer indexer = { .header = header, .name = command->name };
+        for_each_word(header, command, NULL, index_word, &indexer);
+    }
+}
+
+static void unindex_word(uint32_t hash, bool is_target, void* data) {
+    (void)is_target;
+
+    Indexer* indexer = (Indexer*)data;
+    CliHeader* header = indexer->header;
+    size_t index = find_keyword(header, hash, indexer->name);
+
+    if ((index < header->keyword_count)
+        && (compare_keyword(&header->keywords[index], hash, indexer->name) == 0)
+    ) {
+        size_t move_size = (header->keyword_count - index - 1) * sizeof(CliKeyword);
+        memmove(&header->keywords[index], &header->keywords[index + 1], move_size);
+        header->keyword_count -= 1;
+    }
+}
+
+void libcli_unindex_command(CliHeader* header, const CliCommand* command) {
+    if (header->keywords_complete) {
+        Indexer indexer = { .header = header, .name = command->name };
+        for_each_word(header, command, NULL, unindex_word, &indexer);
+    }
+}
+
+// Output
+
+static size_t context_depth(const CliHeader* header) {
+    return (header->contexts != NULL) ? header->contexts->depth : 0;
+}
+
+// The context `depth` levels in from the outermost
+static const CliContext* context_at(const CliHeader* header, size_t depth) {
+    return header->contexts->entries[depth].context;
+}
+
+// Width of the name column: the longest name of the global commands and the active contexts
+static size_t name_column_width(const CliHeader* header) {
+    size_t width = header->longest_command_name_length;
+
+    for (size_t i = 0; i < context_depth(header); i++) {
+        size_t length = context_at(header, i)->longest_command_name_length;
+        width = (length > width) ? length : width;
+    }
+
+    return width;
+}
+
+// Returns false if the command is hidden by a command of the same name in an inner context
+static bool is_visible(const CliHeader* header, const CliCommand* command) {
+    return libcli_lookup_command(header, command->name) == command;
+}
+
+static void write_padded_name(const CliHeader* header, const char* name, size_t width) {
+    libcli_write(header, name);
+
+    for (size_t i = strlen(name); i < width; i++) {
+        libcli_write(header, " ");
+    }
+}
+
+// Write a command's line of the list of commands, without its line end
+static void write_command_line(const CliHeader* header, const CliCommand* command, size_t width) {
+    libcli_write(header, "\n    ");
+    write_padded_name(header, command->name, width);
+    libcli_write(header, "    ");
+    libcli_write_summary(header, command->summary);
+}
+
+static void write_command_table(
+    const CliHeader* header,
+    const CliCommand* commands,
+    size_t count,
+    size_t width
+) {
+    for (size_t i = 0; i < count; i++) {
+        if (is_visible(header, &commands[i])) {
+            write_command_line(header, &commands[i], width);
+        }
+    }
+}
+
+// Write the commands of the active contexts, innermost first, and then the global commands
+static void write_command_list(const CliHeader* header) {
+    size_t width = name_column_width(header);
+
+    libcli_write(header, "list of commands:");
+
+    for (size_t i = context_depth(header); i > 0; i--) {
+        const CliContext* context = context_at(header, i - 1);
+        write_command_table(header, context->commands, context->count, width);
+    }
+
+    write_command_table(header, header->commands, header->count, width);
+    libcli_write(header, "\n");
+}
+
+// Write the options a command takes, eg. " [-v|--verbose] [--count <int>]"
+static void write_options(const CliHeader* header, const CliOptionTable* options) {
+    for (size_t i = 0; (options != NULL) && (i < options->count); i++) {
+        const CliOption* option = &options->options[i];
+        char short_name[] = { '-', option->short_name, '|', '\0' };
+
+        libcli_write(header, " [");
+        libcli_write(header, (option->short_name != '\0') ? short_name : "");
+        libcli_write(header, "--");
+        libcli_write(header, option->name);
+
+        if (option->takes_value) {
+            libcli_write(header, " ");
+            libcli_write(header, argument_type_names[option->type]);
+        }
+
+        libcli_write(header, "]");
+    }
+}
+
+// Write the arguments a command takes, eg. " <int> <string>"
+static void write_signature(const CliHeader* header, const CliCommand* command) {
+    if (command->function == libcli_help_command) {
+        libcli_write(header, " [<command> | -s <word>]");
+    } else if (command->function == libcli_time_command) {
+        libcli_write(header, " <command...>");
+    } else if (command->function == libcli_repeat_command) {
+        libcli_write(header, " <count> <command...>");
+    } else if ((command->function == libcli_every_command)
+        || (command->function == libcli_watch_command)
+    ) {
+        libcli_write(header, " <period> <command...>");
+    } else {
+        for (size_t i = 0; i < command->argument_count; i++) {
+            libcli_write(header, " ");
+            libcli_write(header, argument_type_names[command->arguments[i]]);
+        }
+
+        write_options(header, command->options);
+    }
+}
+
+static CliRunResult write_topic(const CliHeader* header, const char* name) {
+    const CliCommand* command = libcli_lookup_command(header, name);
+
+    if (command == NULL) {
+        return cli_run_result_unknown;
+    }
+
+    libcli_write(header, command->name);
+    write_signature(header, command);
+    libcli_write(header, "\n    ");
+    libcli_write_summary(header, command->summary);
+    libcli_write(header, "\n");
+    return cli_run_result_ok;
+}
+
+// Search
+
+static void match_word(uint32_t hash, bool is_target, void* data) {
+    (void)hash;
+
+    bool* found = (bool*)data;
+    *found = *found || is_target;
+}
+
+// Returns true if the command's name or summary has the word
+static bool has_word(const CliHeader* header, const CliCommand* command, const char* word) {
+    bool found = false;
+    for_each_word(header, command, word, match_word, &found);
+    return found;
+}
+
+// Write each global command with the word, using the index. The index only holds hashes, so the
+// words of each command with the word's hash are compared too. Returns the number written.
+static size_t search_index(const CliHeader* header, const char* word, uint32_t hash, size_t width) {
+    size_t matches = 0;
+
+    for (size_t i = find_keyword(header, hash, ""); i < header->keyword_count; i++) {
+        if (header->keywords[i].hash != hash) {
+            break;
+        }
+
+        SearchResult search = libcli_find_command(header, header->keywords[i].name);
+        const CliCommand* command = &header->commands[search.index];
+
+        if (search.found && is_visible(header, command) && has_word(header, command, word)) {
+            write_command_line(header, command, width);
+            matches += 1;
+        }
+    }
+
+    return matches;
+}
+
+// Write each command of a table with the word, by scanning every command. Returns the number
+// written.
+static size_t search_table(
+    const CliHeader* header,
+    const CliCommand* commands,
+    size_t count,
+    const char* word,
+    size_t width
+) {
+    size_t matches = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        if (has_word(header, &commands[i], word) && is_visible(header, &commands[i])) {
+            write_command_line(header, &commands[i], width);
+            matches += 1;
+        }
+    }
+
+    return matches;
+}
+
+// Write each command with the word. Contexts are not indexed, so their commands are scanned.
+static size_t search_commands(const CliHeader* header, const char* word, uint32_t hash) {
+    size_t width = name_column_width(header);
+    size_t matches = 0;
+
+    for (size_t i = context_depth(header); i > 0; i--) {
+        const CliContext* context = context_at(header, i - 1);
+        matches += search_table(header, context->commands, context->count, word, width);
+    }
+
+    if (header->keywords_complete) {
+        matches += search_index(header, word, hash, width);
+    } else {
+        matches += search_table(header, header->commands, header->count, word, width);
+    }
+
+    return matches;
+}
+
+static CliRunResult write_search(const CliHeader* header, const char* word) {
+    uint32_t hash = fnv_offset_basis;
+    size_t length = 0;
+
+    for (const char* c = word; *c != '\0'; c++) {
+        if (!is_word_char(*c)) {
+            return cli_run_result_bad_argument;
+        }
+
+        hash = (hash ^ (uint8_t)to_lower(*c)) * fnv_prime;
+        length += 1;
+    }
+
+    if (length < help_min_keyword_length) {
+        return cli_run_result_bad_argument;
+    }
+
+    libcli_write(header, "commands matching ");
+    libcli_write(header, word);
+    libcli_write(header, ":");
+
+    size_t matches = search_commands(header, word, hash);
+
+    libcli_write(header, (matches > 0) ? "\n" : "\n    (none)\n");
+    return cli_run_result_ok;
+}
+
+CliRunResult libcli_run_help(const CliHeader* header, const char* const* strings, size_t count) {
+    if (count == 0) {
+        write_command_list(header);
+        return cli_run_result_ok;
+    } else if ((count == 1) && (strcmp(strings[0], "-s") != 0)) {
+        return write_topic(header, strings[0]);
+    } else if ((count == 2) && (strcmp(strings[0], "-s") == 0)) {
+        return write_search(header, strings[1]);
+    } else {
+        return cli_run_result_bad_argc;
+    }
+}
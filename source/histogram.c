@@ -0,0 +1,55 @@
+#include "internal/histogram.h"
+
+#include <string.h>
+
+static size_t bucket_index(uint32_t value) {
+    size_t index = 0;
+
+    while (value > 0) {
+        index += 1;
+        value >>= 1;
+    }
+
+    return index;
+}
+
+// The largest value which falls into the bucket at `index`
+static uint32_t bucket_upper_bound(size_t index) {
+    return (uint32_t)(((uint64_t)1 << index) - 1);
+}
+
+void libcli_histogram_init(Histogram* histogram) {
+    histogram->min = UINT32_MAX;
+    histogram->max = 0;
+    histogram->sum = 0;
+    histogram->count = 0;
+    memset(histogram->buckets, 0, sizeof(histogram->buckets));
+}
+
+void libcli_histogram_add(Histogram* histogram, uint32_t value) {
+    histogram->min = (value < histogram->min) ? value : histogram->min;
+    histogram->max = (value > histogram->max) ? value : histogram->max;
+    histogram->sum += value;
+    histogram->count += 1;
+    histogram->buckets[bucket_index(value)] += 1;
+}
+
+uint32_t libcli_histogram_mean(const Histogram* histogram) {
+    return (histogram->count > 0) ? (uint32_t)(histogram->sum / histogram->count) : 0;
+}
+
+uint32_t libcli_histogram_percentile(const Histogram* histogram, unsigned percentile) {
+    uint64_t rank = (((uint64_t)histogram->count * percentile) + 99) / 100;
+    uint64_t seen = 0;
+
+    for (size_t i = 0; i < histogram_bucket_count; i++) {
+        seen += histogram->buckets[i];
+
+        if ((seen >= rank) && (seen > 0)) {
+            uint32_t bound = bucket_upper_bound(i);
+            return (bound < histogram->max) ? bound : histogram->max;
+        }
+    }
+
+    return histogram->max;
+}
@@ -0,0 +1,544 @@
+#include "internal/jobs.h"
+#include "cli_format.h"
+#include "internal/array.h"
+#include "internal/command.h"
+#include "internal/constraints.h"
+
+#include <string.h>
+
+enum {
+    wheel_bucket_count = cli_wheel_level_count * cli_wheel_slot_count,
+    wheel_slot_mask = cli_wheel_slot_count - 1,
+};
+
+void libcli_every_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* data
+) {
+    (void)header;
+    (void)argc;
+    (void)argv;
+    (void)data;
+    // Unused. If the every command is selected, `libcli_run_every` is executed instead of this.
+}
+
+void libcli_watch_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* data
+) {
+    (void)header;
+    (void)argc;
+    (void)argv;
+    (void)data;
+    // Unused. If the watch command is selected, `libcli_run_watch` is executed instead of this.
+}
+
+// Timer wheel
+
+// The wheel list a job due at `due` goes in. Level `n` holds the jobs due within 64^(n + 1) ticks,
+// in the slot of their due tick's `n`th group of six bits. Jobs due further away than the wheel
+// reaches wait in the slot of its furthest tick, and move down when that slot is cascaded.
+static uint16_t bucket_for(const CliJobs* jobs, uint32_t due) {
+    uint32_t delay = due - jobs->now;
+
+    if (delay >= (uint32_t)cli_job_max_period) {
+        delay = cli_job_max_period - 1;
+        due = jobs->now + delay;
+    }
+
+    size_t level = 0;
+    while ((delay >> (cli_wheel_slot_bits * (level + 1))) != 0) {
+        level += 1;
+    }
+
+    size_t slot = (due >> (cli_wheel_slot_bits * level)) & wheel_slot_mask;
+    return (uint16_t)((level * cli_wheel_slot_count) + slot);
+}
+
+static void link_job(CliJobs* jobs, uint16_t index) {
+    CliJob* job = &jobs->jobs[index];
+    uint16_t bucket = bucket_for(jobs, job->due);
+    uint16_t head = jobs->buckets[bucket];
+
+    job->bucket = bucket;
+    job->previous = cli_job_none;
+    job->next = head;
+
+    if (head != cli_job_none) {
+        jobs->jobs[head].previous = index;
+    }
+
+    jobs->buckets[bucket] = index;
+}
+
+static void unlink_job(CliJobs* jobs, uint16_t index) {
+    CliJob* job = &jobs->jobs[index];
+
+    if (job->bucket == cli_job_none) {
+        return;
+    }
+
+    if (job->previous != cli_job_none) {
+        jobs->jobs[job->previous].next = job->next;
+    } else {
+        jobs->buckets[job->bucket] = job->next;
+    }
+
+    if (job->next != cli_job_none) {
+        jobs->jobs[job->next].previous = job->previous;
+    }
+
+    job->bucket = cli_job_none;
+}
+
+// Move the jobs of a slot of an upper level down to the levels below, now that the wheel has
+// turned to within its range
+static void cascade(CliJobs* jobs, size_t level) {
+    size_t slot = (jobs->now >> (cli_wheel_slot_bits * level)) & wheel_slot_mask;
+    uint16_t bucket = (uint16_t)((level * cli_wheel_slot_count) + slot);
+
+    while (jobs->buckets[bucket] != cli_job_none) {
+        uint16_t index = jobs->buckets[bucket];
+        unlink_job(jobs, index);
+        link_job(jobs, index);
+    }
+}
+
+static void record_run(CliJobStats* stats, uint32_t late) {
+    stats->runs += 1;
+    stats->last_late = late;
+    stats->total_late += late;
+
+    if (late > stats->max_late) {
+        stats->max_late = late;
+    }
+}
+
+// Run a job which has come due, and schedule its next run after `target`, the tick the wheel is
+// turning to
+static void run_job(
+    const CliHeader* header,
+    CliJobs* jobs,
+    uint16_t index,
+    uint32_t target,
+    void* userdata
+) {
+    CliJob* job = &jobs->jobs[index];
+    uint32_t id = job->id;
+    uint32_t late = target - job->due;
+
+    record_run(&job->stats, late);
+
+    CliHeader job_header = *header;
+
+    if (job->writeback != NULL) {
+        job_header.writeback = job->writeback;
+        job_header.writeback_data = job->writeback_data;
+    }
+
+    libcli_run_command(&job_header, job->command, job->argc, job->argv, userdata);
+
+    // The command may have cancelled its own job (and another may have taken its place)
+    if (job->id != id) {
+        return;
+    }
+
+    uint32_t missed = late / job->period;
+    job->stats.missed += missed;
+    job->due += (missed + 1) * job->period;
+    link_job(jobs, index);
+}
+
+// Turn the wheel one tick, and run the jobs due then. Returns the number of runs.
+static size_t turn_wheel(const CliHeader* header, CliJobs* jobs, uint32_t target, void* userdata) {
+    jobs->now += 1;
+
+    for (size_t level = 1; level < cli_wheel_level_count; level++) {
+        uint32_t lower_bits = jobs->now & ((1u << (cli_wheel_slot_bits * level)) - 1);
+
+        if (lower_bits != 0) {
+            break;
+        }
+
+        cascade(jobs, level);
+    }
+
+    uint16_t bucket = (uint16_t)(jobs->now & wheel_slot_mask);
+    size_t runs = 0;
+
+    // Rescheduled jobs are due at least a tick later, so they never land back in this slot.
+    while (jobs->buckets[bucket] != cli_job_none) {
+        uint16_t index = jobs->buckets[bucket];
+        unlink_job(jobs, index);
+        run_job(header, jobs, index, target, userdata);
+        runs += 1;
+    }
+
+    return runs;
+}
+
+bool libcli_jobs_init(
+    CliJobs* jobs,
+    CliJob* entries,
+    size_t capacity,
+    CliTimestampFunction clock,
+    uint32_t ticks_per_second
+) {
+    if ((clock == NULL) || (ticks_per_second == 0) || (capacity >= cli_job_none)) {
+        return false;
+    }
+
+    jobs->jobs = entries;
+    jobs->capacity = capacity;
+    jobs->clock = clock;
+    jobs->ticks_per_second = ticks_per_second;
+    jobs->now = clock();
+    jobs->next_id = 1;
+    jobs->active = 0;
+
+    for (size_t i = 0; i < wheel_bucket_count; i++) {
+        jobs->buckets[i] = cli_job_none;
+    }
+
+    for (size_t i = 0; i < capacity; i++) {
+        entries[i].id = 0;
+        entries[i].bucket = cli_job_none;
+    }
+
+    return true;
+}
+
+size_t libcli_jobs_service(const CliHeader* header, CliJobs* jobs, void* userdata) {
+    uint32_t target = jobs->clock();
+    size_t runs = 0;
+
+    while (jobs->now != target) {
+        if (jobs->active == 0) {
+            // Nothing can come due, so the wheel skips straight to the target.
+            jobs->now = target;
+        } else {
+            runs += turn_wheel(header, jobs, target, userdata);
+        }
+    }
+
+    return runs;
+}
+
+static CliJob* find_job(const CliJobs* jobs, uint32_t id) {
+    for (size_t i = 0; (id != 0) && (i < jobs->capacity); i++) {
+        if (jobs->jobs[i].id == id) {
+            return &jobs->jobs[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void free_job(CliJobs* jobs, CliJob* job) {
+    unlink_job(jobs, (uint16_t)(job - jobs->jobs));
+    job->id = 0;
+    jobs->active -= 1;
+}
+
+bool libcli_jobs_cancel(CliJobs* jobs, uint32_t id) {
+    CliJob* job = find_job(jobs, id);
+
+    if (job == NULL) {
+        return false;
+    }
+
+    free_job(jobs, job);
+    return true;
+}
+
+size_t libcli_jobs_cancel_watches(CliJobs* jobs, const void* writeback_data) {
+    size_t cancelled = 0;
+
+    for (size_t i = 0; i < jobs->capacity; i++) {
+        CliJob* job = &jobs->jobs[i];
+
+        if ((job->id != 0) && (job->writeback != NULL) && (job->writeback_data == writeback_data)) {
+            free_job(jobs, job);
+            cancelled += 1;
+        }
+    }
+
+    return cancelled;
+}
+
+bool libcli_jobs_stats(const CliJobs* jobs, uint32_t id, CliJobStats* stats) {
+    const CliJob* job = find_job(jobs, id);
+
+    if (job == NULL) {
+        return false;
+    }
+
+    *stats = job->stats;
+    return true;
+}
+
+// Creating jobs
+
+// Parse a period of ticks ("250"), milliseconds ("100ms") or seconds ("2s") into ticks
+static bool parse_period(const CliJobs* jobs, const char* text, uint32_t* period) {
+    uint64_t value = 0;
+    const char* c = text;
+
+    for (; (*c >= '0') && (*c <= '9'); c++) {
+        value = (value * 10) + (uint64_t)(*c - '0');
+
+        if (value >= cli_job_max_period) {
+            return false;
+        }
+    }
+
+    if (c == text) {
+        return false;
+    } else if (strcmp(c, "ms") == 0) {
+        // Rounded up, so short periods are at least a tick
+        value = ((value * jobs->ticks_per_second) + 999) / 1000;
+    } else if (strcmp(c, "s") == 0) {
+        value *= jobs->ticks_per_second;
+    } else if (*c != '\0') {
+        return false;
+    }
+
+    if ((value == 0) || (value >= cli_job_max_period)) {
+        return false;
+    }
+
+    *period = (uint32_t)value;
+    return true;
+}
+
+// Copy the command's words into the job twice: once as given, for listing, and once for its
+// arguments to be converted from, so its strings (and blobs, which are decoded in place) outlive
+// the input line. Stores the offset of each word, since conversion writes into the words.
+static bool copy_words(
+    CliJob* job,
+    const char* const* strings,
+    size_t string_count,
+    size_t* offsets
+) {
+    size_t length = 0;
+
+    for (size_t i = 0; i < string_count; i++) {
+        size_t size = strlen(strings[i]) + 1;
+
+        if (size > (cli_job_text_size - length)) {
+            return false;
+        }
+
+        offsets[i] = length;
+        memcpy(&job->text[length], strings[i], size);
+        length += size;
+    }
+
+    memcpy(job->argument_text, job->text, length);
+    return true;
+}
+
+// Convert the arguments of the job's command from its copied words, which start at `offsets`
+// (after the command's name). Arrays are stored in the job, rather than in the header's array
+// buffer, which the next line reuses.
+static CliRunResult convert_job_arguments(
+    const CliHeader* header,
+    CliJob* job,
+    const size_t* offsets
+) {
+    CliHeader job_header = *header;
+    job_header.array_buffer = job->elements;
+    job_header.array_buffer_size = sizeof(job->elements);
+    job_header.error = NULL;
+
+    size_t array_used = 0;
+
+    for (size_t i = 0; i < job->argc; i++) {
+        char* word = &job->argument_text[offsets[i]];
+        CliArgumentType type = job->command.arguments[i];
+        CliArgument* argument = &job->argv[i];
+        size_t element = 0;
+        size_t offset = 0;
+        size_t failed = 0;
+        bool converted;
+
+        if (libcli_is_array_type(type)) {
+            argument->type = type;
+            converted = libcli_parse_array(
+                &job_header, type, word, &array_used, &argument->array, &element, &offset
+            );
+        } else {
+            converted = libcli_convert_argument(&job_header, type, word, argument);
+        }
+
+        if (!converted) {
+            return cli_run_result_bad_argument;
+        } else if (!libcli_check_constraints(&job->command, i, argument, &failed)) {
+            return cli_run_result_failed_constraint;
+        }
+    }
+
+    return cli_run_result_ok;
+}
+
+static CliJob* take_free_job(CliJobs* jobs) {
+    for (size_t i = 0; i < jobs->capacity; i++) {
+        if (jobs->jobs[i].id == 0) {
+            return &jobs->jobs[i];
+        }
+    }
+
+    return NULL;
+}
+
+// Create a job from `<period> <command...>`. Watches write their output to the header's writeback.
+static CliRunResult add_job(
+    const CliHeader* header,
+    const char* const* strings,
+    size_t string_count,
+    bool watch
+) {
+    CliJobs* jobs = header->jobs;
+    uint32_t period = 0;
+
+    if (header->transient_output) {
+        // The output (and its writeback's data) only lasts for this line, and the job would
+        // report itself, or write, to it long after.
+        return cli_run_result_bad_pipe;
+    } else if (string_count < 2) {
+        return cli_run_result_bad_argc;
+    } else if (!parse_period(jobs, strings[0], &period)) {
+        return cli_run_result_bad_argument;
+    }
+
+    const CliCommand* command = libcli_lookup_command(header, strings[1]);
+    size_t argc = string_count - 2;
+    CliJob* job = take_free_job(jobs);
+    size_t offsets[cli_max_argument_count + 1];
+
+    if (command == NULL) {
+        return cli_run_result_unknown;
+    } else if (libcli_is_variadic_command(command) || (argc != command->argument_count)) {
+        // Built-in commands which take other commands cannot run as jobs.
+        return cli_run_result_bad_argc;
+    } else if ((job == NULL) || !copy_words(job, &strings[1], string_count - 1, offsets)) {
+        return cli_run_result_no_space;
+    }
+
+    job->command = *command;
+    job->argc = argc;
+
+    CliRunResult result = convert_job_arguments(header, job, &offsets[1]);
+
+    if (result != cli_run_result_ok) {
+        return result;
+    }
+
+    job->id = jobs->next_id;
+    job->period = period;
+    job->due = jobs->clock() + period;
+    job->writeback = watch ? header->writeback : NULL;
+    job->writeback_data = watch ? header->writeback_data : NULL;
+    job->stats = (CliJobStats){ 0 };
+
+    // Ids are never zero, which marks a free job.
+    jobs->next_id = (jobs->next_id == UINT32_MAX) ? 1 : (jobs->next_id + 1);
+    jobs->active += 1;
+    link_job(jobs, (uint16_t)(job - jobs->jobs));
+
+    libcli_printf(header, "job %u\n", (unsigned)job->id);
+    return cli_run_result_ok;
+}
+
+CliRunResult libcli_run_every(
+    const CliHeader* header,
+    const char* const* strings,
+    size_t string_count
+) {
+    return add_job(header, strings, string_count, false);
+}
+
+CliRunResult libcli_run_watch(
+    const CliHeader* header,
+    const char* const* strings,
+    size_t string_count
+) {
+    return add_job(header, strings, string_count, true);
+}
+
+// Listing and cancelling jobs
+
+static void write_words(const CliHeader* header, const CliJob* job) {
+    const char* word = job->text;
+
+    for (size_t i = 0; i <= job->argc; i++) {
+        libcli_write(header, (i > 0) ? " " : "");
+        libcli_write(header, word);
+        word += strlen(word) + 1;
+    }
+}
+
+static void jobs_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* data
+) {
+    (void)argc;
+    (void)argv;
+    (void)data;
+
+    const CliJobs* jobs = header->jobs;
+    libcli_printf(header, "%4s %-5s %8s %8s %6s %8s %8s  %s\n",
+        "id", "kind", "period", "runs", "missed", "late", "max", "command");
+
+    for (size_t i = 0; i < jobs->capacity; i++) {
+        const CliJob* job = &jobs->jobs[i];
+        const CliJobStats* stats = &job->stats;
+
+        if (job->id == 0) {
+            continue;
+        }
+
+        uint64_t mean_late = (stats->runs > 0) ? (stats->total_late / stats->runs) : 0;
+        libcli_printf(header, "%4u %-5s %8u %8u %6u %8llu %8u  ",
+            (unsigned)job->id,
+            (job->writeback != NULL) ? "watch" : "every",
+            (unsigned)job->period,
+            (unsigned)stats->runs,
+            (unsigned)stats->missed,
+            (unsigned long long)mean_late,
+            (unsigned)stats->max_late);
+        write_words(header, job);
+        libcli_write(header, "\n");
+    }
+}
+
+static void cancel_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* data
+) {
+    (void)argc;
+    (void)data;
+
+    if ((argv[0].integer <= 0) || !libcli_jobs_cancel(header->jobs, (uint32_t)argv[0].integer)) {
+        libcli_write(header, "no such job\n");
+    }
+}
+
+bool libcli_add_job_commands(CliHeader* header) {
+    const char* every_summary = "runs a command periodically in the background";
+    const char* watch_summary = "runs a command periodically, showing its output here";
+    CliArgumentType cancel_args[] = { cli_argument_type_int };
+
+    return libcli_add(header, "every", every_summary, 0, NULL, libcli_every_command)
+        && libcli_add(header, "watch", watch_summary, 0, NULL, libcli_watch_command)
+        && libcli_add(header, "jobs", "lists periodic jobs", 0, NULL, jobs_command)
+        && libcli_add(header, "cancel", "stops a periodic job", 1, cancel_args, cancel_command);
+}
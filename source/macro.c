@@ -0,0 +1,440 @@
+#include "cli_macro.h"
+#include "internal/array.h"
+#include "internal/command.h"
+#include "internal/constraints.h"
+#include "internal/shared.h"
+
+#include <string.h>
+
+_Static_assert(sizeof(float) == sizeof(uint32_t), "macros store floats as 32-bit values");
+
+static const char macro_magic[3] = { 'L', 'C', 'M' };
+
+// Appends bytecode to a fixed-size buffer. Once anything does not fit, `full` is set.
+typedef struct Writer {
+    uint8_t* data;
+    size_t size;
+    size_t length;
+    bool full;
+} Writer;
+
+// Reads bytecode with bounds checking. Once anything is out of bounds, `failed` is set.
+typedef struct Reader {
+    const uint8_t* data;
+    size_t size;
+    size_t position;
+    bool failed;
+} Reader;
+
+static void write_bytes(Writer* writer, const void* bytes, size_t count) {
+    if (count > (writer->size - writer->length)) {
+        writer->full = true;
+    } else {
+        memcpy(&writer->data[writer->length], bytes, count);
+        writer->length += count;
+    }
+}
+
+static void write_u8(Writer* writer, uint8_t value) {
+    write_bytes(writer, &value, 1);
+}
+
+static void write_u16(Writer* writer, uint16_t value) {
+    uint8_t bytes[2] = { (uint8_t)value, (uint8_t)(value >> 8) };
+    write_bytes(writer, bytes, sizeof(bytes));
+}
+
+static void write_u32(Writer* writer, uint32_t value) {
+    uint8_t bytes[4] = {
+        (uint8_t)value,
+        (uint8_t)(value >> 8),
+        (uint8_t)(value >> 16),
+        (uint8_t)(value >> 24),
+    };
+    write_bytes(writer, bytes, sizeof(bytes));
+}
+
+// Returns a pointer to the next `count` bytes, or NULL if there are not enough bytes left.
+static const uint8_t* read_bytes(Reader* reader, size_t count) {
+    if (reader->failed || (count > (reader->size - reader->position))) {
+        reader->failed = true;
+        return NULL;
+    } else {
+        const uint8_t* bytes = &reader->data[reader->position];
+        reader->position += count;
+        return bytes;
+    }
+}
+
+static uint8_t read_u8(Reader* reader) {
+    const uint8_t* bytes = read_bytes(reader, 1);
+    return (bytes == NULL) ? 0 : bytes[0];
+}
+
+static uint16_t read_u16(Reader* reader) {
+    const uint8_t* bytes = read_bytes(reader, 2);
+    return (bytes == NULL) ? 0 : (uint16_t)(bytes[0] | (bytes[1] << 8));
+}
+
+static uint32_t read_u32(Reader* reader) {
+    const uint8_t* bytes = read_bytes(reader, 4);
+
+    if (bytes == NULL) {
+        return 0;
+    } else {
+        return (uint32_t)bytes[0]
+            | ((uint32_t)bytes[1] << 8)
+            | ((uint32_t)bytes[2] << 16)
+            | ((uint32_t)bytes[3] << 24);
+    }
+}
+
+// Arrays are stored as a count and the elements, with int and float elements as 32-bit values.
+static void write_array(Writer* writer, const CliArgument* argument) {
+    const CliArray* array = &argument->array;
+
+    if (array->count > UINT16_MAX) {
+        writer->full = true;
+        return;
+    }
+
+    write_u16(writer, (uint16_t)array->count);
+
+    for (size_t i = 0; i < array->count; i++) {
+        if (argument->type == cli_argument_type_int_array) {
+            write_u32(writer, (uint32_t)(int32_t)array->integers[i]);
+        } else if (argument->type == cli_argument_type_float_array) {
+            uint32_t bits;
+            memcpy(&bits, &array->floats[i], sizeof(bits));
+            write_u32(writer, bits);
+        } else {
+            write_u8(writer, array->bytes[i]);
+        }
+    }
+}
+
+static void write_argument(Writer* writer, const CliArgument* argument) {
+    write_u8(writer, (uint8_t)argument->type);
+
+    switch (argument->type) {
+        case cli_argument_type_string: {
+            size_t length = strlen(argument->string);
+
+            if (length > UINT16_MAX) {
+                writer->full = true;
+            } else {
+                write_u16(writer, (uint16_t)length);
+                write_bytes(writer, argument->string, length + 1);
+            }
+            break;
+        }
+        case cli_argument_type_int:
+            write_u32(writer, (uint32_t)(int32_t)argument->integer);
+            break;
+        case cli_argument_type_float: {
+            uint32_t bits;
+            memcpy(&bits, &argument->float_, sizeof(bits));
+            write_u32(writer, bits);
+            break;
+        }
+        case cli_argument_type_fixed:
+            write_u32(writer, (uint32_t)argument->fixed);
+            break;
+        case cli_argument_type_blob:
+            if (argument->blob.size > UINT16_MAX) {
+                writer->full = true;
+            } else {
+                write_u16(writer, (uint16_t)argument->blob.size);
+                write_bytes(writer, argument->blob.data, argument->blob.size);
+            }
+            break;
+        case cli_argument_type_int_array:
+        case cli_argument_type_u8_array:
+        case cli_argument_type_float_array:
+            write_array(writer, argument);
+            break;
+    }
+}
+
+// Byte arrays are used in place in the macro. Int and float elements are decoded into the array
+// buffer, after the instruction's earlier arrays.
+static bool read_array(
+    const CliHeader* header,
+    Reader* reader,
+    CliArgumentType type,
+    size_t* array_used,
+    CliArray* array
+) {
+    size_t count = read_u16(reader);
+
+    if (type == cli_argument_type_u8_array) {
+        array->bytes = read_bytes(reader, count);
+        array->count = count;
+        return !reader->failed;
+    }
+
+    void* elements = libcli_reserve_array(header, type, count, array_used);
+
+    if (elements == NULL) {
+        return false;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        uint32_t bits = read_u32(reader);
+
+        if (type == cli_argument_type_int_array) {
+            ((int*)elements)[i] = (int)(int32_t)bits;
+        } else {
+            memcpy(&((float*)elements)[i], &bits, sizeof(bits));
+        }
+    }
+
+    array->data = elements;
+    array->count = count;
+    return !reader->failed;
+}
+
+static bool read_argument(
+    const CliHeader* header,
+    Reader* reader,
+    CliArgumentType expected_type,
+    size_t* array_used,
+    CliArgument* argument
+) {
+    uint8_t type = read_u8(reader);
+
+    if (reader->failed || (type != (uint8_t)expected_type)) {
+        return false;
+    }
+
+    argument->type = expected_type;
+
+    switch (expected_type) {
+        case cli_argument_type_string: {
+            uint16_t length = read_u16(reader);
+            const uint8_t* bytes = read_bytes(reader, (size_t)length + 1);
+
+            argument->string = (const char*)bytes;
+            return (bytes != NULL) && (bytes[length] == '\0');
+        }
+        case cli_argument_type_int:
+            argument->integer = (int)(int32_t)read_u32(reader);
+            return !reader->failed;
+        case cli_argument_type_float: {
+            uint32_t bits = read_u32(reader);
+            memcpy(&argument->float_, &bits, sizeof(bits));
+            return !reader->failed;
+        }
+        case cli_argument_type_fixed:
+            argument->fixed = (int32_t)read_u32(reader);
+            return !reader->failed;
+        case cli_argument_type_blob: {
+            uint16_t size = read_u16(reader);
+
+            argument->blob.data = read_bytes(reader, size);
+            argument->blob.size = size;
+            return !reader->failed;
+        }
+        case cli_argument_type_int_array:
+        case cli_argument_type_u8_array:
+        case cli_argument_type_float_array:
+            return read_array(header, reader, expected_type, array_used, &argument->array);
+    }
+
+    return false;
+}
+
+// Compile a single line into an instruction (or nothing, if the line is empty).
+static CliRunResult compile_line(const CliHeader* header, char* line, Writer* writer) {
+    const char* strings[input_parser_argument_capacity];
+    size_t string_count = 0;
+
+    CliRunResult result = libcli_tokenize(
+        header,
+        line,
+        strings,
+        input_parser_argument_capacity,
+        &string_count
+    );
+
+    if (result != cli_run_result_ok) {
+        return result;
+    } else if (string_count == 0) {
+        return cli_run_result_ok;
+    }
+
+    for (size_t i = 0; i < string_count; i++) {
+        if (strings[i] == NULL) {
+            return cli_run_result_bad_pipe;
+        }
+    }
+
+    SearchResult search = libcli_find_command(header, strings[0]);
+
+    if (!search.found) {
+        return cli_run_result_unknown;
+    } else if (search.index > UINT16_MAX) {
+        return cli_run_result_no_space;
+    }
+
+    const CliCommand* command = &header->commands[search.index];
+    size_t argc = string_count - 1;
+
+    if (argc != command->argument_count) {
+        return cli_run_result_bad_argc;
+    }
+
+    write_u16(writer, (uint16_t)search.index);
+    write_u8(writer, (uint8_t)argc);
+
+    for (size_t i = 0; i < argc; i++) {
+        CliArgument argument;
+        size_t failed = 0;
+
+        if (!libcli_convert_argument(header, command->arguments[i], strings[i + 1], &argument)) {
+            return cli_run_result_bad_argument;
+        } else if (!libcli_check_constraints(command, i, &argument, &failed)) {
+            // Replays run the command without converting again, so constraints are checked here
+            return cli_run_result_failed_constraint;
+        }
+
+        write_argument(writer, &argument);
+    }
+
+    return writer->full ? cli_run_result_no_space : cli_run_result_ok;
+}
+
+static CliCompileResult compile_script(
+    const CliHeader* header,
+    char* script,
+    uint8_t* buffer,
+    size_t buffer_size
+) {
+    if (buffer_size < cli_macro_header_size) {
+        return (CliCompileResult){ cli_run_result_no_space, 0, 0 };
+    }
+
+    Writer writer = { buffer, buffer_size, cli_macro_header_size, false };
+    char* line = script;
+
+    for (size_t line_index = 0; line != NULL; line_index++) {
+        char* newline = strchr(line, '\n');
+        char* next = NULL;
+
+        if (newline != NULL) {
+            *newline = '\0';
+            next = newline + 1;
+        }
+
+        CliRunResult result = compile_line(header, line, &writer);
+
+        if (result != cli_run_result_ok) {
+            return (CliCompileResult){ result, line_index, 0 };
+        }
+
+        line = next;
+    }
+
+    Writer header_writer = { buffer, cli_macro_header_size, 0, false };
+    write_bytes(&header_writer, macro_magic, sizeof(macro_magic));
+    write_u8(&header_writer, cli_macro_version);
+    write_u32(&header_writer, header->fingerprint);
+    write_u32(&header_writer, (uint32_t)(writer.length - cli_macro_header_size));
+
+    return (CliCompileResult){ cli_run_result_ok, 0, writer.length };
+}
+
+CliCompileResult libcli_compile(
+    const CliHeader* header,
+    char* script,
+    uint8_t* buffer,
+    size_t buffer_size
+) {
+    if (header->shared == NULL) {
+        return compile_script(header, script, buffer, buffer_size);
+    }
+
+    CliHeader snapshot;
+    unsigned reader = libcli_begin_snapshot(header, &snapshot);
+    CliCompileResult result = compile_script(&snapshot, script, buffer, buffer_size);
+    libcli_end_snapshot(header, reader);
+    return result;
+}
+
+// Run the instruction at the reader's position.
+static CliRunResult replay_instruction(const CliHeader* header, Reader* reader, void* userdata) {
+    uint16_t index = read_u16(reader);
+    uint8_t argc = read_u8(reader);
+
+    if (reader->failed || (index >= header->count)) {
+        return cli_run_result_bad_macro;
+    }
+
+    CliCommand command = header->commands[index];
+    CliArgument argv[cli_max_argument_count];
+    size_t array_used = 0;
+
+    if (argc != command.argument_count) {
+        return cli_run_result_bad_macro;
+    }
+
+    for (size_t i = 0; i < argc; i++) {
+        if (!read_argument(header, reader, command.arguments[i], &array_used, &argv[i])) {
+            return cli_run_result_bad_macro;
+        }
+    }
+
+    return libcli_run_command(header, command, argc, argv, userdata);
+}
+
+static CliRunResult replay_macro(
+    const CliHeader* header,
+    const uint8_t* macro,
+    size_t size,
+    void* userdata
+) {
+    Reader reader = { macro, size, 0, false };
+
+    const uint8_t* magic = read_bytes(&reader, sizeof(macro_magic));
+    uint8_t version = read_u8(&reader);
+    uint32_t fingerprint = read_u32(&reader);
+    uint32_t body_size = read_u32(&reader);
+
+    if (reader.failed
+        || (memcmp(magic, macro_magic, sizeof(macro_magic)) != 0)
+        || (version != cli_macro_version)
+        || (fingerprint != header->fingerprint)
+        || (body_size > (size - cli_macro_header_size))
+    ) {
+        return cli_run_result_bad_macro;
+    }
+
+    reader.size = cli_macro_header_size + body_size;
+
+    while (reader.position < reader.size) {
+        CliRunResult result = replay_instruction(header, &reader, userdata);
+
+        if (result != cli_run_result_ok) {
+            return result;
+        }
+    }
+
+    return cli_run_result_ok;
+}
+
+CliRunResult libcli_replay(
+    const CliHeader* header,
+    const uint8_t* macro,
+    size_t size,
+    void* userdata
+) {
+    if (header->shared == NULL) {
+        return replay_macro(header, macro, size, userdata);
+    }
+
+    CliHeader snapshot;
+    unsigned reader = libcli_begin_snapshot(header, &snapshot);
+    CliRunResult result = replay_macro(&snapshot, macro, size, userdata);
+    libcli_end_snapshot(header, reader);
+    return result;
+}
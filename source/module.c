@@ -0,0 +1,206 @@
+#include "cli_module.h"
+#include "internal/command.h"
+
+#include <dlfcn.h>
+#include <string.h>
+
+enum {
+    // Number of tab-separated fields in a manifest line
+    manifest_field_count = 5,
+};
+
+typedef enum ManifestField {
+    manifest_field_name,
+    manifest_field_arguments,
+    manifest_field_path,
+    manifest_field_symbol,
+    manifest_field_summary,
+} ManifestField;
+
+// Split `line` in-place at each tab. Returns false if it does not have exactly the expected fields.
+static bool split_fields(char* line, char** fields) {
+    size_t count = 0;
+    char* field = line;
+
+    while (field != NULL) {
+        if (count == manifest_field_count) {
+            return false;
+        }
+
+        char* tab = strchr(field, '\t');
+
+        if (tab != NULL) {
+            *tab = '\0';
+            tab += 1;
+        }
+
+        fields[count] = field;
+        count += 1;
+        field = tab;
+    }
+
+    return count == manifest_field_count;
+}
+
+static bool parse_argument_types(const char* text, CliArgumentType* types, size_t* count) {
+    *count = 0;
+
+    if (strcmp(text, "-") == 0) {
+        return true;
+    }
+
+    for (const char* c = text; *c != '\0'; c++) {
+        if (*count == cli_max_argument_count) {
+            return false;
+        } else if (*c == 's') {
+            types[*count] = cli_argument_type_string;
+        } else if (*c == 'i') {
+            types[*count] = cli_argument_type_int;
+        } else if (*c == 'f') {
+            types[*count] = cli_argument_type_float;
+        } else if (*c == 'q') {
+            types[*count] = cli_argument_type_fixed;
+        } else if (*c == 'b') {
+            types[*count] = cli_argument_type_blob;
+        } else {
+            return false;
+        }
+
+        *count += 1;
+    }
+
+    return *count > 0;
+}
+
+static CliModuleCommand* find_module_command(CliModules* modules, const char* name) {
+    // Only searched the first time each command runs, so a linear search is enough.
+    for (size_t i = 0; i < modules->count; i++) {
+        if (strcmp(modules->commands[i].name, name) == 0) {
+            return &modules->commands[i];
+        }
+    }
+
+    return NULL;
+}
+
+static CliCommandFunction resolve_module_command(const char* name, void* data) {
+    CliModuleCommand* command = find_module_command((CliModules*)data, name);
+
+    if (command == NULL) {
+        return NULL;
+    }
+
+    if (command->handle == NULL) {
+        command->handle = dlopen(command->path, RTLD_NOW | RTLD_LOCAL);
+    }
+
+    if (command->handle == NULL) {
+        return NULL;
+    }
+
+    // POSIX guarantees a `dlsym` result can be converted to a function pointer, but ISO C does not
+    // allow a direct cast, so it is copied.
+    void* symbol = dlsym(command->handle, command->symbol);
+    CliCommandFunction function = NULL;
+
+    if (symbol != NULL) {
+        memcpy(&function, &symbol, sizeof(function));
+    }
+
+    return function;
+}
+
+// Add the stub command described by one manifest line
+static CliRunResult load_line(CliHeader* header, CliModules* modules, char* line) {
+    char* fields[manifest_field_count];
+    CliArgumentType types[cli_max_argument_count];
+    size_t type_count = 0;
+
+    if (!split_fields(line, fields)
+        || (fields[manifest_field_name][0] == '\0')
+        || !parse_argument_types(fields[manifest_field_arguments], types, &type_count)
+    ) {
+        return cli_run_result_bad_module;
+    } else if (modules->count == modules->capacity) {
+        return cli_run_result_no_space;
+    }
+
+    const char* name = fields[manifest_field_name];
+    const char* summary = fields[manifest_field_summary];
+
+    if (!libcli_add(header, name, summary, type_count, types, NULL)) {
+        return (header->count == header->capacity)
+            ? cli_run_result_no_space
+            : cli_run_result_bad_module;
+    }
+
+    modules->commands[modules->count] = (CliModuleCommand){
+        .name = name,
+        .path = fields[manifest_field_path],
+        .symbol = fields[manifest_field_symbol],
+        .handle = NULL,
+    };
+    modules->count += 1;
+
+    return cli_run_result_ok;
+}
+
+CliModules libcli_modules_new(CliModuleCommand* commands, size_t commands_size) {
+    return (CliModules){
+        .commands = commands,
+        .capacity = commands_size,
+        .count = 0,
+    };
+}
+
+CliManifestResult libcli_load_manifest(CliHeader* header, CliModules* modules, char* manifest) {
+    // Shared headers are run from many threads, which would open modules concurrently.
+    if (header->shared != NULL) {
+        return (CliManifestResult){ .status = cli_run_result_bad_module, .line = 0 };
+    }
+
+    header->resolve = resolve_module_command;
+    header->resolve_data = modules;
+
+    char* line = manifest;
+
+    for (size_t line_index = 0; line != NULL; line_index++) {
+        char* newline = strchr(line, '\n');
+        char* next = NULL;
+
+        if (newline != NULL) {
+            *newline = '\0';
+            next = newline + 1;
+        }
+
+        if ((line[0] != '\0') && (line[0] != '#')) {
+            CliRunResult result = load_line(header, modules, line);
+
+            if (result != cli_run_result_ok) {
+                return (CliManifestResult){ result, line_index };
+            }
+        }
+
+        line = next;
+    }
+
+    return (CliManifestResult){ cli_run_result_ok, 0 };
+}
+
+void libcli_unload_modules(CliHeader* header, CliModules* modules) {
+    for (size_t i = 0; i < modules->count; i++) {
+        CliModuleCommand* command = &modules->commands[i];
+        SearchResult search = libcli_find_command(header, command->name);
+
+        // Unbind the command, so its next run opens the module again rather than calling into
+        // the closed one.
+        if (search.found) {
+            header->commands[search.index].function = NULL;
+        }
+
+        if (command->handle != NULL) {
+            dlclose(command->handle);
+            command->handle = NULL;
+        }
+    }
+}
@@ -0,0 +1,158 @@
+#include "internal/options.h"
+
+#include <ctype.h>
+#include <string.h>
+
+static const uint32_t fnv_offset_basis = 2166136261u;
+static const uint32_t fnv_prime = 16777619u;
+
+static uint32_t hash_char(uint32_t hash, char c) {
+    return (hash ^ (uint8_t)c) * fnv_prime;
+}
+
+// Hash a name up to its end or '=', so `--name=value` hashes like `--name`
+static uint32_t hash_name(uint32_t hash, const char* name, const char** end) {
+    const char* c = name;
+
+    for (; (*c != '\0') && (*c != '='); c++) {
+        hash = hash_char(hash, *c);
+    }
+
+    *end = c;
+    return hash;
+}
+
+static uint32_t hash_long_name(const char* name) {
+    const char* end = NULL;
+    return hash_name(hash_char(hash_char(fnv_offset_basis, '-'), '-'), name, &end);
+}
+
+static uint32_t hash_short_name(char name) {
+    return hash_char(hash_char(fnv_offset_basis, '-'), name);
+}
+
+// Insert a key at the first free slot from its hash. Returns false if it is a duplicate name.
+static bool insert_key(CliOptionTable* table, uint32_t hash, size_t key) {
+    const CliOption* option = &table->options[key / 2];
+
+    for (size_t i = 0; i < cli_option_slot_count; i++) {
+        size_t slot = (hash + i) % cli_option_slot_count;
+        size_t existing = table->slots[slot];
+
+        if (existing == 0) {
+            table->slots[slot] = (uint8_t)(key + 1);
+            return true;
+        }
+
+        const CliOption* other = &table->options[(existing - 1) / 2];
+        bool both_long = ((key % 2) == 0) && ((existing - 1) % 2 == 0);
+        bool both_short = ((key % 2) == 1) && ((existing - 1) % 2 == 1);
+
+        if ((both_long && (strcmp(option->name, other->name) == 0))
+            || (both_short && (option->short_name == other->short_name))
+        ) {
+            return false;
+        }
+    }
+
+    return false;
+}
+
+bool libcli_option_table_new(CliOptionTable* table, const CliOption* options, size_t count) {
+    *table = (CliOptionTable){ .options = options, .count = count };
+
+    if (count > cli_max_option_count) {
+        return false;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        const CliOption* option = &options[i];
+
+        if ((strchr(option->name, '=') != NULL)
+            || !insert_key(table, hash_long_name(option->name), i * 2)
+        ) {
+            return false;
+        }
+
+        if (option->short_name == '\0') {
+            continue;
+        } else if (!isalpha((unsigned char)option->short_name)
+            || !insert_key(table, hash_short_name(option->short_name), i * 2 + 1)
+        ) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool libcli_is_option_word(const char* word) {
+    if (word[0] != '-') {
+        return false;
+    } else if (word[1] == '-') {
+        return word[2] != '\0';
+    } else {
+        return isalpha((unsigned char)word[1]);
+    }
+}
+
+// Returns true if the name between `start` and `end` is the name of the key
+static bool key_matches(
+    const CliOptionTable* table,
+    size_t key,
+    const char* start,
+    const char* end
+) {
+    const CliOption* option = &table->options[key / 2];
+    size_t length = (size_t)(end - start);
+
+    if ((key % 2) == 1) {
+        return (length == 1) && (*start == option->short_name);
+    } else {
+        return (strncmp(option->name, start, length) == 0) && (option->name[length] == '\0');
+    }
+}
+
+size_t libcli_find_option(const CliOptionTable* table, const char* word, const char** value) {
+    const char* end = NULL;
+    uint32_t hash = hash_name(fnv_offset_basis, word, &end);
+
+    const char* name = (word[1] == '-') ? &word[2] : &word[1];
+    *value = (*end == '=') ? end + 1 : NULL;
+
+    for (size_t i = 0; i < cli_option_slot_count; i++) {
+        size_t slot = table->slots[(hash + i) % cli_option_slot_count];
+
+        if (slot == 0) {
+            break;
+        }
+
+        size_t key = slot - 1;
+        bool is_short = (key % 2) == 1;
+
+        if ((is_short == (word[1] != '-')) && key_matches(table, key, name, end)) {
+            return key / 2;
+        }
+    }
+
+    return option_not_found;
+}
+
+void libcli_default_options(const CliOptionTable* table, CliOptions* options) {
+    options->present = 0;
+
+    for (size_t i = 0; i < table->count; i++) {
+        const CliOption* option = &table->options[i];
+
+        if (option->takes_value) {
+            options->values[i] = option->default_value;
+            options->values[i].type = option->type;
+        } else {
+            options->values[i] = (CliArgument){ .type = cli_argument_type_int, .integer = 0 };
+        }
+    }
+}
+
+bool libcli_option_present(const CliOptions* options, size_t index) {
+    return (options->present & ((uint32_t)1 << index)) != 0;
+}
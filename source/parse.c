@@ -1,5 +1,4 @@
 #include "internal/parse.h"
-#include <ctype.h>
 
 typedef enum QuoteKind {
     quote_kind_unquoted,
@@ -13,28 +12,117 @@ typedef struct Parser {
     const char** arguments;
     size_t argument_count;
     size_t max_arguments;
+
+    // UTF-8 validation state. `sequence` is the first byte of the last multi-byte sequence, which
+    // still needs `continuation_count` bytes in the range `continuation_min..continuation_max`.
+    bool validate_utf8;
+    const char* sequence;
+    unsigned char continuation_count;
+    unsigned char continuation_min;
+    unsigned char continuation_max;
+    const char* invalid;
+
+    // Optional callback for each token as it ends, and the start of the current token
+    ParseTokenFunction on_token;
+    void* token_data;
+    const char* token;
 } Parser;
 
+// Classify whitespace by byte value, independent of locale and of the signedness of `char`.
+// Bytes of multi-byte UTF-8 sequences are never whitespace, so code points are never split.
+static bool is_space(char c) {
+    return (c == ' ') || (c == '\t') || (c == '\n') || (c == '\v') || (c == '\f') || (c == '\r');
+}
+
+// Start validating a UTF-8 sequence with the non-ASCII lead byte `byte`. Returns false if `byte`
+// can not start a sequence.
+static bool parser_start_sequence(Parser* parser, unsigned char byte) {
+    parser->sequence = parser->read;
+    parser->continuation_min = 0x80;
+    parser->continuation_max = 0xBF;
+
+    if ((byte >= 0xC2) && (byte <= 0xDF)) {
+        parser->continuation_count = 1;
+    } else if ((byte >= 0xE0) && (byte <= 0xEF)) {
+        parser->continuation_count = 2;
+        parser->continuation_min = (byte == 0xE0) ? 0xA0 : 0x80; // overlong
+        parser->continuation_max = (byte == 0xED) ? 0x9F : 0xBF; // surrogates
+    } else if ((byte >= 0xF0) && (byte <= 0xF4)) {
+        parser->continuation_count = 3;
+        parser->continuation_min = (byte == 0xF0) ? 0x90 : 0x80; // overlong
+        parser->continuation_max = (byte == 0xF4) ? 0x8F : 0xBF; // above U+10FFFF
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+// Feed the next input byte (or the terminator) to the UTF-8 validator. Returns false if the input
+// is not valid UTF-8.
+static bool parser_check_utf8(Parser* parser, char c) {
+    unsigned char byte = (unsigned char)c;
+
+    if (parser->continuation_count == 0) {
+        return (byte < 0x80) || parser_start_sequence(parser, byte);
+    } else if ((byte < parser->continuation_min) || (byte > parser->continuation_max)) {
+        return false;
+    } else {
+        parser->continuation_count -= 1;
+        parser->continuation_min = 0x80;
+        parser->continuation_max = 0xBF;
+        return true;
+    }
+}
+
+static void parser_write(Parser* parser, char c) {
+    *parser->write = c;
+    parser->write += 1;
+}
+
 static void parser_mark_argument(Parser* parser) {
+    parser->token = parser->write;
+
     if (parser->argument_count < parser->max_arguments) {
         parser->arguments[parser->argument_count] = parser->write;
         parser->argument_count += 1;
     }
 }
 
+// Record a pipeline stage boundary as a NULL argument. Returns false if the parse should stop.
+static bool parser_mark_pipe(Parser* parser) {
+    if (parser->argument_count < parser->max_arguments) {
+        parser->arguments[parser->argument_count] = NULL;
+        parser->argument_count += 1;
+    }
+
+    return (parser->on_token == NULL) || parser->on_token(NULL, parser->token_data);
+}
+
+// Terminate the current token. Returns false if the parse should stop.
+static bool parser_end_token(Parser* parser) {
+    parser_write(parser, '\0');
+    return (parser->on_token == NULL) || parser->on_token(parser->token, parser->token_data);
+}
+
+// Read the next input byte. Invalid UTF-8 (if validating) ends the input early.
 static char parser_read(Parser* parser) {
     char c = *parser->read;
+
+    // ASCII bytes outside of a sequence are always valid, and are checked with a single compare.
+    bool ascii = ((unsigned char)c < 0x80) && (parser->continuation_count == 0);
+
+    if (parser->validate_utf8 && !ascii && !parser_check_utf8(parser, c)) {
+        parser->invalid = (parser->continuation_count == 0) ? parser->read : parser->sequence;
+        return '\0';
+    }
+
     if (c != '\0') {
         parser->read += 1;
     }
     return c;
 }
 
-static void parser_write(Parser* parser, char c) {
-    *parser->write = c;
-    parser->write += 1;
-}
-
 static ParseStatus parse_argument(Parser* parser);
 
 // parsing an argument, last char was a '\'
@@ -106,15 +194,24 @@ static ParseStatus parse_double_quote(Parser* parser) {
 
 static ParseStatus parse_space(Parser* parser);
 
+// an argument just ended with `c` (the terminator, whitespace or '|')
+static ParseStatus parse_token_end(Parser* parser, char c) {
+    if (!parser_end_token(parser)) {
+        return parse_status_stopped;
+    } else if (c == '\0') {
+        return parse_status_success;
+    } else if ((c == '|') && !parser_mark_pipe(parser)) {
+        return parse_status_stopped;
+    } else {
+        return parse_space(parser);
+    }
+}
+
 // parsing an argument, no special characters in effect
 static ParseStatus parse_argument(Parser* parser) {
     char c = parser_read(parser);
-    if (c == '\0') {
-        parser_write(parser, '\0');
-        return parse_status_success;
-    } else if (isspace(c)) {
-        parser_write(parser, '\0');
-        return parse_space(parser);
+    if ((c == '\0') || is_space(c) || (c == '|')) {
+        return parse_token_end(parser, c);
     } else if (c == '\'') {
         return parse_single_quote(parser);
     } else if (c == '\"') {
@@ -132,8 +229,10 @@ static ParseStatus parse_space(Parser* parser) {
     char c = parser_read(parser);
     if (c == '\0') {
         return parse_status_success;
-    } else if (isspace(c)) {
+    } else if (is_space(c)) {
         return parse_space(parser);
+    } else if (c == '|') {
+        return parser_mark_pipe(parser) ? parse_space(parser) : parse_status_stopped;
     } else if (c == '\\') {
         parser_mark_argument(parser);
         return parse_slash(parser);
@@ -150,19 +249,63 @@ static ParseStatus parse_space(Parser* parser) {
     }
 }
 
-ParseResult libcli_parse(char* input, const char** arguments, size_t max_arguments) {
+static ParseResult parse(
+    char* input,
+    const char** arguments,
+    size_t max_arguments,
+    bool validate,
+    ParseTokenFunction on_token,
+    void* data
+) {
     Parser parser = {
         .read = input,
         .write = input,
         .arguments = arguments,
         .argument_count = 0,
         .max_arguments = max_arguments,
+        .validate_utf8 = validate,
+        .sequence = input,
+        .continuation_count = 0,
+        .continuation_min = 0x80,
+        .continuation_max = 0xBF,
+        .invalid = NULL,
+        .on_token = on_token,
+        .token_data = data,
+        .token = input,
     };
 
     ParseStatus status = parse_space(&parser);
 
-    return (ParseResult) {
-        .status = status,
-        .argument_count = parser.argument_count,
-    };
+    if (parser.invalid != NULL) {
+        return (ParseResult) {
+            .status = parse_status_invalid_utf8,
+            .argument_count = parser.argument_count,
+            .error_offset = (size_t)(parser.invalid - input),
+        };
+    } else {
+        return (ParseResult) {
+            .status = status,
+            .argument_count = parser.argument_count,
+            .error_offset = 0,
+        };
+    }
+}
+
+ParseResult libcli_parse(char* input, const char** arguments, size_t max_arguments) {
+    return parse(input, arguments, max_arguments, false, NULL, NULL);
+}
+
+ParseResult libcli_parse_utf8(char* input, const char** arguments, size_t max_arguments) {
+    return parse(input, arguments, max_arguments, true, NULL, NULL);
+}
+
+ParseResult libcli_parse_tokens(
+    char* input,
+    const char** arguments,
+    size_t max_arguments,
+    bool validate_utf8,
+    ParseTokenFunction on_token,
+    void* data
+) {
+    return parse(input, arguments, max_arguments, validate_utf8, on_token, data);
 }
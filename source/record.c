@@ -0,0 +1,260 @@
+#include "cli_record.h"
+#include "internal/histogram.h"
+#include "internal/record.h"
+#include "internal/timing.h"
+
+#include <string.h>
+
+static const uint8_t trace_magic[3] = { 'L', 'C', 'R' };
+
+// Offsets of the fields of an entry
+enum {
+    entry_timestamp_offset = 0,
+    entry_duration_offset = 4,
+    entry_result_offset = 8,
+    entry_length_offset = 9,
+};
+
+// Ring access, wrapping around the end of the buffer
+
+static void ring_put(CliRecorder* recorder, size_t offset, uint8_t byte) {
+    recorder->buffer[(recorder->start + offset) % recorder->size] = byte;
+}
+
+static uint8_t ring_get(const CliRecorder* recorder, size_t offset) {
+    return recorder->buffer[(recorder->start + offset) % recorder->size];
+}
+
+static void ring_put_u32(CliRecorder* recorder, size_t offset, uint32_t value) {
+    for (size_t i = 0; i < 4; i++) {
+        ring_put(recorder, offset + i, (uint8_t)(value >> (i * 8)));
+    }
+}
+
+static size_t entry_size_at(const CliRecorder* recorder, size_t offset) {
+    size_t length = (size_t)ring_get(recorder, offset + entry_length_offset)
+        | ((size_t)ring_get(recorder, offset + entry_length_offset + 1) << 8);
+
+    return cli_trace_entry_size + length;
+}
+
+// Drop the oldest entries until `size` more bytes fit in the ring
+static void make_space(CliRecorder* recorder, size_t size) {
+    while ((recorder->size - recorder->length) < size) {
+        size_t oldest = entry_size_at(recorder, 0);
+
+        recorder->start = (recorder->start + oldest) % recorder->size;
+        recorder->length -= oldest;
+        recorder->entry_count -= 1;
+        recorder->dropped += 1;
+    }
+}
+
+static uint32_t now(const CliRecorder* recorder) {
+    return (recorder->timestamp != NULL) ? recorder->timestamp() : 0;
+}
+
+// Store `input` as a new entry, with its result and duration to be filled in once it has run.
+// Returns false if the line cannot be recorded.
+static bool begin_entry(CliRecorder* recorder, const char* input, size_t* entry) {
+    size_t length = strlen(input);
+    size_t size = cli_trace_entry_size + length;
+
+    if ((length >= cli_trace_line_size) || (size > recorder->size)) {
+        recorder->dropped += 1;
+        return false;
+    }
+
+    make_space(recorder, size);
+
+    *entry = recorder->length;
+    ring_put_u32(recorder, *entry + entry_timestamp_offset, now(recorder));
+    ring_put_u32(recorder, *entry + entry_duration_offset, 0);
+    ring_put(recorder, *entry + entry_result_offset, 0);
+    ring_put(recorder, *entry + entry_length_offset, (uint8_t)length);
+    ring_put(recorder, *entry + entry_length_offset + 1, (uint8_t)(length >> 8));
+
+    for (size_t i = 0; i < length; i++) {
+        ring_put(recorder, *entry + cli_trace_entry_size + i, (uint8_t)input[i]);
+    }
+
+    recorder->length += size;
+    recorder->entry_count += 1;
+    return true;
+}
+
+static void finish_entry(
+    CliRecorder* recorder,
+    size_t entry,
+    CliRunResult result,
+    uint32_t duration
+) {
+    ring_put_u32(recorder, entry + entry_duration_offset, duration);
+    ring_put(recorder, entry + entry_result_offset, (uint8_t)result);
+}
+
+CliRunResult libcli_run_recorded(const CliHeader* header, char* input, void* userdata) {
+    CliRecorder* recorder = header->recorder;
+    size_t entry = 0;
+
+    // The line is stored before it runs, as the parser destroys it.
+    bool recording = begin_entry(recorder, input, &entry);
+
+    // Lines run by the command itself (eg. by `repeat`) are not recorded, and the run is timed
+    // with the recorder's clock to find the time spent in the handler.
+    CliTiming timing = { .stamps = {0} };
+    CliHeader recorded_header = *header;
+    recorded_header.recorder = NULL;
+
+    if (recorder->timestamp != NULL) {
+        recorded_header.timestamp = recorder->timestamp;
+        recorded_header.timing = &timing;
+    }
+
+    CliRunResult result = libcli_run(&recorded_header, input, userdata);
+
+    if (recording) {
+        uint32_t duration = (result == cli_run_result_ok)
+            ? (timing.stamps[timing_phase_handler] - timing.stamps[timing_phase_convert])
+            : 0;
+
+        finish_entry(recorder, entry, result, duration);
+    }
+
+    return result;
+}
+
+CliRecorder libcli_recorder_new(uint8_t* buffer, size_t size, CliTimestampFunction timestamp) {
+    return (CliRecorder){
+        .buffer = buffer,
+        .size = size,
+        .start = 0,
+        .length = 0,
+        .entry_count = 0,
+        .dropped = 0,
+        .timestamp = timestamp,
+    };
+}
+
+size_t libcli_recorder_dropped(const CliRecorder* recorder) {
+    return recorder->dropped;
+}
+
+size_t libcli_recorder_dump_size(const CliRecorder* recorder) {
+    return cli_trace_header_size + recorder->length;
+}
+
+size_t libcli_recorder_dump(const CliRecorder* recorder, uint8_t* trace, size_t trace_size) {
+    size_t size = libcli_recorder_dump_size(recorder);
+
+    if (trace_size < size) {
+        return 0;
+    }
+
+    memcpy(trace, trace_magic, sizeof(trace_magic));
+    trace[3] = cli_trace_version;
+
+    for (size_t i = 0; i < 4; i++) {
+        trace[4 + i] = (uint8_t)((uint32_t)recorder->entry_count >> (i * 8));
+    }
+
+    for (size_t i = 0; i < recorder->length; i++) {
+        trace[cli_trace_header_size + i] = ring_get(recorder, i);
+    }
+
+    return size;
+}
+
+// Replay
+
+static uint32_t read_u32(const uint8_t* data) {
+    return (uint32_t)data[0]
+        | ((uint32_t)data[1] << 8)
+        | ((uint32_t)data[2] << 16)
+        | ((uint32_t)data[3] << 24);
+}
+
+static void wait_until(CliTimestampFunction timestamp, uint32_t start, uint32_t delay) {
+    while ((uint32_t)(timestamp() - start) < delay) {}
+}
+
+static void finish_stats(CliReplayStats* stats, const Histogram* latency) {
+    stats->min = (latency->count > 0) ? latency->min : 0;
+    stats->mean = libcli_histogram_mean(latency);
+    stats->p50 = libcli_histogram_percentile(latency, 50);
+    stats->p99 = libcli_histogram_percentile(latency, 99);
+    stats->max = latency->max;
+}
+
+CliRunResult libcli_replay_trace(
+    const CliHeader* header,
+    const uint8_t* trace,
+    size_t trace_size,
+    CliTimestampFunction timestamp,
+    bool realtime,
+    void* userdata,
+    CliReplayStats* stats
+) {
+    *stats = (CliReplayStats){ .runs = 0 };
+
+    if ((trace_size < cli_trace_header_size)
+        || (memcmp(trace, trace_magic, sizeof(trace_magic)) != 0)
+        || (trace[3] != cli_trace_version)
+    ) {
+        return cli_run_result_bad_macro;
+    }
+
+    // Replayed lines are not recorded again.
+    CliHeader replay_header = *header;
+    replay_header.recorder = NULL;
+
+    Histogram latency;
+    libcli_histogram_init(&latency);
+
+    uint32_t entry_count = read_u32(&trace[4]);
+    size_t offset = cli_trace_header_size;
+    uint32_t first_recorded = 0;
+    uint32_t replay_start = timestamp();
+    uint32_t last_finish = replay_start;
+
+    for (uint32_t i = 0; i < entry_count; i++) {
+        if ((trace_size - offset) < cli_trace_entry_size) {
+            return cli_run_result_bad_macro;
+        }
+
+        const uint8_t* entry = &trace[offset];
+        size_t length = (size_t)entry[entry_length_offset]
+            | ((size_t)entry[entry_length_offset + 1] << 8);
+
+        if ((length >= cli_trace_line_size)
+            || ((trace_size - offset - cli_trace_entry_size) < length)
+        ) {
+            return cli_run_result_bad_macro;
+        }
+
+        char line[cli_trace_line_size];
+        memcpy(line, &entry[cli_trace_entry_size], length);
+        line[length] = '\0';
+
+        uint32_t recorded = read_u32(&entry[entry_timestamp_offset]);
+        first_recorded = (i == 0) ? recorded : first_recorded;
+
+        if (realtime) {
+            wait_until(timestamp, replay_start, recorded - first_recorded);
+        }
+
+        uint32_t start = timestamp();
+        CliRunResult result = libcli_run(&replay_header, line, userdata);
+        last_finish = timestamp();
+
+        libcli_histogram_add(&latency, last_finish - start);
+        stats->runs += 1;
+        stats->mismatches += (result != (CliRunResult)entry[entry_result_offset]) ? 1 : 0;
+
+        offset += cli_trace_entry_size + length;
+    }
+
+    stats->elapsed = (uint32_t)(last_finish - replay_start);
+    finish_stats(stats, &latency);
+    return cli_run_result_ok;
+}
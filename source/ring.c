@@ -0,0 +1,152 @@
+#include "cli_ring.h"
+
+static bool is_line_end(char c) {
+    return (c == '\n') || (c == '\r') || (c == (char)cli_ring_cancel);
+}
+
+bool libcli_ring_init(CliRing* ring, char* buffer, size_t size, size_t line_size) {
+    bool power_of_two = (size > 0) && ((size & (size - 1)) == 0);
+
+    if (!power_of_two || (line_size < 2) || (line_size > size)) {
+        return false;
+    }
+
+    ring->buffer = buffer;
+    ring->mask = size - 1;
+    ring->line_size = line_size;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->overrun_bytes, 0);
+    ring->dropping = false;
+    ring->scanned = 0;
+    ring->discarding = false;
+    ring->discarded_lines = 0;
+    return true;
+}
+
+// Store `c` at the free-running index `index`, and in the mirror past the end if it is one of the
+// first `line_size` bytes
+static void ring_store(CliRing* ring, size_t index, char c) {
+    size_t position = index & ring->mask;
+    ring->buffer[position] = c;
+
+    if (position < ring->line_size) {
+        ring->buffer[ring->mask + 1 + position] = c;
+    }
+}
+
+size_t libcli_ring_space(const CliRing* ring) {
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    return (ring->mask + 1) - (head - tail);
+}
+
+size_t libcli_ring_push(CliRing* ring, const char* data, size_t length) {
+    // Only this side writes `head`. Acquiring `tail` makes sure the consumer is done with the
+    // space it freed before it is written again.
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    size_t space = (ring->mask + 1) - (head - tail);
+    size_t stored = 0;
+
+    for (size_t i = 0; i < length; i++) {
+        char c = data[i];
+
+        if (ring->dropping && is_line_end(c) && (space > 0)) {
+            // The end of a damaged line, which is cancelled
+            ring_store(ring, head + stored, (char)cli_ring_cancel);
+            stored += 1;
+            space -= 1;
+            ring->dropping = false;
+        } else if (!ring->dropping && (space > 0)) {
+            ring_store(ring, head + stored, c);
+            stored += 1;
+            space -= 1;
+        } else {
+            ring->dropping = true;
+        }
+    }
+
+    // Publish the new bytes to the consumer
+    atomic_store_explicit(&ring->head, head + stored, memory_order_release);
+
+    if (stored < length) {
+        atomic_fetch_add_explicit(&ring->overrun_bytes, length - stored, memory_order_relaxed);
+    }
+
+    return stored;
+}
+
+// Run the line from `tail` to `end` (its terminator), which has been checked to fit in the line
+// size. A line which wraps around continues in the mirror, so it is always contiguous.
+static CliRunResult run_line(
+    const CliHeader* header,
+    CliRing* ring,
+    size_t tail,
+    size_t end,
+    void* userdata
+) {
+    char* line = &ring->buffer[tail & ring->mask];
+    size_t length = end - tail;
+
+    if (length == 0) {
+        return cli_run_result_ok;
+    }
+
+    line[length] = '\0';
+    return libcli_run(header, line, userdata);
+}
+
+CliRunResult libcli_service(const CliHeader* header, CliRing* ring, void* userdata) {
+    CliRunResult result = cli_run_result_ok;
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+    // Acquiring `head` makes the bytes the producer stored before it visible.
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+    while (ring->scanned != head) {
+        size_t index = ring->scanned;
+        char c = ring->buffer[index & ring->mask];
+        ring->scanned += 1;
+
+        if (!is_line_end(c)) {
+            if (!ring->discarding && ((ring->scanned - tail) >= ring->line_size)) {
+                // Too long to run, so its start is freed, and the rest is skipped as it arrives.
+                ring->discarding = true;
+                ring->discarded_lines += 1;
+                result = cli_run_result_no_space;
+            }
+
+            if (ring->discarding) {
+                tail = ring->scanned;
+                atomic_store_explicit(&ring->tail, tail, memory_order_release);
+            }
+
+            continue;
+        }
+
+        if (ring->discarding) {
+            ring->discarding = false;
+        } else if (c == (char)cli_ring_cancel) {
+            ring->discarded_lines += 1;
+            result = cli_run_result_no_space;
+        } else {
+            CliRunResult line_result = run_line(header, ring, tail, index, userdata);
+            result = (result == cli_run_result_ok) ? line_result : result;
+        }
+
+        // Free the line only once it has run, as it is parsed in place.
+        tail = ring->scanned;
+        atomic_store_explicit(&ring->tail, tail, memory_order_release);
+    }
+
+    return result;
+}
+
+size_t libcli_ring_overrun_bytes(const CliRing* ring) {
+    return atomic_load_explicit(&ring->overrun_bytes, memory_order_relaxed);
+}
+
+size_t libcli_ring_discarded_lines(const CliRing* ring) {
+    return ring->discarded_lines;
+}
@@ -0,0 +1,182 @@
+#include "cli_scheduler.h"
+
+#include <string.h>
+
+static uint32_t now(const CliScheduler* scheduler) {
+    return (scheduler->clock != NULL) ? scheduler->clock() : 0;
+}
+
+// The highest priority of the sources with lines waiting. Returns false if every queue is empty.
+static bool highest_priority(const CliScheduler* scheduler, uint8_t* priority) {
+    bool found = false;
+
+    for (size_t i = 0; i < scheduler->count; i++) {
+        const CliSchedulerSource* source = &scheduler->sources[i];
+
+        if ((source->count > 0) && (!found || (source->priority > *priority))) {
+            *priority = source->priority;
+            found = true;
+        }
+    }
+
+    return found;
+}
+
+// Choose the source which runs next with smooth weighted round-robin: each waiting source of the
+// priority earns its weight, and the one with the most credit gives up the total, so each source's
+// turns are spread out in proportion to its weight.
+static CliSchedulerSource* choose_source(CliScheduler* scheduler, uint8_t priority) {
+    CliSchedulerSource* chosen = NULL;
+    int64_t total = 0;
+
+    for (size_t i = 0; i < scheduler->count; i++) {
+        CliSchedulerSource* source = &scheduler->sources[i];
+
+        if ((source->count == 0) || (source->priority != priority)) {
+            continue;
+        }
+
+        source->credit += source->weight;
+        total += source->weight;
+
+        if ((chosen == NULL) || (source->credit > chosen->credit)) {
+            chosen = source;
+        }
+    }
+
+    chosen->credit -= total;
+    return chosen;
+}
+
+static void record_wait(CliSourceStats* stats, uint32_t wait) {
+    stats->dispatched += 1;
+    stats->last_wait = wait;
+    stats->total_wait += wait;
+
+    if (wait > stats->max_wait) {
+        stats->max_wait = wait;
+    }
+}
+
+CliScheduler libcli_scheduler_new(
+    CliSchedulerSource* sources,
+    size_t capacity,
+    CliTimestampFunction clock
+) {
+    return (CliScheduler){
+        .sources = sources,
+        .capacity = capacity,
+        .count = 0,
+        .clock = clock,
+    };
+}
+
+bool libcli_scheduler_add_source(
+    CliScheduler* scheduler,
+    const CliSourceInfo* info,
+    size_t* source
+) {
+    if (scheduler->count >= scheduler->capacity) {
+        return false;
+    } else if ((info->lines == NULL) || (info->lines_size == 0)) {
+        return false;
+    } else if ((info->weight == 0) || (info->writeback == NULL)) {
+        return false;
+    }
+
+    *source = scheduler->count;
+    scheduler->sources[scheduler->count] = (CliSchedulerSource){
+        .lines = info->lines,
+        .capacity = info->lines_size,
+        .head = 0,
+        .count = 0,
+        .priority = info->priority,
+        .weight = info->weight,
+        .credit = 0,
+        .writeback = info->writeback,
+        .writeback_data = info->writeback_data,
+        .contexts = info->contexts,
+        .stats = { 0 },
+    };
+    scheduler->count += 1;
+
+    return true;
+}
+
+bool libcli_scheduler_submit(CliScheduler* scheduler, size_t source, const char* line) {
+    CliSchedulerSource* queue = &scheduler->sources[source];
+    size_t length = strlen(line);
+
+    if ((queue->count >= queue->capacity) || (length >= cli_scheduler_line_size)) {
+        queue->stats.dropped += 1;
+        return false;
+    }
+
+    CliQueuedLine* slot = &queue->lines[(queue->head + queue->count) % queue->capacity];
+    slot->queued_at = now(scheduler);
+    memcpy(slot->text, line, length + 1);
+
+    queue->count += 1;
+
+    if (queue->count > queue->stats.max_depth) {
+        queue->stats.max_depth = queue->count;
+    }
+
+    return true;
+}
+
+bool libcli_scheduler_tick(
+    const CliHeader* header,
+    CliScheduler* scheduler,
+    void* userdata,
+    CliRunResult* result
+) {
+    uint8_t priority = 0;
+
+    if (!highest_priority(scheduler, &priority)) {
+        return false;
+    }
+
+    CliSchedulerSource* source = choose_source(scheduler, priority);
+
+    CliQueuedLine* line = &source->lines[source->head];
+    record_wait(&source->stats, now(scheduler) - line->queued_at);
+
+    CliHeader source_header = *header;
+    source_header.writeback = source->writeback;
+    source_header.writeback_data = source->writeback_data;
+
+    if (source->contexts != NULL) {
+        source_header.contexts = source->contexts;
+    }
+
+    // The line runs in place, so it keeps its slot until it is done, even if the command queues
+    // more lines on the same source.
+    *result = libcli_run(&source_header, line->text, userdata);
+
+    source->head = (source->head + 1) % source->capacity;
+    source->count -= 1;
+
+    // An emptied source starts afresh when it next has lines, rather than with its old credit.
+    if (source->count == 0) {
+        source->credit = 0;
+    }
+
+    return true;
+}
+
+size_t libcli_scheduler_pending(const CliScheduler* scheduler) {
+    size_t pending = 0;
+
+    for (size_t i = 0; i < scheduler->count; i++) {
+        pending += scheduler->sources[i].count;
+    }
+
+    return pending;
+}
+
+CliSourceStats libcli_scheduler_stats(const CliScheduler* scheduler, size_t source) {
+    CliSourceStats stats = scheduler->sources[source].stats;
+    stats.depth = scheduler->sources[source].count;
+    return stats;
+}
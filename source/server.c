@@ -0,0 +1,472 @@
+#include "cli_server.h"
+#include "cli_jobs.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+enum {
+    // Maximum number of events handled by a single `epoll_wait` call
+    server_event_capacity = 64,
+};
+
+static size_t min_size(size_t a, size_t b) {
+    return (a < b) ? a : b;
+}
+
+static bool set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return (flags >= 0) && (fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0);
+}
+
+static int open_unix_listener(const char* path) {
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+    size_t length = strlen(path);
+
+    if (length >= sizeof(address.sun_path)) {
+        return -1;
+    }
+
+    memcpy(address.sun_path, path, length + 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    unlink(path);
+
+    if ((bind(fd, (const struct sockaddr*)&address, sizeof(address)) != 0)
+        || (listen(fd, SOMAXCONN) != 0)
+    ) {
+        close(fd);
+        return -1;
+    } else {
+        return fd;
+    }
+}
+
+static int open_tcp_listener(uint16_t port) {
+    struct sockaddr_in address = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    if ((bind(fd, (const struct sockaddr*)&address, sizeof(address)) != 0)
+        || (listen(fd, SOMAXCONN) != 0)
+    ) {
+        close(fd);
+        return -1;
+    } else {
+        return fd;
+    }
+}
+
+// Written after the output of a line which did not all fit in the session's output queue. Room
+// for it is always kept free, so a client can tell its output was cut short.
+static const char truncated_notice[] = "(output truncated)\n";
+
+enum {
+    // Space of the output queue which command output may take
+    session_output_limit = cli_session_output_size - (sizeof(truncated_notice) - 1),
+};
+
+static void session_append(CliSession* session, const char* string, size_t length) {
+    size_t end = (session->output_start + session->output_length) % cli_session_output_size;
+    size_t first = min_size(length, cli_session_output_size - end);
+
+    memcpy(&session->output[end], string, first);
+    memcpy(session->output, &string[first], length - first);
+    session->output_length += length;
+}
+
+// Write as much queued output as the connection accepts without blocking. Returns false if the
+// connection failed.
+static bool session_flush(CliSession* session) {
+    while (session->output_length > 0) {
+        size_t contiguous = min_size(
+            session->output_length,
+            cli_session_output_size - session->output_start
+        );
+
+        ssize_t written = send(
+            session->fd,
+            &session->output[session->output_start],
+            contiguous,
+            MSG_NOSIGNAL
+        );
+
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            } else {
+                return (errno == EAGAIN) || (errno == EWOULDBLOCK);
+            }
+        }
+
+        session->output_start = (session->output_start + (size_t)written) % cli_session_output_size;
+        session->output_length -= (size_t)written;
+    }
+
+    session->output_start = 0;
+    return true;
+}
+
+// Append `string` to the session's output queue. When the queue fills, it is written to the
+// connection to make room. Output which still does not fit is dropped.
+static void session_writeback(const char* string, void* userdata) {
+    CliSession* session = (CliSession*)userdata;
+    size_t length = strlen(string);
+
+    while (length > 0) {
+        size_t queued = session->output_length;
+
+        if (queued >= session_output_limit) {
+            // Stop if the connection failed or accepts nothing more for now
+            if (!session_flush(session) || (session->output_length == queued)) {
+                break;
+            }
+
+            continue;
+        }
+
+        size_t part = min_size(length, session_output_limit - queued);
+        session_append(session, string, part);
+        string += part;
+        length -= part;
+    }
+
+    session->output_dropped += length;
+}
+
+// Queue the truncation notice if output was dropped since it was last queued. Output written
+// outside of a line (eg. by watches) may have taken the space kept for it, in which case it is
+// queued once there is room.
+static void session_report_dropped(CliSession* session) {
+    size_t space = cli_session_output_size - session->output_length;
+
+    if ((session->output_dropped != session->output_reported)
+        && (space >= (sizeof(truncated_notice) - 1))
+    ) {
+        session_append(session, truncated_notice, sizeof(truncated_notice) - 1);
+        session->output_reported = session->output_dropped;
+    }
+}
+
+static void session_run_line(CliServer* server, CliSession* session, char* line) {
+    CliHeader header = *server->header;
+    header.writeback = session_writeback;
+    header.writeback_data = session;
+    header.contexts = &session->contexts;
+
+    libcli_run(&header, line, server->userdata);
+    session_report_dropped(session);
+}
+
+// Run every complete line in the session's input buffer. Stops early while the output of a
+// previous line is still waiting to be written. Returns false if the connection failed.
+static bool session_run_lines(CliServer* server, CliSession* session) {
+    size_t start = 0;
+
+    while (session->output_length == 0) {
+        char* line = &session->input[start];
+        char* newline = memchr(line, '\n', session->input_length - start);
+
+        if (newline == NULL) {
+            break;
+        }
+
+        size_t end = (size_t)(newline - session->input);
+        *newline = '\0';
+
+        if ((end > start) && (session->input[end - 1] == '\r')) {
+            session->input[end - 1] = '\0';
+        }
+
+        start = end + 1;
+
+        if (session->discarding_line) {
+            session->discarding_line = false;
+        } else {
+            session_run_line(server, session, line);
+
+            if (!session_flush(session)) {
+                return false;
+            }
+        }
+    }
+
+    memmove(session->input, &session->input[start], session->input_length - start);
+    session->input_length -= start;
+
+    return true;
+}
+
+// Handle readable input. Returns false if the connection was closed or failed.
+static bool session_receive(CliServer* server, CliSession* session) {
+    ssize_t received = recv(
+        session->fd,
+        &session->input[session->input_length],
+        cli_session_input_size - session->input_length,
+        0
+    );
+
+    if (received == 0) {
+        return false;
+    } else if (received < 0) {
+        return (errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR);
+    }
+
+    session->input_length += (size_t)received;
+
+    if (!session_run_lines(server, session)) {
+        return false;
+    }
+
+    // A full buffer with no pending output holds no complete line, so the line is too long.
+    if ((session->input_length == cli_session_input_size) && (session->output_length == 0)) {
+        session->discarding_line = true;
+        session->input_length = 0;
+    }
+
+    return true;
+}
+
+// Handle a connection which became writable. Returns false if the connection failed.
+static bool session_resume(CliServer* server, CliSession* session) {
+    return session_flush(session) && session_run_lines(server, session);
+}
+
+// Wait for writability while output is queued, and for input otherwise.
+static bool session_watch(CliServer* server, CliSession* session) {
+    bool blocked = session->output_length > 0;
+
+    if (blocked == session->output_blocked) {
+        return true;
+    }
+
+    struct epoll_event event = {
+        .events = blocked ? EPOLLOUT : EPOLLIN,
+        .data.ptr = session,
+    };
+    session->output_blocked = blocked;
+
+    return epoll_ctl(server->epoll_fd, EPOLL_CTL_MOD, session->fd, &event) == 0;
+}
+
+static void close_session(CliServer* server, CliSession* session) {
+    // Watches started by the session write to it, so they stop with it.
+    if (server->header->jobs != NULL) {
+        libcli_jobs_cancel_watches(server->header->jobs, session);
+    }
+
+    epoll_ctl(server->epoll_fd, EPOLL_CTL_DEL, session->fd, NULL);
+    close(session->fd);
+    session->fd = -1;
+
+    size_t index = (size_t)(session - server->sessions);
+    if (index < server->next_free_session) {
+        server->next_free_session = index;
+    }
+
+    server->session_count -= 1;
+}
+
+static void handle_session_event(CliServer* server, CliSession* session, uint32_t events) {
+    bool open;
+
+    if ((events & EPOLLIN) != 0) {
+        open = session_receive(server, session);
+    } else if ((events & EPOLLOUT) != 0) {
+        open = session_resume(server, session);
+    } else {
+        open = false; // error or hang-up with no input left to read
+    }
+
+    if (!(open && session_watch(server, session))) {
+        close_session(server, session);
+    }
+}
+
+static CliSession* find_free_session(CliServer* server) {
+    for (size_t i = server->next_free_session; i < server->sessions_size; i++) {
+        if (server->sessions[i].fd < 0) {
+            server->next_free_session = i + 1;
+            return &server->sessions[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void accept_sessions(CliServer* server) {
+    while (true) {
+        int fd = accept(server->listen_fd, NULL, NULL);
+
+        if (fd < 0) {
+            return;
+        }
+
+        CliSession* session = find_free_session(server);
+
+        if ((session == NULL) || !set_nonblocking(fd)) {
+            close(fd);
+            continue;
+        }
+
+        session->fd = fd;
+        session->discarding_line = false;
+        session->output_blocked = false;
+        session->input_length = 0;
+        session->output_start = 0;
+        session->output_length = 0;
+        session->output_dropped = 0;
+        session->output_reported = 0;
+        session->contexts = libcli_context_stack_new();
+
+        struct epoll_event event = { .events = EPOLLIN, .data.ptr = session };
+
+        if (epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+            close(fd);
+            session->fd = -1;
+            server->next_free_session = (size_t)(session - server->sessions);
+        } else {
+            server->session_count += 1;
+        }
+    }
+}
+
+bool libcli_server_new(CliServer* server, const CliServerInfo* info) {
+    *server = (CliServer){
+        .header = info->header,
+        .sessions = info->sessions,
+        .sessions_size = info->sessions_size,
+        .session_count = 0,
+        .next_free_session = 0,
+        .epoll_fd = -1,
+        .listen_fd = -1,
+        .unix_path = info->unix_path,
+        .userdata = info->userdata,
+    };
+
+    for (size_t i = 0; i < info->sessions_size; i++) {
+        info->sessions[i].fd = -1;
+    }
+
+    if (info->unix_path != NULL) {
+        server->listen_fd = open_unix_listener(info->unix_path);
+    } else {
+        server->listen_fd = open_tcp_listener(info->tcp_port);
+    }
+
+    server->epoll_fd = epoll_create1(0);
+
+    // The listener is identified by a NULL event pointer; sessions by their `CliSession`.
+    struct epoll_event event = { .events = EPOLLIN, .data.ptr = NULL };
+
+    if ((server->listen_fd < 0)
+        || (server->epoll_fd < 0)
+        || !set_nonblocking(server->listen_fd)
+        || (epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, server->listen_fd, &event) != 0)
+    ) {
+        libcli_server_delete(server);
+        return false;
+    } else {
+        return true;
+    }
+}
+
+bool libcli_server_poll(CliServer* server, int timeout_ms) {
+    struct epoll_event events[server_event_capacity];
+    int count = epoll_wait(server->epoll_fd, events, server_event_capacity, timeout_ms);
+
+    if (count < 0) {
+        return errno == EINTR;
+    }
+
+    bool accept_pending = false;
+
+    for (int i = 0; i < count; i++) {
+        CliSession* session = (CliSession*)events[i].data.ptr;
+
+        if (session == NULL) {
+            accept_pending = true;
+        } else if (session->fd >= 0) {
+            handle_session_event(server, session, events[i].events);
+        }
+    }
+
+    // Accept last, so a slot freed above is never handed stale events from this batch.
+    if (accept_pending) {
+        accept_sessions(server);
+    }
+
+    return true;
+}
+
+void libcli_server_flush(CliServer* server) {
+    for (size_t i = 0; i < server->sessions_size; i++) {
+        CliSession* session = &server->sessions[i];
+
+        if ((session->fd < 0) || (session->output_length == 0)) {
+            continue;
+        }
+
+        session_report_dropped(session);
+
+        // Lines left waiting behind the output run once it is written.
+        if (!(session_resume(server, session) && session_watch(server, session))) {
+            close_session(server, session);
+        }
+    }
+}
+
+uint16_t libcli_server_port(const CliServer* server) {
+    struct sockaddr_in address;
+    socklen_t length = sizeof(address);
+
+    if ((server->unix_path != NULL)
+        || (getsockname(server->listen_fd, (struct sockaddr*)&address, &length) != 0)
+    ) {
+        return 0;
+    } else {
+        return ntohs(address.sin_port);
+    }
+}
+
+void libcli_server_delete(CliServer* server) {
+    for (size_t i = 0; i < server->sessions_size; i++) {
+        if (server->sessions[i].fd >= 0) {
+            close_session(server, &server->sessions[i]);
+        }
+    }
+
+    if (server->listen_fd >= 0) {
+        close(server->listen_fd);
+        server->listen_fd = -1;
+
+        if (server->unix_path != NULL) {
+            unlink(server->unix_path);
+        }
+    }
+
+    if (server->epoll_fd >= 0) {
+        close(server->epoll_fd);
+        server->epoll_fd = -1;
+    }
+}
@@ -0,0 +1,173 @@
+#include "internal/shared.h"
+#include "internal/command.h"
+
+#include <string.h>
+
+bool libcli_share_commands(
+    CliHeader* header,
+    CliSharedCommands* shared,
+    CliCommand* spare_commands,
+    CliWaitFunction wait
+) {
+    if (header->shared != NULL) {
+        return false;
+    } else if ((header->recorder != NULL) || (header->cache != NULL)) {
+        // Runs write to the recorder's ring and the cache's entries without synchronization.
+        return false;
+    } else if ((header->resolve != NULL) || (header->jobs != NULL)) {
+        // Resolving opens modules from every run, and jobs are added and run by one loop.
+        return false;
+    }
+
+    shared->tables[0] = (CliCommandTable){
+        .commands = header->commands,
+        .count = header->count,
+        .longest_command_name_length = header->longest_command_name_length,
+        .fingerprint = header->fingerprint,
+    };
+    shared->tables[1] = (CliCommandTable){ .commands = spare_commands };
+
+    atomic_init(&shared->current, &shared->tables[0]);
+    atomic_init(&shared->epoch, 0);
+    atomic_init(&shared->readers[0], 0);
+    atomic_init(&shared->readers[1], 0);
+    atomic_flag_clear(&shared->writing);
+    shared->wait = wait;
+
+    // The keyword index would be updated under running searches, so searches scan instead.
+    header->keyword_count = 0;
+    header->keywords_complete = false;
+    header->shared = shared;
+
+    return true;
+}
+
+// Reader side
+
+unsigned libcli_begin_snapshot(const CliHeader* header, CliHeader* snapshot) {
+    CliSharedCommands* shared = header->shared;
+
+    unsigned reader = atomic_load(&shared->epoch) & 1u;
+    atomic_fetch_add(&shared->readers[reader], 1);
+
+    // Loaded after counting the run, so a writer which has not seen the count has published
+    // its table before the load.
+    const CliCommandTable* table = atomic_load(&shared->current);
+
+    *snapshot = *header;
+    snapshot->commands = table->commands;
+    snapshot->count = table->count;
+    snapshot->longest_command_name_length = table->longest_command_name_length;
+    snapshot->fingerprint = table->fingerprint;
+    snapshot->shared = NULL;
+    snapshot->read_only = true;
+
+    return reader;
+}
+
+void libcli_end_snapshot(const CliHeader* header, unsigned reader) {
+    atomic_fetch_sub(&header->shared->readers[reader], 1);
+}
+
+// Writer side
+
+static void writer_wait(const CliSharedCommands* shared) {
+    if (shared->wait != NULL) {
+        shared->wait();
+    }
+}
+
+static void lock_writers(CliSharedCommands* shared) {
+    while (atomic_flag_test_and_set(&shared->writing)) {
+        writer_wait(shared);
+    }
+}
+
+static void unlock_writers(CliSharedCommands* shared) {
+    atomic_flag_clear(&shared->writing);
+}
+
+// The table which is not current, which holds no readers between writes
+static CliCommandTable* spare_table(CliSharedCommands* shared) {
+    CliCommandTable* current = atomic_load(&shared->current);
+    return (current == &shared->tables[0]) ? &shared->tables[1] : &shared->tables[0];
+}
+
+// Publish `table` and wait until no run can still be reading the previous table. Runs started
+// after the first flip count themselves in the other counter, so each wait ends.
+static void publish(CliSharedCommands* shared, CliCommandTable* table) {
+    atomic_store(&shared->current, table);
+
+    for (size_t i = 0; i < 2; i++) {
+        unsigned reader = atomic_fetch_xor(&shared->epoch, 1u) & 1u;
+
+        while (atomic_load(&shared->readers[reader]) != 0) {
+            writer_wait(shared);
+        }
+    }
+}
+
+bool libcli_shared_add(CliSharedCommands* shared, size_t capacity, const CliCommand* command) {
+    lock_writers(shared);
+
+    const CliCommandTable* current = atomic_load(&shared->current);
+    SearchResult search = libcli_find_in_table(current->commands, current->count, command->name);
+
+    if (search.found || (current->count >= capacity)) {
+        unlock_writers(shared);
+        return false;
+    }
+
+    CliCommandTable* next = spare_table(shared);
+    size_t index = search.index;
+    size_t length = strlen(command->name);
+
+    memcpy(next->commands, current->commands, index * sizeof(CliCommand));
+    next->commands[index] = *command;
+    memcpy(
+        &next->commands[index + 1],
+        &current->commands[index],
+        (current->count - index) * sizeof(CliCommand)
+    );
+
+    next->count = current->count + 1;
+    next->fingerprint = current->fingerprint + libcli_command_fingerprint(command);
+    next->longest_command_name_length = (length > current->longest_command_name_length)
+        ? length
+        : current->longest_command_name_length;
+
+    publish(shared, next);
+    unlock_writers(shared);
+    return true;
+}
+
+bool libcli_shared_remove(CliSharedCommands* shared, const char* name) {
+    lock_writers(shared);
+
+    const CliCommandTable* current = atomic_load(&shared->current);
+    SearchResult search = libcli_find_in_table(current->commands, current->count, name);
+
+    if (!search.found) {
+        unlock_writers(shared);
+        return false;
+    }
+
+    CliCommandTable* next = spare_table(shared);
+    size_t index = search.index;
+
+    memcpy(next->commands, current->commands, index * sizeof(CliCommand));
+    memcpy(
+        &next->commands[index],
+        &current->commands[index + 1],
+        (current->count - index - 1) * sizeof(CliCommand)
+    );
+
+    next->count = current->count - 1;
+    next->fingerprint = current->fingerprint
+        - libcli_command_fingerprint(&current->commands[index]);
+    next->longest_command_name_length = libcli_longest_name_length(next->commands, next->count);
+
+    publish(shared, next);
+    unlock_writers(shared);
+    return true;
+}
@@ -0,0 +1,186 @@
+#include "internal/summary.h"
+
+#include <stdint.h>
+#include <string.h>
+
+enum {
+    // Size of the buffer decoded text is collected in before each writeback call
+    summary_scratch_size = 32,
+};
+
+// The parts of a summary blob needed to decode it
+typedef struct SummaryBlob {
+    const uint8_t* data;
+    size_t size;
+    const uint8_t* counts;
+    const uint8_t* symbols;
+    size_t symbol_count;
+    const uint8_t* word_offsets;
+    size_t word_count;
+} SummaryBlob;
+
+typedef struct BitReader {
+    const uint8_t* data;
+    size_t size;
+    size_t bit;
+} BitReader;
+
+// Decoded text waiting to be written back
+typedef struct Scratch {
+    const CliHeader* header;
+    char text[summary_scratch_size];
+    size_t length;
+} Scratch;
+
+static bool open_blob(const CliHeader* header, SummaryBlob* blob) {
+    const uint8_t* data = header->summary_blob;
+    size_t size = header->summary_blob_size;
+
+    if ((size < summary_blob_header_size)
+        || (memcmp(data, "LCS", 3) != 0)
+        || (data[3] != summary_blob_version)
+    ) {
+        return false;
+    }
+
+    blob->data = data;
+    blob->size = size;
+    blob->counts = &data[4];
+    blob->symbols = &data[summary_blob_header_size];
+    blob->symbol_count = 0;
+
+    for (size_t i = 0; i < summary_max_code_length; i++) {
+        blob->symbol_count += blob->counts[i];
+    }
+
+    size_t words = summary_blob_header_size + blob->symbol_count;
+
+    if ((words + 1) > size) {
+        return false;
+    }
+
+    blob->word_count = data[words];
+    blob->word_offsets = &data[words + 1];
+
+    return (words + 1 + (blob->word_count * 2)) <= size;
+}
+
+// Returns the next bit, or -1 if the end of the blob was reached.
+static int read_bit(BitReader* reader) {
+    size_t byte = reader->bit / 8;
+
+    if (byte >= reader->size) {
+        return -1;
+    }
+
+    int bit = (reader->data[byte] >> (7 - (reader->bit % 8))) & 1;
+    reader->bit += 1;
+    return bit;
+}
+
+// Decode one canonical Huffman coded symbol. Returns -1 if the code is not valid.
+static int read_symbol(const SummaryBlob* blob, BitReader* reader) {
+    int code = 0;
+    int first = 0;
+    size_t index = 0;
+
+    for (size_t length = 0; length < summary_max_code_length; length++) {
+        int bit = read_bit(reader);
+
+        if (bit < 0) {
+            return -1;
+        }
+
+        code |= bit;
+        int count = blob->counts[length];
+
+        if ((code - first) < count) {
+            return blob->symbols[index + (size_t)(code - first)];
+        }
+
+        index += (size_t)count;
+        first = (first + count) << 1;
+        code <<= 1;
+    }
+
+    return -1;
+}
+
+static void scratch_flush(Scratch* scratch) {
+    if (scratch->length > 0) {
+        scratch->text[scratch->length] = '\0';
+        libcli_write(scratch->header, scratch->text);
+        scratch->length = 0;
+    }
+}
+
+static void scratch_put(Scratch* scratch, char c) {
+    if (scratch->length == (summary_scratch_size - 1)) {
+        scratch_flush(scratch);
+    }
+
+    scratch->text[scratch->length] = c;
+    scratch->length += 1;
+}
+
+static void scratch_put_word(Scratch* scratch, const SummaryBlob* blob, size_t word) {
+    if (word >= blob->word_count) {
+        return;
+    }
+
+    const uint8_t* offset = &blob->word_offsets[word * 2];
+    size_t start = (size_t)offset[0] | ((size_t)offset[1] << 8);
+
+    if (start >= blob->size) {
+        return;
+    }
+
+    size_t length = blob->data[start];
+
+    for (size_t i = 1; (i <= length) && ((start + i) < blob->size); i++) {
+        scratch_put(scratch, (char)blob->data[start + i]);
+    }
+}
+
+bool libcli_is_compressed_summary(const CliHeader* header, const char* summary) {
+    const char* blob = (const char*)header->summary_blob;
+
+    // Compare as integers, as relational operators on unrelated pointers are undefined.
+    uintptr_t address = (uintptr_t)summary;
+    uintptr_t start = (uintptr_t)blob;
+
+    return (blob != NULL) && (address >= start) && (address < (start + header->summary_blob_size));
+}
+
+void libcli_write_summary(const CliHeader* header, const char* summary) {
+    SummaryBlob blob;
+
+    if (!libcli_is_compressed_summary(header, summary)) {
+        libcli_write(header, summary);
+        return;
+    } else if (!open_blob(header, &blob)) {
+        return;
+    }
+
+    BitReader reader = {
+        .data = blob.data,
+        .size = blob.size,
+        .bit = (size_t)((const uint8_t*)summary - blob.data) * 8,
+    };
+
+    Scratch scratch = { .header = header, .length = 0 };
+
+    while (true) {
+        int symbol = read_symbol(&blob, &reader);
+
+        if (symbol <= summary_end_symbol) {
+            break;
+        } else if (symbol >= summary_first_word_symbol) {
+            scratch_put_word(&scratch, &blob, (size_t)(symbol - summary_first_word_symbol));
+        } else {
+            scratch_put(&scratch, (char)symbol);
+        }
+    }
+
+    scratch_flush(&scratch);
+}
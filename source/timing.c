@@ -0,0 +1,240 @@
+#include "internal/timing.h"
+#include "internal/command.h"
+#include "internal/format.h"
+#include "internal/histogram.h"
+
+#include <string.h>
+
+enum {
+    // Maximum length of a timed command line, once re-quoted
+    timing_line_size = 128,
+
+    // Maximum number of runs of the `repeat` command
+    timing_max_runs = UINT16_MAX,
+
+    // Width of each column of the report
+    timing_column_width = 10,
+};
+
+typedef enum TimingSeries {
+    timing_series_parse,
+    timing_series_lookup,
+    timing_series_convert,
+    timing_series_handler,
+    timing_series_total,
+    timing_series_count,
+} TimingSeries;
+
+static const char* const series_names[timing_series_count] = {
+    "parse",
+    "lookup",
+    "convert",
+    "handler",
+    "total",
+};
+
+void libcli_time_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* data
+) {
+    (void)header;
+    (void)argc;
+    (void)argv;
+    (void)data;
+    // Unused. If the time command is selected, `libcli_run_time` is executed instead of this.
+}
+
+void libcli_repeat_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* data
+) {
+    (void)header;
+    (void)argc;
+    (void)argv;
+    (void)data;
+    // Unused. If the repeat command is selected, `libcli_run_repeat` is executed instead of this.
+}
+
+bool libcli_add_timing_commands(CliHeader* header) {
+    const char* time_summary = "measures the latency of a command";
+    const char* repeat_summary = "runs a command many times and measures its latency";
+
+    return libcli_add(header, "time", time_summary, 0, NULL, libcli_time_command)
+        && libcli_add(header, "repeat", repeat_summary, 0, NULL, libcli_repeat_command);
+}
+
+static bool append_char(char* line, size_t size, size_t* length, char c) {
+    if ((*length + 1) >= size) {
+        return false;
+    } else {
+        line[*length] = c;
+        *length += 1;
+        line[*length] = '\0';
+        return true;
+    }
+}
+
+// Join `strings` into a line which tokenizes back into the same strings, by double-quoting each
+// one. Returns false if the line does not fit in `size` bytes.
+static bool join_line(char* line, size_t size, const char* const* strings, size_t string_count) {
+    size_t length = 0;
+    bool fits = true;
+
+    for (size_t i = 0; (i < string_count) && fits; i++) {
+        if (i > 0) {
+            fits = append_char(line, size, &length, ' ');
+        }
+
+        fits = fits && append_char(line, size, &length, '"');
+
+        for (const char* c = strings[i]; (*c != '\0') && fits; c++) {
+            if ((*c == '"') || (*c == '\\')) {
+                fits = append_char(line, size, &length, '\\');
+            }
+
+            fits = fits && append_char(line, size, &length, *c);
+        }
+
+        fits = fits && append_char(line, size, &length, '"');
+    }
+
+    return fits;
+}
+
+static void record_timing(Histogram* stats, const CliTiming* timing) {
+    const uint32_t* stamps = timing->stamps;
+
+    // Each phase is measured from the end of the phase before it.
+    for (size_t phase = timing_phase_parse; phase < timing_phase_count; phase++) {
+        TimingSeries series = (TimingSeries)(phase - timing_phase_parse);
+        libcli_histogram_add(&stats[series], stamps[phase] - stamps[phase - 1]);
+    }
+
+    uint32_t total = stamps[timing_phase_handler] - stamps[timing_phase_start];
+    libcli_histogram_add(&stats[timing_series_total], total);
+}
+
+static void write_column(const CliHeader* header, const char* text, bool align_right) {
+    size_t length = strlen(text);
+
+    if (!align_right) {
+        libcli_write(header, text);
+    }
+
+    for (size_t i = length; i < timing_column_width; i++) {
+        libcli_write(header, " ");
+    }
+
+    if (align_right) {
+        libcli_write(header, text);
+    }
+}
+
+static void write_number_column(const CliHeader* header, uint64_t value) {
+    char text[format_unsigned_size];
+    libcli_format_unsigned(text, value);
+    write_column(header, text, true);
+}
+
+static void write_report(const CliHeader* header, const Histogram* stats, size_t runs) {
+    char text[format_unsigned_size];
+    libcli_format_unsigned(text, runs);
+
+    libcli_write(header, "runs: ");
+    libcli_write(header, text);
+    libcli_write(header, " (times in ticks)\n");
+
+    write_column(header, "", false);
+    write_column(header, "min", true);
+    write_column(header, "mean", true);
+    write_column(header, "max", true);
+    write_column(header, "p99", true);
+    libcli_write(header, "\n");
+
+    for (size_t i = 0; i < timing_series_count; i++) {
+        write_column(header, series_names[i], false);
+        write_number_column(header, stats[i].min);
+        write_number_column(header, libcli_histogram_mean(&stats[i]));
+        write_number_column(header, stats[i].max);
+        write_number_column(header, libcli_histogram_percentile(&stats[i], 99));
+        libcli_write(header, "\n");
+    }
+}
+
+// Run the command made of `strings` `runs` times through `libcli_run`, then report its latency.
+static CliRunResult run_timed(
+    const CliHeader* header,
+    const char* const* strings,
+    size_t string_count,
+    size_t runs,
+    void* userdata
+) {
+    char line[timing_line_size];
+
+    if (string_count == 0) {
+        return cli_run_result_bad_argc;
+    } else if (!join_line(line, sizeof(line), strings, string_count)) {
+        return cli_run_result_no_space;
+    }
+
+    Histogram stats[timing_series_count];
+    for (size_t i = 0; i < timing_series_count; i++) {
+        libcli_histogram_init(&stats[i]);
+    }
+
+    CliTiming timing;
+    CliHeader timed_header = *header;
+    timed_header.timing = &timing;
+
+    size_t line_size = strlen(line) + 1;
+
+    for (size_t run = 0; run < runs; run++) {
+        // The parser destroys its input, so each run parses a fresh copy.
+        char input[timing_line_size];
+        memcpy(input, line, line_size);
+
+        CliRunResult result = libcli_run(&timed_header, input, userdata);
+
+        if (result != cli_run_result_ok) {
+            return result;
+        }
+
+        record_timing(stats, &timing);
+    }
+
+    write_report(header, stats, runs);
+    return cli_run_result_ok;
+}
+
+CliRunResult libcli_run_time(
+    const CliHeader* header,
+    const char* const* strings,
+    size_t string_count,
+    void* userdata
+) {
+    return run_timed(header, strings, string_count, 1, userdata);
+}
+
+CliRunResult libcli_run_repeat(
+    const CliHeader* header,
+    const char* const* strings,
+    size_t string_count,
+    void* userdata
+) {
+    CliArgument count;
+
+    if (string_count < 2) {
+        return cli_run_result_bad_argc;
+    } else if (!libcli_convert_argument(header, cli_argument_type_int, strings[0], &count)
+        || (count.integer < 1)
+        || (count.integer > timing_max_runs)
+    ) {
+        return cli_run_result_bad_argument;
+    } else {
+        return run_timed(header, &strings[1], string_count - 1, (size_t)count.integer, userdata);
+    }
+}
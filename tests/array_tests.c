@@ -0,0 +1,326 @@
+#include "cli_constraints.h"
+#include "cli_macro.h"
+#include <assert.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+// Mocks & utility
+
+static char writeback_buffer[1024] = {0};
+static size_t command_calls = 0;
+static CliArgument last_arguments[2];
+static int last_integers[64];
+static uint8_t last_bytes[64];
+static float last_floats[64];
+
+static void writeback(const char* string, void* userdata) {
+    (void)userdata;
+    strncat(writeback_buffer, string, sizeof(writeback_buffer) - strlen(writeback_buffer) - 1);
+}
+
+// Keeps a copy of the elements, as the array buffer is reused by the next run
+static void copy_elements(const CliArgument* argument) {
+    const CliArray* array = &argument->array;
+
+    if (argument->type == cli_argument_type_int_array) {
+        memcpy(last_integers, array->integers, array->count * sizeof(int));
+    } else if (argument->type == cli_argument_type_u8_array) {
+        memcpy(last_bytes, array->bytes, array->count);
+    } else if (argument->type == cli_argument_type_float_array) {
+        memcpy(last_floats, array->floats, array->count * sizeof(float));
+    }
+}
+
+static void test_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* data
+) {
+    (void)header;
+    (void)data;
+    command_calls += 1;
+    memcpy(last_arguments, argv, argc * sizeof(CliArgument));
+
+    for (size_t i = 0; i < argc; i++) {
+        copy_elements(&argv[i]);
+    }
+}
+
+static CliHeader new_cli(CliCommand* commands, size_t capacity, void* array_buffer, size_t size) {
+    CliNewInfo info = {
+        .commands = commands,
+        .commands_size = capacity,
+        .writeback = writeback,
+        .parse_float = libcli_parse_float,
+        .array_buffer = array_buffer,
+        .array_buffer_size = size,
+    };
+    return libcli_new(&info);
+}
+
+static const CliArgumentType int_array_argument[] = { cli_argument_type_int_array };
+static const CliArgumentType u8_array_argument[] = { cli_argument_type_u8_array };
+
+// Tests
+
+static void integer_arrays_are_parsed_into_the_array_buffer(void) {
+    // Given
+    enum { capacity = 2 };
+    CliCommand commands[capacity];
+    uint32_t array_buffer[64];
+    CliHeader header = new_cli(commands, capacity, array_buffer, sizeof(array_buffer));
+    assert(libcli_add(&header, "write-regs", "", 1, int_array_argument, test_command));
+
+    // When
+    char input[] = "write-regs 0x1000,0,-1,+7,0xABCDEF,0x7fffffff,123456789,-2147483648,42";
+    CliRunResult result = libcli_run(&header, input, NULL);
+
+    // Then
+    const int expected[] = {
+        0x1000, 0, -1, 7, 0xabcdef, INT_MAX, 123456789, INT_MIN, 42,
+    };
+    assert(result == cli_run_result_ok);
+    assert(last_arguments[0].type == cli_argument_type_int_array);
+    assert(last_arguments[0].array.count == 9);
+    assert(memcmp(expected, last_integers, sizeof(expected)) == 0);
+    assert((void*)last_arguments[0].array.integers >= (void*)array_buffer);
+}
+
+static void arrays_may_be_quoted_lists(void) {
+    // Given
+    enum { capacity = 2 };
+    CliCommand commands[capacity];
+    uint32_t array_buffer[64];
+    CliHeader header = new_cli(commands, capacity, array_buffer, sizeof(array_buffer));
+    const CliArgumentType arguments[] = { cli_argument_type_u8_array, cli_argument_type_int_array };
+    assert(libcli_add(&header, "set-leds", "", 2, arguments, test_command));
+
+    // When
+    char input[] = "set-leds \"255 0 0x80,  12\" ''";
+    CliRunResult result = libcli_run(&header, input, NULL);
+
+    // Then
+    const uint8_t expected[] = { 255, 0, 0x80, 12 };
+    assert(result == cli_run_result_ok);
+    assert(last_arguments[0].array.count == 4);
+    assert(memcmp(expected, last_bytes, sizeof(expected)) == 0);
+    assert(last_arguments[1].array.count == 0);
+}
+
+static void bad_elements_are_reported(void) {
+    // Given
+    enum { capacity = 2 };
+    CliCommand commands[capacity];
+    uint32_t array_buffer[64];
+    CliHeader header = new_cli(commands, capacity, array_buffer, sizeof(array_buffer));
+    assert(libcli_add(&header, "write-regs", "", 1, int_array_argument, test_command));
+
+    const char* inputs[] = {
+        "write-regs 1,2,3x",
+        "write-regs 1,2,2147483648",
+        "write-regs 1,2,0x80000000",
+        "write-regs 1,2,0x1g",
+        "write-regs 1,2,12345678901",
+        "write-regs 1,2,-",
+        "write-regs 1,2,0x",
+    };
+
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++) {
+        // When
+        char input[64];
+        strcpy(input, inputs[i]);
+        CliRunError error;
+        CliRunResult result = libcli_run_with_error(&header, input, NULL, &error);
+
+        // Then
+        assert(result == cli_run_result_bad_argument);
+        assert(error.argument == 0);
+        assert(error.element == 2);
+        assert(error.offset == 4);
+    }
+
+    assert(command_calls == 0);
+}
+
+static void byte_elements_are_range_checked(void) {
+    // Given
+    enum { capacity = 2 };
+    CliCommand commands[capacity];
+    uint32_t array_buffer[64];
+    CliHeader header = new_cli(commands, capacity, array_buffer, sizeof(array_buffer));
+    assert(libcli_add(&header, "bytes", "", 1, u8_array_argument, test_command));
+
+    // When
+    char input[] = "bytes 0,255,256";
+    CliRunError error;
+    CliRunResult result = libcli_run_with_error(&header, input, NULL, &error);
+
+    // Then
+    assert(result == cli_run_result_bad_argument);
+    assert(error.element == 2);
+
+    // When
+    char negative[] = "bytes -1";
+    result = libcli_run_with_error(&header, negative, NULL, &error);
+
+    // Then
+    assert(result == cli_run_result_bad_argument);
+    assert(error.element == 0);
+}
+
+static void float_arrays_use_the_float_parser(void) {
+    // Given
+    enum { capacity = 2 };
+    CliCommand commands[capacity];
+    uint32_t array_buffer[64];
+    CliHeader header = new_cli(commands, capacity, array_buffer, sizeof(array_buffer));
+    const CliArgumentType arguments[] = { cli_argument_type_float_array };
+    assert(libcli_add(&header, "gains", "", 1, arguments, test_command));
+
+    // When
+    char input[] = "gains 0.5,-2.25,8";
+    CliRunResult result = libcli_run(&header, input, NULL);
+
+    // Then
+    assert(result == cli_run_result_ok);
+    assert(last_arguments[0].array.count == 3);
+    assert(last_floats[0] == 0.5f);
+    assert(last_floats[1] == -2.25f);
+    assert(last_floats[2] == 8.0f);
+}
+
+static void arrays_must_fit_in_the_array_buffer(void) {
+    // Given
+    enum { capacity = 2 };
+    CliCommand commands[capacity];
+    uint32_t array_buffer[4];
+    CliHeader header = new_cli(commands, capacity, array_buffer, sizeof(array_buffer));
+    const CliArgumentType arguments[] = {
+        cli_argument_type_int_array,
+        cli_argument_type_int_array,
+    };
+    assert(libcli_add(&header, "pair", "", 2, arguments, test_command));
+
+    // When
+    char input[] = "pair 1,2,3 4,5";
+    CliRunError error;
+    CliRunResult result = libcli_run_with_error(&header, input, NULL, &error);
+
+    // Then
+    assert(result == cli_run_result_bad_argument);
+    assert(error.argument == 1);
+    assert(error.element == 1);
+
+    // When
+    char fits[] = "pair 1,2,3 4";
+    result = libcli_run(&header, fits, NULL);
+
+    // Then
+    assert(result == cli_run_result_ok);
+    assert(last_integers[0] == 4);
+
+    // When (without an array buffer)
+    CliHeader bufferless = new_cli(commands, capacity, NULL, 0);
+
+    // Then
+    assert(!libcli_add(&bufferless, "pair", "", 2, arguments, test_command));
+}
+
+static void arrays_are_compiled_into_macros(void) {
+    // Given
+    enum { capacity = 3 };
+    CliCommand commands[capacity];
+    uint32_t array_buffer[64];
+    CliHeader header = new_cli(commands, capacity, array_buffer, sizeof(array_buffer));
+    const CliArgumentType arguments[] = { cli_argument_type_int_array, cli_argument_type_u8_array };
+    assert(libcli_add(&header, "load", "", 2, arguments, test_command));
+
+    char script[] = "load 0x10,-3,70000 1,2,3";
+    uint8_t macro[128];
+    CliCompileResult compiled = libcli_compile(&header, script, macro, sizeof(macro));
+    assert(compiled.status == cli_run_result_ok);
+
+    // When
+    CliRunResult result = libcli_replay(&header, macro, compiled.size, NULL);
+
+    // Then
+    const int expected_integers[] = { 0x10, -3, 70000 };
+    const uint8_t expected_bytes[] = { 1, 2, 3 };
+    assert(result == cli_run_result_ok);
+    assert(last_arguments[0].array.count == 3);
+    assert(memcmp(expected_integers, last_integers, sizeof(expected_integers)) == 0);
+    assert(last_arguments[1].array.count == 3);
+    assert(memcmp(expected_bytes, last_bytes, sizeof(expected_bytes)) == 0);
+}
+
+static void array_lengths_can_be_constrained(void) {
+    // Given
+    enum { capacity = 3 };
+    CliCommand commands[capacity];
+    uint32_t array_buffer[64];
+    CliHeader header = new_cli(commands, capacity, array_buffer, sizeof(array_buffer));
+
+    const CliConstraint rgb = { .argument = 0, .kind = cli_constraint_length, .length = { 3, 3 } };
+    CliCommandInfo info = {
+        .name = "set-led",
+        .summary = "sets an led colour",
+        .argument_count = 1,
+        .arguments = u8_array_argument,
+        .constraints = &rgb,
+        .constraint_count = 1,
+        .function = test_command,
+    };
+    assert(libcli_add_command(&header, &info));
+
+    // When, Then
+    char good[] = "set-led 1,2,3";
+    assert(libcli_run(&header, good, NULL) == cli_run_result_ok);
+
+    char short_list[] = "set-led 1,2";
+    assert(libcli_run(&header, short_list, NULL) == cli_run_result_failed_constraint);
+
+    // When
+    char help[] = "help set-led";
+    writeback_buffer[0] = '\0';
+    libcli_run(&header, help, NULL);
+
+    // Then
+    assert(strcmp("set-led <u8[]>\n    sets an led colour\n", writeback_buffer) == 0);
+}
+
+// Test runner
+
+static void cleanup(void) {
+    memset(writeback_buffer, 0, sizeof(writeback_buffer));
+    memset(last_arguments, 0, sizeof(last_arguments));
+    memset(last_integers, 0, sizeof(last_integers));
+    memset(last_bytes, 0, sizeof(last_bytes));
+    memset(last_floats, 0, sizeof(last_floats));
+    command_calls = 0;
+}
+
+int main(void) {
+    typedef void (*Test)(void);
+
+    const Test tests[] = {
+        integer_arrays_are_parsed_into_the_array_buffer,
+        arrays_may_be_quoted_lists,
+        bad_elements_are_reported,
+        byte_elements_are_range_checked,
+        float_arrays_use_the_float_parser,
+        arrays_must_fit_in_the_array_buffer,
+        arrays_are_compiled_into_macros,
+        array_lengths_can_be_constrained,
+    };
+
+    const size_t test_count = sizeof(tests) / sizeof(Test);
+    for (size_t i = 0; i < test_count; i++) {
+        Test test = tests[i];
+        test();
+        cleanup();
+    }
+
+    printf("All tests (%zu) passed.\n", test_count);
+}
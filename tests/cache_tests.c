@@ -0,0 +1,311 @@
+#include "cli_cache.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+// Mocks & utility
+
+static char writeback_buffer[2048] = {0};
+static size_t status_calls = 0;
+static size_t other_calls = 0;
+static uint32_t fake_time = 0;
+
+static void writeback(const char* string, void* userdata) {
+    (void)userdata;
+    strncat(writeback_buffer, string, sizeof(writeback_buffer) - strlen(writeback_buffer) - 1);
+}
+
+static uint32_t fake_clock(void) {
+    return fake_time;
+}
+
+// Writes its argument and how many times it has run
+static void status_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* data
+) {
+    (void)argc;
+    (void)data;
+    status_calls += 1;
+
+    char line[64];
+    snprintf(line, sizeof(line), "%s: %zu\n", argv[0].string, status_calls);
+    libcli_write(header, line);
+}
+
+static void other_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* data
+) {
+    (void)argc;
+    (void)argv;
+    (void)data;
+    other_calls += 1;
+    libcli_write(header, "other\n");
+}
+
+// Writes its argument `count` times
+static void repeat_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* data
+) {
+    (void)argc;
+    (void)data;
+    status_calls += 1;
+
+    for (int i = 0; i < argv[1].integer; i++) {
+        libcli_write(header, argv[0].string);
+    }
+}
+
+static const CliArgumentType string_argument[] = { cli_argument_type_string };
+static const CliArgumentType repeat_arguments[] = {
+    cli_argument_type_string,
+    cli_argument_type_int,
+};
+
+static bool add_cacheable(
+    CliHeader* header,
+    const char* name,
+    size_t argument_count,
+    const CliArgumentType* arguments,
+    CliCommandFunction function
+) {
+    CliCommandInfo info = {
+        .name = name,
+        .summary = "",
+        .argument_count = argument_count,
+        .arguments = arguments,
+        .function = function,
+        .cacheable = true,
+    };
+    return libcli_add_command(header, &info);
+}
+
+static CliHeader new_cli(CliCommand* commands, size_t capacity, CliCache* cache, char* pipe) {
+    CliNewInfo info = {
+        .commands = commands,
+        .commands_size = capacity,
+        .writeback = writeback,
+        .pipe_buffer = pipe,
+        .pipe_buffer_size = (pipe != NULL) ? 256 : 0,
+        .cache = cache,
+    };
+    CliHeader header = libcli_new(&info);
+
+    assert(add_cacheable(&header, "status", 1, string_argument, status_command));
+    return header;
+}
+
+static CliRunResult run(const CliHeader* header, const char* text) {
+    char input[256];
+    strcpy(input, text);
+    return libcli_run(header, input, NULL);
+}
+
+// Tests
+
+static void repeated_lines_are_served_from_the_cache(void) {
+    // Given
+    enum { capacity = 3 };
+    CliCommand commands[capacity];
+    CliCacheEntry entries[4];
+    CliCache cache = libcli_cache_new(entries, 4, NULL, 0);
+    CliHeader header = new_cli(commands, capacity, &cache, NULL);
+
+    // When
+    assert(run(&header, "status eth0") == cli_run_result_ok);
+    assert(run(&header, "status eth0") == cli_run_result_ok);
+    assert(run(&header, "  status   'eth0'") == cli_run_result_ok);
+
+    // Then
+    assert(status_calls == 1);
+    assert(strcmp("eth0: 1\neth0: 1\neth0: 1\n", writeback_buffer) == 0);
+    assert(libcli_cache_hits(&cache) == 2);
+    assert(libcli_cache_misses(&cache) == 1);
+
+    // When (other arguments are cached apart)
+    writeback_buffer[0] = '\0';
+    assert(run(&header, "status eth1") == cli_run_result_ok);
+    assert(run(&header, "status eth0") == cli_run_result_ok);
+
+    // Then
+    assert(status_calls == 2);
+    assert(strcmp("eth1: 2\neth0: 1\n", writeback_buffer) == 0);
+}
+
+static void invalidating_runs_commands_again(void) {
+    // Given
+    enum { capacity = 3 };
+    CliCommand commands[capacity];
+    CliCacheEntry entries[4];
+    CliCache cache = libcli_cache_new(entries, 4, NULL, 0);
+    CliHeader header = new_cli(commands, capacity, &cache, NULL);
+    run(&header, "status eth0");
+
+    // When
+    libcli_cache_invalidate(&cache);
+    run(&header, "status eth0");
+    run(&header, "status eth0");
+
+    // Then
+    assert(status_calls == 2);
+    assert(strcmp("eth0: 1\neth0: 2\neth0: 2\n", writeback_buffer) == 0);
+}
+
+static void entries_expire_after_their_time_to_live(void) {
+    // Given
+    enum { capacity = 3 };
+    CliCommand commands[capacity];
+    CliCacheEntry entries[4];
+    CliCache cache = libcli_cache_new(entries, 4, fake_clock, 100);
+    CliHeader header = new_cli(commands, capacity, &cache, NULL);
+    fake_time = UINT32_MAX - 10;
+    run(&header, "status eth0");
+
+    // When, Then (the clock may wrap)
+    fake_time += 99;
+    run(&header, "status eth0");
+    assert(status_calls == 1);
+
+    fake_time += 1;
+    run(&header, "status eth0");
+    assert(status_calls == 2);
+}
+
+static void the_least_recently_used_entry_is_replaced(void) {
+    // Given
+    enum { capacity = 3 };
+    CliCommand commands[capacity];
+    CliCacheEntry entries[2];
+    CliCache cache = libcli_cache_new(entries, 2, NULL, 0);
+    CliHeader header = new_cli(commands, capacity, &cache, NULL);
+    run(&header, "status a");
+    run(&header, "status b");
+    run(&header, "status a");
+
+    // When
+    run(&header, "status c");
+
+    // Then
+    assert(status_calls == 3);
+    run(&header, "status a");
+    run(&header, "status c");
+    assert(status_calls == 3);
+
+    run(&header, "status b");
+    assert(status_calls == 4);
+}
+
+static void only_whole_successful_runs_are_cached(void) {
+    // Given
+    enum { capacity = 8 };
+    CliCommand commands[capacity];
+    CliCacheEntry entries[4];
+    CliCache cache = libcli_cache_new(entries, 4, NULL, 0);
+    char pipe[256];
+    CliHeader header = new_cli(commands, capacity, &cache, pipe);
+    assert(libcli_add_filters(&header));
+    assert(add_cacheable(&header, "repeat", 2, repeat_arguments, repeat_command));
+    assert(libcli_add(&header, "other", "", 1, string_argument, other_command));
+
+    // When, Then (rejected lines do not run)
+    assert(run(&header, "status") == cli_run_result_bad_argc);
+    assert(run(&header, "repeat word x") == cli_run_result_bad_argument);
+    assert(libcli_cache_misses(&cache) == 0);
+
+    // When, Then (pipelines)
+    run(&header, "status eth0 | count");
+    run(&header, "status eth0 | count");
+    assert(status_calls == 2);
+
+    // When, Then (output longer than an entry)
+    run(&header, "repeat 0123456789abcdef 40");
+    run(&header, "repeat 0123456789abcdef 40");
+    assert(status_calls == 4);
+    assert(strlen(writeback_buffer) == 4 + (2 * 16 * 40));
+
+    // When, Then (lines longer than a key)
+    run(&header, "status 0123456789abcdef0123456789abcdef0123456789abcdef0123456789");
+    run(&header, "status 0123456789abcdef0123456789abcdef0123456789abcdef0123456789");
+    assert(status_calls == 6);
+
+    // When, Then (commands which are not cacheable)
+    run(&header, "other x");
+    run(&header, "other x");
+    assert(other_calls == 2);
+    assert(libcli_cache_hits(&cache) == 0);
+}
+
+static void replaced_commands_are_not_served_old_output(void) {
+    // Given
+    enum { capacity = 3 };
+    CliCommand commands[capacity];
+    CliCacheEntry entries[4];
+    CliCache cache = libcli_cache_new(entries, 4, NULL, 0);
+    CliHeader header = new_cli(commands, capacity, &cache, NULL);
+    run(&header, "status x");
+
+    // When
+    assert(libcli_remove(&header, "status"));
+    assert(add_cacheable(&header, "status", 1, string_argument, other_command));
+    run(&header, "status x");
+    run(&header, "status x");
+
+    // Then
+    assert(status_calls == 1);
+    assert(other_calls == 1);
+    assert(strcmp("x: 1\nother\nother\n", writeback_buffer) == 0);
+}
+
+static void headers_without_a_cache_run_every_line(void) {
+    // Given
+    enum { capacity = 3 };
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity, NULL, NULL);
+
+    // When
+    run(&header, "status eth0");
+    run(&header, "status eth0");
+
+    // Then
+    assert(status_calls == 2);
+}
+
+// Test runner
+
+static void cleanup(void) {
+    memset(writeback_buffer, 0, sizeof(writeback_buffer));
+    status_calls = 0;
+    other_calls = 0;
+    fake_time = 0;
+}
+
+int main(void) {
+    typedef void (*Test)(void);
+
+    const Test tests[] = {
+        repeated_lines_are_served_from_the_cache,
+        invalidating_runs_commands_again,
+        entries_expire_after_their_time_to_live,
+        the_least_recently_used_entry_is_replaced,
+        only_whole_successful_runs_are_cached,
+        replaced_commands_are_not_served_old_output,
+        headers_without_a_cache_run_every_line,
+    };
+
+    const size_t test_count = sizeof(tests) / sizeof(Test);
+    for (size_t i = 0; i < test_count; i++) {
+        Test test = tests[i];
+        test();
+        cleanup();
+    }
+
+    printf("All tests (%zu) passed.\n", test_count);
+}
@@ -0,0 +1,462 @@
+#include "cli_channel.h"
+#include "cli_jobs.h"
+#include "cli_macro.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Mocks & utility
+
+enum {
+    process_request_count = 2000,
+};
+
+static void echo_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* userdata
+) {
+    (void)argc;
+    (void)userdata;
+
+    libcli_write(header, argv[0].string);
+    libcli_write(header, "\n");
+}
+
+// Writes its argument `count` times
+static void repeat_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* userdata
+) {
+    (void)argc;
+    (void)userdata;
+
+    for (int i = 0; i < argv[1].integer; i++) {
+        libcli_write(header, argv[0].string);
+    }
+}
+
+// Overwrites the shared response lengths of every slot, as a faulty client could, then writes
+static void tamper_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* userdata
+) {
+    (void)argc;
+    (void)argv;
+
+    CliChannelRegion* region = (CliChannelRegion*)userdata;
+
+    for (size_t i = 0; i < cli_channel_slot_count; i++) {
+        region->slots[i].response_size = UINT32_MAX;
+    }
+
+    libcli_write(header, "kept\n");
+}
+
+static uint32_t zero_clock(void) {
+    return 0;
+}
+
+// Overwrites the requests of every slot, terminators included, then writes its argument
+static void scribble_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* userdata
+) {
+    (void)argc;
+
+    CliChannelRegion* region = (CliChannelRegion*)userdata;
+
+    for (size_t i = 0; i < cli_channel_slot_count; i++) {
+        memset(region->slots[i].request, 'x', cli_channel_request_size);
+    }
+
+    libcli_write(header, argv[0].string);
+    libcli_write(header, "\n");
+}
+
+static void discard_writeback(const char* string, void* userdata) {
+    (void)string;
+    (void)userdata;
+}
+
+static CliHeader new_echo_cli(CliCommand* commands, size_t capacity) {
+    CliNewInfo info = {
+        .commands = commands,
+        .commands_size = capacity,
+        .writeback = discard_writeback,
+        .writeback_data = NULL,
+    };
+    CliHeader header = libcli_new(&info);
+
+    CliArgumentType echo_args[] = { cli_argument_type_string };
+    bool added = libcli_add(&header, "echo", "repeats its argument", 1, echo_args, echo_command);
+    assert(added);
+
+    CliArgumentType repeat_args[] = { cli_argument_type_string, cli_argument_type_int };
+    added = libcli_add(&header, "repeat", "repeats a word", 2, repeat_args, repeat_command);
+    assert(added);
+
+    return header;
+}
+
+// Map a region which stays shared with child processes
+static CliChannelRegion* map_region(void) {
+    void* memory = mmap(
+        NULL,
+        sizeof(CliChannelRegion),
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_ANONYMOUS,
+        -1,
+        0
+    );
+    assert(memory != MAP_FAILED);
+
+    CliChannelRegion* region = (CliChannelRegion*)memory;
+    libcli_channel_init(region);
+    return region;
+}
+
+static void unmap_region(CliChannelRegion* region) {
+    munmap(region, sizeof(CliChannelRegion));
+}
+
+static bool output_equals(const CliChannelResponse* response, const char* expected) {
+    return (response->output_size == strlen(expected))
+        && (memcmp(response->output, expected, response->output_size) == 0);
+}
+
+// Tests
+
+static void lines_run_in_shared_memory(void) {
+    // Given
+    enum { capacity = 3 };
+    CliCommand commands[capacity];
+    CliHeader header = new_echo_cli(commands, capacity);
+    CliChannelRegion* region = map_region();
+    CliChannel channel = libcli_channel_new(region);
+    CliChannelClient client;
+    assert(libcli_channel_connect(&client, region));
+
+    // When
+    assert(libcli_channel_submit(&client, "echo hello"));
+    assert(libcli_channel_submit(&client, "missing"));
+    size_t served = libcli_channel_serve(&header, &channel, 0, NULL);
+
+    // Then
+    CliChannelResponse response;
+    assert(served == 2);
+    assert(libcli_channel_receive(&client, 0, &response));
+    assert(response.result == cli_run_result_ok);
+    assert(output_equals(&response, "hello\n"));
+
+    assert(libcli_channel_receive(&client, 0, &response));
+    assert(response.result == cli_run_result_unknown);
+    assert(response.output_size == 0);
+
+    assert(!libcli_channel_receive(&client, 0, &response));
+    unmap_region(region);
+}
+
+static void requests_are_pipelined_up_to_the_slot_count(void) {
+    // Given
+    enum { capacity = 3 };
+    CliCommand commands[capacity];
+    CliHeader header = new_echo_cli(commands, capacity);
+    CliChannelRegion* region = map_region();
+    CliChannel channel = libcli_channel_new(region);
+    CliChannelClient client;
+    assert(libcli_channel_connect(&client, region));
+
+    // When
+    for (size_t i = 0; i < cli_channel_slot_count; i++) {
+        char line[32];
+        snprintf(line, sizeof(line), "echo %zu", i);
+        assert(libcli_channel_submit(&client, line));
+    }
+
+    // Then
+    assert(!libcli_channel_submit(&client, "echo full"));
+    assert(libcli_channel_serve(&header, &channel, 0, region) == cli_channel_slot_count);
+
+    for (size_t i = 0; i < cli_channel_slot_count; i++) {
+        char expected[32];
+        snprintf(expected, sizeof(expected), "%zu\n", i);
+
+        CliChannelResponse response;
+        assert(libcli_channel_receive(&client, 0, &response));
+        assert(output_equals(&response, expected));
+    }
+
+    // When (receiving frees the slots)
+    assert(libcli_channel_submit(&client, "echo again"));
+    assert(libcli_channel_serve(&header, &channel, 0, NULL) == 1);
+
+    // Then
+    CliChannelResponse response;
+    assert(libcli_channel_receive(&client, 0, &response));
+    assert(output_equals(&response, "again\n"));
+    unmap_region(region);
+}
+
+static void long_output_and_requests_are_limited(void) {
+    // Given
+    enum { capacity = 3 };
+    CliCommand commands[capacity];
+    CliHeader header = new_echo_cli(commands, capacity);
+    CliChannelRegion* region = map_region();
+    CliChannel channel = libcli_channel_new(region);
+    CliChannelClient client;
+    assert(libcli_channel_connect(&client, region));
+
+    char long_line[cli_channel_request_size + 1];
+    memset(long_line, 'a', sizeof(long_line) - 1);
+    long_line[sizeof(long_line) - 1] = '\0';
+
+    // When
+    assert(!libcli_channel_submit(&client, long_line));
+    assert(libcli_channel_submit(&client, "repeat 0123456789abcdef 100"));
+    libcli_channel_serve(&header, &channel, 0, NULL);
+
+    // Then
+    CliChannelResponse response;
+    assert(libcli_channel_receive(&client, 0, &response));
+    assert(response.result == cli_run_result_ok);
+    assert(response.output_size == cli_channel_response_size);
+    assert(response.output_dropped == (16 * 100) - cli_channel_response_size);
+    unmap_region(region);
+}
+
+static void shared_counters_are_not_trusted(void) {
+    // Given
+    enum { capacity = 4 };
+    CliCommand commands[capacity];
+    CliHeader header = new_echo_cli(commands, capacity);
+    bool added = libcli_add(&header, "tamper", "", 0, NULL, tamper_command);
+    assert(added);
+
+    CliChannelRegion* region = map_region();
+    CliChannel channel = libcli_channel_new(region);
+    CliChannelClient client;
+    assert(libcli_channel_connect(&client, region));
+
+    // When (the response length in shared memory is overwritten while the command writes)
+    assert(libcli_channel_submit(&client, "tamper"));
+    assert(libcli_channel_serve(&header, &channel, 0, region) == 1);
+
+    // Then
+    CliChannelResponse response;
+    assert(libcli_channel_receive(&client, 0, &response));
+    assert(output_equals(&response, "kept\n"));
+
+    // When (the submitted counter is corrupt)
+    atomic_fetch_add(&region->submitted, 1000);
+
+    // Then (at most one request per slot runs)
+    assert(libcli_channel_serve(&header, &channel, 0, region) == cli_channel_slot_count);
+    unmap_region(region);
+}
+
+static void requests_are_copied_before_they_run(void) {
+    // Given
+    enum { capacity = 4 };
+    CliCommand commands[capacity];
+    CliHeader header = new_echo_cli(commands, capacity);
+    CliArgumentType scribble_args[] = { cli_argument_type_string };
+    bool added = libcli_add(&header, "scribble", "", 1, scribble_args, scribble_command);
+    assert(added);
+
+    CliChannelRegion* region = map_region();
+    CliChannel channel = libcli_channel_new(region);
+    CliChannelClient client;
+    assert(libcli_channel_connect(&client, region));
+
+    // When (the request is overwritten while its command runs)
+    assert(libcli_channel_submit(&client, "scribble kept"));
+    assert(libcli_channel_serve(&header, &channel, 0, region) == 1);
+
+    // Then (the command's argument did not change)
+    CliChannelResponse response;
+    assert(libcli_channel_receive(&client, 0, &response));
+    assert(response.result == cli_run_result_ok);
+    assert(output_equals(&response, "kept\n"));
+
+    // When (a request without a terminator fills its slot)
+    memset(region->slots[1].request, 'x', cli_channel_request_size);
+    region->slots[1].frame = cli_channel_frame_line;
+    region->slots[1].request_size = cli_channel_request_size;
+    atomic_fetch_add(&region->submitted, 1);
+    assert(libcli_channel_serve(&header, &channel, 0, region) == 1);
+
+    // Then (it ends within the request)
+    assert(region->slots[1].result == cli_run_result_unknown);
+    unmap_region(region);
+}
+
+static void jobs_cannot_be_started_by_requests(void) {
+    // Given
+    enum { capacity = 8 };
+    CliCommand commands[capacity];
+    CliJob entries[2];
+    CliJobs jobs;
+    assert(libcli_jobs_init(&jobs, entries, 2, zero_clock, 1000));
+
+    CliNewInfo info = {
+        .commands = commands,
+        .commands_size = capacity,
+        .writeback = discard_writeback,
+        .writeback_data = NULL,
+        .jobs = &jobs,
+    };
+    CliHeader header = libcli_new(&info);
+    CliChannelRegion* region = map_region();
+    CliChannel channel = libcli_channel_new(region);
+    CliChannelClient client;
+    assert(libcli_channel_connect(&client, region));
+
+    // When (the slot a watch would write to is reused by the next request)
+    assert(libcli_channel_submit(&client, "watch 10 help"));
+    assert(libcli_channel_submit(&client, "every 10 help"));
+    assert(libcli_channel_serve(&header, &channel, 0, NULL) == 2);
+
+    // Then
+    CliChannelResponse response;
+    assert(libcli_channel_receive(&client, 0, &response));
+    assert(response.result == cli_run_result_bad_pipe);
+    assert(libcli_channel_receive(&client, 0, &response));
+    assert(response.result == cli_run_result_bad_pipe);
+    assert(!libcli_jobs_stats(&jobs, 1, &(CliJobStats){ 0 }));
+
+    unmap_region(region);
+}
+
+static void macros_run_as_binary_frames(void) {
+    // Given
+    enum { capacity = 3 };
+    CliCommand commands[capacity];
+    CliHeader header = new_echo_cli(commands, capacity);
+    CliChannelRegion* region = map_region();
+    CliChannel channel = libcli_channel_new(region);
+    CliChannelClient client;
+    assert(libcli_channel_connect(&client, region));
+
+    char script[] = "echo first\necho second";
+    uint8_t macro[64];
+    CliCompileResult compiled = libcli_compile(&header, script, macro, sizeof(macro));
+    assert(compiled.status == cli_run_result_ok);
+
+    // When
+    assert(libcli_channel_submit_macro(&client, macro, compiled.size));
+    libcli_channel_serve(&header, &channel, 0, NULL);
+
+    // Then
+    CliChannelResponse response;
+    assert(libcli_channel_receive(&client, 0, &response));
+    assert(response.result == cli_run_result_ok);
+    assert(output_equals(&response, "first\nsecond\n"));
+    unmap_region(region);
+}
+
+static void waits_time_out_without_work(void) {
+    // Given
+    enum { capacity = 3 };
+    CliCommand commands[capacity];
+    CliHeader header = new_echo_cli(commands, capacity);
+    CliChannelRegion* region = map_region();
+    CliChannel channel = libcli_channel_new(region);
+    CliChannelClient client;
+
+    // When, Then
+    CliChannelRegion uninitialized = { .magic = 0 };
+    assert(!libcli_channel_connect(&client, &uninitialized));
+    assert(libcli_channel_connect(&client, region));
+
+    assert(libcli_channel_serve(&header, &channel, 10, NULL) == 0);
+
+    CliChannelResponse response;
+    assert(!libcli_channel_receive(&client, 10, &response));
+
+    assert(libcli_channel_submit(&client, "echo late"));
+    assert(!libcli_channel_receive(&client, 10, &response));
+    unmap_region(region);
+}
+
+static void clients_in_other_processes_are_woken(void) {
+    // Given
+    enum { capacity = 3 };
+    CliCommand commands[capacity];
+    CliHeader header = new_echo_cli(commands, capacity);
+    CliChannelRegion* region = map_region();
+    CliChannel channel = libcli_channel_new(region);
+
+    // When
+    pid_t child = fork();
+    assert(child >= 0);
+
+    if (child == 0) {
+        CliChannelClient client;
+        bool ok = libcli_channel_connect(&client, region);
+
+        for (size_t i = 0; ok && (i < process_request_count); i++) {
+            char line[32];
+            char expected[32];
+            snprintf(line, sizeof(line), "echo %zu", i);
+            snprintf(expected, sizeof(expected), "%zu\n", i);
+
+            CliChannelResponse response;
+            ok = libcli_channel_submit(&client, line)
+                && libcli_channel_receive(&client, -1, &response)
+                && output_equals(&response, expected);
+        }
+
+        _exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    size_t served = 0;
+    while (served < process_request_count) {
+        served += libcli_channel_serve(&header, &channel, 1000, NULL);
+    }
+
+    // Then
+    int status = 0;
+    assert(waitpid(child, &status, 0) == child);
+    assert(WIFEXITED(status) && (WEXITSTATUS(status) == EXIT_SUCCESS));
+    assert(served == process_request_count);
+    unmap_region(region);
+}
+
+// Test runner
+
+int main(void) {
+    typedef void (*Test)(void);
+
+    const Test tests[] = {
+        lines_run_in_shared_memory,
+        requests_are_pipelined_up_to_the_slot_count,
+        long_output_and_requests_are_limited,
+        shared_counters_are_not_trusted,
+        requests_are_copied_before_they_run,
+        jobs_cannot_be_started_by_requests,
+        macros_run_as_binary_frames,
+        waits_time_out_without_work,
+        clients_in_other_processes_are_woken,
+    };
+
+    const size_t test_count = sizeof(tests) / sizeof(Test);
+    for (size_t i = 0; i < test_count; i++) {
+        Test test = tests[i];
+        test();
+    }
+
+    printf("All tests (%zu) passed.\n", test_count);
+}
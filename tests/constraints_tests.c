@@ -0,0 +1,362 @@
+#include "cli_constraints.h"
+#include "cli_macro.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+// Mocks & utility
+
+static char writeback_buffer[1024] = {0};
+static size_t command_calls = 0;
+static CliArgument last_arguments[2];
+
+static void writeback(const char* string, void* userdata) {
+    (void)userdata;
+    strncat(writeback_buffer, string, sizeof(writeback_buffer) - strlen(writeback_buffer) - 1);
+}
+
+static CliHeader new_cli(CliCommand* commands, size_t capacity) {
+    CliNewInfo info = {
+        .commands = commands,
+        .commands_size = capacity,
+        .writeback = writeback,
+    };
+    return libcli_new(&info);
+}
+
+static void test_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* data
+) {
+    (void)header;
+    (void)data;
+    command_calls += 1;
+    memcpy(last_arguments, argv, argc * sizeof(CliArgument));
+}
+
+static bool is_even(const CliArgument* argument, const void* data) {
+    (void)data;
+    return (argument->integer % 2) == 0;
+}
+
+static const char* const modes[] = { "auto", "manual" };
+
+enum { gain_range, gain_even, mode_one_of };
+
+static const CliConstraint gain_constraints[] = {
+    [gain_range] = { .argument = 0, .kind = cli_constraint_range, .range = { 0, 40 } },
+    [gain_even] = {
+        .argument = 0,
+        .kind = cli_constraint_predicate,
+        .predicate = { is_even, NULL },
+    },
+    [mode_one_of] = { .argument = 1, .kind = cli_constraint_one_of, .one_of = { modes, 2 } },
+};
+
+static const CliArgumentType gain_arguments[] = {
+    cli_argument_type_int,
+    cli_argument_type_string,
+};
+
+static bool add_gain_command(CliHeader* header) {
+    CliCommandInfo info = {
+        .name = "set-gain",
+        .summary = "sets the amplifier gain",
+        .argument_count = 2,
+        .arguments = gain_arguments,
+        .constraints = gain_constraints,
+        .constraint_count = 3,
+        .function = test_command,
+    };
+    return libcli_add_command(header, &info);
+}
+
+// Tests
+
+static void arguments_within_constraints_run(void) {
+    // Given
+    enum { capacity = 2 };
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity);
+    assert(add_gain_command(&header));
+
+    // When
+    char input[] = "set-gain 40 manual";
+    CliRunResult result = libcli_run(&header, input, NULL);
+
+    // Then
+    assert(result == cli_run_result_ok);
+    assert(command_calls == 1);
+    assert(last_arguments[0].integer == 40);
+    assert(strcmp("manual", last_arguments[1].string) == 0);
+}
+
+static void failed_constraints_are_reported(void) {
+    // Given
+    enum { capacity = 2 };
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity);
+    assert(add_gain_command(&header));
+
+    // When
+    char out_of_range[] = "set-gain 42 auto";
+    CliRunError error;
+    CliRunResult result = libcli_run_with_error(&header, out_of_range, NULL, &error);
+
+    // Then
+    assert(result == cli_run_result_failed_constraint);
+    assert(error.argument == 0);
+    assert(error.constraint == gain_range);
+
+    // When
+    char odd[] = "set-gain 7 auto";
+    result = libcli_run_with_error(&header, odd, NULL, &error);
+
+    // Then
+    assert(result == cli_run_result_failed_constraint);
+    assert(error.argument == 0);
+    assert(error.constraint == gain_even);
+
+    // When
+    char bad_mode[] = "set-gain 8 off";
+    result = libcli_run_with_error(&header, bad_mode, NULL, &error);
+
+    // Then
+    assert(result == cli_run_result_failed_constraint);
+    assert(error.argument == 1);
+    assert(error.constraint == mode_one_of);
+    assert(command_calls == 0);
+}
+
+static void failed_constraints_stop_the_whole_pipeline(void) {
+    // Given
+    enum { capacity = 2 };
+    CliCommand commands[capacity];
+    char pipe_buffer[64];
+    CliNewInfo info = {
+        .commands = commands,
+        .commands_size = capacity,
+        .writeback = writeback,
+        .pipe_buffer = pipe_buffer,
+        .pipe_buffer_size = sizeof(pipe_buffer),
+    };
+    CliHeader header = libcli_new(&info);
+    assert(add_gain_command(&header));
+
+    // When
+    char input[] = "set-gain 2 auto | set-gain 50 auto";
+    CliRunResult result = libcli_run(&header, input, NULL);
+
+    // Then
+    assert(result == cli_run_result_failed_constraint);
+    assert(command_calls == 0);
+}
+
+static void lengths_and_charsets_are_checked(void) {
+    // Given
+    enum { capacity = 2 };
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity);
+
+    const CliArgumentType arguments[] = { cli_argument_type_string, cli_argument_type_blob };
+    const CliConstraint constraints[] = {
+        { .argument = 0, .kind = cli_constraint_length, .length = { 1, 8 } },
+        { .argument = 0, .kind = cli_constraint_charset, .charset = "a-z0-9_-" },
+        { .argument = 1, .kind = cli_constraint_length, .length = { 2, 2 } },
+    };
+    CliCommandInfo info = {
+        .name = "name",
+        .summary = "",
+        .argument_count = 2,
+        .arguments = arguments,
+        .constraints = constraints,
+        .constraint_count = 3,
+        .function = test_command,
+    };
+    assert(libcli_add_command(&header, &info));
+
+    // When, Then
+    char good[] = "name eth-0_a 00ff";
+    assert(libcli_run(&header, good, NULL) == cli_run_result_ok);
+
+    char too_long[] = "name abcdefghi 00ff";
+    assert(libcli_run(&header, too_long, NULL) == cli_run_result_failed_constraint);
+
+    char bad_character[] = "name Eth0 00ff";
+    assert(libcli_run(&header, bad_character, NULL) == cli_run_result_failed_constraint);
+
+    char short_blob[] = "name eth0 00";
+    assert(libcli_run(&header, short_blob, NULL) == cli_run_result_failed_constraint);
+
+    assert(command_calls == 1);
+}
+
+static void constraints_must_fit_their_arguments(void) {
+    // Given
+    enum { capacity = 4 };
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity);
+
+    const CliArgumentType arguments[] = { cli_argument_type_string };
+    const CliConstraint range = { .argument = 0, .kind = cli_constraint_range, .range = { 0, 1 } };
+    const CliConstraint past_end = {
+        .argument = 1,
+        .kind = cli_constraint_length,
+        .length = { 0, 1 },
+    };
+    const CliConstraint no_charset = { .argument = 0, .kind = cli_constraint_charset };
+
+    CliCommandInfo info = {
+        .name = "word",
+        .summary = "",
+        .argument_count = 1,
+        .arguments = arguments,
+        .constraint_count = 1,
+        .function = test_command,
+    };
+
+    // When, Then
+    info.constraints = &range;
+    assert(!libcli_add_command(&header, &info));
+
+    info.constraints = &past_end;
+    assert(!libcli_add_command(&header, &info));
+
+    info.constraints = &no_charset;
+    assert(!libcli_add_command(&header, &info));
+
+    info.constraints = NULL;
+    info.constraint_count = 0;
+    assert(libcli_add_command(&header, &info));
+}
+
+static void constraints_are_described(void) {
+    // Given
+    enum { capacity = 2 };
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity);
+
+    // When
+    for (size_t i = 0; i < 3; i++) {
+        CliArgumentType type = gain_arguments[gain_constraints[i].argument];
+        libcli_write_constraint(&header, &gain_constraints[i], type);
+        libcli_write(&header, "\n");
+    }
+
+    // Then
+    const char* expected = "between 0 and 40\nvalid\none of: auto, manual\n";
+    assert(strcmp(expected, writeback_buffer) == 0);
+}
+
+static void fixed_ranges_are_described_as_decimals(void) {
+    // Given
+    enum { capacity = 2 };
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity);
+
+    const int32_t one = 1 << cli_fixed_fraction_bits;
+    const CliConstraint ranges[] = {
+        { .argument = 0, .kind = cli_constraint_range, .range = { one, one * 10 } },
+        { .argument = 0, .kind = cli_constraint_range, .range = { -(one * 3) / 2, (one * 9) / 4 } },
+        { .argument = 0, .kind = cli_constraint_range, .range = { 0, (one + 5) / 10 } },
+    };
+
+    // When
+    for (size_t i = 0; i < 3; i++) {
+        libcli_write_constraint(&header, &ranges[i], cli_argument_type_fixed);
+        libcli_write(&header, "\n");
+    }
+
+    // Then (bounds are written with as many places as they need to convert back exactly)
+    const char* expected = "between 1 and 10\nbetween -1.5 and 2.25\nbetween 0 and 0.1\n";
+    assert(strcmp(expected, writeback_buffer) == 0);
+}
+
+static void macros_are_checked_when_compiled(void) {
+    // Given
+    enum { capacity = 2 };
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity);
+    assert(add_gain_command(&header));
+
+    uint8_t macro[64];
+
+    // When
+    char bad_script[] = "set-gain 4 auto\nset-gain 41 auto";
+    CliCompileResult compiled = libcli_compile(&header, bad_script, macro, sizeof(macro));
+
+    // Then
+    assert(compiled.status == cli_run_result_failed_constraint);
+
+    // When
+    char script[] = "set-gain 4 auto";
+    compiled = libcli_compile(&header, script, macro, sizeof(macro));
+
+    // Then
+    assert(compiled.status == cli_run_result_ok);
+    assert(libcli_replay(&header, macro, compiled.size, NULL) == cli_run_result_ok);
+    assert(command_calls == 1);
+}
+
+static void macros_are_rejected_once_constraints_change(void) {
+    // Given
+    enum { capacity = 2 };
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity);
+    CliCommandInfo info = {
+        .name = "set-gain",
+        .summary = "sets the amplifier gain",
+        .argument_count = 2,
+        .arguments = gain_arguments,
+        .function = test_command,
+    };
+    assert(libcli_add_command(&header, &info));
+
+    uint8_t macro[64];
+    char script[] = "set-gain 41 auto";
+    CliCompileResult compiled = libcli_compile(&header, script, macro, sizeof(macro));
+    assert(compiled.status == cli_run_result_ok);
+
+    // When (the same command is added again, with constraints its recorded values fail)
+    assert(libcli_remove(&header, "set-gain"));
+    assert(add_gain_command(&header));
+
+    // Then
+    assert(libcli_replay(&header, macro, compiled.size, NULL) == cli_run_result_bad_macro);
+    assert(command_calls == 0);
+}
+
+// Test runner
+
+static void cleanup(void) {
+    memset(writeback_buffer, 0, sizeof(writeback_buffer));
+    memset(last_arguments, 0, sizeof(last_arguments));
+    command_calls = 0;
+}
+
+int main(void) {
+    typedef void (*Test)(void);
+
+    const Test tests[] = {
+        arguments_within_constraints_run,
+        failed_constraints_are_reported,
+        failed_constraints_stop_the_whole_pipeline,
+        lengths_and_charsets_are_checked,
+        constraints_must_fit_their_arguments,
+        constraints_are_described,
+        fixed_ranges_are_described_as_decimals,
+        macros_are_checked_when_compiled,
+        macros_are_rejected_once_constraints_change,
+    };
+
+    const size_t test_count = sizeof(tests) / sizeof(Test);
+    for (size_t i = 0; i < test_count; i++) {
+        Test test = tests[i];
+        test();
+        cleanup();
+    }
+
+    printf("All tests (%zu) passed.\n", test_count);
+}
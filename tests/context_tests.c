@@ -0,0 +1,437 @@
+#include "cli_context.h"
+#include "cli_constraints.h"
+#include "cli_options.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+// Mocks & utility
+
+static char writeback_buffer[1024] = {0};
+static const char* last_command = NULL;
+
+static void writeback(const char* string, void* userdata) {
+    (void)userdata;
+    strncat(writeback_buffer, string, sizeof(writeback_buffer) - strlen(writeback_buffer) - 1);
+}
+
+static CliHeader new_cli(CliCommand* commands, size_t capacity, CliContextStack* contexts) {
+    CliNewInfo info = {
+        .commands = commands,
+        .commands_size = capacity,
+        .writeback = writeback,
+        .contexts = contexts,
+    };
+    return libcli_new(&info);
+}
+
+static CliContext config_context;
+static CliContext interface_context;
+
+static void show_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* data
+) {
+    (void)header;
+    (void)argc;
+    (void)argv;
+    (void)data;
+    last_command = "global show";
+}
+
+static void config_show_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* data
+) {
+    (void)header;
+    (void)argc;
+    (void)argv;
+    (void)data;
+    last_command = "config show";
+}
+
+static void configure_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* data
+) {
+    (void)argc;
+    (void)argv;
+    (void)data;
+    libcli_enter_context(header, &config_context, NULL);
+}
+
+static void interface_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* data
+) {
+    (void)argc;
+    (void)data;
+    libcli_enter_context(header, &interface_context, (void*)argv[0].string);
+}
+
+static void mtu_command(const CliHeader* header, size_t argc, const CliArgument* argv, void* data) {
+    (void)argc;
+    (void)argv;
+    (void)data;
+    last_command = (const char*)libcli_context_data(header);
+}
+
+static int last_mtu = 0;
+static bool last_verbose = false;
+
+static void set_mtu_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* data
+) {
+    (void)argc;
+    (void)data;
+    last_mtu = argv[0].integer;
+    last_verbose = libcli_option_present(libcli_options(header), 0);
+}
+
+static void exit_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* data
+) {
+    (void)argc;
+    (void)argv;
+    (void)data;
+    libcli_exit_context(header);
+}
+
+static const CliArgumentType string_argument[] = { cli_argument_type_string };
+static const CliArgumentType int_argument[] = { cli_argument_type_int };
+
+// Add a global `configure` and `show`; `config` with `interface`, `show` and `exit`; and
+// `interface` with `mtu` and `exit`.
+static void add_commands(
+    CliHeader* header,
+    CliCommand* config_commands,
+    CliCommand* interface_commands
+) {
+    config_context = libcli_context_new("config", config_commands, 3);
+    interface_context = libcli_context_new("config-if", interface_commands, 2);
+
+    assert(libcli_add(header, "configure", "enter configuration mode", 0, NULL, configure_command));
+    assert(libcli_add(header, "show", "show the running state", 0, NULL, show_command));
+
+    assert(libcli_context_add(
+        header, &config_context, "interface", "configure an interface", 1, string_argument,
+        interface_command
+    ));
+    assert(libcli_context_add(
+        header, &config_context, "show", "show the pending configuration", 0, NULL,
+        config_show_command
+    ));
+    assert(libcli_context_add(
+        header, &config_context, "exit", "leave configuration mode", 0, NULL, exit_command
+    ));
+
+    assert(libcli_context_add(
+        header, &interface_context, "mtu", "set the interface mtu", 1, int_argument, mtu_command
+    ));
+    assert(libcli_context_add(
+        header, &interface_context, "exit", "leave interface mode", 0, NULL, exit_command
+    ));
+}
+
+// Tests
+
+static void context_commands_run_only_once_entered(void) {
+    // Given
+    enum { capacity = 4 };
+    CliCommand commands[capacity];
+    CliCommand config_commands[3];
+    CliCommand interface_commands[2];
+    CliContextStack contexts = libcli_context_stack_new();
+    CliHeader header = new_cli(commands, capacity, &contexts);
+    add_commands(&header, config_commands, interface_commands);
+
+    // When
+    char mtu[] = "mtu 1500";
+    CliRunResult result = libcli_run(&header, mtu, NULL);
+
+    // Then
+    assert(result == cli_run_result_unknown);
+    assert(libcli_context_prompt(&header) == NULL);
+
+    // When
+    char configure[] = "configure";
+    char interface[] = "interface eth0";
+    char mtu2[] = "mtu 1500";
+    assert(libcli_run(&header, configure, NULL) == cli_run_result_ok);
+    assert(libcli_run(&header, interface, NULL) == cli_run_result_ok);
+    result = libcli_run(&header, mtu2, NULL);
+
+    // Then
+    assert(result == cli_run_result_ok);
+    assert(strcmp("eth0", last_command) == 0);
+    assert(strcmp("config-if", libcli_context_prompt(&header)) == 0);
+
+    // When
+    char bad_mtu[] = "mtu big";
+    result = libcli_run(&header, bad_mtu, NULL);
+
+    // Then
+    assert(result == cli_run_result_bad_argument);
+}
+
+static void context_commands_hide_global_commands(void) {
+    // Given
+    enum { capacity = 4 };
+    CliCommand commands[capacity];
+    CliCommand config_commands[3];
+    CliCommand interface_commands[2];
+    CliContextStack contexts = libcli_context_stack_new();
+    CliHeader header = new_cli(commands, capacity, &contexts);
+    add_commands(&header, config_commands, interface_commands);
+
+    // When
+    char show[] = "show";
+    libcli_run(&header, show, NULL);
+
+    // Then
+    assert(strcmp("global show", last_command) == 0);
+
+    // When (in an inner context without `show`, the outer context's `show` is found)
+    char configure[] = "configure";
+    char interface[] = "interface eth0";
+    char show2[] = "show";
+    libcli_run(&header, configure, NULL);
+    libcli_run(&header, interface, NULL);
+    libcli_run(&header, show2, NULL);
+
+    // Then
+    assert(strcmp("config show", last_command) == 0);
+
+    // When (leaving every context returns to the global commands)
+    char show3[] = "show";
+    libcli_exit_all_contexts(&header);
+    libcli_run(&header, show3, NULL);
+
+    // Then
+    assert(strcmp("global show", last_command) == 0);
+    assert(libcli_context_prompt(&header) == NULL);
+}
+
+static void exit_leaves_the_innermost_context(void) {
+    // Given
+    enum { capacity = 4 };
+    CliCommand commands[capacity];
+    CliCommand config_commands[3];
+    CliCommand interface_commands[2];
+    CliContextStack contexts = libcli_context_stack_new();
+    CliHeader header = new_cli(commands, capacity, &contexts);
+    add_commands(&header, config_commands, interface_commands);
+
+    char configure[] = "configure";
+    char interface[] = "interface eth0";
+    libcli_run(&header, configure, NULL);
+    libcli_run(&header, interface, NULL);
+
+    // When
+    char exit[] = "exit";
+    libcli_run(&header, exit, NULL);
+
+    // Then
+    assert(strcmp("config", libcli_context_prompt(&header)) == 0);
+    assert(libcli_context_data(&header) == NULL);
+
+    // When
+    char exit2[] = "exit";
+    char exit3[] = "exit";
+    libcli_run(&header, exit2, NULL);
+    CliRunResult result = libcli_run(&header, exit3, NULL);
+
+    // Then
+    assert(result == cli_run_result_unknown);
+    assert(libcli_context_prompt(&header) == NULL);
+    assert(!libcli_exit_context(&header));
+}
+
+static void context_stack_has_a_limited_depth(void) {
+    // Given
+    enum { capacity = 2 };
+    CliCommand commands[capacity];
+    CliCommand context_commands[1];
+    CliContextStack contexts = libcli_context_stack_new();
+    CliHeader header = new_cli(commands, capacity, &contexts);
+    CliContext context = libcli_context_new("nested", context_commands, 1);
+
+    // When
+    for (size_t i = 0; i < cli_max_context_depth; i++) {
+        assert(libcli_enter_context(&header, &context, NULL));
+    }
+
+    // Then
+    assert(!libcli_enter_context(&header, &context, NULL));
+
+    // When (without a context stack)
+    CliHeader stackless = new_cli(commands, capacity, NULL);
+
+    // Then
+    assert(!libcli_enter_context(&stackless, &context, NULL));
+    assert(libcli_context_prompt(&stackless) == NULL);
+}
+
+static void context_add_rejects_bad_commands(void) {
+    // Given
+    enum { capacity = 2 };
+    CliCommand commands[capacity];
+    CliCommand context_commands[2];
+    CliHeader header = new_cli(commands, capacity, NULL);
+    CliContext context = libcli_context_new("config", context_commands, 2);
+    const CliArgumentType float_argument[] = { cli_argument_type_float };
+
+    // When, Then
+    assert(libcli_context_add(&header, &context, "show", "", 0, NULL, show_command));
+    assert(!libcli_context_add(&header, &context, "show", "", 0, NULL, show_command));
+    assert(!libcli_context_add(&header, &context, "lazy", "", 0, NULL, NULL));
+    assert(!libcli_context_add(&header, &context, "gain", "", 1, float_argument, show_command));
+    assert(libcli_context_add(&header, &context, "exit", "", 0, NULL, exit_command));
+    assert(!libcli_context_add(&header, &context, "full", "", 0, NULL, show_command));
+}
+
+static void context_commands_take_options_and_constraints(void) {
+    // Given
+    enum { capacity = 2 };
+    CliCommand commands[capacity];
+    CliCommand context_commands[2];
+    CliContextStack contexts = libcli_context_stack_new();
+    CliHeader header = new_cli(commands, capacity, &contexts);
+    CliContext context = libcli_context_new("config-if", context_commands, 2);
+
+    static const CliOption verbose[] = { { .name = "verbose", .short_name = 'v' } };
+    CliOptionTable options;
+    assert(libcli_option_table_new(&options, verbose, 1));
+    static const CliConstraint mtu_range = {
+        .argument = 0,
+        .kind = cli_constraint_range,
+        .range = { 68, 9000 },
+    };
+
+    CliCommandInfo info = {
+        .name = "mtu",
+        .summary = "sets the MTU",
+        .argument_count = 1,
+        .arguments = int_argument,
+        .options = &options,
+        .constraints = &mtu_range,
+        .constraint_count = 1,
+        .function = set_mtu_command,
+    };
+
+    // When
+    bool added = libcli_context_add_command(&header, &context, &info);
+    libcli_enter_context(&header, &context, NULL);
+
+    // Then
+    assert(added);
+    char set[] = "mtu -v 1500";
+    assert(libcli_run(&header, set, NULL) == cli_run_result_ok);
+    assert((last_mtu == 1500) && last_verbose);
+    char too_small[] = "mtu 20";
+    assert(libcli_run(&header, too_small, NULL) == cli_run_result_failed_constraint);
+    assert(last_mtu == 1500);
+
+    char help[] = "help mtu";
+    assert(libcli_run(&header, help, NULL) == cli_run_result_ok);
+    assert(strcmp("mtu <int> [-v|--verbose]\n    sets the MTU\n", writeback_buffer) == 0);
+
+    // When, Then (a constraint must fit its argument)
+    info.name = "name";
+    info.arguments = string_argument;
+    assert(!libcli_context_add_command(&header, &context, &info));
+}
+
+static void help_covers_the_context_chain(void) {
+    // Given
+    enum { capacity = 4 };
+    CliCommand commands[capacity];
+    CliCommand config_commands[3];
+    CliCommand interface_commands[2];
+    CliContextStack contexts = libcli_context_stack_new();
+    CliHeader header = new_cli(commands, capacity, &contexts);
+    add_commands(&header, config_commands, interface_commands);
+
+    char configure[] = "configure";
+    libcli_run(&header, configure, NULL);
+
+    // When
+    char help[] = "help";
+    CliRunResult result = libcli_run(&header, help, NULL);
+
+    // Then
+    const char* expected = "list of commands:\n"
+        "    exit         leave configuration mode\n"
+        "    interface    configure an interface\n"
+        "    show         show the pending configuration\n"
+        "    configure    enter configuration mode\n"
+        "    help         displays information about commands\n";
+    assert(result == cli_run_result_ok);
+    assert(strcmp(expected, writeback_buffer) == 0);
+
+    // When
+    char topic[] = "help interface";
+    writeback_buffer[0] = '\0';
+    result = libcli_run(&header, topic, NULL);
+
+    // Then
+    assert(result == cli_run_result_ok);
+    assert(strcmp("interface <string>\n    configure an interface\n", writeback_buffer) == 0);
+
+    // When
+    char search[] = "help -s show";
+    writeback_buffer[0] = '\0';
+    result = libcli_run(&header, search, NULL);
+
+    // Then
+    const char* expected_search = "commands matching show:\n"
+        "    show         show the pending configuration\n";
+    assert(result == cli_run_result_ok);
+    assert(strcmp(expected_search, writeback_buffer) == 0);
+}
+
+// Test runner
+
+static void cleanup(void) {
+    memset(writeback_buffer, 0, sizeof(writeback_buffer));
+    last_command = NULL;
+    last_mtu = 0;
+    last_verbose = false;
+}
+
+int main(void) {
+    typedef void (*Test)(void);
+
+    const Test tests[] = {
+        context_commands_run_only_once_entered,
+        context_commands_hide_global_commands,
+        exit_leaves_the_innermost_context,
+        context_stack_has_a_limited_depth,
+        context_add_rejects_bad_commands,
+        context_commands_take_options_and_constraints,
+        help_covers_the_context_chain,
+    };
+
+    const size_t test_count = sizeof(tests) / sizeof(Test);
+    for (size_t i = 0; i < test_count; i++) {
+        Test test = tests[i];
+        test();
+        cleanup();
+    }
+
+    printf("All tests (%zu) passed.\n", test_count);
+}
@@ -0,0 +1,174 @@
+#include "cli_format.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+// Mocks & utility
+
+static char writeback_buffer[1024] = {0};
+static size_t writeback_count = 0;
+
+static void writeback(const char* string, void* userdata) {
+    (void)userdata;
+    strncat(writeback_buffer, string, sizeof(writeback_buffer) - strlen(writeback_buffer) - 1);
+    writeback_count += 1;
+}
+
+static CliHeader new_cli(CliCommand* commands, size_t capacity) {
+    CliNewInfo info = {
+        .commands = commands,
+        .commands_size = capacity,
+        .writeback = writeback,
+    };
+    return libcli_new(&info);
+}
+
+// Check that `libcli_printf` output matches `snprintf` for the same arguments
+#define assert_printf_matches(header, ...) do { \
+        char expected[256]; \
+        snprintf(expected, sizeof(expected), __VA_ARGS__); \
+        writeback_buffer[0] = '\0'; \
+        libcli_printf(header, __VA_ARGS__); \
+        assert(strcmp(expected, writeback_buffer) == 0); \
+    } while (0)
+
+// Tests
+
+static void printf_matches_libc(void) {
+    // Given
+    enum { capacity = 1 };
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity);
+
+    // When, Then
+    assert_printf_matches(&header, "plain text\n");
+    assert_printf_matches(&header, "%d %i %u", 0, -2147483647 - 1, 4294967295u);
+    assert_printf_matches(&header, "%ld %lu %lld", -5L, 99999999UL, -123456789012345LL);
+    assert_printf_matches(&header, "%llu %zu", 18446744073709551615ULL, (size_t)12);
+    assert_printf_matches(&header, "%x %X %08x %lx", 0xdeadbeefu, 0xabcu, 0x1fu, 0UL);
+    assert_printf_matches(&header, "[%5d] [%-5d] [%05d] [%-3d]", 42, 42, -42, 7);
+    assert_printf_matches(&header, "[%s] [%8s] [%-8s] [%c] 100%%", "reg", "reg", "reg", 'x');
+    assert_printf_matches(&header, "%d%d%d%d%d", 1, 10, 100, 1000, 10000);
+}
+
+static void printf_writes_unsupported_conversions_as_is(void) {
+    // Given
+    enum { capacity = 1 };
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity);
+
+    // When
+    libcli_printf(&header, "%f %5q %d %", 3);
+
+    // Then
+    assert(strcmp("%f %5q 3 %", writeback_buffer) == 0);
+}
+
+static void null_characters_are_left_out(void) {
+    // Given
+    enum { capacity = 1 };
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity);
+
+    // When
+    libcli_printf(&header, "a%cbcdef [%2c]\n", 0, 0);
+
+    // Then (the rest of the output is still written)
+    assert(strcmp("abcdef [  ]\n", writeback_buffer) == 0);
+}
+
+static void long_output_is_written_in_pieces(void) {
+    // Given
+    enum { capacity = 1 };
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity);
+
+    char expected[512] = {0};
+    memset(expected, 'a', 300);
+
+    // When
+    libcli_printf(&header, "%s%d", expected, 12);
+
+    // Then
+    strcat(expected, "12");
+    assert(strcmp(expected, writeback_buffer) == 0);
+    assert(writeback_count == (302 + cli_format_buffer_size - 2) / (cli_format_buffer_size - 1));
+}
+
+static void can_put_numbers(void) {
+    // Given
+    enum { capacity = 1 };
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity);
+
+    // When
+    libcli_put_u32(&header, 4294967295u);
+    libcli_put_u32(&header, 0);
+    libcli_put_i32(&header, -2147483647 - 1);
+    libcli_put_hex(&header, 0x1f, 4);
+    libcli_put_hex(&header, 0xdeadbeef, 2);
+
+    // Then
+    assert(strcmp("42949672950-2147483648001fef", writeback_buffer) == 0);
+}
+
+static void can_put_fixed_point(void) {
+    // Given
+    enum { capacity = 1 };
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity);
+    const int32_t one = (int32_t)1 << cli_fixed_fraction_bits;
+
+    // When, Then
+    libcli_put_fixed(&header, -(one * 3) / 2, 2);
+    assert(strcmp("-1.50", writeback_buffer) == 0);
+
+    // When, Then (rounded, with halves away from zero)
+    writeback_buffer[0] = '\0';
+    libcli_put_fixed(&header, (one * 5) / 8, 2);
+    libcli_put_fixed(&header, 0, 3);
+    assert(strcmp("0.630.000", writeback_buffer) == 0);
+
+    // When, Then (rounding carries into the integer part, and negative zero has no sign)
+    writeback_buffer[0] = '\0';
+    libcli_put_fixed(&header, one - 1, 1);
+    libcli_put_fixed(&header, -1, 2);
+    libcli_put_fixed(&header, one * 7, 0);
+    assert(strcmp("1.00.007", writeback_buffer) == 0);
+
+    // When, Then (the most negative value)
+    char expected[32];
+    snprintf(expected, sizeof(expected), "-%lld", (1LL << 31) >> cli_fixed_fraction_bits);
+    writeback_buffer[0] = '\0';
+    libcli_put_fixed(&header, -2147483647 - 1, 0);
+    assert(strcmp(expected, writeback_buffer) == 0);
+}
+
+// Test runner
+
+static void cleanup(void) {
+    memset(writeback_buffer, 0, sizeof(writeback_buffer));
+    writeback_count = 0;
+}
+
+int main(void) {
+    typedef void (*Test)(void);
+
+    const Test tests[] = {
+        printf_matches_libc,
+        printf_writes_unsupported_conversions_as_is,
+        null_characters_are_left_out,
+        long_output_is_written_in_pieces,
+        can_put_numbers,
+        can_put_fixed_point,
+    };
+
+    const size_t test_count = sizeof(tests) / sizeof(Test);
+    for (size_t i = 0; i < test_count; i++) {
+        Test test = tests[i];
+        test();
+        cleanup();
+    }
+
+    printf("All tests (%zu) passed.\n", test_count);
+}
@@ -0,0 +1,472 @@
+#include "cli_jobs.h"
+#include "cli_constraints.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+// Mocks & utility
+
+typedef struct Output {
+    char text[1024];
+} Output;
+
+typedef struct Mark {
+    int label;
+    uint32_t time;
+} Mark;
+
+static Output main_output;
+static Output session_output;
+static uint32_t fake_time = 0;
+static Mark marks[16];
+static size_t mark_count = 0;
+static CliJobs* running_jobs = NULL;
+
+static void writeback(const char* string, void* userdata) {
+    Output* output = (Output*)userdata;
+    strncat(output->text, string, sizeof(output->text) - strlen(output->text) - 1);
+}
+
+static uint32_t fake_clock(void) {
+    return fake_time;
+}
+
+// Records when it ran
+static void mark_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* data
+) {
+    (void)header;
+    (void)argc;
+    (void)data;
+
+    if (mark_count < (sizeof(marks) / sizeof(marks[0]))) {
+        marks[mark_count] = (Mark){ argv[0].integer, fake_time };
+        mark_count += 1;
+    }
+}
+
+// Writes its string, blob and array arguments
+static void show_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* data
+) {
+    (void)argc;
+    (void)data;
+
+    char line[128];
+    snprintf(line, sizeof(line), "%s %u:%02x %zu:%d,%d\n",
+        argv[0].string,
+        (unsigned)argv[1].blob.size,
+        argv[1].blob.data[0],
+        argv[2].array.count,
+        argv[2].array.integers[0],
+        argv[2].array.integers[argv[2].array.count - 1]);
+    libcli_write(header, line);
+}
+
+// Writes its array's count and last element, and the integer after it
+static void last_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* data
+) {
+    (void)argc;
+    (void)data;
+
+    char line[64];
+    snprintf(line, sizeof(line), "%zu:%d %d\n",
+        argv[0].array.count,
+        argv[0].array.integers[argv[0].array.count - 1],
+        argv[1].integer);
+    libcli_write(header, line);
+}
+
+// Writes its blob's size and last byte, and the integer after it
+static void tail_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* data
+) {
+    (void)argc;
+    (void)data;
+
+    char line[64];
+    snprintf(line, sizeof(line), "%u:%02x %d\n",
+        (unsigned)argv[0].blob.size,
+        argv[0].blob.data[argv[0].blob.size - 1],
+        argv[1].integer);
+    libcli_write(header, line);
+}
+
+// Cancels its own job
+static void once_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* data
+) {
+    (void)argc;
+    (void)data;
+
+    libcli_write(header, "once\n");
+    assert(libcli_jobs_cancel(running_jobs, (uint32_t)argv[0].integer));
+}
+
+static const CliArgumentType int_argument[] = { cli_argument_type_int };
+static const CliArgumentType show_arguments[] = {
+    cli_argument_type_string,
+    cli_argument_type_blob,
+    cli_argument_type_int_array,
+};
+static const CliArgumentType last_arguments[] = {
+    cli_argument_type_int_array,
+    cli_argument_type_int,
+};
+static const CliArgumentType tail_arguments[] = { cli_argument_type_blob, cli_argument_type_int };
+static const CliConstraint positive = {
+    .argument = 0,
+    .kind = cli_constraint_range,
+    .range = { 1, 100 },
+};
+
+static CliHeader new_cli(CliCommand* commands, size_t capacity, CliJobs* jobs, Output* output) {
+    static uint32_t array_buffer[16];
+    static char pipe_buffer[256];
+
+    CliNewInfo info = {
+        .commands = commands,
+        .commands_size = capacity,
+        .writeback = writeback,
+        .writeback_data = output,
+        .array_buffer = array_buffer,
+        .array_buffer_size = sizeof(array_buffer),
+        .pipe_buffer = pipe_buffer,
+        .pipe_buffer_size = sizeof(pipe_buffer),
+        .jobs = jobs,
+    };
+    CliHeader header = libcli_new(&info);
+
+    CliCommandInfo mark = {
+        .name = "mark",
+        .summary = "",
+        .argument_count = 1,
+        .arguments = int_argument,
+        .constraints = &positive,
+        .constraint_count = 1,
+        .function = mark_command,
+    };
+    assert(libcli_add_command(&header, &mark));
+    assert(libcli_add(&header, "show", "", 3, show_arguments, show_command));
+    assert(libcli_add(&header, "once", "", 1, int_argument, once_command));
+    assert(libcli_add(&header, "last", "", 2, last_arguments, last_command));
+    assert(libcli_add(&header, "tail", "", 2, tail_arguments, tail_command));
+    assert(libcli_add_filters(&header));
+    return header;
+}
+
+static CliRunResult run(const CliHeader* header, const char* text) {
+    char input[128];
+    strcpy(input, text);
+    return libcli_run(header, input, NULL);
+}
+
+static size_t advance_to(const CliHeader* header, CliJobs* jobs, uint32_t time) {
+    size_t runs = 0;
+
+    while (fake_time != time) {
+        fake_time += 1;
+        runs += libcli_jobs_service(header, jobs, NULL);
+    }
+
+    return runs;
+}
+
+// Tests
+
+static void jobs_run_at_their_period(void) {
+    // Given
+    enum { capacity = 16 };
+    CliCommand commands[capacity];
+    CliJob entries[4];
+    CliJobs jobs;
+    fake_time = 1000;
+    assert(libcli_jobs_init(&jobs, entries, 4, fake_clock, 1000));
+    CliHeader header = new_cli(commands, capacity, &jobs, &main_output);
+
+    // When
+    assert(run(&header, "every 10ms mark 1") == cli_run_result_ok);
+
+    // Then
+    assert(strcmp("job 1\n", main_output.text) == 0);
+    assert(advance_to(&header, &jobs, 1009) == 0);
+    assert(advance_to(&header, &jobs, 1030) == 3);
+    assert(mark_count == 3);
+    assert((marks[0].time == 1010) && (marks[1].time == 1020) && (marks[2].time == 1030));
+
+    CliJobStats stats;
+    assert(libcli_jobs_stats(&jobs, 1, &stats));
+    assert((stats.runs == 3) && (stats.missed == 0) && (stats.max_late == 0));
+}
+
+static void late_loops_skip_missed_runs(void) {
+    // Given
+    enum { capacity = 16 };
+    CliCommand commands[capacity];
+    CliJob entries[4];
+    CliJobs jobs;
+    fake_time = 0;
+    assert(libcli_jobs_init(&jobs, entries, 4, fake_clock, 1000));
+    CliHeader header = new_cli(commands, capacity, &jobs, &main_output);
+    run(&header, "every 10 mark 1");
+
+    // When (the loop only services the jobs after 35 ticks)
+    fake_time = 35;
+    size_t runs = libcli_jobs_service(&header, &jobs, NULL);
+
+    // Then (the job ran once, late, and keeps its phase)
+    assert(runs == 1);
+    CliJobStats stats;
+    assert(libcli_jobs_stats(&jobs, 1, &stats));
+    assert((stats.runs == 1) && (stats.missed == 2));
+    assert((stats.last_late == 25) && (stats.max_late == 25) && (stats.total_late == 25));
+
+    assert(advance_to(&header, &jobs, 39) == 0);
+    assert(advance_to(&header, &jobs, 40) == 1);
+    assert(libcli_jobs_stats(&jobs, 1, &stats));
+    assert((stats.runs == 2) && (stats.last_late == 0) && (stats.max_late == 25));
+}
+
+static void long_periods_cascade_through_the_wheel(void) {
+    // Given (a clock about to wrap)
+    enum { capacity = 16 };
+    CliCommand commands[capacity];
+    CliJob entries[4];
+    CliJobs jobs;
+    const uint32_t start = UINT32_MAX - 1000;
+    fake_time = start;
+    assert(libcli_jobs_init(&jobs, entries, 4, fake_clock, 1000));
+    CliHeader header = new_cli(commands, capacity, &jobs, &main_output);
+
+    // When
+    run(&header, "every 100 mark 1");
+    run(&header, "every 5000 mark 2");
+    run(&header, "every 300s mark 3");
+    run(&header, "every 63 mark 4");
+    advance_to(&header, &jobs, start + 300000);
+
+    // Then (every run was on time)
+    uint32_t next_due[5] = { 0, start + 100, start + 5000, start + 300000, start + 63 };
+    size_t runs[5] = { 0 };
+
+    for (size_t i = 0; i < 4; i++) {
+        uint32_t id = (uint32_t)(i + 1);
+        CliJobStats stats;
+        assert(libcli_jobs_stats(&jobs, id, &stats));
+        assert(stats.max_late == 0);
+        runs[id] = stats.runs;
+    }
+
+    assert((runs[1] == 3000) && (runs[2] == 60) && (runs[3] == 1) && (runs[4] == 4761));
+
+    for (size_t i = 0; i < mark_count; i++) {
+        int label = marks[i].label;
+        assert(marks[i].time == next_due[label]);
+        next_due[label] += (label == 1) ? 100 : (label == 2) ? 5000 : (label == 3) ? 300000 : 63;
+    }
+}
+
+static void watches_write_to_where_they_were_started(void) {
+    // Given (two headers sharing jobs, like the sessions of a server)
+    enum { capacity = 16 };
+    CliCommand main_commands[capacity];
+    CliCommand session_commands[capacity];
+    CliJob entries[4];
+    CliJobs jobs;
+    fake_time = 0;
+    assert(libcli_jobs_init(&jobs, entries, 4, fake_clock, 1000));
+    CliHeader header = new_cli(main_commands, capacity, &jobs, &main_output);
+    CliHeader session = new_cli(session_commands, capacity, &jobs, &session_output);
+
+    // When
+    assert(run(&session, "watch 10 show eth0 ff01 1,2,3") == cli_run_result_ok);
+    assert(run(&session, "every 20 show lo 0a 7") == cli_run_result_ok);
+    advance_to(&header, &jobs, 20);
+
+    // Then (arguments were converted once, and outlive the line they came from)
+    assert(strcmp("job 1\njob 2\neth0 2:ff 3:1,3\neth0 2:ff 3:1,3\n", session_output.text) == 0);
+    assert(strcmp("lo 1:0a 1:7,7\n", main_output.text) == 0);
+
+    // When
+    assert(libcli_jobs_cancel_watches(&jobs, &session_output) == 1);
+    advance_to(&header, &jobs, 40);
+
+    // Then
+    assert(strcmp("lo 1:0a 1:7,7\nlo 1:0a 1:7,7\n", main_output.text) == 0);
+}
+
+static void arguments_after_arrays_and_blobs_are_converted(void) {
+    // Given
+    enum { capacity = 16 };
+    CliCommand commands[capacity];
+    CliJob entries[4];
+    CliJobs jobs;
+    fake_time = 0;
+    assert(libcli_jobs_init(&jobs, entries, 4, fake_clock, 1000));
+    CliHeader header = new_cli(commands, capacity, &jobs, &main_output);
+
+    // When
+    assert(run(&header, "every 10 last 1,2,3 7") == cli_run_result_ok);
+    assert(run(&header, "every 15 tail 00ff 8") == cli_run_result_ok);
+    main_output.text[0] = '\0';
+    advance_to(&header, &jobs, 15);
+
+    // Then
+    assert(strcmp("3:3 7\n2:ff 8\n", main_output.text) == 0);
+
+    // When
+    main_output.text[0] = '\0';
+    run(&header, "jobs");
+
+    // Then (the words are listed as given, not as converted)
+    const char* expected =
+        "  id kind    period     runs missed     late      max  command\n"
+        "   1 every       10        1      0        0        0  last 1,2,3 7\n"
+        "   2 every       15        1      0        0        0  tail 00ff 8\n";
+    assert(strcmp(expected, main_output.text) == 0);
+}
+
+static void jobs_cannot_start_in_pipelines(void) {
+    // Given
+    enum { capacity = 16 };
+    CliCommand commands[capacity];
+    CliJob entries[4];
+    CliJobs jobs;
+    fake_time = 0;
+    assert(libcli_jobs_init(&jobs, entries, 4, fake_clock, 1000));
+    CliHeader header = new_cli(commands, capacity, &jobs, &main_output);
+
+    // When, Then (the pipeline's output is gone by the time the job runs)
+    assert(run(&header, "watch 10 mark 1 | count") == cli_run_result_bad_pipe);
+    assert(run(&header, "help | every 10 mark 1") == cli_run_result_bad_pipe);
+    assert(advance_to(&header, &jobs, 100) == 0);
+    assert(mark_count == 0);
+}
+
+static void bad_jobs_are_rejected(void) {
+    // Given
+    enum { capacity = 16 };
+    CliCommand commands[capacity];
+    CliJob entries[1];
+    CliJobs jobs;
+    fake_time = 0;
+    assert(libcli_jobs_init(&jobs, entries, 1, fake_clock, 100));
+    CliHeader header = new_cli(commands, capacity, &jobs, &main_output);
+
+    // When, Then
+    assert(run(&header, "every 10") == cli_run_result_bad_argc);
+    assert(run(&header, "every 0 mark 1") == cli_run_result_bad_argument);
+    assert(run(&header, "every 10us mark 1") == cli_run_result_bad_argument);
+    assert(run(&header, "every ms mark 1") == cli_run_result_bad_argument);
+    assert(run(&header, "every 200000s mark 1") == cli_run_result_bad_argument);
+    assert(run(&header, "every 10 missing") == cli_run_result_unknown);
+    assert(run(&header, "every 10 mark") == cli_run_result_bad_argc);
+    assert(run(&header, "every 10 watch 10 mark 1") == cli_run_result_bad_argc);
+    assert(run(&header, "every 10 mark x") == cli_run_result_bad_argument);
+    assert(run(&header, "every 10 mark 500") == cli_run_result_failed_constraint);
+    assert(strcmp("", main_output.text) == 0);
+
+    // When, Then (short periods round up to a tick, and the jobs are full)
+    assert(run(&header, "every 1ms mark 1") == cli_run_result_ok);
+    assert(run(&header, "every 1 mark 1") == cli_run_result_no_space);
+    assert(advance_to(&header, &jobs, 3) == 3);
+}
+
+static void jobs_are_listed_and_cancelled(void) {
+    // Given
+    enum { capacity = 16 };
+    CliCommand commands[capacity];
+    CliJob entries[4];
+    CliJobs jobs;
+    fake_time = 0;
+    running_jobs = &jobs;
+    assert(libcli_jobs_init(&jobs, entries, 4, fake_clock, 1000));
+    CliHeader header = new_cli(commands, capacity, &jobs, &main_output);
+    run(&header, "every 10 mark 1");
+    run(&header, "watch 1s mark  2");
+    run(&header, "every 5 once 3");
+    fake_time = 12;
+    libcli_jobs_service(&header, &jobs, NULL);
+
+    // When
+    main_output.text[0] = '\0';
+    run(&header, "jobs");
+
+    // Then (the job which cancelled itself is gone)
+    const char* expected =
+        "  id kind    period     runs missed     late      max  command\n"
+        "   1 every       10        1      0        2        2  mark 1\n"
+        "   2 watch     1000        0      0        0        0  mark 2\n";
+    assert(strcmp(expected, main_output.text) == 0);
+
+    // When
+    main_output.text[0] = '\0';
+    run(&header, "cancel 1");
+    run(&header, "cancel 1");
+    run(&header, "cancel 3");
+
+    // Then
+    assert(strcmp("no such job\nno such job\n", main_output.text) == 0);
+    assert(!libcli_jobs_stats(&jobs, 1, &(CliJobStats){ 0 }));
+    assert(advance_to(&header, &jobs, 1000) == 1);
+    assert(mark_count == 2);
+
+    // When, Then (help describes the built-in commands)
+    main_output.text[0] = '\0';
+    run(&header, "help every");
+    assert(strcmp(
+        "every <period> <command...>\n    runs a command periodically in the background\n",
+        main_output.text
+    ) == 0);
+}
+
+// Test runner
+
+static void cleanup(void) {
+    memset(&main_output, 0, sizeof(main_output));
+    memset(&session_output, 0, sizeof(session_output));
+    memset(marks, 0, sizeof(marks));
+    mark_count = 0;
+    fake_time = 0;
+    running_jobs = NULL;
+}
+
+int main(void) {
+    typedef void (*Test)(void);
+
+    const Test tests[] = {
+        jobs_run_at_their_period,
+        late_loops_skip_missed_runs,
+        long_periods_cascade_through_the_wheel,
+        watches_write_to_where_they_were_started,
+        arguments_after_arrays_and_blobs_are_converted,
+        jobs_cannot_start_in_pipelines,
+        bad_jobs_are_rejected,
+        jobs_are_listed_and_cancelled,
+    };
+
+    const size_t test_count = sizeof(tests) / sizeof(Test);
+    for (size_t i = 0; i < test_count; i++) {
+        Test test = tests[i];
+        test();
+        cleanup();
+    }
+
+    printf("All tests (%zu) passed.\n", test_count);
+}
@@ -0,0 +1,304 @@
+#include "cli_macro.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+// Mocks & utility
+
+static size_t gain_command_call_count = 0;
+static int gain_command_last_value = 0;
+static void* gain_command_last_userdata = NULL;
+
+static void gain_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* userdata
+) {
+    (void)header;
+
+    assert(argc == 1);
+    assert(argv[0].type == cli_argument_type_int);
+
+    gain_command_call_count += 1;
+    gain_command_last_value = argv[0].integer;
+    gain_command_last_userdata = userdata;
+}
+
+static char label_command_last_label[32] = {0};
+static float label_command_last_scale = 0.0f;
+
+static void label_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* userdata
+) {
+    (void)header;
+    (void)userdata;
+
+    assert(argc == 2);
+    assert(argv[0].type == cli_argument_type_string);
+    assert(argv[1].type == cli_argument_type_float);
+
+    strncpy(label_command_last_label, argv[0].string, sizeof(label_command_last_label) - 1);
+    label_command_last_scale = argv[1].float_;
+}
+
+static uint8_t load_command_last_data[8] = {0};
+static size_t load_command_last_size = 0;
+
+static void load_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* userdata
+) {
+    (void)header;
+    (void)userdata;
+
+    assert(argc == 1);
+    assert(argv[0].type == cli_argument_type_blob);
+    assert(argv[0].blob.size <= sizeof(load_command_last_data));
+
+    memcpy(load_command_last_data, argv[0].blob.data, argv[0].blob.size);
+    load_command_last_size = argv[0].blob.size;
+}
+
+static void discard_writeback(const char* string, void* userdata) {
+    (void)string;
+    (void)userdata;
+}
+
+static const CliArgumentType gain_args[] = { cli_argument_type_int };
+static const CliArgumentType label_args[] = { cli_argument_type_string, cli_argument_type_float };
+static const CliArgumentType load_args[] = { cli_argument_type_blob };
+
+static CliHeader new_cli(CliCommand* commands, size_t capacity) {
+    CliNewInfo info = {
+        .commands = commands,
+        .commands_size = capacity,
+        .writeback = discard_writeback,
+        .writeback_data = NULL,
+        .parse_float = libcli_parse_float,
+    };
+    return libcli_new(&info);
+}
+
+// Tests
+
+static void can_compile_and_replay(void) {
+    // Given
+    enum { capacity = 4 };
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity);
+    libcli_add(&header, "set-gain", "", 1, gain_args, gain_command);
+    libcli_add(&header, "label", "", 2, label_args, label_command);
+
+    char script[] = "set-gain 12\n"
+        "\n"
+        "label 'channel a' 0.25\n"
+        "set-gain -0x10\n";
+    uint8_t macro[128];
+
+    // When
+    CliCompileResult compiled = libcli_compile(&header, script, macro, sizeof(macro));
+
+    // Then
+    assert(compiled.status == cli_run_result_ok);
+    assert(compiled.size > cli_macro_header_size);
+    assert(gain_command_call_count == 0);
+
+    // When
+    memset(script, 0, sizeof(script));
+    int userdata = 42;
+    CliRunResult result = libcli_replay(&header, macro, compiled.size, &userdata);
+
+    // Then
+    assert(result == cli_run_result_ok);
+    assert(gain_command_call_count == 2);
+    assert(gain_command_last_value == -16);
+    assert(gain_command_last_userdata == &userdata);
+    assert(strcmp(label_command_last_label, "channel a") == 0);
+    assert(label_command_last_scale == 0.25f);
+
+    // When, Then
+    result = libcli_replay(&header, macro, compiled.size, NULL);
+    assert(result == cli_run_result_ok);
+    assert(gain_command_call_count == 4);
+}
+
+static void blobs_are_stored_decoded(void) {
+    // Given
+    enum { capacity = 2 };
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity);
+    libcli_add(&header, "load", "", 1, load_args, load_command);
+
+    char script[] = "load c0ffee\nload b64:AQI=\n";
+    uint8_t macro[64];
+
+    // When
+    CliCompileResult compiled = libcli_compile(&header, script, macro, sizeof(macro));
+    memset(script, 0, sizeof(script));
+    CliRunResult result = libcli_replay(&header, macro, compiled.size, NULL);
+
+    // Then
+    assert(compiled.status == cli_run_result_ok);
+    assert(result == cli_run_result_ok);
+    assert(load_command_last_size == 2);
+    assert((load_command_last_data[0] == 1) && (load_command_last_data[1] == 2));
+}
+
+static void stored_macros_replay_with_same_commands(void) {
+    // Given
+    enum { capacity = 4 };
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity);
+    libcli_add(&header, "set-gain", "", 1, gain_args, gain_command);
+    libcli_add(&header, "label", "", 2, label_args, label_command);
+
+    char script[] = "label x 1.5\nset-gain 7";
+    uint8_t macro[64];
+    CliCompileResult compiled = libcli_compile(&header, script, macro, sizeof(macro));
+    assert(compiled.status == cli_run_result_ok);
+
+    // And (the same commands registered in a different order, eg. after a reboot)
+    uint8_t stored[64];
+    memcpy(stored, macro, compiled.size);
+
+    CliCommand other_commands[capacity];
+    CliHeader other_header = new_cli(other_commands, capacity);
+    libcli_add(&other_header, "label", "", 2, label_args, label_command);
+    libcli_add(&other_header, "set-gain", "", 1, gain_args, gain_command);
+
+    // When
+    CliRunResult result = libcli_replay(&other_header, stored, compiled.size, NULL);
+
+    // Then
+    assert(result == cli_run_result_ok);
+    assert(gain_command_last_value == 7);
+    assert(strcmp(label_command_last_label, "x") == 0);
+    assert(label_command_last_scale == 1.5f);
+}
+
+static void rejects_macros_for_other_commands(void) {
+    // Given
+    enum { capacity = 4 };
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity);
+    libcli_add(&header, "set-gain", "", 1, gain_args, gain_command);
+
+    char script[] = "set-gain 1";
+    uint8_t macro[64];
+    CliCompileResult compiled = libcli_compile(&header, script, macro, sizeof(macro));
+    assert(compiled.status == cli_run_result_ok);
+
+    // When
+    libcli_add(&header, "label", "", 2, label_args, label_command);
+    CliRunResult result = libcli_replay(&header, macro, compiled.size, NULL);
+
+    // Then
+    assert(result == cli_run_result_bad_macro);
+    assert(gain_command_call_count == 0);
+}
+
+static void rejects_damaged_macros(void) {
+    // Given
+    enum { capacity = 4 };
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity);
+    libcli_add(&header, "label", "", 2, label_args, label_command);
+
+    char script[] = "label abc 1";
+    uint8_t macro[64];
+    CliCompileResult compiled = libcli_compile(&header, script, macro, sizeof(macro));
+    assert(compiled.status == cli_run_result_ok);
+
+    // When, Then
+    assert(libcli_replay(&header, macro, compiled.size - 1, NULL) == cli_run_result_bad_macro);
+    assert(libcli_replay(&header, macro, 4, NULL) == cli_run_result_bad_macro);
+
+    // When, Then (macros of the first version are not read)
+    assert(macro[3] == cli_macro_version);
+    macro[3] = 1;
+    assert(libcli_replay(&header, macro, compiled.size, NULL) == cli_run_result_bad_macro);
+
+    // When, Then
+    macro[3] = cli_macro_version;
+    macro[0] = 'X';
+    assert(libcli_replay(&header, macro, compiled.size, NULL) == cli_run_result_bad_macro);
+}
+
+static void compile_errors_report_line(void) {
+    // Given
+    enum { capacity = 4 };
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity);
+    libcli_add(&header, "set-gain", "", 1, gain_args, gain_command);
+    uint8_t macro[64];
+
+    // When, Then
+    char unknown[] = "set-gain 1\nset-gian 2\n";
+    CliCompileResult compiled = libcli_compile(&header, unknown, macro, sizeof(macro));
+    assert(compiled.status == cli_run_result_unknown);
+    assert(compiled.line == 1);
+
+    // When, Then
+    char bad_argument[] = "\n\nset-gain two";
+    compiled = libcli_compile(&header, bad_argument, macro, sizeof(macro));
+    assert(compiled.status == cli_run_result_bad_argument);
+    assert(compiled.line == 2);
+
+    // When, Then
+    char bad_argc[] = "set-gain";
+    compiled = libcli_compile(&header, bad_argc, macro, sizeof(macro));
+    assert(compiled.status == cli_run_result_bad_argc);
+
+    // When, Then
+    char pipeline[] = "help | help";
+    compiled = libcli_compile(&header, pipeline, macro, sizeof(macro));
+    assert(compiled.status == cli_run_result_bad_pipe);
+
+    // When, Then
+    char too_long[] = "set-gain 1\nset-gain 2\nset-gain 3";
+    compiled = libcli_compile(&header, too_long, macro, cli_macro_header_size + 10);
+    assert(compiled.status == cli_run_result_no_space);
+    assert(compiled.line == 1);
+
+    assert(gain_command_call_count == 0);
+}
+
+// Test runner
+
+static void cleanup(void) {
+    gain_command_call_count = 0;
+    gain_command_last_value = 0;
+    gain_command_last_userdata = NULL;
+    memset(label_command_last_label, 0, sizeof(label_command_last_label));
+    label_command_last_scale = 0.0f;
+    memset(load_command_last_data, 0, sizeof(load_command_last_data));
+    load_command_last_size = 0;
+}
+
+int main(void) {
+    typedef void (*Test)(void);
+
+    const Test tests[] = {
+        can_compile_and_replay,
+        blobs_are_stored_decoded,
+        stored_macros_replay_with_same_commands,
+        rejects_macros_for_other_commands,
+        rejects_damaged_macros,
+        compile_errors_report_line,
+    };
+
+    const size_t test_count = sizeof(tests) / sizeof(Test);
+    for (size_t i = 0; i < test_count; i++) {
+        Test test = tests[i];
+        test();
+        cleanup();
+    }
+
+    printf("All tests (%zu) passed.\n", test_count);
+}
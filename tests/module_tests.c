@@ -0,0 +1,243 @@
+#include "cli_module.h"
+#include "cli_shared.h"
+#include <assert.h>
+#include <dlfcn.h>
+#include <stdio.h>
+#include <string.h>
+
+// Mocks & utility
+
+static char writeback_buffer[1024] = {0};
+
+static void writeback(const char* string, void* userdata) {
+    (void)userdata;
+    strncat(writeback_buffer, string, sizeof(writeback_buffer) - strlen(writeback_buffer) - 1);
+}
+
+static CliHeader new_cli(CliCommand* commands, size_t capacity) {
+    CliNewInfo info = {
+        .commands = commands,
+        .commands_size = capacity,
+        .writeback = writeback,
+    };
+    return libcli_new(&info);
+}
+
+static bool test_module_is_loaded(void) {
+    void* handle = dlopen(TEST_MODULE_PATH, RTLD_NOW | RTLD_NOLOAD);
+
+    if (handle != NULL) {
+        dlclose(handle);
+    }
+
+    return handle != NULL;
+}
+
+static void write_manifest(char* manifest, size_t size) {
+    snprintf(
+        manifest,
+        size,
+        "# test commands\n"
+        "add\ti\t%s\ttest_module_add\tadds a number\n"
+        "\n"
+        "add-twice\ti\t%s\ttest_module_add_twice\tadds a number twice\n"
+        "missing-module\t-\t/nonexistent/module.so\tfunction\tis never found\n"
+        "missing-symbol\t-\t%s\tnot_a_function\tis never found either\n",
+        TEST_MODULE_PATH,
+        TEST_MODULE_PATH,
+        TEST_MODULE_PATH
+    );
+}
+
+// Tests
+
+static void help_does_not_load_modules(void) {
+    // Given
+    enum { capacity = 8 };
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity);
+    CliModuleCommand module_commands[capacity];
+    CliModules modules = libcli_modules_new(module_commands, capacity);
+    char manifest[1024];
+    write_manifest(manifest, sizeof(manifest));
+
+    // When
+    CliManifestResult loaded = libcli_load_manifest(&header, &modules, manifest);
+    char help[] = "help";
+    CliRunResult result = libcli_run(&header, help, NULL);
+
+    // Then
+    const char* expected = "list of commands:\n"
+        "    add               adds a number\n"
+        "    add-twice         adds a number twice\n"
+        "    help              displays information about commands\n"
+        "    missing-module    is never found\n"
+        "    missing-symbol    is never found either\n";
+
+    assert(loaded.status == cli_run_result_ok);
+    assert(result == cli_run_result_ok);
+    assert(strcmp(writeback_buffer, expected) == 0);
+    assert(!test_module_is_loaded());
+
+    // When, Then (arguments are checked before the module is loaded)
+    char bad_argument[] = "add one";
+    assert(libcli_run(&header, bad_argument, NULL) == cli_run_result_bad_argument);
+    assert(!test_module_is_loaded());
+
+    libcli_unload_modules(&header, &modules);
+}
+
+static void modules_load_on_first_use(void) {
+    // Given
+    enum { capacity = 8 };
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity);
+    CliModuleCommand module_commands[capacity];
+    CliModules modules = libcli_modules_new(module_commands, capacity);
+    char manifest[1024];
+    write_manifest(manifest, sizeof(manifest));
+    libcli_load_manifest(&header, &modules, manifest);
+    int total = 0;
+
+    // When
+    char add[] = "add 5";
+    CliRunResult result = libcli_run(&header, add, &total);
+
+    // Then
+    assert(result == cli_run_result_ok);
+    assert(total == 5);
+    assert(test_module_is_loaded());
+
+    // When
+    char add_again[] = "add 1";
+    char add_twice[] = "add-twice 10";
+    libcli_run(&header, add_again, &total);
+    result = libcli_run(&header, add_twice, &total);
+
+    // Then
+    assert(result == cli_run_result_ok);
+    assert(total == 26);
+
+    // When
+    libcli_unload_modules(&header, &modules);
+
+    // Then
+    assert(!test_module_is_loaded());
+
+    // When, Then (the next run loads the module again)
+    char add_after_unload[] = "add 4";
+    assert(libcli_run(&header, add_after_unload, &total) == cli_run_result_ok);
+    assert(total == 30);
+    assert(test_module_is_loaded());
+
+    libcli_unload_modules(&header, &modules);
+    assert(!test_module_is_loaded());
+}
+
+static void missing_modules_are_reported(void) {
+    // Given
+    enum { capacity = 8 };
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity);
+    CliModuleCommand module_commands[capacity];
+    CliModules modules = libcli_modules_new(module_commands, capacity);
+    char manifest[1024];
+    write_manifest(manifest, sizeof(manifest));
+    libcli_load_manifest(&header, &modules, manifest);
+
+    // When, Then
+    char missing_module[] = "missing-module";
+    assert(libcli_run(&header, missing_module, NULL) == cli_run_result_bad_module);
+
+    // When, Then (a failed binding is retried on the next run)
+    char missing_symbol[] = "missing-symbol";
+    assert(libcli_run(&header, missing_symbol, NULL) == cli_run_result_bad_module);
+    char missing_symbol_again[] = "missing-symbol";
+    assert(libcli_run(&header, missing_symbol_again, NULL) == cli_run_result_bad_module);
+
+    libcli_unload_modules(&header, &modules);
+}
+
+static void bad_manifests_report_line(void) {
+    // Given
+    enum { capacity = 4 };
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity);
+    CliModuleCommand module_commands[capacity];
+    CliModules modules = libcli_modules_new(module_commands, capacity);
+
+    // When, Then
+    char missing_field[] = "a\t-\tmodule.so\tsymbol\tsummary\nb\t-\tmodule.so\tsymbol\n";
+    CliManifestResult loaded = libcli_load_manifest(&header, &modules, missing_field);
+    assert(loaded.status == cli_run_result_bad_module);
+    assert(loaded.line == 1);
+
+    // When, Then
+    char bad_type[] = "c\tix\tmodule.so\tsymbol\tsummary";
+    loaded = libcli_load_manifest(&header, &modules, bad_type);
+    assert(loaded.status == cli_run_result_bad_module);
+
+    // When, Then
+    char duplicate[] = "a\t-\tmodule.so\tsymbol\tsummary";
+    loaded = libcli_load_manifest(&header, &modules, duplicate);
+    assert(loaded.status == cli_run_result_bad_module);
+
+    // When, Then
+    char too_many[] = "d\t-\tm.so\ts\t\ne\t-\tm.so\ts\t\nf\t-\tm.so\ts\t\n";
+    loaded = libcli_load_manifest(&header, &modules, too_many);
+    assert(loaded.status == cli_run_result_no_space);
+    assert(loaded.line == 2);
+}
+
+static void modules_cannot_be_used_with_shared_commands(void) {
+    // Given
+    enum { capacity = 8 };
+    CliCommand commands[capacity];
+    CliCommand spare_commands[capacity];
+    CliSharedCommands shared;
+    CliModuleCommand module_commands[capacity];
+    CliModules modules = libcli_modules_new(module_commands, capacity);
+    char manifest[1024];
+    write_manifest(manifest, sizeof(manifest));
+
+    // When, Then (runs on any thread would open modules and bind commands)
+    CliHeader loaded_header = new_cli(commands, capacity);
+    CliManifestResult loaded = libcli_load_manifest(&loaded_header, &modules, manifest);
+    assert(loaded.status == cli_run_result_ok);
+    assert(!libcli_share_commands(&loaded_header, &shared, spare_commands, NULL));
+
+    // When, Then
+    CliHeader shared_header = new_cli(commands, capacity);
+    assert(libcli_share_commands(&shared_header, &shared, spare_commands, NULL));
+    CliModules more_modules = libcli_modules_new(module_commands, capacity);
+    write_manifest(manifest, sizeof(manifest));
+    loaded = libcli_load_manifest(&shared_header, &more_modules, manifest);
+    assert(loaded.status == cli_run_result_bad_module);
+}
+
+// Test runner
+
+static void cleanup(void) {
+    memset(writeback_buffer, 0, sizeof(writeback_buffer));
+}
+
+int main(void) {
+    typedef void (*Test)(void);
+
+    const Test tests[] = {
+        help_does_not_load_modules,
+        modules_load_on_first_use,
+        missing_modules_are_reported,
+        bad_manifests_report_line,
+        modules_cannot_be_used_with_shared_commands,
+    };
+
+    const size_t test_count = sizeof(tests) / sizeof(Test);
+    for (size_t i = 0; i < test_count; i++) {
+        Test test = tests[i];
+        test();
+        cleanup();
+    }
+
+    printf("All tests (%zu) passed.\n", test_count);
+}
@@ -0,0 +1,334 @@
+#include "cli_macro.h"
+#include "cli_options.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+// Mocks & utility
+
+static char writeback_buffer[1024] = {0};
+
+static size_t last_argc = 0;
+static CliArgument last_argv[cli_max_argument_count];
+static CliOptions last_options;
+static bool had_options = false;
+
+static void writeback(const char* string, void* userdata) {
+    (void)userdata;
+    strncat(writeback_buffer, string, sizeof(writeback_buffer) - strlen(writeback_buffer) - 1);
+}
+
+static void record_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* userdata
+) {
+    (void)userdata;
+
+    const CliOptions* options = libcli_options(header);
+    had_options = options != NULL;
+
+    if (options != NULL) {
+        last_options = *options;
+    }
+
+    last_argc = argc;
+    memcpy(last_argv, argv, sizeof(CliArgument) * argc);
+}
+
+static CliHeader new_cli(CliCommand* commands, size_t capacity) {
+    CliNewInfo info = {
+        .commands = commands,
+        .commands_size = capacity,
+        .writeback = writeback,
+        .pipe_buffer = NULL,
+        .pipe_buffer_size = 0,
+    };
+    return libcli_new(&info);
+}
+
+enum {
+    option_verbose,
+    option_count,
+    option_name,
+};
+
+static const CliOption dump_options[] = {
+    [option_verbose] = { .name = "verbose", .short_name = 'v', .takes_value = false },
+    [option_count] = {
+        .name = "count",
+        .short_name = 'c',
+        .takes_value = true,
+        .type = cli_argument_type_int,
+        .default_value.integer = 1,
+    },
+    [option_name] = {
+        .name = "name",
+        .takes_value = true,
+        .type = cli_argument_type_string,
+        .default_value.string = "all",
+    },
+};
+
+static CliOptionTable dump_table;
+
+// Add `dump <int>` with the options above, and `plain <string>` without options
+static void add_commands(CliHeader* header) {
+    bool created = libcli_option_table_new(&dump_table, dump_options, 3);
+    assert(created);
+
+    const CliArgumentType dump_arguments[] = { cli_argument_type_int };
+    const CliArgumentType plain_arguments[] = { cli_argument_type_string };
+
+    assert(libcli_add_with_options(
+        header, "dump", "dumps registers", 1, dump_arguments, &dump_table, record_command
+    ));
+    assert(libcli_add(header, "plain", "takes no options", 1, plain_arguments, record_command));
+}
+
+// Tests
+
+static void options_take_their_defaults(void) {
+    // Given
+    enum { capacity = 3 };
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity);
+    add_commands(&header);
+
+    // When
+    char input[] = "dump 7";
+    CliRunResult result = libcli_run(&header, input, NULL);
+
+    // Then
+    assert(result == cli_run_result_ok);
+    assert(had_options);
+    assert(last_options.present == 0);
+    assert(last_options.values[option_verbose].integer == 0);
+    assert(last_options.values[option_count].type == cli_argument_type_int);
+    assert(last_options.values[option_count].integer == 1);
+    assert(strcmp("all", last_options.values[option_name].string) == 0);
+    assert((last_argc == 1) && (last_argv[0].integer == 7));
+}
+
+static void long_and_short_options_are_converted(void) {
+    // Given
+    enum { capacity = 3 };
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity);
+    add_commands(&header);
+
+    // When
+    char input[] = "dump --count=5 12 -v --name uart";
+    CliRunResult result = libcli_run(&header, input, NULL);
+
+    // Then
+    assert(result == cli_run_result_ok);
+    assert(libcli_option_present(&last_options, option_verbose));
+    assert(libcli_option_present(&last_options, option_count));
+    assert(libcli_option_present(&last_options, option_name));
+    assert(last_options.values[option_verbose].integer == 1);
+    assert(last_options.values[option_count].integer == 5);
+    assert(strcmp("uart", last_options.values[option_name].string) == 0);
+    assert((last_argc == 1) && (last_argv[0].integer == 12));
+
+    // When
+    char input2[] = "dump -c 0x10 -3";
+    result = libcli_run(&header, input2, NULL);
+
+    // Then (negative numbers are positional)
+    assert(result == cli_run_result_ok);
+    assert(last_options.present == (1u << option_count));
+    assert(last_options.values[option_count].integer == 16);
+    assert((last_argc == 1) && (last_argv[0].integer == -3));
+}
+
+static void double_dash_ends_options(void) {
+    // Given
+    enum { capacity = 4 };
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity);
+    add_commands(&header);
+    const CliArgumentType string_arguments[] = { cli_argument_type_string };
+    CliOptionTable empty_table;
+    assert(libcli_option_table_new(&empty_table, NULL, 0));
+    assert(libcli_add_with_options(
+        &header, "find", "finds a word", 1, string_arguments, &empty_table, record_command
+    ));
+
+    // When
+    char input[] = "find -- --verbose";
+    CliRunResult result = libcli_run(&header, input, NULL);
+
+    // Then
+    assert(result == cli_run_result_ok);
+    assert((last_argc == 1) && (strcmp("--verbose", last_argv[0].string) == 0));
+
+    // When (commands without options take option-like words as positional arguments)
+    char input2[] = "plain --verbose";
+    result = libcli_run(&header, input2, NULL);
+
+    // Then
+    assert(result == cli_run_result_ok);
+    assert(!had_options);
+    assert((last_argc == 1) && (strcmp("--verbose", last_argv[0].string) == 0));
+}
+
+static void bad_options_are_reported(void) {
+    // Given
+    enum { capacity = 3 };
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity);
+    add_commands(&header);
+    CliRunError error;
+
+    // When, Then (unknown option)
+    char unknown[] = "dump 1 --verbosity";
+    assert(libcli_run_with_error(&header, unknown, NULL, &error) == cli_run_result_bad_option);
+    assert(error.argument == 1);
+
+    // When, Then (invalid value)
+    char invalid[] = "dump -c five 1";
+    assert(libcli_run_with_error(&header, invalid, NULL, &error) == cli_run_result_bad_option);
+    assert(error.argument == 1);
+
+    // When, Then (missing value)
+    char missing[] = "dump 1 --count";
+    assert(libcli_run_with_error(&header, missing, NULL, &error) == cli_run_result_bad_option);
+    assert(error.argument == 1);
+
+    // When, Then (a flag with a value)
+    char flag[] = "dump --verbose=1 1";
+    assert(libcli_run_with_error(&header, flag, NULL, &error) == cli_run_result_bad_option);
+    assert(error.argument == 0);
+
+    // When, Then (options do not count as positional arguments)
+    char argc[] = "dump -v";
+    assert(libcli_run(&header, argc, NULL) == cli_run_result_bad_argc);
+    assert(last_argc == 0);
+}
+
+static void option_tables_reject_bad_options(void) {
+    // Given
+    const CliOption duplicate_long[] = { { .name = "a" }, { .name = "b" }, { .name = "a" } };
+    const CliOption duplicate_short[] = {
+        { .name = "one", .short_name = 'x' },
+        { .name = "two", .short_name = 'x' },
+    };
+    const CliOption bad_short[] = { { .name = "one", .short_name = '1' } };
+    CliOption too_many[cli_max_option_count + 1];
+    CliOptionTable table;
+
+    // When, Then
+    assert(!libcli_option_table_new(&table, duplicate_long, 3));
+    assert(!libcli_option_table_new(&table, duplicate_short, 2));
+    assert(!libcli_option_table_new(&table, bad_short, 1));
+    assert(!libcli_option_table_new(&table, too_many, cli_max_option_count + 1));
+}
+
+static void options_work_in_pipelines_and_macros_use_defaults(void) {
+    // Given
+    enum { capacity = 3 };
+    CliCommand commands[capacity];
+    char pipe_buffer[64];
+    CliNewInfo info = {
+        .commands = commands,
+        .commands_size = capacity,
+        .writeback = writeback,
+        .pipe_buffer = pipe_buffer,
+        .pipe_buffer_size = sizeof(pipe_buffer),
+    };
+    CliHeader header = libcli_new(&info);
+    add_commands(&header);
+
+    // When
+    char input[] = "dump -v 1 | dump 2 -c 3";
+    CliRunResult result = libcli_run(&header, input, NULL);
+
+    // Then (the last stage only has its own options)
+    assert(result == cli_run_result_ok);
+    assert(last_options.present == (1u << option_count));
+    assert(last_options.values[option_count].integer == 3);
+    assert(last_argv[0].integer == 2);
+
+    // When
+    char script[] = "dump 4";
+    uint8_t macro[64];
+    CliCompileResult compiled = libcli_compile(&header, script, macro, sizeof(macro));
+    assert(compiled.status == cli_run_result_ok);
+    result = libcli_replay(&header, macro, compiled.size, NULL);
+
+    // Then
+    assert(result == cli_run_result_ok);
+    assert(had_options);
+    assert(last_options.present == 0);
+    assert(last_options.values[option_count].integer == 1);
+
+    // When (the command is added again with another default, which the macro would not replay)
+    CliOption changed_options[3];
+    memcpy(changed_options, dump_options, sizeof(changed_options));
+    changed_options[option_count].default_value.integer = 5;
+
+    CliOptionTable changed_table;
+    bool created = libcli_option_table_new(&changed_table, changed_options, 3);
+    assert(created);
+
+    const CliArgumentType dump_arguments[] = { cli_argument_type_int };
+    assert(libcli_remove(&header, "dump"));
+    assert(libcli_add_with_options(
+        &header, "dump", "dumps registers", 1, dump_arguments, &changed_table, record_command
+    ));
+
+    // Then
+    assert(libcli_replay(&header, macro, compiled.size, NULL) == cli_run_result_bad_macro);
+}
+
+static void help_shows_options(void) {
+    // Given
+    enum { capacity = 3 };
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity);
+    add_commands(&header);
+
+    // When
+    char input[] = "help dump";
+    CliRunResult result = libcli_run(&header, input, NULL);
+
+    // Then
+    const char* expected = "dump <int> [-v|--verbose] [-c|--count <int>] [--name <string>]\n"
+        "    dumps registers\n";
+    assert(result == cli_run_result_ok);
+    assert(strcmp(expected, writeback_buffer) == 0);
+}
+
+// Test runner
+
+static void cleanup(void) {
+    memset(writeback_buffer, 0, sizeof(writeback_buffer));
+    memset(&last_options, 0, sizeof(last_options));
+    last_argc = 0;
+    had_options = false;
+}
+
+int main(void) {
+    typedef void (*Test)(void);
+
+    const Test tests[] = {
+        options_take_their_defaults,
+        long_and_short_options_are_converted,
+        double_dash_ends_options,
+        bad_options_are_reported,
+        option_tables_reject_bad_options,
+        options_work_in_pipelines_and_macros_use_defaults,
+        help_shows_options,
+    };
+
+    const size_t test_count = sizeof(tests) / sizeof(Test);
+    for (size_t i = 0; i < test_count; i++) {
+        Test test = tests[i];
+        test();
+        cleanup();
+    }
+
+    printf("All tests (%zu) passed.\n", test_count);
+}
@@ -1,3 +1,5 @@
+#include "internal/blob.h"
+#include "internal/fixed.h"
 #include "internal/parse.h"
 #include <assert.h>
 #include <stdio.h>
@@ -109,6 +111,296 @@ static void unterminated_single_quote() {
     assert(result.status == parse_status_unterminated_single_quote);
 }
 
+static void pipes() {
+    const char* arguments[6] = {0};
+    char input[] = "a b|c | d";
+    ParseResult result = libcli_parse(input, arguments, 6);
+
+    assert(result.status == parse_status_success);
+    assert(result.argument_count == 6);
+    assert(strcmp("a", arguments[0]) == 0);
+    assert(strcmp("b", arguments[1]) == 0);
+    assert(arguments[2] == NULL);
+    assert(strcmp("c", arguments[3]) == 0);
+    assert(arguments[4] == NULL);
+    assert(strcmp("d", arguments[5]) == 0);
+}
+
+static void quoted_pipes() {
+    const char* arguments[3] = {0};
+    char input[] = "'a|b' \"|\" \\|";
+    ParseResult result = libcli_parse(input, arguments, 3);
+
+    assert(result.status == parse_status_success);
+    assert(result.argument_count == 3);
+    assert(strcmp("a|b", arguments[0]) == 0);
+    assert(strcmp("|", arguments[1]) == 0);
+    assert(strcmp("|", arguments[2]) == 0);
+}
+
+static void high_bytes_are_not_whitespace() {
+    const char* arguments[3] = {0};
+    char input[] = "a\xA0" "b \xC2\xA0";
+    ParseResult result = libcli_parse(input, arguments, 3);
+
+    assert(result.status == parse_status_success);
+    assert(result.argument_count == 2);
+    assert(strcmp("a\xA0" "b", arguments[0]) == 0);
+    assert(strcmp("\xC2\xA0", arguments[1]) == 0);
+}
+
+static void valid_utf8() {
+    const char* arguments[3] = {0};
+    char input[] = "caf\xC3\xA9 '\xE2\x82\xAC 5' \\\xF0\x9F\x98\x80";
+    ParseResult result = libcli_parse_utf8(input, arguments, 3);
+
+    assert(result.status == parse_status_success);
+    assert(result.argument_count == 3);
+    assert(strcmp("caf\xC3\xA9", arguments[0]) == 0);
+    assert(strcmp("\xE2\x82\xAC 5", arguments[1]) == 0);
+    assert(strcmp("\xF0\x9F\x98\x80", arguments[2]) == 0);
+}
+
+static void invalid_utf8() {
+    const char* arguments[4] = {0};
+
+    // Stray continuation byte
+    char stray[] = "abc \x80";
+    ParseResult result = libcli_parse_utf8(stray, arguments, 4);
+    assert(result.status == parse_status_invalid_utf8);
+    assert(result.error_offset == 4);
+
+    // Overlong encoding of '/'
+    char overlong[] = "ab\xC0\xAF";
+    result = libcli_parse_utf8(overlong, arguments, 4);
+    assert(result.status == parse_status_invalid_utf8);
+    assert(result.error_offset == 2);
+
+    // UTF-16 surrogate
+    char surrogate[] = "x \"\xED\xA0\x80\"";
+    result = libcli_parse_utf8(surrogate, arguments, 4);
+    assert(result.status == parse_status_invalid_utf8);
+    assert(result.error_offset == 3);
+
+    // Sequence cut short by the end of input
+    char truncated[] = "abcd \xE2\x82";
+    result = libcli_parse_utf8(truncated, arguments, 4);
+    assert(result.status == parse_status_invalid_utf8);
+    assert(result.error_offset == 5);
+
+    // Above U+10FFFF
+    char too_large[] = "\xF4\x90\x80\x80";
+    result = libcli_parse_utf8(too_large, arguments, 4);
+    assert(result.status == parse_status_invalid_utf8);
+    assert(result.error_offset == 0);
+
+    // Not checked without validation
+    char unchecked[] = "abc \x80";
+    result = libcli_parse(unchecked, arguments, 4);
+    assert(result.status == parse_status_success);
+    assert(result.argument_count == 2);
+}
+
+typedef struct TokenLog {
+    const char* tokens[8];
+    size_t count;
+    size_t stop_at;
+} TokenLog;
+
+static bool log_token(const char* token, void* data) {
+    TokenLog* log = (TokenLog*)data;
+    log->tokens[log->count] = token;
+    log->count += 1;
+    return log->count != log->stop_at;
+}
+
+static void token_callbacks() {
+    const char* arguments[8] = {0};
+    TokenLog log = { .count = 0, .stop_at = 0 };
+    char input[] = "one 't w o'|three | four";
+    ParseResult result = libcli_parse_tokens(input, arguments, 8, false, log_token, &log);
+
+    assert(result.status == parse_status_success);
+    assert(result.argument_count == 6);
+    assert(log.count == 6);
+    assert(strcmp("one", log.tokens[0]) == 0);
+    assert(strcmp("t w o", log.tokens[1]) == 0);
+    assert(log.tokens[2] == NULL);
+    assert(strcmp("three", log.tokens[3]) == 0);
+    assert(log.tokens[4] == NULL);
+    assert(strcmp("four", log.tokens[5]) == 0);
+}
+
+static void token_callbacks_can_stop() {
+    const char* arguments[8] = {0};
+
+    // Stopping skips the rest of the input, including its syntax errors
+    TokenLog log = { .count = 0, .stop_at = 2 };
+    char input[] = "one two three \"unterminated";
+    ParseResult result = libcli_parse_tokens(input, arguments, 8, false, log_token, &log);
+    assert(result.status == parse_status_stopped);
+    assert(log.count == 2);
+
+    // Pipes can stop the parse as well
+    TokenLog pipe_log = { .count = 0, .stop_at = 2 };
+    char pipe[] = "one | two";
+    result = libcli_parse_tokens(pipe, arguments, 8, false, log_token, &pipe_log);
+    assert(result.status == parse_status_stopped);
+    assert(pipe_log.tokens[1] == NULL);
+
+    // Invalid UTF-8 ends the token before it, and is reported even if the parse stopped there
+    TokenLog utf8_log = { .count = 0, .stop_at = 1 };
+    char invalid[] = "ab\x80";
+    result = libcli_parse_tokens(invalid, arguments, 8, true, log_token, &utf8_log);
+    assert(result.status == parse_status_invalid_utf8);
+    assert(result.error_offset == 2);
+    assert(utf8_log.count == 1);
+}
+
+static void hex_blobs() {
+    CliBlob blob;
+    size_t error_offset = 0;
+
+    // Long enough for a whole block and a tail, in mixed case
+    char input[] = "000102030405060708090A0b0C0d0E0f1011";
+    assert(libcli_decode_blob(input, &blob, &error_offset));
+    assert(blob.size == 18);
+    assert((const char*)blob.data == input);
+
+    for (size_t i = 0; i < blob.size; i++) {
+        assert(blob.data[i] == i);
+    }
+
+    char empty[] = "";
+    assert(libcli_decode_blob(empty, &blob, &error_offset));
+    assert(blob.size == 0);
+}
+
+static void base64_blobs() {
+    CliBlob blob;
+    size_t error_offset = 0;
+
+    char padded[] = "b64:AAECAwQFBgcICQoLDA0ODxAREhMUFRYXGBkaGxwdHh8g";
+    assert(libcli_decode_blob(padded, &blob, &error_offset));
+    assert(blob.size == 33);
+
+    for (size_t i = 0; i < blob.size; i++) {
+        assert(blob.data[i] == i);
+    }
+
+    char one_byte[] = "b64:/w==";
+    assert(libcli_decode_blob(one_byte, &blob, &error_offset));
+    assert((blob.size == 1) && (blob.data[0] == 0xFF));
+
+    char unpadded[] = "b64:+/8";
+    assert(libcli_decode_blob(unpadded, &blob, &error_offset));
+    assert((blob.size == 2) && (blob.data[0] == 0xFB) && (blob.data[1] == 0xFF));
+}
+
+static void invalid_blobs() {
+    CliBlob blob;
+    size_t error_offset = 0;
+
+    // In a whole block
+    char bad_block[] = "00112233445566778899aabbccddeeXf00";
+    assert(!libcli_decode_blob(bad_block, &blob, &error_offset));
+    assert(error_offset == 30);
+
+    // In the tail, as the second digit of a byte
+    char bad_tail[] = "00 1";
+    assert(!libcli_decode_blob(bad_tail, &blob, &error_offset));
+    assert(error_offset == 2);
+
+    char bad_base64[] = "b64:AAAAAAAAAAAAAAAAAA-A";
+    assert(!libcli_decode_blob(bad_base64, &blob, &error_offset));
+    assert(error_offset == 22);
+
+    char cut_short[] = "b64:AAAAA";
+    assert(!libcli_decode_blob(cut_short, &blob, &error_offset));
+    assert(error_offset == 9);
+
+    char bad_padding[] = "b64:AA=";
+    assert(!libcli_decode_blob(bad_padding, &blob, &error_offset));
+    assert(error_offset == 7);
+
+    char early_padding[] = "b64:A=AA";
+    assert(!libcli_decode_blob(early_padding, &blob, &error_offset));
+    assert(error_offset == 5);
+}
+
+static void fixed_point() {
+    int32_t value = 0;
+
+    assert(libcli_parse_fixed("3.25", 16, &value));
+    assert(value == 0x34000);
+
+    assert(libcli_parse_fixed("-3.25", 16, &value));
+    assert(value == -0x34000);
+
+    assert(libcli_parse_fixed("+12", 16, &value));
+    assert(value == (12 << 16));
+
+    assert(libcli_parse_fixed(".5", 1, &value));
+    assert(value == 1);
+
+    assert(libcli_parse_fixed("7.", 0, &value));
+    assert(value == 7);
+}
+
+static void fixed_point_rounding() {
+    int32_t value = 0;
+
+    // 0.1 is 6553.6 steps of 2^-16
+    assert(libcli_parse_fixed("0.1", 16, &value));
+    assert(value == 6554);
+
+    // Exactly half a step (2^-17) rounds away from zero
+    assert(libcli_parse_fixed("0.00000762939453125", 16, &value));
+    assert(value == 1);
+    assert(libcli_parse_fixed("-0.00000762939453125", 16, &value));
+    assert(value == -1);
+
+    // Just under half a step rounds down, even when the difference is past the 32nd digit
+    assert(libcli_parse_fixed("0.00000762939453124999999999999999999", 16, &value));
+    assert(value == 0);
+
+    assert(libcli_parse_fixed("2.5", 0, &value));
+    assert(value == 3);
+    assert(libcli_parse_fixed("2.4999", 0, &value));
+    assert(value == 2);
+}
+
+static void fixed_point_range() {
+    int32_t value = 0;
+
+    assert(libcli_parse_fixed("32767.99998", 16, &value));
+    assert(value == INT32_MAX);
+
+    assert(libcli_parse_fixed("-32768", 16, &value));
+    assert(value == INT32_MIN);
+
+    // Rounds up past the largest value
+    assert(!libcli_parse_fixed("32767.999999", 16, &value));
+    assert(!libcli_parse_fixed("32768", 16, &value));
+    assert(!libcli_parse_fixed("-32768.00001", 16, &value));
+    assert(!libcli_parse_fixed("99999999999999999999", 0, &value));
+
+    assert(libcli_parse_fixed("-2147483648", 0, &value));
+    assert(value == INT32_MIN);
+}
+
+static void invalid_fixed_point() {
+    int32_t value = 0;
+
+    assert(!libcli_parse_fixed("", 16, &value));
+    assert(!libcli_parse_fixed("-", 16, &value));
+    assert(!libcli_parse_fixed(".", 16, &value));
+    assert(!libcli_parse_fixed("1.2.3", 16, &value));
+    assert(!libcli_parse_fixed("1e3", 16, &value));
+    assert(!libcli_parse_fixed("0x10", 16, &value));
+    assert(!libcli_parse_fixed(" 1", 16, &value));
+}
+
 int main(void) {
     typedef void (*Test)(void);
 
@@ -124,6 +416,20 @@ int main(void) {
         eof_after_slash,
         unterminated_double_quote,
         unterminated_single_quote,
+        pipes,
+        quoted_pipes,
+        high_bytes_are_not_whitespace,
+        valid_utf8,
+        invalid_utf8,
+        token_callbacks,
+        token_callbacks_can_stop,
+        hex_blobs,
+        base64_blobs,
+        invalid_blobs,
+        fixed_point,
+        fixed_point_rounding,
+        fixed_point_range,
+        invalid_fixed_point,
     };
 
     const size_t test_count = sizeof(tests) / sizeof(Test);
@@ -0,0 +1,378 @@
+#include "cli_record.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+// Mocks & utility
+
+static uint32_t clock_ticks = 0;
+static uint32_t clock_step = 0;
+
+// Returns the current tick, then advances by `clock_step`
+static uint32_t fake_clock(void) {
+    uint32_t ticks = clock_ticks;
+    clock_ticks += clock_step;
+    return ticks;
+}
+
+static int set_gain_command_last_value = 0;
+static size_t set_gain_command_call_count = 0;
+
+static void set_gain_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* userdata
+) {
+    (void)header;
+    (void)argc;
+    (void)userdata;
+
+    // The handler takes 100 ticks
+    clock_ticks += 100;
+    set_gain_command_last_value = argv[0].integer;
+    set_gain_command_call_count += 1;
+}
+
+static void discard_writeback(const char* string, void* userdata) {
+    (void)string;
+    (void)userdata;
+}
+
+static const CliArgumentType set_gain_args[] = { cli_argument_type_int };
+
+static CliHeader new_cli(CliCommand* commands, size_t capacity, CliRecorder* recorder) {
+    CliNewInfo info = {
+        .commands = commands,
+        .commands_size = capacity,
+        .writeback = discard_writeback,
+        .timestamp = fake_clock,
+        .recorder = recorder,
+    };
+    CliHeader header = libcli_new(&info);
+    libcli_add(&header, "set-gain", "", 1, set_gain_args, set_gain_command);
+    return header;
+}
+
+static uint32_t read_u32(const uint8_t* data) {
+    return (uint32_t)data[0]
+        | ((uint32_t)data[1] << 8)
+        | ((uint32_t)data[2] << 16)
+        | ((uint32_t)data[3] << 24);
+}
+
+typedef struct Entry {
+    uint32_t timestamp;
+    uint32_t duration;
+    CliRunResult result;
+    char line[cli_trace_line_size];
+} Entry;
+
+// Read the entry at `*offset` of a trace and move past it
+static Entry read_entry(const uint8_t* trace, size_t* offset) {
+    const uint8_t* data = &trace[*offset];
+    size_t length = (size_t)data[9] | ((size_t)data[10] << 8);
+
+    Entry entry = {
+        .timestamp = read_u32(&data[0]),
+        .duration = read_u32(&data[4]),
+        .result = (CliRunResult)data[8],
+    };
+    memcpy(entry.line, &data[cli_trace_entry_size], length);
+    entry.line[length] = '\0';
+
+    *offset += cli_trace_entry_size + length;
+    return entry;
+}
+
+static void run(CliHeader* header, const char* line) {
+    char input[cli_trace_line_size];
+    strcpy(input, line);
+    libcli_run(header, input, NULL);
+}
+
+// Tests
+
+static void records_lines(void) {
+    // Given
+    enum { capacity = 8 };
+    uint8_t ring[256];
+    CliRecorder recorder = libcli_recorder_new(ring, sizeof(ring), fake_clock);
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity, &recorder);
+
+    // When
+    clock_ticks = 1000;
+    run(&header, "set-gain 3");
+    clock_ticks = 2000;
+    run(&header, "set-gain 'x'");
+    run(&header, "nothing");
+
+    uint8_t trace[256];
+    size_t size = libcli_recorder_dump(&recorder, trace, sizeof(trace));
+
+    // Then
+    assert(size == libcli_recorder_dump_size(&recorder));
+    assert(memcmp(trace, "LCR", 3) == 0);
+    assert(read_u32(&trace[4]) == 3);
+
+    size_t offset = cli_trace_header_size;
+    Entry first = read_entry(trace, &offset);
+    assert(first.timestamp == 1000);
+    assert(first.duration == 100);
+    assert(first.result == cli_run_result_ok);
+    assert(strcmp(first.line, "set-gain 3") == 0);
+
+    Entry second = read_entry(trace, &offset);
+    assert(second.timestamp == 2000);
+    assert(second.duration == 0);
+    assert(second.result == cli_run_result_bad_argument);
+    assert(strcmp(second.line, "set-gain 'x'") == 0);
+
+    Entry third = read_entry(trace, &offset);
+    assert(third.result == cli_run_result_unknown);
+    assert(strcmp(third.line, "nothing") == 0);
+    assert(offset == size);
+
+    // When, Then
+    assert(libcli_recorder_dump(&recorder, trace, size - 1) == 0);
+}
+
+static void blank_lines_take_no_time(void) {
+    // Given
+    enum { capacity = 8 };
+    uint8_t ring[256];
+    CliRecorder recorder = libcli_recorder_new(ring, sizeof(ring), fake_clock);
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity, &recorder);
+
+    // When
+    clock_ticks = 1000;
+    run(&header, "   ");
+
+    uint8_t trace[256];
+    size_t size = libcli_recorder_dump(&recorder, trace, sizeof(trace));
+
+    // Then (the duration did not wrap around)
+    size_t offset = cli_trace_header_size;
+    Entry entry = read_entry(trace, &offset);
+    assert(entry.result == cli_run_result_ok);
+    assert(entry.duration == 0);
+    assert(strcmp(entry.line, "   ") == 0);
+    assert(offset == size);
+}
+
+static void full_rings_drop_oldest_lines(void) {
+    // Given (room for three entries of 21 bytes, plus some)
+    enum { capacity = 8 };
+    uint8_t ring[70];
+    CliRecorder recorder = libcli_recorder_new(ring, sizeof(ring), NULL);
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity, &recorder);
+
+    // When
+    run(&header, "set-gain 1");
+    run(&header, "set-gain 2");
+    run(&header, "set-gain 3");
+    run(&header, "set-gain 4");
+    run(&header, "set-gain 5");
+
+    // Then
+    uint8_t trace[128];
+    size_t size = libcli_recorder_dump(&recorder, trace, sizeof(trace));
+    size_t offset = cli_trace_header_size;
+
+    assert(set_gain_command_call_count == 5);
+    assert(libcli_recorder_dropped(&recorder) == 2);
+    assert(read_u32(&trace[4]) == 3);
+    assert(strcmp(read_entry(trace, &offset).line, "set-gain 3") == 0);
+    assert(strcmp(read_entry(trace, &offset).line, "set-gain 4") == 0);
+
+    Entry last = read_entry(trace, &offset);
+    assert(strcmp(last.line, "set-gain 5") == 0);
+    assert(last.timestamp == 0);
+    assert(last.duration == 0);
+    assert(offset == size);
+}
+
+static void nested_lines_are_not_recorded(void) {
+    // Given
+    enum { capacity = 8 };
+    uint8_t ring[256];
+    CliRecorder recorder = libcli_recorder_new(ring, sizeof(ring), fake_clock);
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity, &recorder);
+
+    // When
+    run(&header, "repeat 3 set-gain 7");
+
+    // Then
+    assert(set_gain_command_call_count == 3);
+
+    uint8_t trace[256];
+    libcli_recorder_dump(&recorder, trace, sizeof(trace));
+    size_t offset = cli_trace_header_size;
+
+    assert(read_u32(&trace[4]) == 1);
+    assert(strcmp(read_entry(trace, &offset).line, "repeat 3 set-gain 7") == 0);
+}
+
+static void can_replay_traces(void) {
+    // Given
+    enum { capacity = 8 };
+    uint8_t ring[256];
+    CliRecorder recorder = libcli_recorder_new(ring, sizeof(ring), fake_clock);
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity, &recorder);
+
+    clock_ticks = 0;
+    run(&header, "set-gain 1");
+    clock_ticks = 500;
+    run(&header, "set-gain 2");
+    run(&header, "set-gain");
+
+    uint8_t trace[256];
+    size_t size = libcli_recorder_dump(&recorder, trace, sizeof(trace));
+    set_gain_command_call_count = 0;
+
+    // When
+    CliReplayStats stats;
+    clock_ticks = 0;
+    clock_step = 1;
+    CliRunResult result = libcli_replay_trace(&header, trace, size, fake_clock, true, NULL, &stats);
+
+    // Then
+    assert(result == cli_run_result_ok);
+    assert(stats.runs == 3);
+    assert(stats.mismatches == 0);
+    assert(stats.elapsed >= 600);
+    assert(stats.min < 100);
+    assert(stats.p50 >= 100);
+    assert(stats.max >= 100);
+    assert(set_gain_command_last_value == 2);
+    assert(set_gain_command_call_count == 2);
+
+    // And (replayed lines are not recorded again)
+    assert(libcli_recorder_dump_size(&recorder) == size);
+}
+
+static void replay_counts_changed_results(void) {
+    // Given
+    enum { capacity = 8 };
+    uint8_t ring[256];
+    CliRecorder recorder = libcli_recorder_new(ring, sizeof(ring), fake_clock);
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity, &recorder);
+    run(&header, "set-gain 1");
+    run(&header, "calibrate");
+
+    uint8_t trace[256];
+    size_t size = libcli_recorder_dump(&recorder, trace, sizeof(trace));
+
+    // And (a newer CLI, which has a `calibrate` command)
+    CliCommand other_commands[capacity];
+    CliHeader other_header = new_cli(other_commands, capacity, NULL);
+    libcli_add(&other_header, "calibrate", "", 0, NULL, set_gain_command);
+
+    // When
+    CliReplayStats stats;
+    clock_step = 1;
+    CliRunResult result = libcli_replay_trace(
+        &other_header,
+        trace,
+        size,
+        fake_clock,
+        false,
+        NULL,
+        &stats
+    );
+
+    // Then
+    assert(result == cli_run_result_ok);
+    assert(stats.runs == 2);
+    assert(stats.mismatches == 1);
+}
+
+static void rejects_damaged_traces(void) {
+    // Given
+    enum { capacity = 8 };
+    uint8_t ring[256];
+    CliRecorder recorder = libcli_recorder_new(ring, sizeof(ring), fake_clock);
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity, &recorder);
+    run(&header, "set-gain 1");
+
+    uint8_t trace[256];
+    size_t size = libcli_recorder_dump(&recorder, trace, sizeof(trace));
+    CliReplayStats stats;
+    clock_step = 1;
+
+    // When, Then
+    assert(libcli_replay_trace(&header, trace, size - 1, fake_clock, false, NULL, &stats)
+        == cli_run_result_bad_macro);
+    assert(libcli_replay_trace(&header, trace, 4, fake_clock, false, NULL, &stats)
+        == cli_run_result_bad_macro);
+
+    // When, Then
+    trace[0] = 'X';
+    assert(libcli_replay_trace(&header, trace, size, fake_clock, false, NULL, &stats)
+        == cli_run_result_bad_macro);
+}
+
+// Record a trace to `path`, for the `replay_trace` tool test to replay (see replay_commands.c)
+static void write_trace_file(const char* path) {
+    enum { capacity = 8 };
+    uint8_t ring[1024];
+    CliRecorder recorder = libcli_recorder_new(ring, sizeof(ring), fake_clock);
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity, &recorder);
+    clock_step = 10;
+
+    for (int i = 0; i < 20; i++) {
+        run(&header, (i % 2) ? "set-gain 4" : "set-gain -2");
+    }
+
+    uint8_t trace[1024];
+    size_t size = libcli_recorder_dump(&recorder, trace, sizeof(trace));
+
+    FILE* file = fopen(path, "wb");
+    assert(file != NULL);
+    assert(fwrite(trace, 1, size, file) == size);
+    fclose(file);
+}
+
+// Test runner
+
+static void cleanup(void) {
+    clock_ticks = 0;
+    clock_step = 0;
+    set_gain_command_last_value = 0;
+    set_gain_command_call_count = 0;
+}
+
+int main(int argc, char** argv) {
+    typedef void (*Test)(void);
+
+    const Test tests[] = {
+        records_lines,
+        blank_lines_take_no_time,
+        full_rings_drop_oldest_lines,
+        nested_lines_are_not_recorded,
+        can_replay_traces,
+        replay_counts_changed_results,
+        rejects_damaged_traces,
+    };
+
+    const size_t test_count = sizeof(tests) / sizeof(Test);
+    for (size_t i = 0; i < test_count; i++) {
+        Test test = tests[i];
+        test();
+        cleanup();
+    }
+
+    if (argc > 1) {
+        write_trace_file(argv[1]);
+    }
+
+    printf("All tests (%zu) passed.\n", test_count);
+}
@@ -0,0 +1,22 @@
+#include "replay_trace.h"
+
+// Commands for the `replay_trace` tool test, matching those recorded by record_tests.
+
+static void set_gain_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* userdata
+) {
+    (void)header;
+    (void)argc;
+    *(int*)userdata = argv[0].integer;
+}
+
+void* replay_add_commands(CliHeader* header) {
+    static int gain = 0;
+    static const CliArgumentType set_gain_args[] = { cli_argument_type_int };
+
+    libcli_add(header, "set-gain", "", 1, set_gain_args, set_gain_command);
+    return &gain;
+}
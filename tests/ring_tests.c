@@ -0,0 +1,374 @@
+#include "cli_ring.h"
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Mocks & utility
+
+static char set_command_last_name[64] = {0};
+static int set_command_last_value = 0;
+static size_t set_command_call_count = 0;
+
+static void set_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* userdata
+) {
+    (void)header;
+    (void)argc;
+    (void)userdata;
+
+    strncpy(set_command_last_name, argv[0].string, sizeof(set_command_last_name) - 1);
+    set_command_last_value = argv[1].integer;
+    set_command_call_count += 1;
+}
+
+// State of a stress test's consumer: the last sequence number seen, and how many lines ran
+typedef struct CheckState {
+    long last_sequence;
+    size_t count;
+    bool lossless;
+} CheckState;
+
+// Integrity check written by the producer thread for a line's sequence number
+static unsigned check_value(long sequence) {
+    return (unsigned)sequence * 2654435761u;
+}
+
+static void check_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* userdata
+) {
+    (void)header;
+    (void)argc;
+
+    CheckState* state = (CheckState*)userdata;
+    long sequence = argv[0].integer;
+    char expected[16];
+    snprintf(expected, sizeof(expected), "%x", check_value(sequence));
+
+    assert(strcmp(expected, argv[1].string) == 0);
+    assert(sequence > state->last_sequence);
+    assert(!state->lossless || (sequence == state->last_sequence + 1));
+
+    state->last_sequence = sequence;
+    state->count += 1;
+}
+
+static void discard_writeback(const char* string, void* userdata) {
+    (void)string;
+    (void)userdata;
+}
+
+static const CliArgumentType set_args[] = { cli_argument_type_string, cli_argument_type_int };
+static const CliArgumentType check_args[] = { cli_argument_type_int, cli_argument_type_string };
+
+static CliHeader new_cli(CliCommand* commands, size_t capacity) {
+    CliNewInfo info = {
+        .commands = commands,
+        .commands_size = capacity,
+        .writeback = discard_writeback,
+    };
+    CliHeader header = libcli_new(&info);
+    libcli_add(&header, "set", "", 2, set_args, set_command);
+    libcli_add(&header, "check", "", 2, check_args, check_command);
+    return header;
+}
+
+static void push(CliRing* ring, const char* text) {
+    libcli_ring_push(ring, text, strlen(text));
+}
+
+// Tests
+
+static void runs_complete_lines(void) {
+    // Given
+    enum { capacity = 4, size = 64 };
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity);
+    CliRing ring;
+    char buffer[size + 32];
+    assert(libcli_ring_init(&ring, buffer, size, 32));
+
+    // When
+    push(&ring, "set a 1\nset b 2\r\nset c");
+    CliRunResult result = libcli_service(&header, &ring, NULL);
+
+    // Then
+    assert(result == cli_run_result_ok);
+    assert(set_command_call_count == 2);
+    assert(strcmp(set_command_last_name, "b") == 0);
+
+    // When
+    push(&ring, " 3\n");
+    result = libcli_service(&header, &ring, NULL);
+
+    // Then
+    assert(result == cli_run_result_ok);
+    assert(set_command_call_count == 3);
+    assert(strcmp(set_command_last_name, "c") == 0);
+    assert(set_command_last_value == 3);
+
+    // When, Then (errors are passed back)
+    push(&ring, "nothing\nset d 4\n");
+    assert(libcli_service(&header, &ring, NULL) == cli_run_result_unknown);
+    assert(set_command_call_count == 4);
+}
+
+static void wrapped_lines_are_contiguous(void) {
+    // Given
+    enum { capacity = 4, size = 16, line_size = 12 };
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity);
+    CliRing ring;
+    char buffer[size + line_size];
+    libcli_ring_init(&ring, buffer, size, line_size);
+
+    // When (every line start moves along the ring, so lines wrap at every offset)
+    for (int i = 0; i < 40; i++) {
+        char line[16];
+        snprintf(line, sizeof(line), "set x%d %d\n", i % 10, i);
+        assert(libcli_ring_push(&ring, line, strlen(line)) == strlen(line));
+        assert(libcli_service(&header, &ring, NULL) == cli_run_result_ok);
+
+        // Then
+        char name[4];
+        snprintf(name, sizeof(name), "x%d", i % 10);
+        assert(strcmp(set_command_last_name, name) == 0);
+        assert(set_command_last_value == i);
+    }
+
+    assert(set_command_call_count == 40);
+}
+
+static void long_lines_are_discarded(void) {
+    // Given
+    enum { capacity = 4, size = 16, line_size = 8 };
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity);
+    CliRing ring;
+    char buffer[size + line_size];
+    libcli_ring_init(&ring, buffer, size, line_size);
+
+    // When
+    push(&ring, "set abcdefgh");
+    CliRunResult result = libcli_service(&header, &ring, NULL);
+    push(&ring, "ijklmnopqrstuvwx");
+    libcli_service(&header, &ring, NULL);
+    push(&ring, "yz 1\nset b 2\n");
+    CliRunResult result2 = libcli_service(&header, &ring, NULL);
+
+    // Then
+    assert(result == cli_run_result_no_space);
+    assert(result2 == cli_run_result_ok);
+    assert(libcli_ring_discarded_lines(&ring) == 1);
+    assert(set_command_call_count == 1);
+    assert(strcmp(set_command_last_name, "b") == 0);
+
+    // When, Then (the longest line which fits)
+    push(&ring, "set c 3\n");
+    assert(libcli_service(&header, &ring, NULL) == cli_run_result_ok);
+    assert(set_command_last_value == 3);
+}
+
+static void overruns_cancel_damaged_lines(void) {
+    // Given
+    enum { capacity = 4, size = 16, line_size = 16 };
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity);
+    CliRing ring;
+    char buffer[size + line_size];
+    libcli_ring_init(&ring, buffer, size, line_size);
+
+    // When (the second line only partly fits, and the third arrives while the ring is full)
+    push(&ring, "set a 1\n");
+    push(&ring, "set b 22\n");
+    push(&ring, "set c 3\n");
+    CliRunResult result = libcli_service(&header, &ring, NULL);
+
+    // Then
+    assert(result == cli_run_result_ok);
+    assert(set_command_call_count == 1);
+    assert(libcli_ring_overrun_bytes(&ring) == 9);
+
+    // When (the end of the damaged line is cancelled once there is space)
+    push(&ring, "set d 4\n");
+    result = libcli_service(&header, &ring, NULL);
+
+    // Then
+    assert(result == cli_run_result_no_space);
+    assert(libcli_ring_discarded_lines(&ring) == 1);
+    assert(set_command_call_count == 1);
+
+    // When, Then (later lines run as normal)
+    push(&ring, "set e 5\n");
+    assert(libcli_service(&header, &ring, NULL) == cli_run_result_ok);
+    assert(set_command_call_count == 2);
+    assert(strcmp(set_command_last_name, "e") == 0);
+}
+
+static void cancel_bytes_discard_lines(void) {
+    // Given
+    enum { capacity = 4, size = 32 };
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity);
+    CliRing ring;
+    char buffer[size + size];
+    libcli_ring_init(&ring, buffer, size, size);
+
+    // When
+    push(&ring, "set a 1\x18set b 2\n");
+
+    // Then
+    assert(libcli_service(&header, &ring, NULL) == cli_run_result_no_space);
+    assert(set_command_call_count == 1);
+    assert(strcmp(set_command_last_name, "b") == 0);
+}
+
+static void rejects_bad_sizes(void) {
+    CliRing ring;
+    char buffer[64];
+
+    assert(!libcli_ring_init(&ring, buffer, 24, 8));
+    assert(!libcli_ring_init(&ring, buffer, 16, 32));
+    assert(!libcli_ring_init(&ring, buffer, 16, 1));
+    assert(libcli_ring_init(&ring, buffer, 32, 32));
+}
+
+// Stress tests, with the producer on its own thread
+
+enum {
+    stress_line_count = 50000,
+    stress_ring_size = 64,
+    stress_line_size = 32,
+};
+
+typedef struct Producer {
+    CliRing* ring;
+    bool lossless;
+    atomic_bool done;
+} Producer;
+
+static void* produce(void* data) {
+    Producer* producer = (Producer*)data;
+    unsigned seed = 1;
+
+    for (long sequence = 1; sequence <= stress_line_count; sequence++) {
+        char line[stress_line_size];
+        unsigned value = check_value(sequence);
+        int length = snprintf(line, sizeof(line), "check %ld %x\n", sequence, value);
+        size_t offset = 0;
+
+        // Pushed in irregular chunks, as bytes arrive in an interrupt handler
+        while (offset < (size_t)length) {
+            size_t chunk = 1 + (size_t)(rand_r(&seed) % 7);
+            chunk = (chunk > ((size_t)length - offset)) ? ((size_t)length - offset) : chunk;
+
+            // Lossless producers wait for space (like a UART with flow control).
+            if (producer->lossless) {
+                size_t space = libcli_ring_space(producer->ring);
+                chunk = (chunk > space) ? space : chunk;
+            }
+
+            size_t stored = libcli_ring_push(producer->ring, &line[offset], chunk);
+            offset += chunk;
+
+            if ((stored < chunk) || (chunk == 0)) {
+                sched_yield();
+            }
+        }
+    }
+
+    atomic_store(&producer->done, true);
+    return NULL;
+}
+
+static void stress(bool lossless, CheckState* state, CliRing* ring) {
+    enum { capacity = 4 };
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity);
+    static char buffer[stress_ring_size + stress_line_size];
+    assert(libcli_ring_init(ring, buffer, stress_ring_size, stress_line_size));
+
+    Producer producer = { .ring = ring, .lossless = lossless };
+    atomic_init(&producer.done, false);
+    *state = (CheckState){ .last_sequence = 0, .count = 0, .lossless = lossless };
+
+    pthread_t thread;
+    assert(pthread_create(&thread, NULL, produce, &producer) == 0);
+
+    // The consumer yields between polls, as a main loop would sleep, in case both threads share
+    // a core.
+    while (!atomic_load(&producer.done)) {
+        libcli_service(&header, ring, state);
+        sched_yield();
+    }
+
+    pthread_join(thread, NULL);
+    libcli_service(&header, ring, state);
+}
+
+static void stress_lossless(void) {
+    // Given, When
+    CliRing ring;
+    CheckState state;
+    stress(true, &state, &ring);
+
+    // Then
+    assert(state.count == stress_line_count);
+    assert(state.last_sequence == stress_line_count);
+    assert(libcli_ring_discarded_lines(&ring) == 0);
+}
+
+static void stress_with_overruns(void) {
+    // Given, When
+    CliRing ring;
+    CheckState state;
+    stress(false, &state, &ring);
+
+    // Then (every line which ran was intact and in order, and every loss was reported)
+    assert(state.count > 0);
+    assert((state.count + libcli_ring_discarded_lines(&ring)) <= stress_line_count);
+
+    if (state.count < stress_line_count) {
+        assert(libcli_ring_overrun_bytes(&ring) > 0);
+    }
+}
+
+// Test runner
+
+static void cleanup(void) {
+    memset(set_command_last_name, 0, sizeof(set_command_last_name));
+    set_command_last_value = 0;
+    set_command_call_count = 0;
+}
+
+int main(void) {
+    typedef void (*Test)(void);
+
+    const Test tests[] = {
+        runs_complete_lines,
+        wrapped_lines_are_contiguous,
+        long_lines_are_discarded,
+        overruns_cancel_damaged_lines,
+        cancel_bytes_discard_lines,
+        rejects_bad_sizes,
+        stress_lossless,
+        stress_with_overruns,
+    };
+
+    const size_t test_count = sizeof(tests) / sizeof(Test);
+    for (size_t i = 0; i < test_count; i++) {
+        Test test = tests[i];
+        test();
+        cleanup();
+    }
+
+    printf("All tests (%zu) passed.\n", test_count);
+}
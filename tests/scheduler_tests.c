@@ -0,0 +1,290 @@
+#include "cli_scheduler.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+// Mocks & utility
+
+typedef struct Output {
+    char text[256];
+} Output;
+
+static Output outputs[3];
+static char order[256] = {0};
+static uint32_t fake_time = 0;
+
+static void writeback(const char* string, void* userdata) {
+    Output* output = (Output*)userdata;
+    strncat(output->text, string, sizeof(output->text) - strlen(output->text) - 1);
+}
+
+static uint32_t fake_clock(void) {
+    return fake_time;
+}
+
+// Writes its argument, and records the order lines ran in
+static void say_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* data
+) {
+    (void)argc;
+    (void)data;
+
+    strncat(order, argv[0].string, sizeof(order) - strlen(order) - 1);
+    libcli_write(header, argv[0].string);
+}
+
+static CliHeader new_cli(CliCommand* commands, size_t capacity) {
+    CliNewInfo info = {
+        .commands = commands,
+        .commands_size = capacity,
+        .writeback = writeback,
+        .writeback_data = &outputs[0],
+    };
+    CliHeader header = libcli_new(&info);
+
+    const CliArgumentType arguments[] = { cli_argument_type_string };
+    assert(libcli_add(&header, "say", "", 1, arguments, say_command));
+    return header;
+}
+
+static size_t add_source(
+    CliScheduler* scheduler,
+    CliQueuedLine* lines,
+    size_t lines_size,
+    uint8_t priority,
+    uint32_t weight,
+    Output* output
+) {
+    CliSourceInfo info = {
+        .lines = lines,
+        .lines_size = lines_size,
+        .priority = priority,
+        .weight = weight,
+        .writeback = writeback,
+        .writeback_data = output,
+    };
+
+    size_t source = 0;
+    assert(libcli_scheduler_add_source(scheduler, &info, &source));
+    return source;
+}
+
+static size_t run_all(const CliHeader* header, CliScheduler* scheduler) {
+    size_t ticks = 0;
+    CliRunResult result;
+
+    while (libcli_scheduler_tick(header, scheduler, NULL, &result)) {
+        assert(result == cli_run_result_ok);
+        ticks += 1;
+    }
+
+    return ticks;
+}
+
+// Tests
+
+static void output_is_routed_to_the_source_of_each_line(void) {
+    // Given
+    enum { capacity = 2 };
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity);
+    CliSchedulerSource sources[2];
+    CliScheduler scheduler = libcli_scheduler_new(sources, 2, NULL);
+    CliQueuedLine uart_lines[4];
+    CliQueuedLine usb_lines[4];
+    size_t uart = add_source(&scheduler, uart_lines, 4, 0, 1, &outputs[1]);
+    size_t usb = add_source(&scheduler, usb_lines, 4, 0, 1, &outputs[2]);
+
+    // When
+    assert(libcli_scheduler_submit(&scheduler, uart, "say a"));
+    assert(libcli_scheduler_submit(&scheduler, usb, "say b"));
+    assert(libcli_scheduler_submit(&scheduler, uart, "say c"));
+    assert(libcli_scheduler_pending(&scheduler) == 3);
+
+    // Then (one line per tick)
+    CliRunResult result;
+    assert(libcli_scheduler_tick(&header, &scheduler, NULL, &result));
+    assert(libcli_scheduler_pending(&scheduler) == 2);
+    assert(run_all(&header, &scheduler) == 2);
+
+    assert(strcmp("abc", order) == 0);
+    assert(strcmp("ac", outputs[1].text) == 0);
+    assert(strcmp("b", outputs[2].text) == 0);
+    assert(strcmp("", outputs[0].text) == 0);
+}
+
+static void higher_priorities_run_first(void) {
+    // Given
+    enum { capacity = 2 };
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity);
+    CliSchedulerSource sources[2];
+    CliScheduler scheduler = libcli_scheduler_new(sources, 2, NULL);
+    CliQueuedLine bulk_lines[8];
+    CliQueuedLine urgent_lines[2];
+    size_t bulk = add_source(&scheduler, bulk_lines, 8, 0, 100, &outputs[1]);
+    size_t urgent = add_source(&scheduler, urgent_lines, 2, 1, 1, &outputs[2]);
+
+    for (size_t i = 0; i < 8; i++) {
+        assert(libcli_scheduler_submit(&scheduler, bulk, "say b"));
+    }
+
+    // When
+    CliRunResult result;
+    assert(libcli_scheduler_tick(&header, &scheduler, NULL, &result));
+    assert(libcli_scheduler_submit(&scheduler, urgent, "say U"));
+    assert(libcli_scheduler_tick(&header, &scheduler, NULL, &result));
+
+    // Then
+    assert(strcmp("bU", order) == 0);
+    assert(run_all(&header, &scheduler) == 7);
+}
+
+static void equal_priorities_share_by_weight(void) {
+    // Given
+    enum { capacity = 2 };
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity);
+    CliSchedulerSource sources[3];
+    CliScheduler scheduler = libcli_scheduler_new(sources, 3, NULL);
+    CliQueuedLine heavy_lines[8];
+    CliQueuedLine light_lines[8];
+    CliQueuedLine idle_lines[1];
+    size_t heavy = add_source(&scheduler, heavy_lines, 8, 0, 3, &outputs[1]);
+    size_t light = add_source(&scheduler, light_lines, 8, 0, 1, &outputs[2]);
+    add_source(&scheduler, idle_lines, 1, 0, 5, &outputs[0]);
+
+    for (size_t i = 0; i < 6; i++) {
+        assert(libcli_scheduler_submit(&scheduler, heavy, "say H"));
+        assert(libcli_scheduler_submit(&scheduler, light, "say l"));
+    }
+
+    // When
+    assert(run_all(&header, &scheduler) == 12);
+
+    // Then (turns are interleaved, and the idle source earns nothing)
+    assert(strcmp("HHlHHHlHllll", order) == 0);
+}
+
+static void full_queues_and_long_lines_are_dropped(void) {
+    // Given
+    enum { capacity = 2 };
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity);
+    CliSchedulerSource sources[1];
+    CliScheduler scheduler = libcli_scheduler_new(sources, 1, NULL);
+    CliQueuedLine lines[2];
+    size_t source = add_source(&scheduler, lines, 2, 0, 1, &outputs[1]);
+
+    char long_line[cli_scheduler_line_size + 1];
+    memset(long_line, 'a', sizeof(long_line) - 1);
+    long_line[sizeof(long_line) - 1] = '\0';
+
+    // When
+    assert(libcli_scheduler_submit(&scheduler, source, "say 1"));
+    assert(!libcli_scheduler_submit(&scheduler, source, long_line));
+    assert(libcli_scheduler_submit(&scheduler, source, "say 2"));
+    assert(!libcli_scheduler_submit(&scheduler, source, "say 3"));
+
+    // Then (the queue wraps around once it has room)
+    CliRunResult result;
+    assert(libcli_scheduler_tick(&header, &scheduler, NULL, &result));
+    assert(libcli_scheduler_submit(&scheduler, source, "say 4"));
+    assert(run_all(&header, &scheduler) == 2);
+    assert(strcmp("124", order) == 0);
+
+    CliSourceStats stats = libcli_scheduler_stats(&scheduler, source);
+    assert(stats.dropped == 2);
+    assert(stats.dispatched == 3);
+    assert(stats.max_depth == 2);
+    assert(stats.depth == 0);
+
+    // When, Then (sources must have a queue, weight and writeback)
+    CliSourceInfo info = { .lines = lines, .lines_size = 2, .weight = 0, .writeback = writeback };
+    CliScheduler other = libcli_scheduler_new(sources, 1, NULL);
+    assert(!libcli_scheduler_add_source(&other, &info, &source));
+    info.weight = 1;
+    assert(libcli_scheduler_add_source(&other, &info, &source));
+    assert(!libcli_scheduler_add_source(&other, &info, &source));
+}
+
+static void wait_times_are_measured(void) {
+    // Given
+    enum { capacity = 2 };
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity);
+    CliSchedulerSource sources[1];
+    CliScheduler scheduler = libcli_scheduler_new(sources, 1, fake_clock);
+    CliQueuedLine lines[4];
+    size_t source = add_source(&scheduler, lines, 4, 0, 1, &outputs[1]);
+
+    // When
+    fake_time = 100;
+    libcli_scheduler_submit(&scheduler, source, "say a");
+    fake_time = 110;
+    libcli_scheduler_submit(&scheduler, source, "say b");
+    libcli_scheduler_submit(&scheduler, source, "say c");
+
+    CliRunResult result;
+    fake_time = 130;
+    libcli_scheduler_tick(&header, &scheduler, NULL, &result);
+    fake_time = 135;
+    libcli_scheduler_tick(&header, &scheduler, NULL, &result);
+
+    // Then
+    CliSourceStats stats = libcli_scheduler_stats(&scheduler, source);
+    assert(stats.depth == 1);
+    assert(stats.max_depth == 3);
+    assert(stats.dispatched == 2);
+    assert(stats.last_wait == 25);
+    assert(stats.max_wait == 30);
+    assert(stats.total_wait == 55);
+}
+
+static void idle_ticks_run_nothing(void) {
+    // Given
+    enum { capacity = 2 };
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity);
+    CliSchedulerSource sources[1];
+    CliScheduler scheduler = libcli_scheduler_new(sources, 1, NULL);
+
+    // When, Then
+    CliRunResult result = cli_run_result_bad_argc;
+    assert(!libcli_scheduler_tick(&header, &scheduler, NULL, &result));
+    assert(result == cli_run_result_bad_argc);
+    assert(libcli_scheduler_pending(&scheduler) == 0);
+}
+
+// Test runner
+
+static void cleanup(void) {
+    memset(outputs, 0, sizeof(outputs));
+    memset(order, 0, sizeof(order));
+    fake_time = 0;
+}
+
+int main(void) {
+    typedef void (*Test)(void);
+
+    const Test tests[] = {
+        output_is_routed_to_the_source_of_each_line,
+        higher_priorities_run_first,
+        equal_priorities_share_by_weight,
+        full_queues_and_long_lines_are_dropped,
+        wait_times_are_measured,
+        idle_ticks_run_nothing,
+    };
+
+    const size_t test_count = sizeof(tests) / sizeof(Test);
+    for (size_t i = 0; i < test_count; i++) {
+        Test test = tests[i];
+        test();
+        cleanup();
+    }
+
+    printf("All tests (%zu) passed.\n", test_count);
+}
@@ -0,0 +1,558 @@
+#include "cli_server.h"
+#include "cli_jobs.h"
+#include <assert.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Mocks & utility
+
+enum {
+    session_capacity = 2048,
+    load_session_count = 2000,
+};
+
+static CliSession sessions[session_capacity];
+static uint32_t fake_time = 0;
+
+static uint32_t fake_clock(void) {
+    return fake_time;
+}
+
+static void echo_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* userdata
+) {
+    (void)argc;
+    (void)userdata;
+
+    libcli_write(header, argv[0].string);
+    libcli_write(header, "\n");
+}
+
+static CliContext debug_context;
+
+static void debug_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* data
+) {
+    (void)argc;
+    (void)argv;
+    (void)data;
+    libcli_enter_context(header, &debug_context, NULL);
+}
+
+static void prompt_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* data
+) {
+    (void)argc;
+    (void)argv;
+    (void)data;
+    const char* prompt = libcli_context_prompt(header);
+    libcli_write(header, (prompt != NULL) ? prompt : "top");
+    libcli_write(header, "\n");
+}
+
+enum {
+    flood_chunk_size = 1024,
+};
+
+// Write the given number of kilobytes of output
+static void flood_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* data
+) {
+    (void)argc;
+    (void)data;
+
+    char chunk[flood_chunk_size + 1];
+    memset(chunk, 'x', flood_chunk_size - 1);
+    chunk[flood_chunk_size - 1] = '\n';
+    chunk[flood_chunk_size] = '\0';
+
+    for (int i = 0; i < argv[0].integer; i++) {
+        libcli_write(header, chunk);
+    }
+}
+
+static void discard_writeback(const char* string, void* userdata) {
+    (void)string;
+    (void)userdata;
+}
+
+static CliHeader new_echo_cli(CliCommand* commands, size_t capacity) {
+    CliNewInfo info = {
+        .commands = commands,
+        .commands_size = capacity,
+        .writeback = discard_writeback,
+        .writeback_data = NULL,
+    };
+    CliHeader header = libcli_new(&info);
+
+    CliArgumentType echo_args[] = { cli_argument_type_string };
+    bool added = libcli_add(&header, "echo", "repeats its argument", 1, echo_args, echo_command);
+    assert(added);
+
+    return header;
+}
+
+static void socket_path(char* buffer, size_t size) {
+    snprintf(buffer, size, "/tmp/libcli_server_tests_%ld.sock", (long)getpid());
+}
+
+static int connect_unix(const char* path) {
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+    strcpy(address.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    assert(fd >= 0);
+    int status = connect(fd, (const struct sockaddr*)&address, sizeof(address));
+    assert(status == 0);
+
+    return fd;
+}
+
+static int connect_tcp(uint16_t port) {
+    struct sockaddr_in address = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    assert(fd >= 0);
+    int status = connect(fd, (const struct sockaddr*)&address, sizeof(address));
+    assert(status == 0);
+
+    return fd;
+}
+
+static void send_string(int fd, const char* string) {
+    size_t length = strlen(string);
+    ssize_t sent = send(fd, string, length, 0);
+    assert(sent == (ssize_t)length);
+}
+
+// Run the server until `line_count` lines have arrived on `fd`.
+static void receive_lines(CliServer* server, int fd, char* buffer, size_t size, size_t line_count) {
+    size_t length = 0;
+
+    while (line_count > 0) {
+        ssize_t received = recv(fd, &buffer[length], size - 1 - length, MSG_DONTWAIT);
+
+        if (received > 0) {
+            for (ssize_t i = 0; (i < received) && (line_count > 0); i++) {
+                line_count -= (buffer[length + (size_t)i] == '\n') ? 1 : 0;
+            }
+
+            length += (size_t)received;
+            assert(length < size - 1);
+        } else {
+            assert((received < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)));
+            bool polled = libcli_server_poll(server, 10);
+            assert(polled);
+        }
+    }
+
+    buffer[length] = '\0';
+}
+
+// Run the server until the output on `fd` ends with `ending`. Returns the number of bytes received.
+static size_t receive_until(CliServer* server, int fd, const char* ending) {
+    size_t ending_length = strlen(ending);
+    char tail[64] = { 0 };
+    const char* tail_end = &tail[sizeof(tail) - 1 - ending_length];
+    size_t total = 0;
+
+    while ((total < ending_length) || (strcmp(tail_end, ending) != 0)) {
+        char buffer[4096];
+        ssize_t received = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+
+        if (received > 0) {
+            // Keep the last bytes received, in `tail` before its terminator
+            for (ssize_t i = 0; i < received; i++) {
+                memmove(tail, &tail[1], sizeof(tail) - 2);
+                tail[sizeof(tail) - 2] = buffer[i];
+            }
+
+            total += (size_t)received;
+        } else {
+            assert((received < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)));
+            bool polled = libcli_server_poll(server, 10);
+            assert(polled);
+        }
+    }
+
+    return total;
+}
+
+// Tests
+
+static void thousands_of_unix_sessions(void) {
+    // Given
+    CliCommand commands[2];
+    CliHeader header = new_echo_cli(commands, 2);
+
+    char path[64];
+    socket_path(path, sizeof(path));
+
+    CliServer server;
+    CliServerInfo info = {
+        .header = &header,
+        .sessions = sessions,
+        .sessions_size = session_capacity,
+        .unix_path = path,
+        .userdata = NULL,
+    };
+    bool created = libcli_server_new(&server, &info);
+    assert(created);
+
+    static int clients[load_session_count];
+    for (size_t i = 0; i < load_session_count; i++) {
+        clients[i] = connect_unix(path);
+        libcli_server_poll(&server, 0);
+    }
+
+    // When
+    for (size_t i = 0; i < load_session_count; i++) {
+        char line[32];
+        snprintf(line, sizeof(line), "echo session-%zu\n", i);
+        send_string(clients[i], line);
+    }
+
+    // Then
+    for (size_t i = 0; i < load_session_count; i++) {
+        char expected[32];
+        snprintf(expected, sizeof(expected), "session-%zu\n", i);
+
+        char reply[32];
+        receive_lines(&server, clients[i], reply, sizeof(reply), 1);
+        assert(strcmp(expected, reply) == 0);
+    }
+
+    assert(server.session_count == load_session_count);
+
+    // When
+    for (size_t i = 0; i < load_session_count; i++) {
+        close(clients[i]);
+    }
+
+    while (server.session_count > 0) {
+        libcli_server_poll(&server, 10);
+    }
+
+    libcli_server_delete(&server);
+}
+
+static void tcp_session_receives_its_own_output(void) {
+    // Given
+    CliCommand commands[2];
+    CliHeader header = new_echo_cli(commands, 2);
+
+    CliServer server;
+    CliServerInfo info = {
+        .header = &header,
+        .sessions = sessions,
+        .sessions_size = 2,
+        .unix_path = NULL,
+        .tcp_port = 0,
+        .userdata = NULL,
+    };
+    bool created = libcli_server_new(&server, &info);
+    assert(created);
+
+    uint16_t port = libcli_server_port(&server);
+    assert(port != 0);
+
+    int first = connect_tcp(port);
+    int second = connect_tcp(port);
+
+    // When, Then
+    send_string(first, "ec");
+    libcli_server_poll(&server, 10);
+    send_string(second, "echo two\r\n");
+    send_string(first, "ho one\n");
+
+    char reply[256];
+    receive_lines(&server, second, reply, sizeof(reply), 1);
+    assert(strcmp("two\n", reply) == 0);
+    receive_lines(&server, first, reply, sizeof(reply), 1);
+    assert(strcmp("one\n", reply) == 0);
+
+    // When, Then
+    send_string(second, "help\n");
+    receive_lines(&server, second, reply, sizeof(reply), 3);
+    const char* expected = "list of commands:\n"
+        "    echo    repeats its argument\n"
+        "    help    displays information about commands\n";
+    assert(strcmp(expected, reply) == 0);
+
+    close(first);
+    close(second);
+    libcli_server_delete(&server);
+}
+
+static void overlong_lines_are_discarded(void) {
+    // Given
+    CliCommand commands[2];
+    CliHeader header = new_echo_cli(commands, 2);
+
+    CliServer server;
+    CliServerInfo info = {
+        .header = &header,
+        .sessions = sessions,
+        .sessions_size = 1,
+        .unix_path = NULL,
+        .tcp_port = 0,
+        .userdata = NULL,
+    };
+    bool created = libcli_server_new(&server, &info);
+    assert(created);
+
+    int client = connect_tcp(libcli_server_port(&server));
+
+    // When
+    char line[cli_session_input_size * 2];
+    memset(line, 'x', sizeof(line) - 1);
+    memcpy(line, "echo ", 5);
+    line[sizeof(line) - 1] = '\0';
+
+    send_string(client, line);
+    for (size_t i = 0; i < 4; i++) {
+        libcli_server_poll(&server, 10);
+    }
+    send_string(client, "\necho after\n");
+
+    // Then
+    char reply[256];
+    receive_lines(&server, client, reply, sizeof(reply), 1);
+    assert(strcmp("after\n", reply) == 0);
+
+    close(client);
+    libcli_server_delete(&server);
+}
+
+static void sessions_have_their_own_contexts(void) {
+    // Given
+    CliCommand commands[4];
+    CliHeader header = new_echo_cli(commands, 4);
+    bool added = libcli_add(&header, "debug", "enter debug mode", 0, NULL, debug_command);
+    assert(added);
+
+    CliCommand debug_commands[1];
+    debug_context = libcli_context_new("debug", debug_commands, 1);
+    added = libcli_context_add(&header, &debug_context, "prompt", "", 0, NULL, prompt_command);
+    assert(added);
+
+    CliServer server;
+    CliServerInfo info = {
+        .header = &header,
+        .sessions = sessions,
+        .sessions_size = 2,
+        .unix_path = NULL,
+        .tcp_port = 0,
+        .userdata = NULL,
+    };
+    bool created = libcli_server_new(&server, &info);
+    assert(created);
+
+    int first = connect_tcp(libcli_server_port(&server));
+    int second = connect_tcp(libcli_server_port(&server));
+
+    // When
+    send_string(first, "debug\nprompt\n");
+    send_string(second, "prompt\necho done\n");
+
+    // Then
+    char reply[256];
+    receive_lines(&server, first, reply, sizeof(reply), 1);
+    assert(strcmp("debug\n", reply) == 0);
+    receive_lines(&server, second, reply, sizeof(reply), 1);
+    assert(strcmp("done\n", reply) == 0);
+
+    close(first);
+    close(second);
+    libcli_server_delete(&server);
+}
+
+static void replies_larger_than_the_queue_are_written_in_full(void) {
+    // Given
+    CliCommand commands[3];
+    CliHeader header = new_echo_cli(commands, 3);
+
+    CliArgumentType flood_args[] = { cli_argument_type_int };
+    bool added = libcli_add(&header, "flood", "writes kilobytes", 1, flood_args, flood_command);
+    assert(added);
+
+    CliServer server;
+    CliServerInfo info = {
+        .header = &header,
+        .sessions = sessions,
+        .sessions_size = 1,
+        .unix_path = NULL,
+        .tcp_port = 0,
+        .userdata = NULL,
+    };
+    bool created = libcli_server_new(&server, &info);
+    assert(created);
+
+    int client = connect_tcp(libcli_server_port(&server));
+
+    // When
+    send_string(client, "flood 8\necho after\n");
+
+    // Then
+    char reply[(8 * flood_chunk_size) + 64];
+    receive_lines(&server, client, reply, sizeof(reply), 9);
+    assert(strlen(reply) == (8 * flood_chunk_size) + strlen("after\n"));
+    assert(strcmp(&reply[8 * flood_chunk_size], "after\n") == 0);
+
+    close(client);
+    libcli_server_delete(&server);
+}
+
+static void output_the_connection_cannot_take_is_reported(void) {
+    // Given
+    CliCommand commands[3];
+    CliHeader header = new_echo_cli(commands, 3);
+
+    CliArgumentType flood_args[] = { cli_argument_type_int };
+    bool added = libcli_add(&header, "flood", "writes kilobytes", 1, flood_args, flood_command);
+    assert(added);
+
+    char path[64];
+    socket_path(path, sizeof(path));
+
+    CliServer server;
+    CliServerInfo info = {
+        .header = &header,
+        .sessions = sessions,
+        .sessions_size = 1,
+        .unix_path = path,
+        .userdata = NULL,
+    };
+    bool created = libcli_server_new(&server, &info);
+    assert(created);
+
+    int client = connect_unix(path);
+    libcli_server_poll(&server, 0);
+
+    // When (the client reads nothing until the command is done)
+    send_string(client, "flood 4096\n");
+    libcli_server_poll(&server, 10);
+
+    // Then
+    size_t received = receive_until(&server, client, "(output truncated)\n");
+    assert(received < 4096 * flood_chunk_size);
+
+    // When, Then
+    send_string(client, "echo after\n");
+    char reply[64];
+    receive_lines(&server, client, reply, sizeof(reply), 1);
+    assert(strcmp("after\n", reply) == 0);
+
+    close(client);
+    libcli_server_delete(&server);
+}
+
+static void watches_are_written_to_their_sessions(void) {
+    // Given
+    CliCommand commands[8];
+    CliJob entries[2];
+    CliJobs jobs;
+    fake_time = 0;
+    bool initialized = libcli_jobs_init(&jobs, entries, 2, fake_clock, 1000);
+    assert(initialized);
+
+    CliNewInfo cli_info = {
+        .commands = commands,
+        .commands_size = 8,
+        .writeback = discard_writeback,
+        .writeback_data = NULL,
+        .jobs = &jobs,
+    };
+    CliHeader header = libcli_new(&cli_info);
+
+    CliArgumentType flood_args[] = { cli_argument_type_int };
+    bool added = libcli_add(&header, "flood", "writes kilobytes", 1, flood_args, flood_command);
+    assert(added);
+
+    CliServer server;
+    CliServerInfo info = {
+        .header = &header,
+        .sessions = sessions,
+        .sessions_size = 1,
+        .unix_path = NULL,
+        .tcp_port = 0,
+        .userdata = NULL,
+    };
+    bool created = libcli_server_new(&server, &info);
+    assert(created);
+
+    int client = connect_tcp(libcli_server_port(&server));
+    send_string(client, "watch 10 flood 2\n");
+
+    char reply[(2 * flood_chunk_size) + 64];
+    receive_lines(&server, client, reply, sizeof(reply), 1);
+    assert(strcmp("job 1\n", reply) == 0);
+
+    // When (the watch writes more than the session's queue holds, between polls)
+    fake_time = 10;
+    size_t runs = libcli_jobs_service(&header, &jobs, NULL);
+    libcli_server_flush(&server);
+
+    // Then (all of it arrives without further input)
+    assert(runs == 1);
+    receive_lines(&server, client, reply, sizeof(reply), 2);
+    assert(strlen(reply) == 2 * flood_chunk_size);
+
+    // When (the session closes)
+    close(client);
+
+    while (server.session_count > 0) {
+        bool polled = libcli_server_poll(&server, 10);
+        assert(polled);
+    }
+
+    // Then (its watch stopped with it)
+    assert(!libcli_jobs_stats(&jobs, 1, &(CliJobStats){ 0 }));
+
+    libcli_server_delete(&server);
+}
+
+// Test runner
+
+int main(void) {
+    typedef void (*Test)(void);
+
+    const Test tests[] = {
+        thousands_of_unix_sessions,
+        tcp_session_receives_its_own_output,
+        overlong_lines_are_discarded,
+        sessions_have_their_own_contexts,
+        replies_larger_than_the_queue_are_written_in_full,
+        output_the_connection_cannot_take_is_reported,
+        watches_are_written_to_their_sessions,
+    };
+
+    const size_t test_count = sizeof(tests) / sizeof(Test);
+    for (size_t i = 0; i < test_count; i++) {
+        Test test = tests[i];
+        test();
+    }
+
+    printf("All tests (%zu) passed.\n", test_count);
+}
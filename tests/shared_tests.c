@@ -0,0 +1,291 @@
+#include "cli_cache.h"
+#include "cli_macro.h"
+#include "cli_record.h"
+#include "cli_shared.h"
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+// Mocks & utility
+
+enum {
+    capacity = 16,
+    reader_count = 2,
+    reader_runs = 100000,
+    writer_updates = 2000,
+};
+
+static atomic_size_t stable_calls;
+static atomic_size_t plugin_calls;
+
+static atomic_bool in_slow_command;
+static atomic_bool writer_started;
+static atomic_bool writer_finished;
+
+static void discard_writeback(const char* string, void* userdata) {
+    (void)string;
+    (void)userdata;
+}
+
+static void yield(void) {
+    sched_yield();
+}
+
+static void stable_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* data
+) {
+    (void)header;
+    (void)argc;
+    (void)argv;
+    (void)data;
+    atomic_fetch_add(&stable_calls, 1);
+}
+
+static void plugin_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* data
+) {
+    (void)header;
+    (void)argc;
+    (void)argv;
+    (void)data;
+    atomic_fetch_add(&plugin_calls, 1);
+}
+
+// Waits for a writer to start, and checks that it cannot finish until the command returns
+static void slow_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* data
+) {
+    (void)argc;
+    (void)argv;
+    (void)data;
+    atomic_store(&in_slow_command, true);
+
+    while (!atomic_load(&writer_started)) {
+        sched_yield();
+    }
+
+    for (size_t i = 0; i < 100; i++) {
+        sched_yield();
+        assert(!atomic_load(&writer_finished));
+    }
+
+    // The run's snapshot still holds the removed command.
+    char stable[] = "stable";
+    assert(libcli_run(header, stable, NULL) == cli_run_result_ok);
+}
+
+static CliHeader new_shared_cli(
+    CliCommand* commands,
+    CliCommand* spare_commands,
+    CliSharedCommands* shared
+) {
+    CliNewInfo info = {
+        .commands = commands,
+        .commands_size = capacity,
+        .writeback = discard_writeback,
+        .writeback_data = NULL,
+    };
+    CliHeader header = libcli_new(&info);
+
+    bool added = libcli_add(&header, "stable", "always there", 0, NULL, stable_command);
+    assert(added);
+
+    bool shared_commands = libcli_share_commands(&header, shared, spare_commands, yield);
+    assert(shared_commands);
+    assert(!libcli_share_commands(&header, shared, spare_commands, yield));
+
+    return header;
+}
+
+static void* run_commands(void* data) {
+    const CliHeader* header = (const CliHeader*)data;
+
+    for (size_t i = 0; i < reader_runs; i++) {
+        char stable[] = "stable";
+        CliRunResult result = libcli_run(header, stable, NULL);
+        assert(result == cli_run_result_ok);
+
+        char plugin[] = "plugin";
+        result = libcli_run(header, plugin, NULL);
+        assert((result == cli_run_result_ok) || (result == cli_run_result_unknown));
+    }
+
+    return NULL;
+}
+
+static void* remove_stable_command(void* data) {
+    CliHeader* header = (CliHeader*)data;
+
+    while (!atomic_load(&in_slow_command)) {
+        sched_yield();
+    }
+
+    atomic_store(&writer_started, true);
+    bool removed = libcli_remove(header, "stable");
+    atomic_store(&writer_finished, true);
+
+    assert(removed);
+    return NULL;
+}
+
+// Tests
+
+static void commands_can_be_added_and_removed_while_running(void) {
+    // Given
+    CliCommand commands[capacity];
+    CliCommand spare_commands[capacity];
+    CliSharedCommands shared;
+    CliHeader header = new_shared_cli(commands, spare_commands, &shared);
+
+    pthread_t readers[reader_count];
+    for (size_t i = 0; i < reader_count; i++) {
+        int status = pthread_create(&readers[i], NULL, run_commands, &header);
+        assert(status == 0);
+    }
+
+    // When
+    for (size_t i = 0; i < writer_updates; i++) {
+        bool added = libcli_add(&header, "plugin", "comes and goes", 0, NULL, plugin_command);
+        assert(added);
+        assert(!libcli_add(&header, "plugin", "comes and goes", 0, NULL, plugin_command));
+
+        bool removed = libcli_remove(&header, "plugin");
+        assert(removed);
+        assert(!libcli_remove(&header, "plugin"));
+    }
+
+    for (size_t i = 0; i < reader_count; i++) {
+        pthread_join(readers[i], NULL);
+    }
+
+    // Then
+    assert(atomic_load(&stable_calls) == reader_count * reader_runs);
+    assert(atomic_load(&plugin_calls) <= reader_count * reader_runs);
+
+    char plugin[] = "plugin";
+    assert(libcli_run(&header, plugin, NULL) == cli_run_result_unknown);
+}
+
+static void writers_wait_for_running_commands(void) {
+    // Given
+    CliCommand commands[capacity];
+    CliCommand spare_commands[capacity];
+    CliSharedCommands shared;
+    CliHeader header = new_shared_cli(commands, spare_commands, &shared);
+
+    bool added = libcli_add(&header, "slow", "waits for a writer", 0, NULL, slow_command);
+    assert(added);
+
+    // When
+    pthread_t writer;
+    int status = pthread_create(&writer, NULL, remove_stable_command, &header);
+    assert(status == 0);
+
+    char slow[] = "slow";
+    CliRunResult result = libcli_run(&header, slow, NULL);
+    pthread_join(writer, NULL);
+
+    // Then
+    assert(result == cli_run_result_ok);
+    assert(atomic_load(&writer_finished));
+
+    char stable[] = "stable";
+    assert(libcli_run(&header, stable, NULL) == cli_run_result_unknown);
+}
+
+static void macros_are_checked_against_the_current_table(void) {
+    // Given
+    CliCommand commands[capacity];
+    CliCommand spare_commands[capacity];
+    CliSharedCommands shared;
+    CliHeader header = new_shared_cli(commands, spare_commands, &shared);
+
+    char script[] = "stable";
+    uint8_t macro[64];
+    CliCompileResult compiled = libcli_compile(&header, script, macro, sizeof(macro));
+    assert(compiled.status == cli_run_result_ok);
+
+    // When, Then
+    assert(libcli_replay(&header, macro, compiled.size, NULL) == cli_run_result_ok);
+    assert(atomic_load(&stable_calls) == 1);
+
+    // When, Then
+    assert(libcli_add(&header, "plugin", "", 0, NULL, plugin_command));
+    assert(libcli_replay(&header, macro, compiled.size, NULL) == cli_run_result_bad_macro);
+}
+
+static void headers_with_unsynchronized_state_cannot_be_shared(void) {
+    // Given
+    CliCommand commands[capacity];
+    CliCommand spare_commands[capacity];
+    CliSharedCommands shared;
+
+    uint8_t ring[256];
+    CliRecorder recorder = libcli_recorder_new(ring, sizeof(ring), NULL);
+    CliCacheEntry entries[2];
+    CliCache cache = libcli_cache_new(entries, 2, NULL, 0);
+
+    CliNewInfo info = {
+        .commands = commands,
+        .commands_size = capacity,
+        .writeback = discard_writeback,
+        .writeback_data = NULL,
+        .recorder = &recorder,
+    };
+
+    // When, Then (runs write to the recorder and cache without locks)
+    CliHeader recorded = libcli_new(&info);
+    assert(!libcli_share_commands(&recorded, &shared, spare_commands, yield));
+
+    info.recorder = NULL;
+    info.cache = &cache;
+    CliHeader cached = libcli_new(&info);
+    assert(!libcli_share_commands(&cached, &shared, spare_commands, yield));
+
+    // When, Then
+    info.cache = NULL;
+    CliHeader plain = libcli_new(&info);
+    assert(libcli_share_commands(&plain, &shared, spare_commands, yield));
+}
+
+// Test runner
+
+static void cleanup(void) {
+    atomic_store(&stable_calls, 0);
+    atomic_store(&plugin_calls, 0);
+    atomic_store(&in_slow_command, false);
+    atomic_store(&writer_started, false);
+    atomic_store(&writer_finished, false);
+}
+
+int main(void) {
+    typedef void (*Test)(void);
+
+    const Test tests[] = {
+        commands_can_be_added_and_removed_while_running,
+        writers_wait_for_running_commands,
+        macros_are_checked_against_the_current_table,
+        headers_with_unsynchronized_state_cannot_be_shared,
+    };
+
+    const size_t test_count = sizeof(tests) / sizeof(Test);
+    for (size_t i = 0; i < test_count; i++) {
+        Test test = tests[i];
+        test();
+        cleanup();
+    }
+
+    printf("All tests (%zu) passed.\n", test_count);
+}
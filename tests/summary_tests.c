@@ -0,0 +1,198 @@
+#include "cli.h"
+#include "internal/summary.h"
+#include "test_summaries.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+// Mocks & utility
+
+static char writeback_buffer[2048] = {0};
+static size_t writeback_call_count = 0;
+static size_t writeback_longest_string = 0;
+
+static void writeback(const char* string, void* userdata) {
+    (void)userdata;
+
+    size_t length = strlen(string);
+    writeback_longest_string = (length > writeback_longest_string) ? length : writeback_longest_string;
+    writeback_call_count += 1;
+
+    strncat(writeback_buffer, string, sizeof(writeback_buffer) - strlen(writeback_buffer) - 1);
+}
+
+static void empty_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* userdata
+) {
+    (void)header;
+    (void)argc;
+    (void)argv;
+    (void)userdata;
+}
+
+static CliHeader new_cli(CliCommand* commands, size_t capacity) {
+    CliNewInfo info = {
+        .commands = commands,
+        .commands_size = capacity,
+        .writeback = writeback,
+        .summary_blob = test_summaries,
+        .summary_blob_size = test_summaries_size,
+    };
+    return libcli_new(&info);
+}
+
+// Tests
+
+static void help_decompresses_summaries(void) {
+    // Given
+    enum { capacity = 8 };
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity);
+    libcli_add(&header, "enable-sensor", SUMMARY_ENABLE_SENSOR, 0, NULL, empty_command);
+    libcli_add(&header, "fan-speed", SUMMARY_FAN_SPEED, 0, NULL, empty_command);
+    libcli_add(&header, "disable-heater", SUMMARY_DISABLE_HEATER, 0, NULL, empty_command);
+    libcli_add(&header, "plain", "is not compressed", 0, NULL, empty_command);
+    libcli_add(&header, "quiet", SUMMARY_EMPTY, 0, NULL, empty_command);
+
+    // When
+    char help[] = "help";
+    CliRunResult result = libcli_run(&header, help, NULL);
+
+    // Then
+    const char* expected = "list of commands:\n"
+        "    disable-heater    disables the heater\n"
+        "    enable-sensor     enables the sensor and starts sampling\n"
+        "    fan-speed         sets the speed of the fan, in percent of the maximum speed\n"
+        "    help              displays information about commands\n"
+        "    plain             is not compressed\n"
+        "    quiet             \n";
+
+    assert(result == cli_run_result_ok);
+    assert(strcmp(writeback_buffer, expected) == 0);
+}
+
+static void search_indexes_compressed_summaries(void) {
+    // Given
+    enum { capacity = 8, keyword_capacity = 32 };
+    CliCommand commands[capacity];
+    CliKeyword keywords[keyword_capacity];
+    CliNewInfo info = {
+        .commands = commands,
+        .commands_size = capacity,
+        .writeback = writeback,
+        .summary_blob = test_summaries,
+        .summary_blob_size = test_summaries_size,
+        .keywords = keywords,
+        .keywords_size = keyword_capacity,
+    };
+    CliHeader header = libcli_new(&info);
+    libcli_add(&header, "enable-sensor", SUMMARY_ENABLE_SENSOR, 0, NULL, empty_command);
+    libcli_add(&header, "fan-speed", SUMMARY_FAN_SPEED, 0, NULL, empty_command);
+    libcli_add(&header, "sensor-rate", SUMMARY_SENSOR_RATE, 0, NULL, empty_command);
+
+    // When
+    char search[] = "help -s sampling";
+    CliRunResult result = libcli_run(&header, search, NULL);
+
+    // Then
+    const char* expected = "commands matching sampling:\n"
+        "    enable-sensor    enables the sensor and starts sampling\n"
+        "    sensor-rate      sets the sampling rate of the sensor, in samples per second\n";
+
+    assert(result == cli_run_result_ok);
+    assert(strcmp(writeback_buffer, expected) == 0);
+}
+
+static void long_summaries_are_streamed_in_chunks(void) {
+    // Given
+    enum { capacity = 4 };
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity);
+
+    // When
+    libcli_write_summary(&header, SUMMARY_LONG);
+
+    // Then
+    const char* expected = "displays a long summary which is written back in several chunks, to "
+        "check that text longer than the scratch buffer is streamed correctly: 0123456789 "
+        "\"quoted\" {braces} ~tilde~";
+
+    assert(strcmp(writeback_buffer, expected) == 0);
+    assert(writeback_call_count > 1);
+    assert(writeback_longest_string < 32);
+}
+
+static void only_summaries_in_the_blob_are_compressed(void) {
+    // Given
+    enum { capacity = 4 };
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity);
+
+    // When, Then
+    assert(libcli_is_compressed_summary(&header, SUMMARY_FAN_STATUS));
+    assert(libcli_is_compressed_summary(&header, SUMMARY_EMPTY));
+    assert(!libcli_is_compressed_summary(&header, "displays the status of the fan"));
+
+    // When, Then (no blob)
+    header.summary_blob = NULL;
+    assert(!libcli_is_compressed_summary(&header, SUMMARY_FAN_STATUS));
+}
+
+static void ignores_damaged_blobs(void) {
+    // Given
+    enum { capacity = 4 };
+    CliCommand commands[capacity];
+    CliHeader header = new_cli(commands, capacity);
+    unsigned char damaged[test_summaries_size];
+    memcpy(damaged, test_summaries, test_summaries_size);
+    damaged[0] = 'X';
+
+    header.summary_blob = damaged;
+    const char* summary = (const char*)&damaged[SUMMARY_FAN_STATUS - (const char*)test_summaries];
+
+    // When
+    libcli_write_summary(&header, summary);
+
+    // Then
+    assert(writeback_call_count == 0);
+
+    // When (truncated before the summary ends)
+    memcpy(damaged, test_summaries, test_summaries_size);
+    header.summary_blob_size = (size_t)(summary - (const char*)damaged) + 1;
+    libcli_write_summary(&header, summary);
+
+    // Then
+    assert(strlen(writeback_buffer) < strlen("displays the status of the fan"));
+}
+
+// Test runner
+
+static void cleanup(void) {
+    memset(writeback_buffer, 0, sizeof(writeback_buffer));
+    writeback_call_count = 0;
+    writeback_longest_string = 0;
+}
+
+int main(void) {
+    typedef void (*Test)(void);
+
+    const Test tests[] = {
+        help_decompresses_summaries,
+        search_indexes_compressed_summaries,
+        long_summaries_are_streamed_in_chunks,
+        only_summaries_in_the_blob_are_compressed,
+        ignores_damaged_blobs,
+    };
+
+    const size_t test_count = sizeof(tests) / sizeof(Test);
+    for (size_t i = 0; i < test_count; i++) {
+        Test test = tests[i];
+        test();
+        cleanup();
+    }
+
+    printf("All tests (%zu) passed.\n", test_count);
+}
@@ -0,0 +1,20 @@
+#include "cli.h"
+
+// A command module loaded by module_tests. Commands add their argument to the int at `userdata`.
+
+void test_module_add(const CliHeader* header, size_t argc, const CliArgument* argv, void* userdata) {
+    (void)header;
+    (void)argc;
+    *(int*)userdata += argv[0].integer;
+}
+
+void test_module_add_twice(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* userdata
+) {
+    (void)header;
+    (void)argc;
+    *(int*)userdata += 2 * argv[0].integer;
+}
@@ -14,28 +14,52 @@ static void* second_command_last_userdata = NULL;
 static void* third_command_last_userdata = NULL;
 static void* fourth_command_last_userdata = NULL;
 
-static void first_command(size_t argc, const CliArgument* argv, void* userdata) {
+static void first_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* userdata
+) {
+    (void)header;
     (void)argc;
     (void)argv;
     first_command_call_count += 1;
     first_command_last_userdata = userdata;
 }
 
-static void second_command(size_t argc, const CliArgument* argv, void* userdata) {
+static void second_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* userdata
+) {
+    (void)header;
     (void)argc;
     (void)argv;
     second_command_call_count += 1;
     second_command_last_userdata = userdata;
 }
 
-static void third_command(size_t argc, const CliArgument* argv, void* userdata) {
+static void third_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* userdata
+) {
+    (void)header;
     (void)argc;
     (void)argv;
     third_command_call_count += 1;
     third_command_last_userdata = userdata;
 }
 
-static void fourth_command(size_t argc, const CliArgument* argv, void* userdata) {
+static void fourth_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* userdata
+) {
+    (void)header;
     (void)argc;
     (void)argv;
     fourth_command_call_count += 1;
@@ -46,7 +70,13 @@ static int integer_float_command_arg0 = 0;
 static float integer_float_command_arg1 = 0.0f;
 static size_t integer_float_command_call_count = 0;
 
-static void integer_float_command(size_t argc, const CliArgument* argv, void* userdata) {
+static void integer_float_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* userdata
+) {
+    (void)header;
     (void)userdata;
 
     assert(argc == 2);
@@ -60,7 +90,13 @@ static void integer_float_command(size_t argc, const CliArgument* argv, void* us
 
 static size_t four_string_command_last_argc = {0};
 static CliArgument four_string_command_last_argv[8] = {0};
-static void four_string_command(size_t argc, const CliArgument* argv, void* userdata) {
+static void four_string_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* userdata
+) {
+    (void)header;
     (void)userdata;
 
     assert(argc < 8);
@@ -68,8 +104,28 @@ static void four_string_command(size_t argc, const CliArgument* argv, void* user
     memcpy(four_string_command_last_argv, argv, sizeof(CliArgument) * argc);
 }
 
+static void lines_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* userdata
+) {
+    (void)argc;
+    (void)argv;
+    (void)userdata;
+
+    libcli_write(header, "reg0 0x40\nreg1 0x00\nreg2 0x41\nreg3 0x40\n");
+}
+
+// A clock which advances by 10 ticks every time it is read
+static uint32_t fake_clock_ticks = 0;
+static uint32_t fake_clock(void) {
+    fake_clock_ticks += 10;
+    return fake_clock_ticks;
+}
+
 static size_t writeback_size = 0;
-static char writeback_buffer[512] = {0};
+static char writeback_buffer[1024] = {0};
 
 static void write_to_buffer(const char* string, void* userdata) {
     (void)userdata;
@@ -104,7 +160,12 @@ static void can_init_and_register_single_command(void) {
     // Given
     enum { capacity = 32 };
     CliCommand commands[capacity];
-    CliNewInfo info = { commands, capacity, printf_writeback, NULL };
+    CliNewInfo info = {
+        .commands = commands,
+        .commands_size = capacity,
+        .writeback = printf_writeback,
+        .writeback_data = NULL,
+    };
     CliHeader header = libcli_new(&info);
 
     bool added = libcli_add(&header, "first", "", 0, NULL, first_command);
@@ -129,7 +190,12 @@ static void can_register_multiple_commands(void) {
     // Given
     enum { capacity = 5 };
     CliCommand commands[capacity];
-    CliNewInfo info = { commands, capacity, printf_writeback, NULL };
+    CliNewInfo info = {
+        .commands = commands,
+        .commands_size = capacity,
+        .writeback = printf_writeback,
+        .writeback_data = NULL,
+    };
     CliHeader header = libcli_new(&info);
 
     bool added_all_commands = libcli_add(&header, "first", "", 0, NULL, first_command)
@@ -173,7 +239,12 @@ static void cant_exceed_capacity(void) {
     // Given
     enum { capacity = 2 };
     CliCommand commands[capacity];
-    CliNewInfo info = { commands, capacity, printf_writeback, NULL };
+    CliNewInfo info = {
+        .commands = commands,
+        .commands_size = capacity,
+        .writeback = printf_writeback,
+        .writeback_data = NULL,
+    };
     CliHeader header = libcli_new(&info);
 
     bool added = libcli_add(&header, "first", "", 0, NULL, first_command);
@@ -198,7 +269,12 @@ static void automatic_help_command(void) {
     // Given
     enum { capacity = 4 };
     CliCommand commands[capacity];
-    CliNewInfo info = { commands, capacity, write_to_buffer, NULL };
+    CliNewInfo info = {
+        .commands = commands,
+        .commands_size = capacity,
+        .writeback = write_to_buffer,
+        .writeback_data = NULL,
+    };
     CliHeader header = libcli_new(&info);
 
     // When, Then
@@ -239,13 +315,221 @@ static void automatic_help_command(void) {
     assert(strcmp(expected, writeback_buffer) == 0);
 }
 
+static void help_topics(void) {
+    // Given
+    enum { capacity = 4 };
+    CliCommand commands[capacity];
+    CliNewInfo info = {
+        .commands = commands,
+        .commands_size = capacity,
+        .writeback = write_to_buffer,
+        .writeback_data = NULL,
+        .parse_float = libcli_parse_float,
+    };
+    CliHeader header = libcli_new(&info);
+
+    CliArgumentType example_types[] = { cli_argument_type_int, cli_argument_type_float };
+    libcli_add(&header, "example", "does an example", 2, example_types, integer_float_command);
+
+    // When, Then
+    char input[] = "help example";
+    assert(libcli_run(&header, input, NULL) == cli_run_result_ok);
+    assert(strcmp("example <int> <float>\n    does an example\n", writeback_buffer) == 0);
+
+    // When, Then
+    clear_writeback_buffer();
+    char input2[] = "help help";
+    assert(libcli_run(&header, input2, NULL) == cli_run_result_ok);
+    const char* expected = "help [<command> | -s <word>]\n"
+        "    displays information about commands\n";
+    assert(strcmp(expected, writeback_buffer) == 0);
+
+    // When, Then
+    clear_writeback_buffer();
+    char unknown[] = "help nothing";
+    assert(libcli_run(&header, unknown, NULL) == cli_run_result_unknown);
+    char too_many[] = "help example help";
+    assert(libcli_run(&header, too_many, NULL) == cli_run_result_bad_argc);
+    assert(writeback_size == 0);
+}
+
+// Add commands to search for with `help -s`
+static void add_search_commands(CliHeader* header) {
+    libcli_add(header, "set-gain", "sets the amplifier gain", 0, NULL, first_command);
+    libcli_add(header, "get-gain", "reads back the Gain", 0, NULL, second_command);
+    libcli_add(header, "reset", "resets the amplifier and gain stages", 0, NULL, third_command);
+    libcli_add(header, "status", "shows the link state", 0, NULL, fourth_command);
+}
+
+static void help_search(void) {
+    // Given
+    enum { capacity = 8, keyword_capacity = 64 };
+    CliCommand commands[capacity];
+    CliKeyword keywords[keyword_capacity];
+    CliNewInfo info = {
+        .commands = commands,
+        .commands_size = capacity,
+        .writeback = write_to_buffer,
+        .writeback_data = NULL,
+        .keywords = keywords,
+        .keywords_size = keyword_capacity,
+    };
+    CliHeader header = libcli_new(&info);
+    add_search_commands(&header);
+
+    // When, Then (names and summaries match whole words, ignoring case)
+    char input[] = "help -s GAIN";
+    assert(libcli_run(&header, input, NULL) == cli_run_result_ok);
+    const char* expected = "commands matching GAIN:\n"
+        "    get-gain    reads back the Gain\n"
+        "    reset       resets the amplifier and gain stages\n"
+        "    set-gain    sets the amplifier gain\n";
+    assert(strcmp(expected, writeback_buffer) == 0);
+
+    // When, Then
+    clear_writeback_buffer();
+    char input2[] = "help -s stat";
+    assert(libcli_run(&header, input2, NULL) == cli_run_result_ok);
+    assert(strcmp("commands matching stat:\n    (none)\n", writeback_buffer) == 0);
+
+    // When, Then
+    char short_word[] = "help -s of";
+    assert(libcli_run(&header, short_word, NULL) == cli_run_result_bad_argument);
+    char not_a_word[] = "help -s set-gain";
+    assert(libcli_run(&header, not_a_word, NULL) == cli_run_result_bad_argument);
+    char no_word[] = "help -s";
+    assert(libcli_run(&header, no_word, NULL) == cli_run_result_bad_argc);
+}
+
+static void help_search_compares_words(void) {
+    // Given ("glbvs" and "yacxa" have the same hash)
+    enum { capacity = 4, keyword_capacity = 16 };
+    CliCommand commands[capacity];
+    CliKeyword keywords[keyword_capacity];
+    CliNewInfo info = {
+        .commands = commands,
+        .commands_size = capacity,
+        .writeback = write_to_buffer,
+        .writeback_data = NULL,
+    };
+    CliHeader unindexed = libcli_new(&info);
+    libcli_add(&unindexed, "reset", "clears the yacxa", 0, NULL, first_command);
+
+    info.keywords = keywords;
+    info.keywords_size = keyword_capacity;
+    CliHeader indexed = libcli_new(&info);
+    libcli_add(&indexed, "reset", "clears the yacxa", 0, NULL, first_command);
+
+    const char* expected = "commands matching glbvs:\n    (none)\n";
+
+    // When, Then
+    char input[] = "help -s glbvs";
+    assert(libcli_run(&indexed, input, NULL) == cli_run_result_ok);
+    assert(strcmp(expected, writeback_buffer) == 0);
+
+    // When, Then
+    clear_writeback_buffer();
+    char input2[] = "help -s glbvs";
+    assert(libcli_run(&unindexed, input2, NULL) == cli_run_result_ok);
+    assert(strcmp(expected, writeback_buffer) == 0);
+
+    // When, Then
+    clear_writeback_buffer();
+    char input3[] = "help -s YACXA";
+    assert(libcli_run(&indexed, input3, NULL) == cli_run_result_ok);
+    const char* found = "commands matching YACXA:\n    reset    clears the yacxa\n";
+    assert(strcmp(found, writeback_buffer) == 0);
+}
+
+static void can_remove_commands(void) {
+    // Given
+    enum { capacity = 8, keyword_capacity = 64 };
+    CliCommand commands[capacity];
+    CliKeyword keywords[keyword_capacity];
+    CliNewInfo info = {
+        .commands = commands,
+        .commands_size = capacity,
+        .writeback = write_to_buffer,
+        .writeback_data = NULL,
+        .keywords = keywords,
+        .keywords_size = keyword_capacity,
+    };
+    CliHeader header = libcli_new(&info);
+    add_search_commands(&header);
+    uint32_t fingerprint = header.fingerprint;
+
+    // When
+    bool removed = libcli_remove(&header, "get-gain");
+
+    // Then
+    assert(removed);
+    assert(!libcli_remove(&header, "get-gain"));
+
+    char get[] = "get-gain";
+    assert(libcli_run(&header, get, NULL) == cli_run_result_unknown);
+    char set[] = "set-gain";
+    assert(libcli_run(&header, set, NULL) == cli_run_result_ok);
+    assert(first_command_call_count == 1);
+
+    char search[] = "help -s gain";
+    assert(libcli_run(&header, search, NULL) == cli_run_result_ok);
+    const char* expected = "commands matching gain:\n"
+        "    reset       resets the amplifier and gain stages\n"
+        "    set-gain    sets the amplifier gain\n";
+    assert(strcmp(expected, writeback_buffer) == 0);
+
+    // When, Then (adding it back restores the fingerprint)
+    assert(libcli_add(&header, "get-gain", "reads back the Gain", 0, NULL, second_command));
+    assert(header.fingerprint == fingerprint);
+}
+
+static void help_search_without_full_index(void) {
+    // Given (no index, and an index which is too small)
+    enum { capacity = 8 };
+    CliCommand commands[capacity];
+    CliKeyword keywords[4];
+    CliNewInfo info = {
+        .commands = commands,
+        .commands_size = capacity,
+        .writeback = write_to_buffer,
+        .writeback_data = NULL,
+    };
+    CliHeader unindexed = libcli_new(&info);
+    add_search_commands(&unindexed);
+
+    info.keywords = keywords;
+    info.keywords_size = 4;
+    CliHeader partly_indexed = libcli_new(&info);
+    add_search_commands(&partly_indexed);
+
+    const char* expected = "commands matching amplifier:\n"
+        "    reset       resets the amplifier and gain stages\n"
+        "    set-gain    sets the amplifier gain\n";
+
+    // When, Then
+    char input[] = "help -s amplifier";
+    assert(libcli_run(&unindexed, input, NULL) == cli_run_result_ok);
+    assert(strcmp(expected, writeback_buffer) == 0);
+
+    // When, Then
+    clear_writeback_buffer();
+    char input2[] = "help -s amplifier";
+    assert(libcli_run(&partly_indexed, input2, NULL) == cli_run_result_ok);
+    assert(strcmp(expected, writeback_buffer) == 0);
+}
+
 static void writeback_data_is_passed_to_writeback(void) {
     // Given
     int userdata = 987654321;
 
     enum { capacity = 1 };
     CliCommand commands[capacity];
-    CliNewInfo info = { commands, capacity, writeback_userdata, &userdata };
+    CliNewInfo info = {
+        .commands = commands,
+        .commands_size = capacity,
+        .writeback = writeback_userdata,
+        .writeback_data = &userdata,
+    };
     CliHeader header = libcli_new(&info);
 
     // When
@@ -260,7 +544,12 @@ static void can_parse_complex_arguments(void) {
     // Given
     enum { capacity = 2 };
     CliCommand commands[capacity];
-    CliNewInfo info = { commands, capacity, printf_writeback, NULL };
+    CliNewInfo info = {
+        .commands = commands,
+        .commands_size = capacity,
+        .writeback = printf_writeback,
+        .writeback_data = NULL,
+    };
     CliHeader header = libcli_new(&info);
 
     // And
@@ -291,7 +580,13 @@ static void can_check_argument_types(void) {
     // Given
     enum { capacity = 2 };
     CliCommand commands[capacity];
-    CliNewInfo info = { commands, capacity, printf_writeback, NULL };
+    CliNewInfo info = {
+        .commands = commands,
+        .commands_size = capacity,
+        .writeback = printf_writeback,
+        .writeback_data = NULL,
+        .parse_float = libcli_parse_float,
+    };
     CliHeader header = libcli_new(&info);
 
     // And
@@ -312,7 +607,13 @@ static void invalid_numerical_arguments(void) {
     // Given
     enum { capacity = 2 };
     CliCommand commands[capacity];
-    CliNewInfo info = { commands, capacity, printf_writeback, NULL };
+    CliNewInfo info = {
+        .commands = commands,
+        .commands_size = capacity,
+        .writeback = printf_writeback,
+        .writeback_data = NULL,
+        .parse_float = libcli_parse_float,
+    };
     CliHeader header = libcli_new(&info);
 
     // And
@@ -334,6 +635,376 @@ static void invalid_numerical_arguments(void) {
     assert(result2 == cli_run_result_bad_argument);
 }
 
+static int32_t fixed_command_last_value = 0;
+
+static void fixed_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* userdata
+) {
+    (void)header;
+    (void)argc;
+    (void)userdata;
+
+    assert(argv[0].type == cli_argument_type_fixed);
+    fixed_command_last_value = argv[0].fixed;
+}
+
+static void fixed_point_arguments(void) {
+    // Given
+    enum { capacity = 2 };
+    CliCommand commands[capacity];
+    CliNewInfo info = {
+        .commands = commands,
+        .commands_size = capacity,
+        .writeback = printf_writeback,
+    };
+    CliHeader header = libcli_new(&info);
+
+    CliArgumentType fixed_types[] = { cli_argument_type_fixed };
+    libcli_add(&header, "set-level", "", 1, fixed_types, fixed_command);
+
+    // When
+    char input[] = "set-level -1.5";
+    CliRunResult result = libcli_run(&header, input, NULL);
+
+    // Then
+    assert(result == cli_run_result_ok);
+    assert(fixed_command_last_value == -(3 << (cli_fixed_fraction_bits - 1)));
+
+    // When, Then
+    char out_of_range[] = "set-level 1e9";
+    assert(libcli_run(&header, out_of_range, NULL) == cli_run_result_bad_argument);
+}
+
+static uint8_t blob_command_last_data[64] = {0};
+static size_t blob_command_last_size = 0;
+
+static void blob_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* userdata
+) {
+    (void)header;
+    (void)argc;
+    (void)userdata;
+
+    assert(argv[1].type == cli_argument_type_blob);
+    assert(argv[1].blob.size <= sizeof(blob_command_last_data));
+    memcpy(blob_command_last_data, argv[1].blob.data, argv[1].blob.size);
+    blob_command_last_size = argv[1].blob.size;
+}
+
+static void blob_arguments(void) {
+    // Given
+    enum { capacity = 2 };
+    CliCommand commands[capacity];
+    CliNewInfo info = {
+        .commands = commands,
+        .commands_size = capacity,
+        .writeback = printf_writeback,
+    };
+    CliHeader header = libcli_new(&info);
+
+    CliArgumentType blob_types[] = { cli_argument_type_int, cli_argument_type_blob };
+    libcli_add(&header, "write", "", 2, blob_types, blob_command);
+
+    // When
+    char input[] = "write 0 00ff10A0deadBEEF0123456789abcdef";
+    CliRunResult result = libcli_run(&header, input, NULL);
+
+    // Then
+    const uint8_t hex[] = {
+        0x00, 0xFF, 0x10, 0xA0, 0xDE, 0xAD, 0xBE, 0xEF, 0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF,
+    };
+    assert(result == cli_run_result_ok);
+    assert(blob_command_last_size == sizeof(hex));
+    assert(memcmp(blob_command_last_data, hex, sizeof(hex)) == 0);
+
+    // When
+    char base64_input[] = "write 0 'b64:SGVsbG8sIHdvcmxkIQ=='";
+    result = libcli_run(&header, base64_input, NULL);
+
+    // Then
+    assert(result == cli_run_result_ok);
+    assert(blob_command_last_size == 13);
+    assert(memcmp(blob_command_last_data, "Hello, world!", 13) == 0);
+
+    // When, Then (the argument and the offset of the invalid digit in it are reported)
+    CliRunError error;
+    char bad_hex[] = "write 0 00ff1g";
+    assert(libcli_run_with_error(&header, bad_hex, NULL, &error) == cli_run_result_bad_argument);
+    assert(error.argument == 1);
+    assert(error.offset == 5);
+
+    char bad_base64[] = "write 0 b64:AAAA*AAA";
+    result = libcli_run_with_error(&header, bad_base64, NULL, &error);
+    assert(result == cli_run_result_bad_argument);
+    assert(error.offset == 8);
+
+    char odd_hex[] = "write 0 abc";
+    assert(libcli_run_with_error(&header, odd_hex, NULL, &error) == cli_run_result_bad_argument);
+    assert(error.offset == 3);
+}
+
+static void float_arguments_need_a_parser(void) {
+    // Given
+    enum { capacity = 2 };
+    CliCommand commands[capacity];
+    CliNewInfo info = {
+        .commands = commands,
+        .commands_size = capacity,
+        .writeback = printf_writeback,
+    };
+    CliHeader header = libcli_new(&info);
+
+    // When
+    CliArgumentType example_types[] = { cli_argument_type_int, cli_argument_type_float };
+    bool added = libcli_add(&header, "example", "", 2, example_types, integer_float_command);
+
+    // Then
+    assert(!added);
+    assert(header.count == 1);
+}
+
+static void rejects_lines_before_reading_them_fully(void) {
+    // Given
+    enum { capacity = 8 };
+    CliCommand commands[capacity];
+    CliNewInfo info = {
+        .commands = commands,
+        .commands_size = capacity,
+        .writeback = write_to_buffer,
+        .writeback_data = NULL,
+        .parse_float = libcli_parse_float,
+    };
+    CliHeader header = libcli_new(&info);
+
+    CliArgumentType example_types[] = { cli_argument_type_int, cli_argument_type_float };
+    libcli_add(&header, "example", "", 2, example_types, integer_float_command);
+
+    // When, Then (commands and arguments are checked as soon as each token ends)
+    char unknown[] = "nothing \"unterminated";
+    assert(libcli_run(&header, unknown, NULL) == cli_run_result_unknown);
+    char bad_argument[] = "example x 1.0 'unterminated";
+    assert(libcli_run(&header, bad_argument, NULL) == cli_run_result_bad_argument);
+    char too_many[] = "example 1 1.0 extra \\";
+    assert(libcli_run(&header, too_many, NULL) == cli_run_result_bad_argc);
+    char too_few[] = "example 1";
+    assert(libcli_run(&header, too_few, NULL) == cli_run_result_bad_argc);
+
+    // When, Then (syntax errors are still found in otherwise valid lines)
+    char unterminated[] = "example 1 \"1.0";
+    assert(libcli_run(&header, unterminated, NULL) == cli_run_result_unterminated_double_quote);
+    assert(integer_float_command_call_count == 0);
+}
+
+static void can_run_pipelines(void) {
+    // Given
+    enum { capacity = 8 };
+    CliCommand commands[capacity];
+    char pipe_buffer[512];
+    CliNewInfo info = {
+        .commands = commands,
+        .commands_size = capacity,
+        .writeback = write_to_buffer,
+        .writeback_data = NULL,
+        .pipe_buffer = pipe_buffer,
+        .pipe_buffer_size = sizeof(pipe_buffer),
+    };
+    CliHeader header = libcli_new(&info);
+
+    bool added = libcli_add(&header, "lines", "", 0, NULL, lines_command)
+        && libcli_add_filters(&header);
+    assert(added);
+
+    // When, Then
+    char input[] = "lines | grep 0x40";
+    CliRunResult result = libcli_run(&header, input, NULL);
+    assert(result == cli_run_result_ok);
+    assert(strcmp("reg0 0x40\nreg3 0x40\n", writeback_buffer) == 0);
+
+    // When, Then
+    clear_writeback_buffer();
+    char input2[] = "lines|grep 0x4|head 2|count";
+    result = libcli_run(&header, input2, NULL);
+    assert(result == cli_run_result_ok);
+    assert(strcmp("2\n", writeback_buffer) == 0);
+
+    // When, Then
+    clear_writeback_buffer();
+    char input3[] = "help | grep help";
+    result = libcli_run(&header, input3, NULL);
+    assert(result == cli_run_result_ok);
+    assert(strcmp("    help     displays information about commands\n", writeback_buffer) == 0);
+}
+
+static void bad_pipelines(void) {
+    // Given
+    enum { capacity = 8 };
+    CliCommand commands[capacity];
+    char pipe_buffer[64];
+    CliNewInfo info = {
+        .commands = commands,
+        .commands_size = capacity,
+        .writeback = write_to_buffer,
+        .writeback_data = NULL,
+        .pipe_buffer = pipe_buffer,
+        .pipe_buffer_size = sizeof(pipe_buffer),
+    };
+    CliHeader header = libcli_new(&info);
+    libcli_add(&header, "lines", "", 0, NULL, lines_command);
+    libcli_add_filters(&header);
+
+    // When, Then
+    char input[] = "lines | | count";
+    assert(libcli_run(&header, input, NULL) == cli_run_result_bad_pipe);
+    char input2[] = "lines |";
+    assert(libcli_run(&header, input2, NULL) == cli_run_result_bad_pipe);
+    char input3[] = "lines | nope";
+    assert(libcli_run(&header, input3, NULL) == cli_run_result_unknown);
+    assert(writeback_size == 0);
+
+    // Given
+    CliNewInfo no_buffer_info = {
+        .commands = commands,
+        .commands_size = capacity,
+        .writeback = write_to_buffer,
+        .writeback_data = NULL,
+    };
+    CliHeader no_buffer_header = libcli_new(&no_buffer_info);
+    libcli_add(&no_buffer_header, "lines", "", 0, NULL, lines_command);
+
+    // When, Then
+    char input4[] = "lines | lines";
+    assert(libcli_run(&no_buffer_header, input4, NULL) == cli_run_result_bad_pipe);
+}
+
+static void can_time_commands(void) {
+    // Given
+    enum { capacity = 8 };
+    CliCommand commands[capacity];
+    CliNewInfo info = {
+        .commands = commands,
+        .commands_size = capacity,
+        .writeback = write_to_buffer,
+        .writeback_data = NULL,
+        .timestamp = fake_clock,
+        .parse_float = libcli_parse_float,
+    };
+    CliHeader header = libcli_new(&info);
+
+    CliArgumentType example_types[] = { cli_argument_type_int, cli_argument_type_float };
+    libcli_add(&header, "example", "", 2, example_types, integer_float_command);
+
+    // When
+    int userdata = 5;
+    char input[] = "time example 12 0.5";
+    CliRunResult result = libcli_run(&header, input, &userdata);
+
+    // Then
+    assert(result == cli_run_result_ok);
+    assert(integer_float_command_call_count == 1);
+    assert(integer_float_command_arg0 == 12);
+
+    const char* expected = "runs: 1 (times in ticks)\n"
+        "                 min      mean       max       p99\n"
+        "parse             10        10        10        10\n"
+        "lookup            10        10        10        10\n"
+        "convert           10        10        10        10\n"
+        "handler           10        10        10        10\n"
+        "total             40        40        40        40\n";
+    assert(strcmp(expected, writeback_buffer) == 0);
+
+    // When
+    clear_writeback_buffer();
+    char input2[] = "repeat 100 example 7 '1.5'";
+    result = libcli_run(&header, input2, &userdata);
+
+    // Then
+    assert(result == cli_run_result_ok);
+    assert(integer_float_command_call_count == 101);
+    assert(integer_float_command_arg1 == 1.5f);
+    assert(strncmp("runs: 100 (times in ticks)\n", writeback_buffer, 27) == 0);
+}
+
+static void timing_errors(void) {
+    // Given
+    enum { capacity = 8 };
+    CliCommand commands[capacity];
+    CliNewInfo info = {
+        .commands = commands,
+        .commands_size = capacity,
+        .writeback = write_to_buffer,
+        .writeback_data = NULL,
+        .timestamp = fake_clock,
+    };
+    CliHeader header = libcli_new(&info);
+    libcli_add(&header, "first", "", 0, NULL, first_command);
+
+    // When, Then
+    char input[] = "time nothing";
+    assert(libcli_run(&header, input, NULL) == cli_run_result_unknown);
+    char input2[] = "repeat 0 first";
+    assert(libcli_run(&header, input2, NULL) == cli_run_result_bad_argument);
+    char input3[] = "repeat 2";
+    assert(libcli_run(&header, input3, NULL) == cli_run_result_bad_argc);
+    char input4[] = "time first extra";
+    assert(libcli_run(&header, input4, NULL) == cli_run_result_bad_argc);
+    assert(first_command_call_count == 0);
+    assert(writeback_size == 0);
+
+    // Given
+    CliNewInfo untimed_info = {
+        .commands = commands,
+        .commands_size = capacity,
+        .writeback = write_to_buffer,
+        .writeback_data = NULL,
+    };
+    CliHeader untimed_header = libcli_new(&untimed_info);
+
+    // When, Then
+    char input5[] = "time help";
+    assert(libcli_run(&untimed_header, input5, NULL) == cli_run_result_unknown);
+}
+
+static void rejects_invalid_utf8(void) {
+    // Given
+    enum { capacity = 2 };
+    CliCommand commands[capacity];
+    CliNewInfo info = {
+        .commands = commands,
+        .commands_size = capacity,
+        .writeback = printf_writeback,
+        .writeback_data = NULL,
+        .validate_utf8 = true,
+    };
+    CliHeader header = libcli_new(&info);
+
+    CliArgumentType args[] = { cli_argument_type_string };
+    libcli_add(&header, "first", "", 1, args, first_command);
+
+    // When
+    CliRunError error;
+    char input[] = "first \"na\xC3\xAFve\" \xFF";
+    CliRunResult result = libcli_run_with_error(&header, input, NULL, &error);
+
+    // Then
+    assert(result == cli_run_result_invalid_utf8);
+    assert(error.offset == 15);
+    assert(first_command_call_count == 0);
+
+    // When
+    char input2[] = "first \"na\xC3\xAFve\"";
+    result = libcli_run_with_error(&header, input2, NULL, &error);
+
+    // Then
+    assert(result == cli_run_result_ok);
+    assert(first_command_call_count == 1);
+}
+
 // Test runner
 
 static void cleanup(void) {
@@ -350,7 +1021,11 @@ static void cleanup(void) {
     integer_float_command_arg0 = 0;
     integer_float_command_arg1 = 0.0f;
     integer_float_command_call_count = 0;
+    fixed_command_last_value = 0;
+    memset(blob_command_last_data, 0, sizeof(blob_command_last_data));
+    blob_command_last_size = 0;
     four_string_command_last_argc = 0;
+    fake_clock_ticks = 0;
 }
 
 int main(void) {
@@ -361,10 +1036,24 @@ int main(void) {
         can_register_multiple_commands,
         cant_exceed_capacity,
         automatic_help_command,
+        help_topics,
+        help_search,
+        help_search_compares_words,
+        help_search_without_full_index,
+        can_remove_commands,
         writeback_data_is_passed_to_writeback,
         can_parse_complex_arguments,
         can_check_argument_types,
         invalid_numerical_arguments,
+        fixed_point_arguments,
+        blob_arguments,
+        float_arguments_need_a_parser,
+        rejects_lines_before_reading_them_fully,
+        can_run_pipelines,
+        bad_pipelines,
+        can_time_commands,
+        timing_errors,
+        rejects_invalid_utf8,
     };
 
     const size_t test_count = sizeof(tests) / sizeof(Test);
@@ -0,0 +1,232 @@
+//
+// channel_benchmark
+//
+// Host-side benchmark of a local client polling a CLI in another process, through the
+// Unix-domain socket server (see `cli_server.h`) and through the shared-memory channel (see
+// `cli_channel.h`). Every request is a `ping` command, whose output is checked.
+//
+// Usage: channel_benchmark [requests]
+//
+// Times are in nanoseconds per request. Round trips wait for each response before sending the next
+// request; batched channel requests fill every slot before reading the responses.
+//
+
+#include "cli_channel.h"
+#include "cli_server.h"
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+enum {
+    default_request_count = 100000,
+};
+
+static const char ping_output[] = "pong\n";
+
+static void ping_command(
+    const CliHeader* header,
+    size_t argc,
+    const CliArgument* argv,
+    void* userdata
+) {
+    (void)argc;
+    (void)argv;
+    (void)userdata;
+    libcli_write(header, ping_output);
+}
+
+static void discard_writeback(const char* string, void* userdata) {
+    (void)string;
+    (void)userdata;
+}
+
+static uint64_t nanoseconds(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return ((uint64_t)time.tv_sec * 1000000000u) + (uint64_t)time.tv_nsec;
+}
+
+static void report(const char* name, uint64_t start, uint32_t request_count) {
+    uint64_t elapsed = nanoseconds() - start;
+    printf("%-16s %8.1f ns/request\n", name, (double)elapsed / (double)request_count);
+}
+
+static void stop_server(pid_t server) {
+    kill(server, SIGKILL);
+    waitpid(server, NULL, 0);
+}
+
+// Read one response line from the socket. Returns false if it is not the ping's output.
+static bool receive_line(int fd) {
+    char line[sizeof(ping_output)];
+    size_t length = 0;
+
+    while ((length == 0) || (line[length - 1] != '\n')) {
+        ssize_t received = recv(fd, &line[length], sizeof(line) - 1 - length, 0);
+
+        if (received <= 0) {
+            return false;
+        }
+
+        length += (size_t)received;
+    }
+
+    line[length] = '\0';
+    return strcmp(line, ping_output) == 0;
+}
+
+static bool run_socket(const CliHeader* header, uint32_t request_count) {
+    static CliSession sessions[1];
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/libcli_channel_benchmark_%ld.sock", (long)getpid());
+
+    CliServerInfo info = {
+        .header = header,
+        .sessions = sessions,
+        .sessions_size = 1,
+        .unix_path = path,
+    };
+
+    CliServer server;
+    if (!libcli_server_new(&server, &info)) {
+        return false;
+    }
+
+    pid_t child = fork();
+    if (child == 0) {
+        while (libcli_server_poll(&server, -1)) {}
+        _exit(EXIT_FAILURE);
+    }
+
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+    strcpy(address.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    bool ok = (child > 0)
+        && (fd >= 0)
+        && (connect(fd, (const struct sockaddr*)&address, sizeof(address)) == 0);
+
+    uint64_t start = nanoseconds();
+
+    for (uint32_t i = 0; ok && (i < request_count); i++) {
+        ok = (send(fd, "ping\n", 5, 0) == 5) && receive_line(fd);
+    }
+
+    if (ok) {
+        report("socket", start, request_count);
+    }
+
+    if (fd >= 0) {
+        close(fd);
+    }
+
+    if (child > 0) {
+        stop_server(child);
+    }
+
+    libcli_server_delete(&server);
+    return ok;
+}
+
+static bool check_response(CliChannelClient* client) {
+    CliChannelResponse response;
+
+    return libcli_channel_receive(client, -1, &response)
+        && (response.result == cli_run_result_ok)
+        && (response.output_size == strlen(ping_output))
+        && (memcmp(response.output, ping_output, response.output_size) == 0);
+}
+
+static bool run_channel(const CliHeader* header, uint32_t request_count) {
+    void* memory = mmap(
+        NULL,
+        sizeof(CliChannelRegion),
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_ANONYMOUS,
+        -1,
+        0
+    );
+
+    if (memory == MAP_FAILED) {
+        return false;
+    }
+
+    CliChannelRegion* region = (CliChannelRegion*)memory;
+    libcli_channel_init(region);
+
+    pid_t child = fork();
+    if (child == 0) {
+        CliChannel channel = libcli_channel_new(region);
+        while (true) {
+            libcli_channel_serve(header, &channel, -1, NULL);
+        }
+    }
+
+    CliChannelClient client;
+    bool ok = (child > 0) && libcli_channel_connect(&client, region);
+
+    uint64_t start = nanoseconds();
+
+    for (uint32_t i = 0; ok && (i < request_count); i++) {
+        ok = libcli_channel_submit(&client, "ping") && check_response(&client);
+    }
+
+    if (ok) {
+        report("channel", start, request_count);
+        start = nanoseconds();
+    }
+
+    for (uint32_t i = 0; ok && (i < request_count); i += cli_channel_slot_count) {
+        uint32_t batch = request_count - i;
+        batch = (batch < cli_channel_slot_count) ? batch : cli_channel_slot_count;
+
+        for (uint32_t j = 0; ok && (j < batch); j++) {
+            ok = libcli_channel_submit(&client, "ping");
+        }
+
+        for (uint32_t j = 0; ok && (j < batch); j++) {
+            ok = check_response(&client);
+        }
+    }
+
+    if (ok) {
+        report("channel (batch)", start, request_count);
+    }
+
+    if (child > 0) {
+        stop_server(child);
+    }
+
+    munmap(memory, sizeof(CliChannelRegion));
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    uint32_t request_count =
+        (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 10) : default_request_count;
+    request_count = (request_count > 0) ? request_count : 1;
+
+    CliCommand commands[2];
+    CliNewInfo info = {
+        .commands = commands,
+        .commands_size = 2,
+        .writeback = discard_writeback,
+    };
+    CliHeader header = libcli_new(&info);
+    libcli_add(&header, "ping", "answers pong", 0, NULL, ping_command);
+
+    if (!run_socket(&header, request_count) || !run_channel(&header, request_count)) {
+        fprintf(stderr, "channel_benchmark: a transport failed or gave the wrong output\n");
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,509 @@
+//
+// compress_summaries
+//
+// Host-side tool which compresses command summaries into a single blob for
+// `CliNewInfo.summary_blob`. The format is described in `include/internal/summary.h`.
+//
+// Usage: compress_summaries <input> <output base name> <array name>
+//
+// Each input line is `IDENTIFIER<tab>summary text`; empty lines and lines starting with '#' are
+// ignored. The tool writes `<output base name>.c`, defining the blob, and `<output base name>.h`,
+// which defines each IDENTIFIER as a `const char*` to pass to `libcli_add` as the summary.
+//
+// Summaries are first split into dictionary words and literal characters, then the resulting
+// symbols are Huffman coded.
+//
+
+#include "internal/summary.h"
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+    max_summaries = 4096,
+    max_line_length = 1024,
+    max_words = 8192,
+    max_word_length = 255,
+    max_dictionary_words = 256 - summary_first_word_symbol,
+    symbol_count = 256,
+    max_blob_size = UINT16_MAX,
+};
+
+typedef struct Summary {
+    char* identifier;
+    char* text;
+} Summary;
+
+typedef struct Word {
+    char text[max_word_length + 1];
+    size_t length;
+    size_t count;
+    long savings;
+} Word;
+
+typedef struct BitWriter {
+    uint8_t* data;
+    size_t size;
+    size_t bit;
+} BitWriter;
+
+static Summary summaries[max_summaries];
+static size_t summary_count = 0;
+
+static Word words[max_words];
+static size_t word_count = 0;
+
+// Indices into `words` of the dictionary, in symbol order
+static size_t dictionary[max_dictionary_words];
+static size_t dictionary_size = 0;
+
+static unsigned long frequencies[symbol_count];
+static unsigned code_lengths[symbol_count];
+static unsigned codes[symbol_count];
+
+static uint8_t blob[max_blob_size];
+
+static void fail(const char* message, const char* detail) {
+    fprintf(stderr, "compress_summaries: %s%s\n", message, detail);
+    exit(EXIT_FAILURE);
+}
+
+static char* duplicate(const char* string, size_t length) {
+    char* copy = malloc(length + 1);
+
+    if (copy == NULL) {
+        fail("out of memory", "");
+    }
+
+    memcpy(copy, string, length);
+    copy[length] = '\0';
+    return copy;
+}
+
+static void read_summaries(const char* path) {
+    FILE* file = fopen(path, "r");
+    char line[max_line_length];
+
+    if (file == NULL) {
+        fail("cannot open ", path);
+    }
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        size_t length = strcspn(line, "\r\n");
+        line[length] = '\0';
+
+        if ((length == 0) || (line[0] == '#')) {
+            continue;
+        }
+
+        char* tab = strchr(line, '\t');
+
+        if (tab == NULL) {
+            fail("missing tab in line: ", line);
+        } else if (summary_count == max_summaries) {
+            fail("too many summaries", "");
+        }
+
+        for (const char* c = tab + 1; *c != '\0'; c++) {
+            if ((unsigned char)*c >= summary_first_word_symbol) {
+                fail("summaries must be ASCII: ", line);
+            }
+        }
+
+        summaries[summary_count].identifier = duplicate(line, (size_t)(tab - line));
+        summaries[summary_count].text = duplicate(tab + 1, strlen(tab + 1));
+        summary_count += 1;
+    }
+
+    fclose(file);
+}
+
+static size_t word_length_at(const char* text) {
+    size_t length = 0;
+
+    while (isalpha((unsigned char)text[length])) {
+        length += 1;
+    }
+
+    return length;
+}
+
+static Word* find_word(const char* text, size_t length) {
+    for (size_t i = 0; i < word_count; i++) {
+        if ((words[i].length == length) && (memcmp(words[i].text, text, length) == 0)) {
+            return &words[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void count_words(void) {
+    for (size_t i = 0; i < summary_count; i++) {
+        const char* c = summaries[i].text;
+
+        while (*c != '\0') {
+            size_t length = word_length_at(c);
+
+            if (length == 0) {
+                c += 1;
+                continue;
+            }
+
+            Word* word = find_word(c, length);
+
+            if ((word == NULL) && (length <= max_word_length) && (word_count < max_words)) {
+                word = &words[word_count];
+                memcpy(word->text, c, length);
+                word->text[length] = '\0';
+                word->length = length;
+                word->count = 0;
+                word_count += 1;
+            }
+
+            if (word != NULL) {
+                word->count += 1;
+            }
+
+            c += length;
+        }
+    }
+}
+
+static int compare_savings(const void* a, const void* b) {
+    const Word* left = &words[*(const size_t*)a];
+    const Word* right = &words[*(const size_t*)b];
+
+    if (left->savings != right->savings) {
+        return (left->savings > right->savings) ? -1 : 1;
+    } else {
+        return strcmp(left->text, right->text);
+    }
+}
+
+// Pick the words which save the most bytes when replaced by one symbol, counting the cost of
+// storing the word and its offset.
+static void choose_dictionary(void) {
+    static size_t order[max_words];
+
+    for (size_t i = 0; i < word_count; i++) {
+        Word* word = &words[i];
+        word->savings = ((long)word->count * ((long)word->length - 1)) - ((long)word->length + 3);
+        order[i] = i;
+    }
+
+    qsort(order, word_count, sizeof(size_t), compare_savings);
+
+    for (size_t i = 0; (i < word_count) && (dictionary_size < max_dictionary_words); i++) {
+        if (words[order[i]].savings > 0) {
+            dictionary[dictionary_size] = order[i];
+            dictionary_size += 1;
+        }
+    }
+}
+
+// Returns the dictionary symbol for the word at `text`, or 0 if it is not in the dictionary.
+static unsigned dictionary_symbol(const char* text, size_t length) {
+    for (size_t i = 0; i < dictionary_size; i++) {
+        const Word* word = &words[dictionary[i]];
+
+        if ((word->length == length) && (memcmp(word->text, text, length) == 0)) {
+            return (unsigned)(summary_first_word_symbol + i);
+        }
+    }
+
+    return 0;
+}
+
+// Split a summary into symbols, calling `emit` for each one including the end symbol.
+static void for_each_symbol(const char* text, void (*emit)(unsigned symbol, void* data), void* data) {
+    const char* c = text;
+
+    while (*c != '\0') {
+        size_t length = word_length_at(c);
+        unsigned symbol = (length > 0) ? dictionary_symbol(c, length) : 0;
+
+        if (symbol != 0) {
+            emit(symbol, data);
+            c += length;
+        } else if (length > 0) {
+            for (size_t i = 0; i < length; i++) {
+                emit((unsigned char)c[i], data);
+            }
+
+            c += length;
+        } else {
+            emit((unsigned char)*c, data);
+            c += 1;
+        }
+    }
+
+    emit(summary_end_symbol, data);
+}
+
+static void count_symbol(unsigned symbol, void* data) {
+    (void)data;
+    frequencies[symbol] += 1;
+}
+
+// Compute Huffman code lengths from `weights`. Returns the longest code length.
+static unsigned huffman_lengths(const unsigned long* weights) {
+    enum { max_nodes = symbol_count * 2 };
+
+    unsigned long node_weights[max_nodes];
+    int parents[max_nodes];
+    bool alive[max_nodes];
+    size_t node_count = symbol_count;
+
+    for (size_t i = 0; i < symbol_count; i++) {
+        node_weights[i] = weights[i];
+        parents[i] = -1;
+        alive[i] = weights[i] > 0;
+    }
+
+    while (true) {
+        int smallest[2] = { -1, -1 };
+
+        for (size_t i = 0; i < node_count; i++) {
+            if (!alive[i]) {
+                continue;
+            } else if ((smallest[0] < 0) || (node_weights[i] < node_weights[smallest[0]])) {
+                smallest[1] = smallest[0];
+                smallest[0] = (int)i;
+            } else if ((smallest[1] < 0) || (node_weights[i] < node_weights[smallest[1]])) {
+                smallest[1] = (int)i;
+            }
+        }
+
+        if (smallest[1] < 0) {
+            break;
+        }
+
+        node_weights[node_count] = node_weights[smallest[0]] + node_weights[smallest[1]];
+        parents[node_count] = -1;
+        alive[node_count] = true;
+        alive[smallest[0]] = false;
+        alive[smallest[1]] = false;
+        parents[smallest[0]] = (int)node_count;
+        parents[smallest[1]] = (int)node_count;
+        node_count += 1;
+    }
+
+    unsigned longest = 0;
+
+    for (size_t i = 0; i < symbol_count; i++) {
+        unsigned length = 0;
+
+        for (int node = parents[i]; (weights[i] > 0) && (node >= 0); node = parents[node]) {
+            length += 1;
+        }
+
+        // A lone symbol still needs a one bit code.
+        code_lengths[i] = ((weights[i] > 0) && (length == 0)) ? 1 : length;
+        longest = (code_lengths[i] > longest) ? code_lengths[i] : longest;
+    }
+
+    return longest;
+}
+
+// Compute code lengths no longer than the format allows, by flattening the weights until they fit.
+static void limit_code_lengths(void) {
+    unsigned long weights[symbol_count];
+    memcpy(weights, frequencies, sizeof(weights));
+
+    while (huffman_lengths(weights) > summary_max_code_length) {
+        for (size_t i = 0; i < symbol_count; i++) {
+            weights[i] = (weights[i] > 0) ? ((weights[i] / 2) + 1) : 0;
+        }
+    }
+}
+
+static void assign_canonical_codes(void) {
+    unsigned code = 0;
+
+    for (unsigned length = 1; length <= summary_max_code_length; length++) {
+        for (size_t symbol = 0; symbol < symbol_count; symbol++) {
+            if (code_lengths[symbol] == length) {
+                codes[symbol] = code;
+                code += 1;
+            }
+        }
+
+        code <<= 1;
+    }
+}
+
+static void put_byte(size_t* size, unsigned value) {
+    if (*size >= max_blob_size) {
+        fail("summaries do not fit in a 64 KiB blob", "");
+    }
+
+    blob[*size] = (uint8_t)value;
+    *size += 1;
+}
+
+static void write_bits(unsigned symbol, void* data) {
+    BitWriter* writer = (BitWriter*)data;
+    unsigned length = code_lengths[symbol];
+
+    for (unsigned i = length; i > 0; i--) {
+        size_t byte = writer->bit / 8;
+
+        if (byte >= writer->size) {
+            fail("summaries do not fit in a 64 KiB blob", "");
+        } else if ((writer->bit % 8) == 0) {
+            writer->data[byte] = 0;
+        }
+
+        unsigned bit = (codes[symbol] >> (i - 1)) & 1;
+        writer->data[byte] |= (uint8_t)(bit << (7 - (writer->bit % 8)));
+        writer->bit += 1;
+    }
+}
+
+// Build the blob, storing the offset of each summary in `offsets`. Returns the blob size.
+static size_t build_blob(size_t* offsets) {
+    size_t size = 0;
+
+    put_byte(&size, 'L');
+    put_byte(&size, 'C');
+    put_byte(&size, 'S');
+    put_byte(&size, summary_blob_version);
+
+    for (unsigned length = 1; length <= summary_max_code_length; length++) {
+        unsigned count = 0;
+
+        for (size_t symbol = 0; symbol < symbol_count; symbol++) {
+            count += (code_lengths[symbol] == length) ? 1 : 0;
+        }
+
+        put_byte(&size, count);
+    }
+
+    for (unsigned length = 1; length <= summary_max_code_length; length++) {
+        for (size_t symbol = 0; symbol < symbol_count; symbol++) {
+            if (code_lengths[symbol] == length) {
+                put_byte(&size, (unsigned)symbol);
+            }
+        }
+    }
+
+    put_byte(&size, (unsigned)dictionary_size);
+
+    size_t word_offset = size + (dictionary_size * 2);
+
+    for (size_t i = 0; i < dictionary_size; i++) {
+        put_byte(&size, (unsigned)(word_offset & 0xff));
+        put_byte(&size, (unsigned)(word_offset >> 8));
+        word_offset += words[dictionary[i]].length + 1;
+    }
+
+    for (size_t i = 0; i < dictionary_size; i++) {
+        const Word* word = &words[dictionary[i]];
+        put_byte(&size, (unsigned)word->length);
+
+        for (size_t j = 0; j < word->length; j++) {
+            put_byte(&size, (unsigned char)word->text[j]);
+        }
+    }
+
+    for (size_t i = 0; i < summary_count; i++) {
+        BitWriter writer = { .data = &blob[size], .size = max_blob_size - size, .bit = 0 };
+        offsets[i] = size;
+
+        for_each_symbol(summaries[i].text, write_bits, &writer);
+        size += (writer.bit + 7) / 8;
+    }
+
+    return size;
+}
+
+static FILE* open_output(const char* base, const char* extension) {
+    char path[max_line_length];
+    snprintf(path, sizeof(path), "%s%s", base, extension);
+
+    FILE* file = fopen(path, "w");
+
+    if (file == NULL) {
+        fail("cannot create ", path);
+    }
+
+    return file;
+}
+
+static void write_source(const char* base, const char* array, size_t size) {
+    FILE* file = open_output(base, ".c");
+
+    fprintf(file, "// Generated by compress_summaries. Do not edit.\n\n");
+    fprintf(file, "const unsigned char %s[%zu] = {", array, size);
+
+    for (size_t i = 0; i < size; i++) {
+        fprintf(file, "%s0x%02x,", ((i % 12) == 0) ? "\n    " : " ", blob[i]);
+    }
+
+    fprintf(file, "\n};\n");
+    fclose(file);
+}
+
+static void write_header(const char* base, const char* array, size_t size, const size_t* offsets) {
+    FILE* file = open_output(base, ".h");
+
+    fprintf(file, "// Generated by compress_summaries. Do not edit.\n\n");
+    fprintf(file, "#ifndef %s_H\n#define %s_H\n\n", array, array);
+    fprintf(file, "extern const unsigned char %s[%zu];\n\n", array, size);
+    fprintf(file, "enum { %s_size = %zu };\n\n", array, size);
+
+    for (size_t i = 0; i < summary_count; i++) {
+        fprintf(
+            file,
+            "#define %s ((const char*)&%s[%zu])\n",
+            summaries[i].identifier,
+            array,
+            offsets[i]
+        );
+    }
+
+    fprintf(file, "\n#endif // %s_H\n", array);
+    fclose(file);
+}
+
+int main(int argc, char** argv) {
+    static size_t offsets[max_summaries];
+
+    if (argc != 4) {
+        fail("usage: compress_summaries <input> <output base name> <array name>", "");
+    }
+
+    read_summaries(argv[1]);
+    count_words();
+    choose_dictionary();
+
+    for (size_t i = 0; i < summary_count; i++) {
+        for_each_symbol(summaries[i].text, count_symbol, NULL);
+    }
+
+    limit_code_lengths();
+    assign_canonical_codes();
+
+    size_t size = build_blob(offsets);
+    size_t text_size = 0;
+
+    for (size_t i = 0; i < summary_count; i++) {
+        text_size += strlen(summaries[i].text) + 1;
+    }
+
+    write_source(argv[2], argv[3], size);
+    write_header(argv[2], argv[3], size, offsets);
+
+    printf("compress_summaries: %zu bytes of summaries in %zu bytes\n", text_size, size);
+
+    for (size_t i = 0; i < summary_count; i++) {
+        free(summaries[i].identifier);
+        free(summaries[i].text);
+    }
+
+    return EXIT_SUCCESS;
+}
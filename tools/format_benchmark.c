@@ -0,0 +1,125 @@
+//
+// format_benchmark
+//
+// Host-side benchmark of a handler's formatted output, written with `libcli_printf`, with the
+// `libcli_put_*` functions, and with libc `snprintf` into a temporary buffer followed by
+// `libcli_write`. All three must produce the same output, which is checked with a hash.
+//
+// Usage: format_benchmark [lines]
+//
+// Times are in nanoseconds per line. The libc formatter on the host is usually glibc rather than
+// newlib, so the ratio is only indicative of a target's.
+//
+
+#include "cli_format.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+enum {
+    default_line_count = 1000000,
+};
+
+typedef void (*FormatFunction)(const CliHeader* header, uint32_t index);
+
+static uint32_t output_hash = 0;
+
+// FNV-1a over everything written
+static void hash_writeback(const char* string, void* userdata) {
+    (void)userdata;
+
+    for (const char* c = string; *c != '\0'; c++) {
+        output_hash = (output_hash ^ (uint8_t)*c) * 16777619u;
+    }
+}
+
+static uint64_t nanoseconds(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return ((uint64_t)time.tv_sec * 1000000000u) + (uint64_t)time.tv_nsec;
+}
+
+// A typical register dump line: "reg12 0x0000abcd gain -42 level 1.250\n"
+
+static void format_with_printf(const CliHeader* header, uint32_t index) {
+    libcli_printf(
+        header,
+        "reg%u 0x%08x gain %d level %s\n",
+        (unsigned)(index % 64),
+        (unsigned)(index * 2654435761u),
+        (int)(index % 200) - 100,
+        ((index % 4) == 0) ? "1.250" : "0.500"
+    );
+}
+
+static void format_with_put(const CliHeader* header, uint32_t index) {
+    const int32_t one = (int32_t)1 << cli_fixed_fraction_bits;
+
+    libcli_write(header, "reg");
+    libcli_put_u32(header, index % 64);
+    libcli_write(header, " 0x");
+    libcli_put_hex(header, index * 2654435761u, 8);
+    libcli_write(header, " gain ");
+    libcli_put_i32(header, (int32_t)(index % 200) - 100);
+    libcli_write(header, " level ");
+    libcli_put_fixed(header, ((index % 4) == 0) ? (one * 5) / 4 : one / 2, 3);
+    libcli_write(header, "\n");
+}
+
+static void format_with_snprintf(const CliHeader* header, uint32_t index) {
+    char line[64];
+    snprintf(
+        line,
+        sizeof(line),
+        "reg%u 0x%08x gain %d level %s\n",
+        (unsigned)(index % 64),
+        (unsigned)(index * 2654435761u),
+        (int)(index % 200) - 100,
+        ((index % 4) == 0) ? "1.250" : "0.500"
+    );
+    libcli_write(header, line);
+}
+
+// Run `format` for `line_count` lines, printing the time per line. Returns the output's hash.
+static uint32_t run(
+    const CliHeader* header,
+    const char* name,
+    FormatFunction format,
+    uint32_t line_count
+) {
+    output_hash = 2166136261u;
+    uint64_t start = nanoseconds();
+
+    for (uint32_t i = 0; i < line_count; i++) {
+        format(header, i);
+    }
+
+    uint64_t elapsed = nanoseconds() - start;
+    printf("%-16s %8.1f ns/line\n", name, (double)elapsed / (double)line_count);
+    return output_hash;
+}
+
+int main(int argc, char** argv) {
+    uint32_t line_count = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 10) : default_line_count;
+    line_count = (line_count > 0) ? line_count : 1;
+
+    CliCommand commands[1];
+    CliNewInfo info = {
+        .commands = commands,
+        .commands_size = 1,
+        .writeback = hash_writeback,
+    };
+    CliHeader header = libcli_new(&info);
+
+    uint32_t expected = run(&header, "snprintf", format_with_snprintf, line_count);
+    uint32_t printf_hash = run(&header, "libcli_printf", format_with_printf, line_count);
+    uint32_t put_hash = run(&header, "libcli_put_*", format_with_put, line_count);
+
+    if ((printf_hash != expected) || (put_hash != expected)) {
+        fprintf(stderr, "format_benchmark: output differs from snprintf\n");
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,114 @@
+//
+// replay_trace
+//
+// Host-side tool which runs a trace dumped by a `CliRecorder` against an application's commands
+// (see `replay_trace.h`) and reports the throughput and latency distribution.
+//
+// Usage: replay_trace <trace> [--realtime]
+//
+// Times are in microseconds. With `--realtime`, lines are started at their recorded times, which
+// assumes the trace was recorded with a microsecond clock.
+//
+
+#include "cli_record.h"
+#include "replay_trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+enum {
+    replay_command_capacity = 4096,
+};
+
+static void fail(const char* message, const char* detail) {
+    fprintf(stderr, "replay_trace: %s%s\n", message, detail);
+    exit(EXIT_FAILURE);
+}
+
+static void discard_writeback(const char* string, void* userdata) {
+    (void)string;
+    (void)userdata;
+}
+
+static uint32_t microseconds(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint32_t)(((uint64_t)time.tv_sec * 1000000u) + ((uint64_t)time.tv_nsec / 1000u));
+}
+
+static uint8_t* read_file(const char* path, size_t* size) {
+    FILE* file = fopen(path, "rb");
+
+    if (file == NULL) {
+        fail("cannot open ", path);
+    }
+
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    uint8_t* data = malloc((length > 0) ? (size_t)length : 1);
+
+    if ((length < 0) || (data == NULL)) {
+        fail("cannot read ", path);
+    }
+
+    *size = fread(data, 1, (size_t)length, file);
+    fclose(file);
+    return data;
+}
+
+int main(int argc, char** argv) {
+    static CliCommand commands[replay_command_capacity];
+
+    bool realtime = (argc == 3) && (strcmp(argv[2], "--realtime") == 0);
+
+    if ((argc != 2) && !realtime) {
+        fail("usage: replay_trace <trace> [--realtime]", "");
+    }
+
+    size_t trace_size = 0;
+    uint8_t* trace = read_file(argv[1], &trace_size);
+
+    CliNewInfo info = {
+        .commands = commands,
+        .commands_size = replay_command_capacity,
+        .writeback = discard_writeback,
+    };
+    CliHeader header = libcli_new(&info);
+    void* userdata = replay_add_commands(&header);
+
+    CliReplayStats stats;
+    CliRunResult result = libcli_replay_trace(
+        &header,
+        trace,
+        trace_size,
+        microseconds,
+        realtime,
+        userdata,
+        &stats
+    );
+
+    free(trace);
+
+    if (result != cli_run_result_ok) {
+        fail("damaged trace: ", argv[1]);
+    }
+
+    double seconds = (double)stats.elapsed / 1e6;
+    double throughput = (seconds > 0.0) ? ((double)stats.runs / seconds) : 0.0;
+
+    printf("runs: %zu (%zu results differ from the recording)\n", stats.runs, stats.mismatches);
+    printf("elapsed: %.3f s, throughput: %.0f lines/s\n", seconds, throughput);
+    printf("latency (us): min %u, mean %u, p50 %u, p99 %u, max %u\n",
+        (unsigned)stats.min,
+        (unsigned)stats.mean,
+        (unsigned)stats.p50,
+        (unsigned)stats.p99,
+        (unsigned)stats.max
+    );
+
+    return EXIT_SUCCESS;
+}
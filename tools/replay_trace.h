@@ -0,0 +1,17 @@
+#ifndef LIBCLI_REPLAY_TRACE_H
+#define LIBCLI_REPLAY_TRACE_H
+
+//
+// replay_trace
+//
+// The replay tool runs a recorded trace against the commands of an application. The application
+// provides them by implementing this function in a source file given to CMake as
+// `REPLAY_COMMANDS`.
+//
+
+#include "cli.h"
+
+// Add the application's commands to `header`. Returns the userdata passed to every command.
+void* replay_add_commands(CliHeader* header);
+
+#endif // LIBCLI_REPLAY_TRACE_H